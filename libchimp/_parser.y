@@ -11,6 +11,13 @@ void yyerror(const ChimpAstNodeLocation *loc, void *scanner, ChimpRef *filename,
 #define YYDEBUG 1
 #endif
 
+/* our list rules are right-recursive, so long function bodies & literals
+ * run deep. grow the parser stack with alloca: AST nodes on a malloc'd
+ * stack are invisible to the GC & get collected mid-parse.
+ */
+#define YYSTACK_USE_ALLOCA 1
+#define YYMAXDEPTH 100000
+
 %}
 
 %union {
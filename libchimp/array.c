@@ -46,14 +46,9 @@ _chimp_array_real_index (ChimpRef *self, int32_t pos)
 }
 
 static ChimpRef *
-_chimp_array_push (ChimpRef *self, ChimpRef *args)
+_chimp_array_push (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    ChimpRef *arg;
-    if (!chimp_method_parse_args (args, "o", &arg)) {
-        return NULL;
-    }
-    /* TODO error if args len == 0 */
-    if (!chimp_array_push (self, arg)) {
+    if (!chimp_array_push (self, argv[0])) {
         /* XXX error? exception? abort? */
         return NULL;
     }
@@ -61,23 +56,18 @@ _chimp_array_push (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_pop (ChimpRef *self, ChimpRef *args)
+_chimp_array_pop (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    if (!chimp_method_no_args (args)) {
-        return NULL;
-    }
     return chimp_array_pop (self);
 }
 
 static ChimpRef *
-_chimp_array_map (ChimpRef *self, ChimpRef *args)
+_chimp_array_map (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     size_t i;
     ChimpRef *fn;
     ChimpRef *result = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(self));
-    if (!chimp_method_parse_args (args, "o", &fn)) {
-        return NULL;
-    }
+    fn = argv[0];
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
         ChimpRef *fn_args;
         ChimpRef *mapped;
@@ -99,13 +89,11 @@ _chimp_array_map (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_each (ChimpRef *self, ChimpRef *args)
+_chimp_array_each (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     size_t i;
     ChimpRef *fn;
-    if (!chimp_method_parse_args (args, "o", &fn)) {
-        return NULL;
-    }
+    fn = argv[0];
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
         ChimpRef *fn_args;
         ChimpRef *value;
@@ -123,13 +111,11 @@ _chimp_array_each (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_contains (ChimpRef *self, ChimpRef *args)
+_chimp_array_contains (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     size_t i;
     ChimpRef *right;
-    if (!chimp_method_parse_args (args, "o", &right)) {
-        return NULL;
-    }
+    right = argv[0];
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
         ChimpCmpResult r;
         ChimpRef *left = CHIMP_ARRAY_ITEM(self, i);
@@ -146,7 +132,7 @@ _chimp_array_contains (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_any (ChimpRef *self, ChimpRef *args)
+_chimp_array_any (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
 
     ChimpRef *fn;
@@ -155,9 +141,7 @@ _chimp_array_any (ChimpRef *self, ChimpRef *args)
     ChimpRef *fn_args;
     ChimpRef *result;
 
-    if (!chimp_method_parse_args (args, "o", &fn)) {
-        return NULL;
-    }
+    fn = argv[0];
 
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
         item = CHIMP_ARRAY_ITEM(self, i);
@@ -181,15 +165,13 @@ _chimp_array_any (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_filter (ChimpRef *self, ChimpRef *args)
+_chimp_array_filter (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     size_t i;
     ChimpRef *result;
     ChimpRef *fn;
 
-    if (!chimp_method_parse_args (args, "o", &fn)) {
-        return NULL;
-    }
+    fn = argv[0];
 
     result = chimp_array_new ();
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
@@ -277,14 +259,13 @@ chimp_array_str (ChimpRef *self)
 }
 
 static ChimpRef *
-_chimp_array_insert (ChimpRef *self, ChimpRef *args)
+_chimp_array_insert (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int32_t pos;
     ChimpRef *value;
 
-    if (!chimp_method_parse_args (args, "io", &pos, &value)) {
-        return NULL;
-    }
+    pos = (int32_t) CHIMP_INT(argv[0])->value;
+    value = argv[1];
 
     if (!chimp_array_insert (self, pos, value)) {
         return NULL;
@@ -293,17 +274,13 @@ _chimp_array_insert (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_size (ChimpRef *self, ChimpRef *args)
+_chimp_array_size (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    if (!chimp_method_no_args (args)) {
-        return NULL;
-    }
-
     return chimp_int_new (CHIMP_ARRAY_SIZE(self));
 }
 
 static ChimpRef *
-_chimp_array_join (ChimpRef *self, ChimpRef *args)
+_chimp_array_join (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     size_t i;
     size_t len;
@@ -313,9 +290,7 @@ _chimp_array_join (ChimpRef *self, ChimpRef *args)
     char *result;
     char *ptr;
 
-    if (!chimp_method_parse_args (args, "s", &sep)) {
-        return NULL;
-    }
+    sep = CHIMP_STR_DATA(argv[0]);
     seplen = strlen (sep);
 
     strs = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(self));
@@ -386,8 +361,17 @@ _chimp_array_mark (ChimpGC *gc, ChimpRef *self)
 static ChimpCmpResult
 _chimp_array_cmp(ChimpRef *left, ChimpRef *right)
 {
-    size_t lsize = CHIMP_ARRAY_SIZE(left);
-    size_t rsize = CHIMP_ARRAY_SIZE(right);
+    size_t lsize;
+    size_t rsize;
+
+    /* e.g. a pattern test comparing an array with a str literal */
+    if (CHIMP_ANY_CLASS(left) != chimp_array_class ||
+            CHIMP_ANY_CLASS(right) != chimp_array_class) {
+        return CHIMP_CMP_NOT_IMPL;
+    }
+
+    lsize = CHIMP_ARRAY_SIZE(left);
+    rsize = CHIMP_ARRAY_SIZE(right);
 
     if (lsize != rsize)
     {
@@ -453,13 +437,11 @@ _chimp_array_remove_at_internal (ChimpRef *self, size_t index)
 }
 
 static ChimpRef *
-_chimp_array_remove (ChimpRef *self, ChimpRef *args)
+_chimp_array_remove (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     ChimpRef *other;
     size_t i;
-    if (!chimp_method_parse_args (args, "o", &other)) {
-        return NULL;
-    }
+    other = argv[0];
     for (i = 0; i < CHIMP_ARRAY_SIZE(self); i++) {
         int rc = chimp_object_cmp (CHIMP_ARRAY_ITEM(self, i), other);
         if (rc == CHIMP_CMP_EQ) {
@@ -474,13 +456,11 @@ _chimp_array_remove (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_remove_at (ChimpRef *self, ChimpRef *args)
+_chimp_array_remove_at (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     ChimpRef *removed;
     int64_t pos;
-    if (!chimp_method_parse_args (args, "I", &pos)) {
-        return NULL;
-    }
+    pos = CHIMP_INT(argv[0])->value;
     if (pos < 0) {
         pos = CHIMP_ARRAY_SIZE(self) + pos;
     }
@@ -495,14 +475,12 @@ _chimp_array_remove_at (ChimpRef *self, ChimpRef *args)
 
 
 static ChimpRef *
-_chimp_array_slice(ChimpRef *self, ChimpRef *args)
+_chimp_array_slice (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int64_t start;
     int64_t end;
-    if (!chimp_method_parse_args (args, "II", &start, &end)) {
-        CHIMP_BUG("invalid parameters, expecting two numeric values");
-        return NULL;
-    }
+    start = CHIMP_INT(argv[0])->value;
+    end = CHIMP_INT(argv[1])->value;
     // XXX - Better parameter validation?
     // XXX - Negative positioning for slicing
 
@@ -516,24 +494,14 @@ _chimp_array_slice(ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_array_shift (ChimpRef *self, ChimpRef *args)
+_chimp_array_shift (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    if (!chimp_method_no_args (args)) {
-        return NULL;
-    }
-
     return chimp_array_shift (self);
 }
 static ChimpRef *
-_chimp_array_unshift (ChimpRef *self, ChimpRef *args)
+_chimp_array_unshift (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    ChimpRef *arg;
-
-    if (!chimp_method_parse_args (args, "o", &arg)) {
-        return NULL;
-    }
-
-    if (!chimp_array_unshift (self, arg)) {
+    if (!chimp_array_unshift (self, argv[0])) {
         return NULL;
     }
 
@@ -555,21 +523,21 @@ chimp_array_class_bootstrap (void)
     CHIMP_CLASS(chimp_array_class)->cmp = _chimp_array_cmp;
     CHIMP_CLASS(chimp_array_class)->add = _chimp_array_add;
     chimp_gc_make_root (NULL, chimp_array_class);
-    chimp_class_add_native_method (chimp_array_class, "push", _chimp_array_push);
-    chimp_class_add_native_method (chimp_array_class, "pop", _chimp_array_pop);
-    chimp_class_add_native_method (chimp_array_class, "map", _chimp_array_map);
-    chimp_class_add_native_method (chimp_array_class, "shift", _chimp_array_shift);
-    chimp_class_add_native_method (chimp_array_class, "unshift", _chimp_array_unshift);
-    chimp_class_add_native_method (chimp_array_class, "filter", _chimp_array_filter);
-    chimp_class_add_native_method (chimp_array_class, "each", _chimp_array_each);
-    chimp_class_add_native_method (chimp_array_class, "contains", _chimp_array_contains);
-    chimp_class_add_native_method (chimp_array_class, "any", _chimp_array_any);
-    chimp_class_add_native_method (chimp_array_class, "size", _chimp_array_size);
-    chimp_class_add_native_method (chimp_array_class, "join", _chimp_array_join);
-    chimp_class_add_native_method (chimp_array_class, "remove", _chimp_array_remove);
-    chimp_class_add_native_method (chimp_array_class, "remove_at", _chimp_array_remove_at);
-    chimp_class_add_native_method (chimp_array_class, "slice", _chimp_array_slice);
-    chimp_class_add_native_method (chimp_array_class, "insert", _chimp_array_insert);
+    chimp_class_add_native_argv_method (chimp_array_class, "push", "o", _chimp_array_push);
+    chimp_class_add_native_argv_method (chimp_array_class, "pop", "", _chimp_array_pop);
+    chimp_class_add_native_argv_method (chimp_array_class, "map", "o", _chimp_array_map);
+    chimp_class_add_native_argv_method (chimp_array_class, "shift", "", _chimp_array_shift);
+    chimp_class_add_native_argv_method (chimp_array_class, "unshift", "o", _chimp_array_unshift);
+    chimp_class_add_native_argv_method (chimp_array_class, "filter", "o", _chimp_array_filter);
+    chimp_class_add_native_argv_method (chimp_array_class, "each", "o", _chimp_array_each);
+    chimp_class_add_native_argv_method (chimp_array_class, "contains", "o", _chimp_array_contains);
+    chimp_class_add_native_argv_method (chimp_array_class, "any", "o", _chimp_array_any);
+    chimp_class_add_native_argv_method (chimp_array_class, "size", "", _chimp_array_size);
+    chimp_class_add_native_argv_method (chimp_array_class, "join", "s", _chimp_array_join);
+    chimp_class_add_native_argv_method (chimp_array_class, "remove", "o", _chimp_array_remove);
+    chimp_class_add_native_argv_method (chimp_array_class, "remove_at", "I", _chimp_array_remove_at);
+    chimp_class_add_native_argv_method (chimp_array_class, "slice", "II", _chimp_array_slice);
+    chimp_class_add_native_argv_method (chimp_array_class, "insert", "io", _chimp_array_insert);
     return CHIMP_TRUE;
 }
 
@@ -16,6 +16,8 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <sys/mman.h>
+
 #include "chimp/gc.h"
 #include "chimp/object.h"
 #include "chimp/class.h"
@@ -135,7 +137,12 @@ chimp_str_init (ChimpRef *self, ChimpRef *args)
 static void
 chimp_str_dtor (ChimpRef *self)
 {
-    CHIMP_FREE(CHIMP_STR(self)->data);
+    if (CHIMP_STR(self)->mapped > 0) {
+        munmap (CHIMP_STR(self)->data, CHIMP_STR(self)->mapped);
+    }
+    else {
+        CHIMP_FREE(CHIMP_STR(self)->data);
+    }
 }
 
 ChimpRef *
@@ -229,6 +236,25 @@ chimp_class_add_native_method (ChimpRef *self, const char *name, ChimpNativeMeth
     return chimp_class_add_method (self, name_ref, method_ref);
 }
 
+chimp_bool_t
+chimp_class_add_native_argv_method (
+    ChimpRef *self,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc func)
+{
+    ChimpRef *method_ref;
+    ChimpRef *name_ref = chimp_str_new (name, strlen (name));
+    if (name_ref == NULL) {
+        return CHIMP_FALSE;
+    }
+    method_ref = chimp_method_new_native_argv (NULL, name, sig, func);
+    if (method_ref == NULL) {
+        return CHIMP_FALSE;
+    }
+    return chimp_class_add_method (self, name_ref, method_ref);
+}
+
 static void
 chimp_class_dtor (ChimpRef *self)
 {
@@ -21,6 +21,7 @@
 #include "chimp/class.h"
 #include "chimp/array.h"
 #include "chimp/int.h"
+#include "chimp/jit.h"
 
 ChimpRef *chimp_code_class = NULL;
 
@@ -32,8 +33,19 @@ chimp_code_use_label (ChimpRef *self, ChimpLabel *label)
         label->addr = CHIMP_CODE(self)->used;
         label->in_use = CHIMP_TRUE;
         for (i = 0; i < label->patchlist_size; i++) {
-            CHIMP_CODE(self)->bytecode[label->patchlist[i]] |=
-                                            (label->addr & 0xffffff);
+            size_t at = label->patchlist[i];
+            CHIMP_CODE(self)->bytecode[at] |=
+                                (label->addr & CHIMP_INSTR_ARG_MAX);
+            if (label->addr > CHIMP_INSTR_ARG_MAX) {
+                /* CHIMP_JUMP_INSTR reserves a prefix for far jumps */
+                if (at == 0 ||
+                        CHIMP_INSTR_OP(self, at-1) != CHIMP_OPCODE_EXTENDEDARG) {
+                    CHIMP_BUG ("jump target %zu out of range", label->addr);
+                    return;
+                }
+                CHIMP_CODE(self)->bytecode[at-1] |=
+                    (label->addr >> CHIMP_INSTR_ARG_BITS) & CHIMP_INSTR_ARG_MAX;
+            }
         }
         chimp_label_free (label);
     }
@@ -74,6 +86,7 @@ chimp_code_get_jump_addr (ChimpRef *self, ChimpLabel *label, size_t *dest_addr)
 static void
 _chimp_code_dtor (ChimpRef *self)
 {
+    chimp_jit_free (self);
     CHIMP_FREE (CHIMP_CODE(self)->bytecode);
 }
 
@@ -149,34 +162,45 @@ chimp_code_new (void)
 #define CHIMP_CURR_INSTR(co) CHIMP_CODE(co)->bytecode[CHIMP_CODE(co)->used]
 #define CHIMP_NEXT_INSTR(co) CHIMP_CODE(co)->bytecode[CHIMP_CODE(co)->used++]
 
+#define CHIMP_MAKE_INSTR0(op) \
+    (((CHIMP_OPCODE_ ## op) & 0xff) << 24)
+
+/* operands too big for an instruction spill into an EXTENDEDARG prefix */
+#define CHIMP_EMIT_INSTR1(co, op, arg) \
+    do { \
+        size_t _arg = (size_t)(arg); \
+        if (_arg > CHIMP_INSTR_ARG_MAX) { \
+            CHIMP_NEXT_INSTR(co) = CHIMP_MAKE_INSTR0(EXTENDEDARG) | \
+                ((_arg >> CHIMP_INSTR_ARG_BITS) & CHIMP_INSTR_ARG_MAX); \
+        } \
+        CHIMP_NEXT_INSTR(co) = \
+            CHIMP_MAKE_INSTR0(op) | (_arg & CHIMP_INSTR_ARG_MAX); \
+    } while (0)
+
+/* a forward jump emitted this deep into a function may need to land
+ * beyond what an operand can hold, so it gets an empty prefix up front
+ * that chimp_code_use_label can fill in.
+ */
 #define CHIMP_JUMP_INSTR(co, op, label) \
     do { \
         size_t jump_addr; \
+        if (!(label)->in_use && \
+                CHIMP_CODE(co)->used >= CHIMP_INSTR_ARG_MAX / 2) { \
+            CHIMP_NEXT_INSTR(co) = CHIMP_MAKE_INSTR0(EXTENDEDARG); \
+        } \
         if (!chimp_code_get_jump_addr ((co), (label), &jump_addr)) { \
             chimp_label_free (label); \
             return CHIMP_FALSE; \
         } \
-        CHIMP_NEXT_INSTR(co) = \
-            CHIMP_MAKE_INSTR0(op) | (jump_addr & 0xffffff); \
+        CHIMP_EMIT_INSTR1(co, op, jump_addr); \
     } while (0)
 
-#define CHIMP_MAKE_INSTR0(op) \
-    (((CHIMP_OPCODE_ ## op) & 0xff) << 24)
-
-#define CHIMP_MAKE_INSTR1(op, arg1) \
-    ((((CHIMP_OPCODE_ ## op) & 0xff) << 24) | (((arg1) & 0xff) << 16))
-
-#define CHIMP_MAKE_INSTR2(op, arg1, arg2) \
-    ((((CHIMP_OPCODE_ ## op) & 0xff) << 24) | (((arg1) & 0xff) << 16) | (((arg2) & 0xff) << 8))
-
-#define CHIMP_MAKE_INSTR3(op, arg1, arg2, arg3) \
-    ((((CHIMP_OPCODE_ ## op) & 0xff) << 24) | (((arg1) & 0xff) << 16) | (((arg2) & 0xff) << 8) | ((arg3) & 0xff))
-
 static chimp_bool_t
 chimp_code_grow (ChimpRef *self)
 {
     uint32_t *bytecode;
-    if (CHIMP_CODE(self)->used < CHIMP_CODE(self)->allocated) {
+    /* room for an instruction & its prefix */
+    if (CHIMP_CODE(self)->used + 2 <= CHIMP_CODE(self)->allocated) {
         return CHIMP_TRUE;
     }
     bytecode = CHIMP_REALLOC(uint32_t, CHIMP_CODE(self)->bytecode, sizeof(uint32_t) * (CHIMP_CODE(self)->allocated + 32));
@@ -225,7 +249,7 @@ chimp_code_pushconst (ChimpRef *self, ChimpRef *value)
     if (arg < 0) {
         return CHIMP_FALSE;
     }
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(PUSHCONST, arg);
+    CHIMP_EMIT_INSTR1(self, PUSHCONST, arg);
     return CHIMP_TRUE;
 }
 
@@ -240,7 +264,7 @@ chimp_code_pushname (ChimpRef *self, ChimpRef *id)
     if (arg < 0) {
         return CHIMP_FALSE;
     }
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(PUSHNAME, arg);
+    CHIMP_EMIT_INSTR1(self, PUSHNAME, arg);
     return CHIMP_TRUE;
 }
 
@@ -267,7 +291,7 @@ chimp_code_storename (ChimpRef *self, ChimpRef *id)
         return CHIMP_FALSE;
     }
 
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(STORENAME, arg);
+    CHIMP_EMIT_INSTR1(self, STORENAME, arg);
     return CHIMP_TRUE;
 }
 
@@ -297,7 +321,24 @@ chimp_code_getattr (ChimpRef *self, ChimpRef *id)
         return CHIMP_FALSE;
     }
 
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(GETATTR, arg);
+    CHIMP_EMIT_INSTR1(self, GETATTR, arg);
+    return CHIMP_TRUE;
+}
+
+chimp_bool_t
+chimp_code_getmethod (ChimpRef *self, ChimpRef *id)
+{
+    int32_t arg;
+    if (!chimp_code_grow (self)) {
+        return CHIMP_FALSE;
+    }
+
+    arg = chimp_code_add_name (self, id);
+    if (arg < 0) {
+        return CHIMP_FALSE;
+    }
+
+    CHIMP_EMIT_INSTR1(self, GETMETHOD, arg);
     return CHIMP_TRUE;
 }
 
@@ -314,12 +355,22 @@ chimp_code_getitem (ChimpRef *self)
 }
 
 chimp_bool_t
-chimp_code_call (ChimpRef *self, uint8_t nargs)
+chimp_code_call (ChimpRef *self, size_t nargs)
+{
+    if (!chimp_code_grow (self)) {
+        return CHIMP_FALSE;
+    }
+    CHIMP_EMIT_INSTR1(self, CALL, nargs);
+    return CHIMP_TRUE;
+}
+
+chimp_bool_t
+chimp_code_tailcall (ChimpRef *self, size_t nargs)
 {
     if (!chimp_code_grow (self)) {
         return CHIMP_FALSE;
     }
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(CALL, (int32_t)nargs);
+    CHIMP_EMIT_INSTR1(self, TAILCALL, nargs);
     return CHIMP_TRUE;
 }
 
@@ -364,23 +415,23 @@ chimp_code_dup (ChimpRef *self)
 }
 
 chimp_bool_t
-chimp_code_makearray (ChimpRef *self, uint8_t nargs)
+chimp_code_makearray (ChimpRef *self, size_t nargs)
 {
     if (!chimp_code_grow (self)) {
         return CHIMP_FALSE;
     }
     /* XXX this cast should happen automatically in the make_instr macro */
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(MAKEARRAY, (int32_t)nargs);
+    CHIMP_EMIT_INSTR1(self, MAKEARRAY, nargs);
     return CHIMP_TRUE;
 }
 
 chimp_bool_t
-chimp_code_makehash (ChimpRef *self, uint8_t nargs)
+chimp_code_makehash (ChimpRef *self, size_t nargs)
 {
     if (!chimp_code_grow (self)) {
         return CHIMP_FALSE;
     }
-    CHIMP_NEXT_INSTR(self) = CHIMP_MAKE_INSTR1(MAKEHASH, (int32_t)nargs);
+    CHIMP_EMIT_INSTR1(self, MAKEHASH, nargs);
     return CHIMP_TRUE;
 }
 
@@ -445,6 +496,25 @@ chimp_code_jump (ChimpRef *self, ChimpLabel *label)
     return CHIMP_TRUE;
 }
 
+chimp_bool_t
+chimp_code_switch (ChimpRef *self, ChimpRef *table)
+{
+    if (!chimp_code_grow (self)) {
+        return CHIMP_FALSE;
+    }
+
+    /* skip chimp_code_add_const: two tables can look equal while they're
+     * still being filled in.
+     */
+    if (!chimp_array_push (CHIMP_CODE(self)->constants, table)) {
+        return CHIMP_FALSE;
+    }
+
+    CHIMP_EMIT_INSTR1(self, SWITCH,
+        CHIMP_ARRAY_SIZE(CHIMP_CODE(self)->constants) - 1);
+    return CHIMP_TRUE;
+}
+
 chimp_bool_t
 chimp_code_eq (ChimpRef *self)
 {
@@ -566,6 +636,49 @@ chimp_code_pop (ChimpRef *self)
     return CHIMP_TRUE;
 }
 
+int
+chimp_code_reg_for_var (ChimpRef *self, ChimpRef *id)
+{
+    int32_t n = chimp_array_find (CHIMP_CODE(self)->vars, id);
+    if (n < 0 || n >= CHIMP_REG_CONST) {
+        return CHIMP_REG_STACK;
+    }
+    return n;
+}
+
+int
+chimp_code_reg_for_const (ChimpRef *self, ChimpRef *value)
+{
+    int32_t n = chimp_code_add_const (self, value);
+    if (n < 0 || n >= CHIMP_REG_STACK - CHIMP_REG_CONST) {
+        return CHIMP_REG_STACK;
+    }
+    return CHIMP_REG_CONST + n;
+}
+
+chimp_bool_t
+chimp_code_move (ChimpRef *self, int dst, int src)
+{
+    return chimp_code_regop (self, CHIMP_OPCODE_MOVE, dst, src, 0);
+}
+
+chimp_bool_t
+chimp_code_regop (ChimpRef *self, ChimpOpcode op, int dst, int left, int right)
+{
+    if (dst >= CHIMP_REG_CONST && dst != CHIMP_REG_STACK) {
+        CHIMP_BUG ("cannot store to a constant");
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_grow (self)) {
+        return CHIMP_FALSE;
+    }
+
+    CHIMP_NEXT_INSTR(self) = ((op & 0xff) << 24) |
+        ((dst & 0xff) << 16) | ((left & 0xff) << 8) | (right & 0xff);
+    return CHIMP_TRUE;
+}
+
 static const char *
 chimp_code_opcode_str (ChimpOpcode op)
 {
@@ -586,10 +699,16 @@ chimp_code_opcode_str (ChimpOpcode op)
              return "PUSHNIL";
         case CHIMP_OPCODE_GETATTR:
              return "GETATTR";
+        case CHIMP_OPCODE_GETMETHOD:
+             return "GETMETHOD";
+        case CHIMP_OPCODE_SWITCH:
+             return "SWITCH";
         case CHIMP_OPCODE_GETITEM:
              return "GETITEM";
         case CHIMP_OPCODE_CALL:
              return "CALL";
+        case CHIMP_OPCODE_TAILCALL:
+             return "TAILCALL";
         case CHIMP_OPCODE_MAKEARRAY:
              return "MAKEARRAY";
         case CHIMP_OPCODE_MAKEHASH:
@@ -628,11 +747,56 @@ chimp_code_opcode_str (ChimpOpcode op)
              return "GETCLASS";
         case CHIMP_OPCODE_MAKECLOSURE:
              return "MAKECLOSURE";
+        case CHIMP_OPCODE_EXTENDEDARG:
+            return "EXTENDEDARG";
+        case CHIMP_OPCODE_MOVE:
+            return "MOVE";
+        case CHIMP_OPCODE_ADDR:
+            return "ADD_R";
+        case CHIMP_OPCODE_SUBR:
+            return "SUB_R";
+        case CHIMP_OPCODE_MULR:
+            return "MUL_R";
+        case CHIMP_OPCODE_DIVR:
+            return "DIV_R";
+        case CHIMP_OPCODE_CMPEQR:
+            return "CMP_EQ_R";
+        case CHIMP_OPCODE_CMPNEQR:
+            return "CMP_NEQ_R";
+        case CHIMP_OPCODE_CMPGTR:
+            return "CMP_GT_R";
+        case CHIMP_OPCODE_CMPGTER:
+            return "CMP_GTE_R";
+        case CHIMP_OPCODE_CMPLTR:
+            return "CMP_LT_R";
+        case CHIMP_OPCODE_CMPLTER:
+            return "CMP_LTE_R";
         default:
              return "???OPCODE???";
     };
 }
 
+static chimp_bool_t
+chimp_code_dump_reg (ChimpRef *str, ChimpRef *self, int reg)
+{
+    if (!chimp_str_append_str (str, " ")) {
+        return CHIMP_FALSE;
+    }
+    if (reg == CHIMP_REG_STACK) {
+        return chimp_str_append_str (str, "<stack>");
+    }
+    else if (reg >= CHIMP_REG_CONST) {
+        return chimp_str_append (str,
+            CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(self), reg - CHIMP_REG_CONST));
+    }
+    else {
+        if (!chimp_str_append_str (str, "$")) {
+            return CHIMP_FALSE;
+        }
+        return chimp_str_append (str, CHIMP_ARRAY_ITEM(CHIMP_CODE(self)->vars, reg));
+    }
+}
+
 ChimpRef *
 chimp_code_dump (ChimpRef *self)
 {
@@ -653,27 +817,29 @@ chimp_code_dump (ChimpRef *self)
         if (!chimp_str_append_str (str, op_str)) {
             return NULL;
         }
-        if (op == CHIMP_OPCODE_PUSHNAME || op == CHIMP_OPCODE_STORENAME || op == CHIMP_OPCODE_GETATTR) {
+        if (op == CHIMP_OPCODE_PUSHNAME || op == CHIMP_OPCODE_STORENAME ||
+                op == CHIMP_OPCODE_GETATTR || op == CHIMP_OPCODE_GETMETHOD) {
             if (!chimp_str_append_str (str, " ")) {
                 return NULL;
             }
-            if (!chimp_str_append (str, CHIMP_INSTR_NAME1(self, i))) {
+            if (!chimp_str_append (str, CHIMP_INSTR_NAME(self, i))) {
                 return NULL;
             }
         }
-        else if (op == CHIMP_OPCODE_PUSHCONST) {
+        else if (op == CHIMP_OPCODE_PUSHCONST || op == CHIMP_OPCODE_SWITCH) {
             if (!chimp_str_append_str (str, " ")) {
                 return NULL;
             }
-            if (!chimp_str_append (str, CHIMP_INSTR_CONST1(self, i))) {
+            if (!chimp_str_append (str, CHIMP_INSTR_CONST(self, i))) {
                 return NULL;
             }
         }
-        else if (op == CHIMP_OPCODE_MAKEARRAY || op == CHIMP_OPCODE_MAKEHASH || op == CHIMP_OPCODE_CALL) {
+        else if (op == CHIMP_OPCODE_MAKEARRAY || op == CHIMP_OPCODE_MAKEHASH ||
+                op == CHIMP_OPCODE_CALL || op == CHIMP_OPCODE_TAILCALL) {
             if (!chimp_str_append_str (str, " ")) {
                 return NULL;
             }
-            if (!chimp_str_append (str, chimp_int_new (CHIMP_INSTR_ARG1(self, i)))) {
+            if (!chimp_str_append (str, chimp_int_new (CHIMP_INSTR_OPERAND(self, i)))) {
                 return NULL;
             }
         }
@@ -681,7 +847,19 @@ chimp_code_dump (ChimpRef *self)
             if (!chimp_str_append_str (str, " ")) {
                 return NULL;
             }
-            if (!chimp_str_append (str, chimp_int_new ((instr & 0xffffff)))) {
+            if (!chimp_str_append (str, chimp_int_new (CHIMP_INSTR_ADDR(self, i)))) {
+                return NULL;
+            }
+        }
+        else if (op >= CHIMP_OPCODE_MOVE && op <= CHIMP_OPCODE_CMPLTER) {
+            if (!chimp_code_dump_reg (str, self, CHIMP_INSTR_REG_DST(self, i))) {
+                return NULL;
+            }
+            if (!chimp_code_dump_reg (str, self, CHIMP_INSTR_REG_LEFT(self, i))) {
+                return NULL;
+            }
+            if (op != CHIMP_OPCODE_MOVE &&
+                    !chimp_code_dump_reg (str, self, CHIMP_INSTR_REG_RIGHT(self, i))) {
                 return NULL;
             }
         }
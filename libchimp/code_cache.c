@@ -0,0 +1,1179 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "chimp/code_cache.h"
+#include "chimp/object.h"
+#include "chimp/array.h"
+#include "chimp/hash.h"
+#include "chimp/lwhash.h"
+#include "chimp/str.h"
+#include "chimp/int.h"
+#include "chimp/float.h"
+#include "chimp/class.h"
+#include "chimp/code.h"
+#include "chimp/method.h"
+#include "chimp/module.h"
+#include "chimp/module_mgr.h"
+
+/*
+ * A .chimpc file is a fixed header followed by the module's locals:
+ *
+ *   header   magic, version, source mtime/size/hash, payload hash
+ *   str      the module name
+ *   u32      number of locals, then for each: str name, u8 kind, payload
+ *
+ * Everything is in host byte order: caches aren't meant to be portable.
+ * The payload (everything after the header) is hashed so that a corrupt
+ * cache is noticed before we start decoding it.
+ * Locals are written uses first & classes last (bases before subclasses)
+ * so the loader can rebuild them in a single pass.
+ */
+
+#define CHIMP_CODE_CACHE_MAGIC "chimpc\0\0"
+
+typedef struct _ChimpCodeCacheHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint64_t size;
+    uint64_t hash;
+    uint64_t payload_hash;
+} ChimpCodeCacheHeader;
+
+typedef enum _ChimpCodeCacheLocal {
+    CHIMP_CODE_CACHE_LOCAL_USE,
+    CHIMP_CODE_CACHE_LOCAL_METHOD,
+    CHIMP_CODE_CACHE_LOCAL_CLASS,
+    CHIMP_CODE_CACHE_LOCAL_NIL
+} ChimpCodeCacheLocal;
+
+typedef enum _ChimpCodeCacheConst {
+    CHIMP_CODE_CACHE_CONST_NIL,
+    CHIMP_CODE_CACHE_CONST_TRUE,
+    CHIMP_CODE_CACHE_CONST_FALSE,
+    CHIMP_CODE_CACHE_CONST_INT,
+    CHIMP_CODE_CACHE_CONST_FLOAT,
+    CHIMP_CODE_CACHE_CONST_STR,
+    CHIMP_CODE_CACHE_CONST_METHOD,
+    CHIMP_CODE_CACHE_CONST_NIL_CLASS,
+    CHIMP_CODE_CACHE_CONST_FILENAME,    /* __file__ */
+    CHIMP_CODE_CACHE_CONST_HASH         /* a SWITCH table */
+} ChimpCodeCacheConst;
+
+/* how a class's base is found again at load time */
+typedef enum _ChimpCodeCacheBase {
+    CHIMP_CODE_CACHE_BASE_OBJECT,
+    CHIMP_CODE_CACHE_BASE_BUILTIN,  /* name in chimp_builtins */
+    CHIMP_CODE_CACHE_BASE_LOCAL,    /* name in this module */
+    CHIMP_CODE_CACHE_BASE_IMPORT    /* module name, name in that module */
+} ChimpCodeCacheBase;
+
+static char *
+chimp_code_cache_path (const char *filename)
+{
+    size_t len = strlen (filename);
+    char *path = CHIMP_MALLOC(char, len + sizeof(CHIMP_CODE_CACHE_SUFFIX));
+    if (path == NULL) {
+        return NULL;
+    }
+    memcpy (path, filename, len);
+    memcpy (path + len, CHIMP_CODE_CACHE_SUFFIX, sizeof(CHIMP_CODE_CACHE_SUFFIX));
+    return path;
+}
+
+/* FNV-1a */
+static uint64_t
+chimp_code_cache_hash (const char *data, size_t size)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        hash ^= (unsigned char) data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static chimp_bool_t
+chimp_code_cache_hash_file (const char *filename, uint64_t size, uint64_t *hash)
+{
+    char *data;
+    int fd;
+
+    if (size == 0) {
+        *hash = chimp_code_cache_hash ("", 0);
+        return CHIMP_TRUE;
+    }
+    fd = open (filename, O_RDONLY);
+    if (fd < 0) {
+        return CHIMP_FALSE;
+    }
+    data = mmap (NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+        return CHIMP_FALSE;
+    }
+    *hash = chimp_code_cache_hash (data, size);
+    munmap (data, size);
+    return CHIMP_TRUE;
+}
+
+/*
+ * writing
+ */
+
+typedef struct _ChimpCodeCacheWriter {
+    char       *data;
+    size_t      size;
+    size_t      capacity;
+    ChimpRef   *module;
+    const char *filename;
+} ChimpCodeCacheWriter;
+
+static chimp_bool_t
+chimp_code_cache_put (ChimpCodeCacheWriter *w, const void *data, size_t size)
+{
+    if (w->size + size > w->capacity) {
+        size_t capacity = w->capacity > 0 ? w->capacity : 4096;
+        char *newdata;
+        while (capacity < w->size + size) {
+            capacity *= 2;
+        }
+        newdata = CHIMP_REALLOC(char, w->data, capacity);
+        if (newdata == NULL) {
+            return CHIMP_FALSE;
+        }
+        w->data = newdata;
+        w->capacity = capacity;
+    }
+    memcpy (w->data + w->size, data, size);
+    w->size += size;
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_code_cache_put_u8 (ChimpCodeCacheWriter *w, uint8_t value)
+{
+    return chimp_code_cache_put (w, &value, sizeof(value));
+}
+
+static chimp_bool_t
+chimp_code_cache_put_u32 (ChimpCodeCacheWriter *w, uint32_t value)
+{
+    return chimp_code_cache_put (w, &value, sizeof(value));
+}
+
+static chimp_bool_t
+chimp_code_cache_put_data (
+    ChimpCodeCacheWriter *w, const char *data, size_t size)
+{
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) size)) {
+        return CHIMP_FALSE;
+    }
+    return chimp_code_cache_put (w, data, size);
+}
+
+static chimp_bool_t
+chimp_code_cache_put_str (ChimpCodeCacheWriter *w, ChimpRef *str)
+{
+    if (CHIMP_ANY_CLASS(str) != chimp_str_class) {
+        fprintf (stderr, "%s: expected a str, got a %s\n",
+            w->filename, CHIMP_STR_DATA(CHIMP_CLASS(CHIMP_ANY_CLASS(str))->name));
+        return CHIMP_FALSE;
+    }
+    return chimp_code_cache_put_data (w, CHIMP_STR_DATA(str), CHIMP_STR_SIZE(str));
+}
+
+static chimp_bool_t
+chimp_code_cache_put_strs (ChimpCodeCacheWriter *w, ChimpRef *array)
+{
+    size_t i;
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) CHIMP_ARRAY_SIZE(array))) {
+        return CHIMP_FALSE;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(array); i++) {
+        if (!chimp_code_cache_put_str (w, CHIMP_ARRAY_ITEM(array, i))) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_code_cache_put_code (ChimpCodeCacheWriter *w, ChimpRef *code);
+
+static chimp_bool_t
+chimp_code_cache_put_method (ChimpCodeCacheWriter *w, ChimpRef *method)
+{
+    if (CHIMP_METHOD_TYPE(method) != CHIMP_METHOD_TYPE_BYTECODE ||
+            CHIMP_METHOD(method)->module != w->module) {
+        fprintf (stderr, "%s: cannot cache a method from another module\n",
+            w->filename);
+        return CHIMP_FALSE;
+    }
+    return chimp_code_cache_put_code (w, CHIMP_METHOD(method)->bytecode.code);
+}
+
+static chimp_bool_t
+chimp_code_cache_put_const (ChimpCodeCacheWriter *w, ChimpRef *value)
+{
+    ChimpRef *klass = CHIMP_ANY_CLASS(value);
+
+    if (value == chimp_nil) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_NIL);
+    }
+    else if (value == chimp_true) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_TRUE);
+    }
+    else if (value == chimp_false) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_FALSE);
+    }
+    else if (value == chimp_nil_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_NIL_CLASS);
+    }
+    else if (klass == chimp_int_class) {
+        int64_t i = CHIMP_INT(value)->value;
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_INT) &&
+               chimp_code_cache_put (w, &i, sizeof(i));
+    }
+    else if (klass == chimp_float_class) {
+        double f = CHIMP_FLOAT(value)->value;
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_FLOAT) &&
+               chimp_code_cache_put (w, &f, sizeof(f));
+    }
+    else if (klass == chimp_str_class) {
+        /* the same module may be loaded via a different path later */
+        if (strcmp (CHIMP_STR_DATA(value), w->filename) == 0) {
+            return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_FILENAME);
+        }
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_STR) &&
+               chimp_code_cache_put_str (w, value);
+    }
+    else if (klass == chimp_method_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_METHOD) &&
+               chimp_code_cache_put_method (w, value);
+    }
+    else if (klass == chimp_hash_class) {
+        size_t i;
+        if (!chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_CONST_HASH) ||
+                !chimp_code_cache_put_u32 (w, (uint32_t) CHIMP_HASH_SIZE(value))) {
+            return CHIMP_FALSE;
+        }
+        for (i = 0; i < CHIMP_HASH_SIZE(value); i++) {
+            if (!chimp_code_cache_put_const (w, CHIMP_HASH(value)->keys[i]) ||
+                    !chimp_code_cache_put_const (w, CHIMP_HASH(value)->values[i])) {
+                return CHIMP_FALSE;
+            }
+        }
+        return CHIMP_TRUE;
+    }
+    else {
+        fprintf (stderr, "%s: cannot cache a constant of type %s\n",
+            w->filename, CHIMP_STR_DATA(CHIMP_CLASS(klass)->name));
+        return CHIMP_FALSE;
+    }
+}
+
+static chimp_bool_t
+chimp_code_cache_put_code (ChimpCodeCacheWriter *w, ChimpRef *code)
+{
+    ChimpRef *constants = CHIMP_CODE(code)->constants;
+    size_t i;
+
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) CHIMP_ARRAY_SIZE(constants))) {
+        return CHIMP_FALSE;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(constants); i++) {
+        if (!chimp_code_cache_put_const (w, CHIMP_ARRAY_ITEM(constants, i))) {
+            return CHIMP_FALSE;
+        }
+    }
+    if (!chimp_code_cache_put_strs (w, CHIMP_CODE(code)->names)) {
+        return CHIMP_FALSE;
+    }
+    if (!chimp_code_cache_put_strs (w, CHIMP_CODE(code)->vars)) {
+        return CHIMP_FALSE;
+    }
+    if (!chimp_code_cache_put_strs (w, CHIMP_CODE(code)->freevars)) {
+        return CHIMP_FALSE;
+    }
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) CHIMP_CODE(code)->used)) {
+        return CHIMP_FALSE;
+    }
+    return chimp_code_cache_put (w,
+        CHIMP_CODE(code)->bytecode, sizeof(uint32_t) * CHIMP_CODE(code)->used);
+}
+
+typedef struct _ChimpCodeCacheMethods {
+    ChimpCodeCacheWriter *w;
+    ChimpRef             *names;
+    ChimpRef             *methods;
+    chimp_bool_t          ok;
+} ChimpCodeCacheMethods;
+
+static void
+chimp_code_cache_collect_method (
+    ChimpLWHash *hash, ChimpRef *name, ChimpRef *method, void *arg)
+{
+    ChimpCodeCacheMethods *m = (ChimpCodeCacheMethods *) arg;
+    if (!chimp_array_push (m->names, name) ||
+            !chimp_array_push (m->methods, method)) {
+        m->ok = CHIMP_FALSE;
+    }
+}
+
+/* finds a name for klass's base the loader can resolve */
+static chimp_bool_t
+chimp_code_cache_put_base (ChimpCodeCacheWriter *w, ChimpRef *klass)
+{
+    ChimpRef *base = CHIMP_CLASS(klass)->super;
+    ChimpRef *locals = CHIMP_MODULE_LOCALS(w->module);
+    size_t i;
+    size_t j;
+
+    if (base == chimp_object_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_BASE_OBJECT);
+    }
+    for (i = 0; i < CHIMP_HASH_SIZE(chimp_builtins); i++) {
+        if (CHIMP_HASH(chimp_builtins)->values[i] == base) {
+            return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_BASE_BUILTIN) &&
+                   chimp_code_cache_put_str (w,
+                       CHIMP_HASH(chimp_builtins)->keys[i]);
+        }
+    }
+    for (i = 0; i < CHIMP_HASH_SIZE(locals); i++) {
+        ChimpRef *value = CHIMP_HASH(locals)->values[i];
+        if (value == base) {
+            return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_BASE_LOCAL) &&
+                   chimp_code_cache_put_str (w, CHIMP_HASH(locals)->keys[i]);
+        }
+        if (CHIMP_ANY_CLASS(value) != chimp_module_class) {
+            continue;
+        }
+        for (j = 0; j < CHIMP_HASH_SIZE(CHIMP_MODULE_LOCALS(value)); j++) {
+            ChimpRef *imported = CHIMP_MODULE_LOCALS(value);
+            if (CHIMP_HASH(imported)->values[j] == base) {
+                return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_BASE_IMPORT) &&
+                       chimp_code_cache_put_str (w, CHIMP_HASH(locals)->keys[i]) &&
+                       chimp_code_cache_put_str (w, CHIMP_HASH(imported)->keys[j]);
+            }
+        }
+    }
+    fprintf (stderr, "%s: cannot find the base class of %s\n",
+        w->filename, CHIMP_STR_DATA(CHIMP_CLASS(klass)->name));
+    return CHIMP_FALSE;
+}
+
+static chimp_bool_t
+chimp_code_cache_put_class (ChimpCodeCacheWriter *w, ChimpRef *klass)
+{
+    ChimpCodeCacheMethods m;
+    size_t i;
+
+    m.w = w;
+    m.ok = CHIMP_TRUE;
+    m.names = chimp_array_new ();
+    m.methods = chimp_array_new ();
+    if (m.names == NULL || m.methods == NULL) {
+        return CHIMP_FALSE;
+    }
+    chimp_lwhash_foreach (
+        CHIMP_CLASS(klass)->methods, chimp_code_cache_collect_method, &m);
+    if (!m.ok) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_cache_put_base (w, klass)) {
+        return CHIMP_FALSE;
+    }
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) CHIMP_ARRAY_SIZE(m.names))) {
+        return CHIMP_FALSE;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(m.names); i++) {
+        if (!chimp_code_cache_put_str (w, CHIMP_ARRAY_ITEM(m.names, i))) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_code_cache_put_method (w, CHIMP_ARRAY_ITEM(m.methods, i))) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_code_cache_put_local (
+    ChimpCodeCacheWriter *w, ChimpRef *name, ChimpRef *value)
+{
+    ChimpRef *klass = CHIMP_ANY_CLASS(value);
+
+    if (!chimp_code_cache_put_str (w, name)) {
+        return CHIMP_FALSE;
+    }
+    if (klass == chimp_module_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_LOCAL_USE);
+    }
+    else if (klass == chimp_method_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_LOCAL_METHOD) &&
+               chimp_code_cache_put_method (w, value);
+    }
+    else if (klass == chimp_class_class) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_LOCAL_CLASS) &&
+               chimp_code_cache_put_class (w, value);
+    }
+    else if (value == chimp_nil) {
+        return chimp_code_cache_put_u8 (w, CHIMP_CODE_CACHE_LOCAL_NIL);
+    }
+    else {
+        fprintf (stderr, "%s: cannot cache module-level %s of type %s\n",
+            w->filename, CHIMP_STR_DATA(name),
+            CHIMP_STR_DATA(CHIMP_CLASS(klass)->name));
+        return CHIMP_FALSE;
+    }
+}
+
+/* true if klass derives from a class in this module that isn't written */
+static chimp_bool_t
+chimp_code_cache_base_pending (
+    ChimpRef *locals, ChimpRef *klass, const char *written)
+{
+    size_t i;
+    for (i = 0; i < CHIMP_HASH_SIZE(locals); i++) {
+        if (CHIMP_HASH(locals)->values[i] == CHIMP_CLASS(klass)->super) {
+            return !written[i];
+        }
+    }
+    return CHIMP_FALSE;
+}
+
+static chimp_bool_t
+chimp_code_cache_put_locals (ChimpCodeCacheWriter *w)
+{
+    ChimpRef *locals = CHIMP_MODULE_LOCALS(w->module);
+    size_t n = CHIMP_HASH_SIZE(locals);
+    size_t done = 0;
+    size_t pass;
+    size_t i;
+    char *written;
+
+    if (!chimp_code_cache_put_u32 (w, (uint32_t) n)) {
+        return CHIMP_FALSE;
+    }
+    written = CHIMP_MALLOC(char, n > 0 ? n : 1);
+    if (written == NULL) {
+        return CHIMP_FALSE;
+    }
+    memset (written, 0, n);
+
+    /* uses, then methods & vars, then classes after their bases */
+    for (pass = 0; done < n; pass++) {
+        size_t before = done;
+        for (i = 0; i < n; i++) {
+            ChimpRef *value = CHIMP_HASH(locals)->values[i];
+            ChimpRef *klass = CHIMP_ANY_CLASS(value);
+            if (written[i]) {
+                continue;
+            }
+            if (pass == 0 && klass != chimp_module_class) {
+                continue;
+            }
+            if (pass > 0 && klass == chimp_class_class &&
+                    (pass == 1 ||
+                     chimp_code_cache_base_pending (locals, value, written))) {
+                continue;
+            }
+            if (!chimp_code_cache_put_local (
+                    w, CHIMP_HASH(locals)->keys[i], value)) {
+                CHIMP_FREE (written);
+                return CHIMP_FALSE;
+            }
+            written[i] = 1;
+            done++;
+        }
+        if (pass > 1 && done == before) {
+            fprintf (stderr, "%s: circular class hierarchy\n", w->filename);
+            CHIMP_FREE (written);
+            return CHIMP_FALSE;
+        }
+    }
+    CHIMP_FREE (written);
+    return CHIMP_TRUE;
+}
+
+chimp_bool_t
+chimp_code_cache_write (ChimpRef *module, const char *filename)
+{
+    ChimpCodeCacheWriter w;
+    ChimpCodeCacheHeader header;
+    struct stat st;
+    char *path;
+    char *tmp;
+    size_t off;
+    int fd;
+
+    if (stat (filename, &st) != 0) {
+        fprintf (stderr, "%s: %s\n", filename, strerror (errno));
+        return CHIMP_FALSE;
+    }
+
+    memset (&header, 0, sizeof(header));
+    memcpy (header.magic, CHIMP_CODE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CHIMP_CODE_CACHE_VERSION;
+    header.mtime_sec = (int64_t) st.st_mtim.tv_sec;
+    header.mtime_nsec = (int64_t) st.st_mtim.tv_nsec;
+    header.size = (uint64_t) st.st_size;
+    if (!chimp_code_cache_hash_file (filename, header.size, &header.hash)) {
+        fprintf (stderr, "%s: %s\n", filename, strerror (errno));
+        return CHIMP_FALSE;
+    }
+
+    memset (&w, 0, sizeof(w));
+    w.module = module;
+    w.filename = filename;
+    if (!chimp_code_cache_put (&w, &header, sizeof(header)) ||
+        !chimp_code_cache_put_str (&w, CHIMP_MODULE_NAME(module)) ||
+        !chimp_code_cache_put_locals (&w)) {
+        CHIMP_FREE (w.data);
+        return CHIMP_FALSE;
+    }
+    header.payload_hash = chimp_code_cache_hash (
+        w.data + sizeof(header), w.size - sizeof(header));
+    memcpy (w.data + offsetof(ChimpCodeCacheHeader, payload_hash),
+        &header.payload_hash, sizeof(header.payload_hash));
+
+    /* write to a temp file & rename so readers never see half a cache */
+    path = chimp_code_cache_path (filename);
+    tmp = path != NULL ? CHIMP_MALLOC(char, strlen (path) + 32) : NULL;
+    if (tmp == NULL) {
+        CHIMP_FREE (path);
+        CHIMP_FREE (w.data);
+        return CHIMP_FALSE;
+    }
+    sprintf (tmp, "%s.%ld.tmp", path, (long) getpid ());
+    fd = open (tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        goto error;
+    }
+    for (off = 0; off < w.size; ) {
+        ssize_t n = write (fd, w.data + off, w.size - off);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            close (fd);
+            unlink (tmp);
+            goto error;
+        }
+        off += (size_t) n;
+    }
+    if (close (fd) != 0 || rename (tmp, path) != 0) {
+        unlink (tmp);
+        goto error;
+    }
+    CHIMP_FREE (tmp);
+    CHIMP_FREE (path);
+    CHIMP_FREE (w.data);
+    return CHIMP_TRUE;
+
+error:
+    fprintf (stderr, "%s: %s\n", path, strerror (errno));
+    CHIMP_FREE (tmp);
+    CHIMP_FREE (path);
+    CHIMP_FREE (w.data);
+    return CHIMP_FALSE;
+}
+
+/*
+ * loading
+ *
+ * a truncated or corrupt cache just makes the load fail, & the caller
+ * falls back to compiling from source.
+ */
+
+typedef struct _ChimpCodeCacheReader {
+    const char *p;
+    const char *end;
+    ChimpRef   *module;
+    ChimpRef   *filename;
+} ChimpCodeCacheReader;
+
+static chimp_bool_t
+chimp_code_cache_get (ChimpCodeCacheReader *r, void *data, size_t size)
+{
+    if ((size_t)(r->end - r->p) < size) {
+        return CHIMP_FALSE;
+    }
+    memcpy (data, r->p, size);
+    r->p += size;
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_code_cache_get_u8 (ChimpCodeCacheReader *r, uint8_t *value)
+{
+    return chimp_code_cache_get (r, value, sizeof(*value));
+}
+
+static chimp_bool_t
+chimp_code_cache_get_u32 (ChimpCodeCacheReader *r, uint32_t *value)
+{
+    return chimp_code_cache_get (r, value, sizeof(*value));
+}
+
+static ChimpRef *
+chimp_code_cache_get_str (ChimpCodeCacheReader *r)
+{
+    uint32_t size;
+    ChimpRef *str;
+    if (!chimp_code_cache_get_u32 (r, &size)) {
+        return NULL;
+    }
+    if ((size_t)(r->end - r->p) < size) {
+        return NULL;
+    }
+    str = chimp_str_new (r->p, size);
+    r->p += size;
+    return str;
+}
+
+static ChimpRef *
+chimp_code_cache_get_strs (ChimpCodeCacheReader *r)
+{
+    uint32_t n;
+    uint32_t i;
+    ChimpRef *array;
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return NULL;
+    }
+    array = chimp_array_new_with_capacity (n);
+    if (array == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *str = chimp_code_cache_get_str (r);
+        if (str == NULL || !chimp_array_push (array, str)) {
+            return NULL;
+        }
+    }
+    return array;
+}
+
+static ChimpRef *
+chimp_code_cache_get_code (ChimpCodeCacheReader *r);
+
+static ChimpRef *
+chimp_code_cache_get_method (ChimpCodeCacheReader *r)
+{
+    ChimpRef *code = chimp_code_cache_get_code (r);
+    if (code == NULL) {
+        return NULL;
+    }
+    return chimp_method_new_bytecode (r->module, code);
+}
+
+static ChimpRef *
+chimp_code_cache_get_const (ChimpCodeCacheReader *r);
+
+static ChimpRef *
+chimp_code_cache_get_hash (ChimpCodeCacheReader *r)
+{
+    ChimpRef *hash;
+    uint32_t n;
+    uint32_t i;
+
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return NULL;
+    }
+    hash = chimp_hash_new ();
+    if (hash == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *key;
+        ChimpRef *value;
+        if ((key = chimp_code_cache_get_const (r)) == NULL) {
+            return NULL;
+        }
+        if ((value = chimp_code_cache_get_const (r)) == NULL) {
+            return NULL;
+        }
+        if (!chimp_hash_put (hash, key, value)) {
+            return NULL;
+        }
+    }
+    return hash;
+}
+
+static ChimpRef *
+chimp_code_cache_get_const (ChimpCodeCacheReader *r)
+{
+    uint8_t tag;
+    if (!chimp_code_cache_get_u8 (r, &tag)) {
+        return NULL;
+    }
+    switch (tag) {
+        case CHIMP_CODE_CACHE_CONST_NIL:
+            return chimp_nil;
+        case CHIMP_CODE_CACHE_CONST_TRUE:
+            return chimp_true;
+        case CHIMP_CODE_CACHE_CONST_FALSE:
+            return chimp_false;
+        case CHIMP_CODE_CACHE_CONST_NIL_CLASS:
+            return chimp_nil_class;
+        case CHIMP_CODE_CACHE_CONST_INT:
+            {
+                int64_t i;
+                if (!chimp_code_cache_get (r, &i, sizeof(i))) {
+                    return NULL;
+                }
+                return chimp_int_new (i);
+            }
+        case CHIMP_CODE_CACHE_CONST_FLOAT:
+            {
+                double f;
+                if (!chimp_code_cache_get (r, &f, sizeof(f))) {
+                    return NULL;
+                }
+                return chimp_float_new (f);
+            }
+        case CHIMP_CODE_CACHE_CONST_STR:
+            return chimp_code_cache_get_str (r);
+        case CHIMP_CODE_CACHE_CONST_FILENAME:
+            return r->filename;
+        case CHIMP_CODE_CACHE_CONST_METHOD:
+            return chimp_code_cache_get_method (r);
+        case CHIMP_CODE_CACHE_CONST_HASH:
+            return chimp_code_cache_get_hash (r);
+        default:
+            return NULL;
+    }
+}
+
+/* a register operand names a var, a constant or the stack */
+static chimp_bool_t
+chimp_code_cache_check_reg (ChimpRef *code, uint32_t reg)
+{
+    if (reg < CHIMP_REG_CONST) {
+        return reg < CHIMP_ARRAY_SIZE(CHIMP_CODE(code)->vars);
+    }
+    else if (reg != CHIMP_REG_STACK) {
+        return reg - CHIMP_REG_CONST < CHIMP_ARRAY_SIZE(CHIMP_CODE(code)->constants);
+    }
+    return CHIMP_TRUE;
+}
+
+/* true if every operand in code refers to something that exists: the VM
+ * trusts the compiler, so it never checks these itself.
+ */
+static chimp_bool_t
+chimp_code_cache_check_code (ChimpRef *code)
+{
+    size_t used = CHIMP_CODE_SIZE(code);
+    size_t i;
+
+    for (i = 0; i < used; i++) {
+        ChimpOpcode op = CHIMP_INSTR_OP(code, i);
+        size_t operand = CHIMP_INSTR_OPERAND(code, i);
+
+        switch (op) {
+            case CHIMP_OPCODE_JUMP:
+            case CHIMP_OPCODE_JUMPIFTRUE:
+            case CHIMP_OPCODE_JUMPIFFALSE:
+                /* jumping to the very end just falls off it */
+                if (operand > used) {
+                    return CHIMP_FALSE;
+                }
+                break;
+            case CHIMP_OPCODE_PUSHCONST:
+                if (operand >= CHIMP_ARRAY_SIZE(CHIMP_CODE_CONSTANTS(code))) {
+                    return CHIMP_FALSE;
+                }
+                break;
+            case CHIMP_OPCODE_SWITCH:
+                {
+                    ChimpRef *table;
+                    size_t j;
+                    if (operand >= CHIMP_ARRAY_SIZE(CHIMP_CODE_CONSTANTS(code))) {
+                        return CHIMP_FALSE;
+                    }
+                    table = CHIMP_INSTR_CONST(code, i);
+                    if (CHIMP_ANY_CLASS(table) != chimp_hash_class) {
+                        return CHIMP_FALSE;
+                    }
+                    for (j = 0; j < CHIMP_HASH_SIZE(table); j++) {
+                        ChimpRef *addr = CHIMP_HASH(table)->values[j];
+                        if (CHIMP_ANY_CLASS(addr) != chimp_int_class ||
+                                CHIMP_INT(addr)->value < 0 ||
+                                (uint64_t) CHIMP_INT(addr)->value > used) {
+                            return CHIMP_FALSE;
+                        }
+                    }
+                }
+                break;
+            case CHIMP_OPCODE_PUSHNAME:
+            case CHIMP_OPCODE_STORENAME:
+            case CHIMP_OPCODE_GETATTR:
+            case CHIMP_OPCODE_GETMETHOD:
+                if (operand >= CHIMP_ARRAY_SIZE(CHIMP_CODE_NAMES(code))) {
+                    return CHIMP_FALSE;
+                }
+                break;
+            case CHIMP_OPCODE_MOVE:
+            case CHIMP_OPCODE_ADDR:
+            case CHIMP_OPCODE_SUBR:
+            case CHIMP_OPCODE_MULR:
+            case CHIMP_OPCODE_DIVR:
+            case CHIMP_OPCODE_CMPEQR:
+            case CHIMP_OPCODE_CMPNEQR:
+            case CHIMP_OPCODE_CMPGTR:
+            case CHIMP_OPCODE_CMPGTER:
+            case CHIMP_OPCODE_CMPLTR:
+            case CHIMP_OPCODE_CMPLTER:
+                {
+                    uint32_t dst = CHIMP_INSTR_REG_DST(code, i);
+                    if ((dst >= CHIMP_REG_CONST && dst != CHIMP_REG_STACK) ||
+                            !chimp_code_cache_check_reg (code, dst) ||
+                            !chimp_code_cache_check_reg (
+                                code, CHIMP_INSTR_REG_LEFT(code, i))) {
+                        return CHIMP_FALSE;
+                    }
+                    if (op != CHIMP_OPCODE_MOVE &&
+                            !chimp_code_cache_check_reg (
+                                code, CHIMP_INSTR_REG_RIGHT(code, i))) {
+                        return CHIMP_FALSE;
+                    }
+                }
+                break;
+            case CHIMP_OPCODE_EXTENDEDARG:
+                /* a prefix must have something to prefix */
+                if (i + 1 >= used) {
+                    return CHIMP_FALSE;
+                }
+                break;
+            default:
+                if (op > CHIMP_OPCODE_SWITCH) {
+                    return CHIMP_FALSE;
+                }
+                break;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+chimp_code_cache_get_code (ChimpCodeCacheReader *r)
+{
+    ChimpRef *code;
+    ChimpRef *temp;
+    uint32_t n;
+    uint32_t i;
+
+    code = chimp_code_new ();
+    if (code == NULL) {
+        return NULL;
+    }
+
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *value = chimp_code_cache_get_const (r);
+        if (value == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (CHIMP_CODE(code)->constants, value)) {
+            return NULL;
+        }
+    }
+
+    if ((temp = chimp_code_cache_get_strs (r)) == NULL) {
+        return NULL;
+    }
+    CHIMP_CODE(code)->names = temp;
+    if ((temp = chimp_code_cache_get_strs (r)) == NULL) {
+        return NULL;
+    }
+    CHIMP_CODE(code)->vars = temp;
+    if ((temp = chimp_code_cache_get_strs (r)) == NULL) {
+        return NULL;
+    }
+    CHIMP_CODE(code)->freevars = temp;
+
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return NULL;
+    }
+    if (n > CHIMP_CODE(code)->allocated) {
+        uint32_t *bytecode = CHIMP_REALLOC(
+            uint32_t, CHIMP_CODE(code)->bytecode, sizeof(uint32_t) * n);
+        if (bytecode == NULL) {
+            return NULL;
+        }
+        CHIMP_CODE(code)->bytecode = bytecode;
+        CHIMP_CODE(code)->allocated = n;
+    }
+    if (!chimp_code_cache_get (
+            r, CHIMP_CODE(code)->bytecode, sizeof(uint32_t) * n)) {
+        return NULL;
+    }
+    CHIMP_CODE(code)->used = n;
+    if (!chimp_code_cache_check_code (code)) {
+        return NULL;
+    }
+    return code;
+}
+
+static ChimpRef *
+chimp_code_cache_get_base (ChimpCodeCacheReader *r)
+{
+    uint8_t tag;
+    ChimpRef *name;
+    ChimpRef *base;
+
+    if (!chimp_code_cache_get_u8 (r, &tag)) {
+        return NULL;
+    }
+    if (tag == CHIMP_CODE_CACHE_BASE_OBJECT) {
+        return chimp_object_class;
+    }
+    if ((name = chimp_code_cache_get_str (r)) == NULL) {
+        return NULL;
+    }
+    switch (tag) {
+        case CHIMP_CODE_CACHE_BASE_BUILTIN:
+            if (chimp_hash_get (chimp_builtins, name, &base) != 0) {
+                return NULL;
+            }
+            break;
+        case CHIMP_CODE_CACHE_BASE_LOCAL:
+            if (chimp_hash_get (
+                    CHIMP_MODULE_LOCALS(r->module), name, &base) != 0) {
+                return NULL;
+            }
+            break;
+        case CHIMP_CODE_CACHE_BASE_IMPORT:
+            {
+                ChimpRef *imported;
+                if (chimp_hash_get (
+                        CHIMP_MODULE_LOCALS(r->module), name, &imported) != 0) {
+                    return NULL;
+                }
+                if (CHIMP_ANY_CLASS(imported) != chimp_module_class) {
+                    return NULL;
+                }
+                if ((name = chimp_code_cache_get_str (r)) == NULL) {
+                    return NULL;
+                }
+                if (chimp_hash_get (
+                        CHIMP_MODULE_LOCALS(imported), name, &base) != 0) {
+                    return NULL;
+                }
+                break;
+            }
+        default:
+            return NULL;
+    }
+    if (CHIMP_ANY_CLASS(base) != chimp_class_class) {
+        return NULL;
+    }
+    return base;
+}
+
+static ChimpRef *
+chimp_code_cache_get_class (ChimpCodeCacheReader *r, ChimpRef *name)
+{
+    ChimpRef *base;
+    ChimpRef *klass;
+    uint32_t n;
+    uint32_t i;
+
+    if ((base = chimp_code_cache_get_base (r)) == NULL) {
+        return NULL;
+    }
+    klass = chimp_class_new (name, base, sizeof(ChimpObject));
+    if (klass == NULL) {
+        return NULL;
+    }
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *method_name;
+        ChimpRef *method;
+        if ((method_name = chimp_code_cache_get_str (r)) == NULL) {
+            return NULL;
+        }
+        if ((method = chimp_code_cache_get_method (r)) == NULL) {
+            return NULL;
+        }
+        if (!chimp_class_add_method (klass, method_name, method)) {
+            return NULL;
+        }
+    }
+    return klass;
+}
+
+static chimp_bool_t
+chimp_code_cache_get_locals (ChimpCodeCacheReader *r)
+{
+    uint32_t n;
+    uint32_t i;
+
+    if (!chimp_code_cache_get_u32 (r, &n)) {
+        return CHIMP_FALSE;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *name;
+        ChimpRef *value;
+        uint8_t kind;
+
+        if ((name = chimp_code_cache_get_str (r)) == NULL) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_code_cache_get_u8 (r, &kind)) {
+            return CHIMP_FALSE;
+        }
+        switch (kind) {
+            case CHIMP_CODE_CACHE_LOCAL_USE:
+                value = chimp_module_mgr_load (name);
+                break;
+            case CHIMP_CODE_CACHE_LOCAL_METHOD:
+                value = chimp_code_cache_get_method (r);
+                break;
+            case CHIMP_CODE_CACHE_LOCAL_CLASS:
+                value = chimp_code_cache_get_class (r, name);
+                break;
+            case CHIMP_CODE_CACHE_LOCAL_NIL:
+                value = chimp_nil;
+                break;
+            default:
+                value = NULL;
+                break;
+        }
+        if (value == NULL) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_module_add_local (r->module, name, value)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* true if the cache's header matches the source & the payload is intact */
+static chimp_bool_t
+chimp_code_cache_is_fresh (
+    ChimpCodeCacheReader *r, const char *filename, const struct stat *st)
+{
+    ChimpCodeCacheHeader header;
+    uint64_t hash;
+
+    if (!chimp_code_cache_get (r, &header, sizeof(header))) {
+        return CHIMP_FALSE;
+    }
+    if (memcmp (header.magic, CHIMP_CODE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != CHIMP_CODE_CACHE_VERSION) {
+        return CHIMP_FALSE;
+    }
+    if (header.size != (uint64_t) st->st_size) {
+        return CHIMP_FALSE;
+    }
+    if (chimp_code_cache_hash (r->p, (size_t)(r->end - r->p)) !=
+            header.payload_hash) {
+        return CHIMP_FALSE;
+    }
+    if (header.mtime_sec == (int64_t) st->st_mtim.tv_sec &&
+            header.mtime_nsec == (int64_t) st->st_mtim.tv_nsec) {
+        return CHIMP_TRUE;
+    }
+    /* touched but maybe not changed: check the contents */
+    if (!chimp_code_cache_hash_file (filename, header.size, &hash)) {
+        return CHIMP_FALSE;
+    }
+    return hash == header.hash;
+}
+
+ChimpRef *
+chimp_code_cache_load (ChimpRef *name, const char *filename)
+{
+    ChimpCodeCacheReader r;
+    struct stat st;
+    struct stat cst;
+    ChimpRef *stored_name;
+    ChimpRef *result = chimp_nil;
+    char *path;
+    char *data;
+    int fd;
+
+    if (stat (filename, &st) != 0) {
+        return chimp_nil;
+    }
+    path = chimp_code_cache_path (filename);
+    if (path == NULL) {
+        return NULL;
+    }
+    fd = open (path, O_RDONLY);
+    CHIMP_FREE (path);
+    if (fd < 0) {
+        return chimp_nil;
+    }
+    if (fstat (fd, &cst) != 0 || cst.st_size < (off_t) sizeof(ChimpCodeCacheHeader)) {
+        close (fd);
+        return chimp_nil;
+    }
+    data = mmap (NULL, (size_t) cst.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (data == MAP_FAILED) {
+        return chimp_nil;
+    }
+
+    r.p = data;
+    r.end = data + cst.st_size;
+    r.module = NULL;
+    r.filename = NULL;
+    if (!chimp_code_cache_is_fresh (&r, filename, &st)) {
+        goto done;
+    }
+    if ((stored_name = chimp_code_cache_get_str (&r)) == NULL) {
+        goto done;
+    }
+    r.filename = chimp_str_new (filename, strlen (filename));
+    r.module = chimp_module_new (name != NULL ? name : stored_name, NULL);
+    if (r.filename == NULL || r.module == NULL) {
+        result = NULL;
+        goto done;
+    }
+    if (chimp_code_cache_get_locals (&r) && r.p == r.end) {
+        result = r.module;
+    }
+
+done:
+    munmap (data, (size_t) cst.st_size);
+    return result;
+}
+
@@ -200,6 +200,9 @@ chimp_compile_ast_expr_bool (ChimpCodeCompiler *c, ChimpRef *expr);
 static chimp_bool_t
 chimp_compile_ast_expr_call (ChimpCodeCompiler *c, ChimpRef *expr);
 
+static chimp_bool_t
+chimp_compile_call (ChimpCodeCompiler *c, ChimpRef *expr, chimp_bool_t tail);
+
 static chimp_bool_t
 chimp_compile_ast_expr_fn (ChimpCodeCompiler *c, ChimpRef *expr);
 
@@ -392,12 +395,13 @@ chimp_code_compiler_pop_class_unit (ChimpCodeCompiler *c)
     return chimp_code_compiler_pop_unit (c, CHIMP_UNIT_TYPE_CLASS);
 }
 
+/* compiles the first n statements in stmts */
 static chimp_bool_t
-chimp_compile_ast_stmts (ChimpCodeCompiler *c, ChimpRef *stmts)
+chimp_compile_ast_stmts_n (ChimpCodeCompiler *c, ChimpRef *stmts, size_t n)
 {
     size_t i;
 
-    for (i = 0; i < CHIMP_ARRAY_SIZE(stmts); i++) {
+    for (i = 0; i < n; i++) {
         if (CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(stmts, i)) == chimp_ast_stmt_class) {
             if (!chimp_compile_ast_stmt (c, CHIMP_ARRAY_ITEM(stmts, i))) {
                 /* TODO error message? */
@@ -413,6 +417,12 @@ chimp_compile_ast_stmts (ChimpCodeCompiler *c, ChimpRef *stmts)
     return CHIMP_TRUE;
 }
 
+static chimp_bool_t
+chimp_compile_ast_stmts (ChimpCodeCompiler *c, ChimpRef *stmts)
+{
+    return chimp_compile_ast_stmts_n (c, stmts, CHIMP_ARRAY_SIZE(stmts));
+}
+
 static chimp_bool_t
 chimp_compile_ast_decls (ChimpCodeCompiler *c, ChimpRef *decls)
 {
@@ -433,6 +443,11 @@ chimp_compile_ast_mod (ChimpCodeCompiler *c, ChimpRef *mod)
     ChimpRef *uses = CHIMP_AST_MOD(mod)->root.uses;
     ChimpRef *body = CHIMP_AST_MOD(mod)->root.body;
 
+    /* get everything built up front so the loads below are just lookups */
+    if (!chimp_module_mgr_load_uses (uses)) {
+        return CHIMP_FALSE;
+    }
+
     if (!chimp_compile_ast_decls (c, uses)) {
         return CHIMP_FALSE;
     }
@@ -445,21 +460,155 @@ chimp_compile_ast_mod (ChimpCodeCompiler *c, ChimpRef *mod)
     return CHIMP_TRUE;
 }
 
+/* with CHIMP_REGISTER_VM, a function's own vars & literal constants are
+ * used in place as register operands (see CHIMP_INSTR_REG_*) instead of
+ * being bounced through the value stack. CHIMP_REG_STACK means "no
+ * register": compile the expression onto the stack as usual.
+ */
+static int
+chimp_compile_reg_for_var (ChimpCodeCompiler *c, ChimpRef *id)
+{
+#ifdef CHIMP_REGISTER_VM
+    if (CHIMP_COMPILER_IN_CODE(c)) {
+        return chimp_code_reg_for_var (CHIMP_COMPILER_CODE(c), id);
+    }
+#endif
+    return CHIMP_REG_STACK;
+}
+
+static int
+chimp_compile_reg (ChimpCodeCompiler *c, ChimpRef *expr)
+{
+#ifdef CHIMP_REGISTER_VM
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    if (!CHIMP_COMPILER_IN_CODE(c)) {
+        return CHIMP_REG_STACK;
+    }
+    switch (CHIMP_AST_EXPR_TYPE(expr)) {
+        case CHIMP_AST_EXPR_IDENT:
+            return chimp_code_reg_for_var (code, CHIMP_AST_EXPR(expr)->ident.id);
+        case CHIMP_AST_EXPR_INT_:
+            return chimp_code_reg_for_const (code, CHIMP_AST_EXPR(expr)->int_.value);
+        case CHIMP_AST_EXPR_FLOAT_:
+            return chimp_code_reg_for_const (code, CHIMP_AST_EXPR(expr)->float_.value);
+        case CHIMP_AST_EXPR_STR:
+            return chimp_code_reg_for_const (code, CHIMP_AST_EXPR(expr)->str.value);
+        case CHIMP_AST_EXPR_BOOL:
+            return chimp_code_reg_for_const (code, CHIMP_AST_EXPR(expr)->bool.value);
+        case CHIMP_AST_EXPR_NIL:
+            return chimp_code_reg_for_const (code, chimp_nil);
+        default:
+            break;
+    }
+#endif
+    return CHIMP_REG_STACK;
+}
+
+/* the register form of a binop, or -1 if it doesn't have one */
+static int
+chimp_compile_regop_for (ChimpCodeCompiler *c, ChimpRef *expr)
+{
+#ifdef CHIMP_REGISTER_VM
+    if (!CHIMP_COMPILER_IN_CODE(c) ||
+            CHIMP_AST_EXPR_TYPE(expr) != CHIMP_AST_EXPR_BINOP) {
+        return -1;
+    }
+    switch (CHIMP_AST_EXPR(expr)->binop.op) {
+        case CHIMP_BINOP_ADD:
+            return CHIMP_OPCODE_ADDR;
+        case CHIMP_BINOP_SUB:
+            return CHIMP_OPCODE_SUBR;
+        case CHIMP_BINOP_MUL:
+            return CHIMP_OPCODE_MULR;
+        case CHIMP_BINOP_DIV:
+            return CHIMP_OPCODE_DIVR;
+        case CHIMP_BINOP_EQ:
+            return CHIMP_OPCODE_CMPEQR;
+        case CHIMP_BINOP_NEQ:
+            return CHIMP_OPCODE_CMPNEQR;
+        case CHIMP_BINOP_GT:
+            return CHIMP_OPCODE_CMPGTR;
+        case CHIMP_BINOP_GTE:
+            return CHIMP_OPCODE_CMPGTER;
+        case CHIMP_BINOP_LT:
+            return CHIMP_OPCODE_CMPLTR;
+        case CHIMP_BINOP_LTE:
+            return CHIMP_OPCODE_CMPLTER;
+        default:
+            break;
+    }
+#endif
+    return -1;
+}
+
+/* dst = left <op> right in a single instruction */
 static chimp_bool_t
-chimp_compile_ast_stmt_assign (ChimpCodeCompiler *c, ChimpRef *stmt)
+chimp_compile_ast_expr_regop (ChimpCodeCompiler *c, ChimpRef *expr, int dst)
 {
-    ChimpRef *name =
-        CHIMP_AST_EXPR(CHIMP_AST_STMT(stmt)->assign.target)->ident.id;
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    ChimpRef *left_expr = CHIMP_AST_EXPR(expr)->binop.left;
+    ChimpRef *right_expr = CHIMP_AST_EXPR(expr)->binop.right;
+    int left = chimp_compile_reg (c, left_expr);
+    int right = chimp_compile_reg (c, right_expr);
+
+    /* a var read in place would see any side effects of evaluating the
+     * right hand side, so snapshot it on the stack instead.
+     */
+    if (right == CHIMP_REG_STACK && left < CHIMP_REG_CONST) {
+        left = CHIMP_REG_STACK;
+    }
 
-    if (!chimp_compile_ast_expr (c, CHIMP_AST_STMT(stmt)->assign.value)) {
+    if (left == CHIMP_REG_STACK && !chimp_compile_ast_expr (c, left_expr)) {
+        return CHIMP_FALSE;
+    }
+    if (right == CHIMP_REG_STACK && !chimp_compile_ast_expr (c, right_expr)) {
         return CHIMP_FALSE;
     }
 
-    if (!chimp_code_storename (code, name)) {
+    return chimp_code_regop (
+        code, chimp_compile_regop_for (c, expr), dst, left, right);
+}
+
+static chimp_bool_t
+chimp_compile_store (ChimpCodeCompiler *c, ChimpRef *name)
+{
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    int reg = chimp_compile_reg_for_var (c, name);
+    if (reg != CHIMP_REG_STACK) {
+        return chimp_code_move (code, reg, CHIMP_REG_STACK);
+    }
+    return chimp_code_storename (code, name);
+}
+
+static chimp_bool_t
+chimp_compile_assign (ChimpCodeCompiler *c, ChimpRef *name, ChimpRef *value)
+{
+    int reg = chimp_compile_reg_for_var (c, name);
+
+    if (reg != CHIMP_REG_STACK) {
+        int src = chimp_compile_reg (c, value);
+        if (src != CHIMP_REG_STACK) {
+            return chimp_code_move (CHIMP_COMPILER_CODE(c), reg, src);
+        }
+        else if (chimp_compile_regop_for (c, value) >= 0) {
+            return chimp_compile_ast_expr_regop (c, value, reg);
+        }
+    }
+
+    if (!chimp_compile_ast_expr (c, value)) {
         return CHIMP_FALSE;
     }
-    return CHIMP_TRUE;
+
+    return chimp_compile_store (c, name);
+}
+
+static chimp_bool_t
+chimp_compile_ast_stmt_assign (ChimpCodeCompiler *c, ChimpRef *stmt)
+{
+    ChimpRef *name =
+        CHIMP_AST_EXPR(CHIMP_AST_STMT(stmt)->assign.target)->ident.id;
+
+    return chimp_compile_assign (c, name, CHIMP_AST_STMT(stmt)->assign.value);
 }
 
 static chimp_bool_t
@@ -497,23 +646,109 @@ error:
     return CHIMP_FALSE;
 }
 
+/* an item index that's never skipped by chimp_compile_ast_stmt_array_items_test */
+#define CHIMP_NO_COLUMN ((size_t) -1)
+
+/* the value on the stack is an array as long as `array`: test its items
+ * against the patterns in `array`, except the one at index skip (which
+ * the caller has already checked).
+ */
 static chimp_bool_t
-chimp_compile_ast_stmt_array_pattern_test (
+chimp_compile_ast_stmt_array_items_test (
     ChimpCodeCompiler *c,
     ChimpRef *array,
+    size_t skip,
     ChimpBindPath *path,
     ChimpBindVars *vars,
     ChimpLabel *next_label
 )
 {
-    ChimpRef *size;
     size_t i;
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
     ChimpLabel pop_label = CHIMP_LABEL_INIT;
     ChimpLabel end_label = CHIMP_LABEL_INIT;
+    chimp_bool_t tested = CHIMP_FALSE;
 
     /* XXX need to free labels when things go bad */
 
+    for (i = 0; i < CHIMP_ARRAY_SIZE(array); i++) {
+        ChimpRef *item = CHIMP_ARRAY_ITEM(array, i);
+        ChimpAstExprType type = CHIMP_AST_EXPR(item)->type;
+
+        if (i == skip) {
+            continue;
+        }
+
+        CHIMP_BIND_PATH_ARRAY_INDEX(path, i);
+
+        /* bindings are looked up again by path if the arm matches */
+        if (type == CHIMP_AST_EXPR_IDENT || type == CHIMP_AST_EXPR_WILDCARD) {
+            if (!chimp_compile_ast_stmt_pattern_test (
+                        c, item, path, vars, &pop_label)) {
+                return CHIMP_FALSE;
+            }
+            continue;
+        }
+
+        if (!chimp_code_dup (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_pushconst (code, chimp_int_new (i))) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_getitem (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_compile_ast_stmt_pattern_test (
+                    c, item, path, vars, &pop_label)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_pop (code)) {
+            return CHIMP_FALSE;
+        }
+
+        tested = CHIMP_TRUE;
+    }
+
+    if (!tested) {
+        return CHIMP_TRUE;
+    }
+
+    if (!chimp_code_jump (code, &end_label)) {
+        return CHIMP_FALSE;
+    }
+
+    chimp_code_use_label (code, &pop_label);
+
+    if (!chimp_code_pop (code)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_jump (code, next_label)) {
+        return CHIMP_FALSE;
+    }
+
+    chimp_code_use_label (code, &end_label);
+
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_compile_ast_stmt_array_pattern_test (
+    ChimpCodeCompiler *c,
+    ChimpRef *array,
+    ChimpBindPath *path,
+    ChimpBindVars *vars,
+    ChimpLabel *next_label
+)
+{
+    ChimpRef *size;
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+
     /* is the value an array ? */
     if (!chimp_code_dup (code)) {
         return CHIMP_FALSE;
@@ -539,7 +774,7 @@ chimp_compile_ast_stmt_array_pattern_test (
         return CHIMP_FALSE;
     }
 
-    if (!chimp_code_getattr (code, CHIMP_STR_NEW("size"))) {
+    if (!chimp_code_getmethod (code, CHIMP_STR_NEW("size"))) {
         return CHIMP_FALSE;
     }
 
@@ -564,50 +799,8 @@ chimp_compile_ast_stmt_array_pattern_test (
         return CHIMP_FALSE;
     }
 
-    for (i = 0; i < CHIMP_ARRAY_SIZE(array); i++) {
-        ChimpRef *item = CHIMP_ARRAY_ITEM(array, i);
-
-        if (!chimp_code_dup (code)) {
-            return CHIMP_FALSE;
-        }
-
-        if (!chimp_code_pushconst (code, chimp_int_new (i))) {
-            return CHIMP_FALSE;
-        }
-
-        if (!chimp_code_getitem (code)) {
-            return CHIMP_FALSE;
-        }
-
-        CHIMP_BIND_PATH_ARRAY_INDEX(path, i);
-
-        if (!chimp_compile_ast_stmt_pattern_test (
-                    c, item, path, vars, &pop_label)) {
-            return CHIMP_FALSE;
-        }
-
-        if (!chimp_code_pop (code)) {
-            return CHIMP_FALSE;
-        }
-    }
-
-    if (!chimp_code_jump (code, &end_label)) {
-        return CHIMP_FALSE;
-    }
-
-    chimp_code_use_label (code, &pop_label);
-
-    if (!chimp_code_pop (code)) {
-        return CHIMP_FALSE;
-    }
-
-    if (!chimp_code_jump (code, next_label)) {
-        return CHIMP_FALSE;
-    }
-
-    chimp_code_use_label (code, &end_label);
-
-    return CHIMP_TRUE;
+    return chimp_compile_ast_stmt_array_items_test (
+        c, array, CHIMP_NO_COLUMN, path, vars, next_label);
 }
 
 static chimp_bool_t
@@ -648,7 +841,7 @@ chimp_compile_ast_stmt_hash_pattern_test (
         return CHIMP_FALSE;
     }
 
-    if (!chimp_code_getattr (code, CHIMP_STR_NEW("size"))) {
+    if (!chimp_code_getmethod (code, CHIMP_STR_NEW("size"))) {
         return CHIMP_FALSE;
     }
 
@@ -773,13 +966,551 @@ chimp_compile_ast_stmt_simple_pattern_test (
 {
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
 
-    /* XXX the class comparison code path should be moved elsewhere:
-     *     pretty sure it's only used by a pattern test for `nil`
-     */
-    if (value == NULL) {
-        /*
-         * no value provided. do the types match?
-         */
+    /* XXX the class comparison code path should be moved elsewhere:
+     *     pretty sure it's only used by a pattern test for `nil`
+     */
+    if (value == NULL) {
+        /*
+         * no value provided. do the types match?
+         */
+        if (!chimp_code_dup (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_getclass (code)) {
+            return CHIMP_FALSE;
+        }
+
+        /* XXX the `nil` class isn't exposed at the language level */
+        if (strcmp (class_name, "nil") == 0) {
+            if (!chimp_code_pushconst (code, chimp_nil_class)) {
+                return CHIMP_FALSE;
+            }
+        }
+        else if (!chimp_code_pushname (code,
+                chimp_str_new (class_name, strlen(class_name)))) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_eq (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_jumpiffalse (code, next_label)) {
+            return CHIMP_FALSE;
+        }
+
+    }
+    else /* if (value != NULL) */ {
+        /*
+         * okay, so the types match. are the values equivalent?
+         */
+        if (!chimp_code_dup (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_pushconst (code, value)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_eq (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_code_jumpiffalse (code, next_label)) {
+            return CHIMP_FALSE;
+        }
+    }
+
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_compile_ast_stmt_pattern_test (
+    ChimpCodeCompiler *c,
+    ChimpRef *test,
+    ChimpBindPath *path,
+    ChimpBindVars *vars,
+    ChimpLabel *next_label
+)
+{
+    switch (CHIMP_AST_EXPR(test)->type) {
+        case CHIMP_AST_EXPR_INT_:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->int_.value;
+                if (!chimp_compile_ast_stmt_simple_pattern_test (
+                        c, "int", value, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                break;
+            }
+        case CHIMP_AST_EXPR_FLOAT_:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->float_.value;
+                if (!chimp_compile_ast_stmt_simple_pattern_test(
+                        c, "float", value, next_label )) {
+                    return CHIMP_FALSE;
+                }
+
+               break; 
+            }
+        case CHIMP_AST_EXPR_STR:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->str.value;
+                if (!chimp_compile_ast_stmt_simple_pattern_test (
+                        c, "str", value, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                break;
+            }
+        case CHIMP_AST_EXPR_BOOL:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->bool.value;
+                if (!chimp_compile_ast_stmt_simple_pattern_test (
+                        c, "bool", value, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                break;
+            }
+        case CHIMP_AST_EXPR_NIL:
+            {
+                if (!chimp_compile_ast_stmt_simple_pattern_test (
+                        c, "nil", NULL, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                break;
+            }
+        case CHIMP_AST_EXPR_IDENT:
+            {
+                ChimpRef *id = CHIMP_AST_EXPR(test)->ident.id;
+
+                CHIMP_BIND_VARS_ADD(vars, id, path);
+
+                break;
+            }
+        case CHIMP_AST_EXPR_ARRAY:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->array.value;
+
+                CHIMP_BIND_PATH_PUSH_ARRAY(path);
+
+                if (!chimp_compile_ast_stmt_array_pattern_test (
+                        c, value, path, vars, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                CHIMP_BIND_PATH_POP(path);
+
+                break;
+            }
+        case CHIMP_AST_EXPR_HASH:
+            {
+                ChimpRef *value = CHIMP_AST_EXPR(test)->hash.value;
+
+                CHIMP_BIND_PATH_PUSH_HASH(path);
+
+                if (!chimp_compile_ast_stmt_hash_pattern_test (
+                        c, value, path, vars, next_label)) {
+                    return CHIMP_FALSE;
+                }
+
+                CHIMP_BIND_PATH_POP(path);
+
+                break;
+            }
+        case CHIMP_AST_EXPR_WILDCARD:
+            {
+                break;
+            }
+        default:
+            CHIMP_BUG ("TODO");
+            return CHIMP_FALSE;
+    };
+
+    return CHIMP_TRUE;
+}
+
+/* the str or int a pattern matches exactly, or NULL if it's anything else.
+ * these are the patterns a SWITCH can dispatch on.
+ */
+static ChimpRef *
+chimp_compile_pattern_literal (ChimpRef *test)
+{
+    switch (CHIMP_AST_EXPR(test)->type) {
+        case CHIMP_AST_EXPR_STR:
+            return CHIMP_AST_EXPR(test)->str.value;
+        case CHIMP_AST_EXPR_INT_:
+            return CHIMP_AST_EXPR(test)->int_.value;
+        default:
+            return NULL;
+    }
+}
+
+/* arms with a literal or array pattern can be sorted into a decision tree:
+ * anything else might match any value, so a tree has to stop there.
+ */
+static chimp_bool_t
+chimp_compile_pattern_is_dispatchable (ChimpRef *test)
+{
+    return chimp_compile_pattern_literal (test) != NULL ||
+           CHIMP_AST_EXPR(test)->type == CHIMP_AST_EXPR_ARRAY;
+}
+
+/* appends pattern to the array group maps key to, keeping arms in order */
+static chimp_bool_t
+chimp_compile_group_pattern (ChimpRef *group, ChimpRef *key, ChimpRef *pattern)
+{
+    ChimpRef *patterns;
+    int r = chimp_hash_get (group, key, &patterns);
+    if (r < 0) {
+        return CHIMP_FALSE;
+    }
+    else if (r > 0) {
+        patterns = chimp_array_new ();
+        if (patterns == NULL || !chimp_hash_put (group, key, patterns)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return chimp_array_push (patterns, pattern);
+}
+
+/* the next instruction is where the SWITCH owning table sends key */
+static chimp_bool_t
+chimp_compile_switch_target (ChimpRef *code, ChimpRef *table, ChimpRef *key)
+{
+    ChimpRef *addr = chimp_int_new ((int64_t) CHIMP_CODE_SIZE(code));
+    if (addr == NULL) {
+        return CHIMP_FALSE;
+    }
+    return chimp_hash_put (table, key, addr);
+}
+
+/* the pattern's test succeeded: bind its vars, drop the value being
+ * matched & run the body.
+ */
+static chimp_bool_t
+chimp_compile_ast_stmt_match_body (
+    ChimpCodeCompiler *c,
+    ChimpRef *pattern,
+    ChimpBindVars *bound,
+    ChimpLabel *end_label
+)
+{
+    size_t j, k;
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    ChimpRef *body = CHIMP_AST_STMT(pattern)->pattern.body;
+
+    for (j = 0; j < bound->size; j++) {
+        const ChimpBindPath *var_path = &bound->items[j].path;
+
+        if (!chimp_code_dup (code)) {
+            return CHIMP_FALSE;
+        }
+
+        for (k = 0; k < var_path->size; k++) {
+            if (var_path->items[k].type == CHIMP_BIND_PATH_ITEM_TYPE_ARRAY) {
+                size_t index = var_path->items[k].array_index;
+
+                if (!chimp_code_pushconst (code, chimp_int_new (index))) {
+                    return CHIMP_FALSE;
+                }
+
+                if (!chimp_code_getitem (code)) {
+                    return CHIMP_FALSE;
+                }
+            }
+            else if (var_path->items[k].type == CHIMP_BIND_PATH_ITEM_TYPE_HASH) {
+                ChimpRef *key = var_path->items[k].hash_key;
+
+                if (!chimp_code_pushconst (code, key)) {
+                    return CHIMP_FALSE;
+                }
+
+                if (!chimp_code_getitem (code)) {
+                    return CHIMP_FALSE;
+                }
+            }
+            else {
+                /* simple binding: we're storing the matched value itself */
+            }
+        }
+        if (!chimp_compile_store (c, bound->items[j].id)) {
+            return CHIMP_FALSE;
+        }
+    }
+
+    /* pop the value we're testing off the stack */
+    if (!chimp_code_pop (code)) {
+        return CHIMP_FALSE;
+    }
+
+    /* successful match: execute the body */
+    if (!chimp_compile_ast_stmts (c, body)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_jump (code, end_label)) {
+        return CHIMP_FALSE;
+    }
+
+    return CHIMP_TRUE;
+}
+
+/* a single arm, tested on its own: on failure we fall through to whatever
+ * comes next.
+ */
+static chimp_bool_t
+chimp_compile_ast_stmt_match_arm (
+    ChimpCodeCompiler *c,
+    ChimpRef *pattern,
+    ChimpLabel *end_label
+)
+{
+    ChimpLabel next_label = CHIMP_LABEL_INIT;
+    ChimpRef *test = CHIMP_AST_STMT(pattern)->pattern.test;
+    ChimpBindPath path;
+    ChimpBindVars bound;
+
+    CHIMP_BIND_PATH_INIT(&path);
+    CHIMP_BIND_VARS_INIT(&bound);
+
+    /* try to match the value against this test. if we fail, jump to next_label */
+    if (!chimp_compile_ast_stmt_pattern_test (c, test, &path, &bound, &next_label)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_compile_ast_stmt_match_body (c, pattern, &bound, end_label)) {
+        return CHIMP_FALSE;
+    }
+
+    chimp_code_use_label (CHIMP_COMPILER_CODE(c), &next_label);
+
+    return CHIMP_TRUE;
+}
+
+/* the value on the stack is an array as long as every pattern in
+ * `patterns`, which all agree on the item at index skip (if any): try the
+ * rest of each pattern in turn, falling back to fail_label.
+ */
+static chimp_bool_t
+chimp_compile_ast_stmt_match_array_chain (
+    ChimpCodeCompiler *c,
+    ChimpRef *patterns,
+    size_t skip,
+    ChimpLabel *fail_label,
+    ChimpLabel *end_label
+)
+{
+    size_t i;
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(patterns); i++) {
+        ChimpLabel next_label = CHIMP_LABEL_INIT;
+        ChimpRef *pattern = CHIMP_ARRAY_ITEM(patterns, i);
+        ChimpRef *test = CHIMP_AST_STMT(pattern)->pattern.test;
+        ChimpBindPath path;
+        ChimpBindVars bound;
+
+        CHIMP_BIND_PATH_INIT(&path);
+        CHIMP_BIND_VARS_INIT(&bound);
+
+        CHIMP_BIND_PATH_PUSH_ARRAY(&path);
+
+        if (!chimp_compile_ast_stmt_array_items_test (
+                c, CHIMP_AST_EXPR(test)->array.value, skip,
+                &path, &bound, &next_label)) {
+            return CHIMP_FALSE;
+        }
+
+        CHIMP_BIND_PATH_POP(&path);
+
+        if (!chimp_compile_ast_stmt_match_body (c, pattern, &bound, end_label)) {
+            return CHIMP_FALSE;
+        }
+
+        chimp_code_use_label (code, &next_label);
+    }
+
+    return chimp_code_jump (code, fail_label);
+}
+
+/* array patterns of the same length. if every one of them has a str or int
+ * literal at the same index, SWITCH on that item first so each arm only
+ * tests values that could possibly match it.
+ */
+static chimp_bool_t
+chimp_compile_ast_stmt_match_array_group (
+    ChimpCodeCompiler *c,
+    ChimpRef *patterns,
+    ChimpLabel *fail_label,
+    ChimpLabel *end_label
+)
+{
+    size_t i, column;
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    ChimpRef *first = CHIMP_AST_STMT(CHIMP_ARRAY_FIRST(patterns))->pattern.test;
+    const size_t length = CHIMP_ARRAY_SIZE(CHIMP_AST_EXPR(first)->array.value);
+    ChimpRef *tags;
+    ChimpRef *table;
+
+    for (column = 0; column < length; column++) {
+        for (i = 0; i < CHIMP_ARRAY_SIZE(patterns); i++) {
+            ChimpRef *test =
+                CHIMP_AST_STMT(CHIMP_ARRAY_ITEM(patterns, i))->pattern.test;
+            ChimpRef *item =
+                CHIMP_ARRAY_ITEM(CHIMP_AST_EXPR(test)->array.value, column);
+            if (chimp_compile_pattern_literal (item) == NULL) {
+                break;
+            }
+        }
+        if (i == CHIMP_ARRAY_SIZE(patterns)) {
+            break;
+        }
+    }
+
+    /* a lone arm has nothing to be told apart from */
+    if (column == length || CHIMP_ARRAY_SIZE(patterns) < 2) {
+        return chimp_compile_ast_stmt_match_array_chain (
+            c, patterns, CHIMP_NO_COLUMN, fail_label, end_label);
+    }
+
+    tags = chimp_hash_new ();
+    if (tags == NULL) {
+        return CHIMP_FALSE;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(patterns); i++) {
+        ChimpRef *pattern = CHIMP_ARRAY_ITEM(patterns, i);
+        ChimpRef *test = CHIMP_AST_STMT(pattern)->pattern.test;
+        ChimpRef *item =
+            CHIMP_ARRAY_ITEM(CHIMP_AST_EXPR(test)->array.value, column);
+        if (!chimp_compile_group_pattern (
+                tags, chimp_compile_pattern_literal (item), pattern)) {
+            return CHIMP_FALSE;
+        }
+    }
+
+    table = chimp_hash_new ();
+    if (table == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_dup (code)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_pushconst (code, chimp_int_new (column))) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_getitem (code)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_switch (code, table)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_pop (code)) {
+        return CHIMP_FALSE;
+    }
+
+    if (!chimp_code_jump (code, fail_label)) {
+        return CHIMP_FALSE;
+    }
+
+    for (i = 0; i < CHIMP_HASH_SIZE(tags); i++) {
+        if (!chimp_compile_switch_target (
+                code, table, CHIMP_HASH(tags)->keys[i])) {
+            return CHIMP_FALSE;
+        }
+
+        /* drop the item we switched on */
+        if (!chimp_code_pop (code)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_compile_ast_stmt_match_array_chain (
+                c, CHIMP_HASH(tags)->values[i], column,
+                fail_label, end_label)) {
+            return CHIMP_FALSE;
+        }
+    }
+
+    return CHIMP_TRUE;
+}
+
+/* a run of arms with literal & array patterns, as a decision tree: strs &
+ * ints go straight to their arm through a SWITCH, arrays have their class
+ * & length checked once, then SWITCH on the length to the arms that could
+ * match. a value that matches none of them goes on to the arm after the
+ * run.
+ */
+static chimp_bool_t
+chimp_compile_ast_stmt_match_tree (
+    ChimpCodeCompiler *c,
+    ChimpRef *patterns,
+    size_t start,
+    size_t end,
+    ChimpLabel *end_label
+)
+{
+    size_t i;
+    ChimpRef *code = CHIMP_COMPILER_CODE(c);
+    ChimpLabel next_label = CHIMP_LABEL_INIT;
+    ChimpRef *literals;
+    ChimpRef *lengths;
+    ChimpRef *literal_table = NULL;
+    ChimpRef *length_table;
+
+    literals = chimp_hash_new ();
+    if (literals == NULL) {
+        return CHIMP_FALSE;
+    }
+    lengths = chimp_hash_new ();
+    if (lengths == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    for (i = start; i < end; i++) {
+        ChimpRef *pattern = CHIMP_ARRAY_ITEM(patterns, i);
+        ChimpRef *test = CHIMP_AST_STMT(pattern)->pattern.test;
+        ChimpRef *literal = chimp_compile_pattern_literal (test);
+
+        if (literal != NULL) {
+            /* only the first arm for a given literal can ever match */
+            if (chimp_hash_get (literals, literal, NULL) > 0 &&
+                    !chimp_hash_put (literals, literal, pattern)) {
+                return CHIMP_FALSE;
+            }
+        }
+        else {
+            ChimpRef *length = chimp_int_new (
+                CHIMP_ARRAY_SIZE(CHIMP_AST_EXPR(test)->array.value));
+            if (length == NULL) {
+                return CHIMP_FALSE;
+            }
+            if (!chimp_compile_group_pattern (lengths, length, pattern)) {
+                return CHIMP_FALSE;
+            }
+        }
+    }
+
+    if (CHIMP_HASH_SIZE(literals) > 0) {
+        literal_table = chimp_hash_new ();
+        if (literal_table == NULL) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_code_switch (code, literal_table)) {
+            return CHIMP_FALSE;
+        }
+    }
+
+    if (CHIMP_HASH_SIZE(lengths) > 0) {
+        /* is the value an array ? */
         if (!chimp_code_dup (code)) {
             return CHIMP_FALSE;
         }
@@ -788,14 +1519,7 @@ chimp_compile_ast_stmt_simple_pattern_test (
             return CHIMP_FALSE;
         }
 
-        /* XXX the `nil` class isn't exposed at the language level */
-        if (strcmp (class_name, "nil") == 0) {
-            if (!chimp_code_pushconst (code, chimp_nil_class)) {
-                return CHIMP_FALSE;
-            }
-        }
-        else if (!chimp_code_pushname (code,
-                chimp_str_new (class_name, strlen(class_name)))) {
+        if (!chimp_code_pushname (code, CHIMP_STR_NEW("array"))) {
             return CHIMP_FALSE;
         }
 
@@ -803,140 +1527,79 @@ chimp_compile_ast_stmt_simple_pattern_test (
             return CHIMP_FALSE;
         }
 
-        if (!chimp_code_jumpiffalse (code, next_label)) {
+        if (!chimp_code_jumpiffalse (code, &next_label)) {
             return CHIMP_FALSE;
         }
 
-    }
-    else /* if (value != NULL) */ {
-        /*
-         * okay, so the types match. are the values equivalent?
-         */
+        /* ... of a length one of the arms is looking for? */
         if (!chimp_code_dup (code)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_code_pushconst (code, value)) {
+        if (!chimp_code_getmethod (code, CHIMP_STR_NEW("size"))) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_code_eq (code)) {
+        if (!chimp_code_call (code, 0)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_code_jumpiffalse (code, next_label)) {
+        length_table = chimp_hash_new ();
+        if (length_table == NULL) {
             return CHIMP_FALSE;
         }
-    }
-
-    return CHIMP_TRUE;
-}
-
-static chimp_bool_t
-chimp_compile_ast_stmt_pattern_test (
-    ChimpCodeCompiler *c,
-    ChimpRef *test,
-    ChimpBindPath *path,
-    ChimpBindVars *vars,
-    ChimpLabel *next_label
-)
-{
-    switch (CHIMP_AST_EXPR(test)->type) {
-        case CHIMP_AST_EXPR_INT_:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->int_.value;
-                if (!chimp_compile_ast_stmt_simple_pattern_test (
-                        c, "int", value, next_label)) {
-                    return CHIMP_FALSE;
-                }
-
-                break;
-            }
-        case CHIMP_AST_EXPR_FLOAT_:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->float_.value;
-                if (!chimp_compile_ast_stmt_simple_pattern_test(
-                        c, "float", value, next_label )) {
-                    return CHIMP_FALSE;
-                }
 
-               break; 
-            }
-        case CHIMP_AST_EXPR_STR:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->str.value;
-                if (!chimp_compile_ast_stmt_simple_pattern_test (
-                        c, "str", value, next_label)) {
-                    return CHIMP_FALSE;
-                }
+        if (!chimp_code_switch (code, length_table)) {
+            return CHIMP_FALSE;
+        }
 
-                break;
-            }
-        case CHIMP_AST_EXPR_BOOL:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->bool.value;
-                if (!chimp_compile_ast_stmt_simple_pattern_test (
-                        c, "bool", value, next_label)) {
-                    return CHIMP_FALSE;
-                }
+        if (!chimp_code_pop (code)) {
+            return CHIMP_FALSE;
+        }
 
-                break;
-            }
-        case CHIMP_AST_EXPR_NIL:
-            {
-                if (!chimp_compile_ast_stmt_simple_pattern_test (
-                        c, "nil", NULL, next_label)) {
-                    return CHIMP_FALSE;
-                }
+        if (!chimp_code_jump (code, &next_label)) {
+            return CHIMP_FALSE;
+        }
 
-                break;
+        for (i = 0; i < CHIMP_HASH_SIZE(lengths); i++) {
+            if (!chimp_compile_switch_target (
+                    code, length_table, CHIMP_HASH(lengths)->keys[i])) {
+                return CHIMP_FALSE;
             }
-        case CHIMP_AST_EXPR_IDENT:
-            {
-                ChimpRef *id = CHIMP_AST_EXPR(test)->ident.id;
 
-                CHIMP_BIND_VARS_ADD(vars, id, path);
-
-                break;
+            /* drop the length */
+            if (!chimp_code_pop (code)) {
+                return CHIMP_FALSE;
             }
-        case CHIMP_AST_EXPR_ARRAY:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->array.value;
-
-                CHIMP_BIND_PATH_PUSH_ARRAY(path);
-
-                if (!chimp_compile_ast_stmt_array_pattern_test (
-                        c, value, path, vars, next_label)) {
-                    return CHIMP_FALSE;
-                }
-
-                CHIMP_BIND_PATH_POP(path);
 
-                break;
+            if (!chimp_compile_ast_stmt_match_array_group (
+                    c, CHIMP_HASH(lengths)->values[i],
+                    &next_label, end_label)) {
+                return CHIMP_FALSE;
             }
-        case CHIMP_AST_EXPR_HASH:
-            {
-                ChimpRef *value = CHIMP_AST_EXPR(test)->hash.value;
+        }
+    }
+    else if (!chimp_code_jump (code, &next_label)) {
+        return CHIMP_FALSE;
+    }
 
-                CHIMP_BIND_PATH_PUSH_HASH(path);
+    for (i = 0; i < CHIMP_HASH_SIZE(literals); i++) {
+        ChimpBindVars bound;
 
-                if (!chimp_compile_ast_stmt_hash_pattern_test (
-                        c, value, path, vars, next_label)) {
-                    return CHIMP_FALSE;
-                }
+        CHIMP_BIND_VARS_INIT(&bound);
 
-                CHIMP_BIND_PATH_POP(path);
+        if (!chimp_compile_switch_target (
+                code, literal_table, CHIMP_HASH(literals)->keys[i])) {
+            return CHIMP_FALSE;
+        }
 
-                break;
-            }
-        case CHIMP_AST_EXPR_WILDCARD:
-            {
-                break;
-            }
-        default:
-            CHIMP_BUG ("TODO");
+        if (!chimp_compile_ast_stmt_match_body (
+                c, CHIMP_HASH(literals)->values[i], &bound, end_label)) {
             return CHIMP_FALSE;
-    };
+        }
+    }
+
+    chimp_code_use_label (code, &next_label);
 
     return CHIMP_TRUE;
 }
@@ -944,7 +1607,7 @@ chimp_compile_ast_stmt_pattern_test (
 static chimp_bool_t
 chimp_compile_ast_stmt_match (ChimpCodeCompiler *c, ChimpRef *stmt)
 {
-    size_t i;
+    size_t i, j;
     ChimpLabel end_label = CHIMP_LABEL_INIT;
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
     ChimpRef *expr = CHIMP_AST_STMT(stmt)->match.expr;
@@ -956,79 +1619,35 @@ chimp_compile_ast_stmt_match (ChimpCodeCompiler *c, ChimpRef *stmt)
         return CHIMP_FALSE;
     }
 
-    for (i = 0; i < size; i++) {
-        ChimpLabel next_label = CHIMP_LABEL_INIT;
-        ChimpRef *pattern = CHIMP_ARRAY_ITEM(patterns, i);
-        ChimpRef *test = CHIMP_AST_STMT(pattern)->pattern.test;
-        ChimpRef *body = CHIMP_AST_STMT(pattern)->pattern.body;
-        size_t j, k;
-        ChimpBindPath path;
-        ChimpBindVars bound;
-
-        CHIMP_BIND_PATH_INIT(&path);
-        CHIMP_BIND_VARS_INIT(&bound);
-
-        /* try to match the value against this test. if we fail, jump to next_label */
-        if (!chimp_compile_ast_stmt_pattern_test (c, test, &path, &bound, &next_label)) {
-            chimp_label_free (&end_label);
-            return CHIMP_FALSE;
+    for (i = 0; i < size; i = j) {
+        for (j = i; j < size; j++) {
+            ChimpRef *pattern = CHIMP_ARRAY_ITEM(patterns, j);
+            if (!chimp_compile_pattern_is_dispatchable (
+                    CHIMP_AST_STMT(pattern)->pattern.test)) {
+                break;
+            }
         }
 
-        /* pattern test succeeded: bind pattern vars (if any) */
-        for (j = 0; j < bound.size; j++) {
-            const ChimpBindPath *var_path = &bound.items[j].path;
-
-            if (!chimp_code_dup (code)) {
+        if (j - i > 1) {
+            if (!chimp_compile_ast_stmt_match_tree (
+                    c, patterns, i, j, &end_label)) {
+                chimp_label_free (&end_label);
                 return CHIMP_FALSE;
             }
-
-            for (k = 0; k < var_path->size; k++) {
-                if (var_path->items[k].type == CHIMP_BIND_PATH_ITEM_TYPE_ARRAY) {
-                    size_t index = var_path->items[k].array_index;
-
-                    if (!chimp_code_pushconst (code, chimp_int_new (index))) {
-                        return CHIMP_FALSE;
-                    }
-
-                    if (!chimp_code_getitem (code)) {
-                        return CHIMP_FALSE;
-                    }
-                }
-                else if (var_path->items[k].type == CHIMP_BIND_PATH_ITEM_TYPE_HASH) {
-                    ChimpRef *key = var_path->items[k].hash_key;
-
-                    if (!chimp_code_pushconst (code, key)) {
-                        return CHIMP_FALSE;
-                    }
-
-                    if (!chimp_code_getitem (code)) {
-                        return CHIMP_FALSE;
-                    }
-                }
-                else {
-                    /* simple binding: we're storing the matched value itself */
-                }
-            }
-            if (!chimp_code_storename (code, bound.items[j].id)) {
+        }
+        else {
+            if (!chimp_compile_ast_stmt_match_arm (
+                    c, CHIMP_ARRAY_ITEM(patterns, i), &end_label)) {
+                chimp_label_free (&end_label);
                 return CHIMP_FALSE;
             }
+            j = i + 1;
         }
+    }
 
-        /* pop the value we're testing off the stack */
-        if (!chimp_code_pop (code)) {
-            return CHIMP_FALSE;
-        }
-
-        /* successful match: execute the body */
-        if (!chimp_compile_ast_stmts (c, body)) {
-            return CHIMP_FALSE;
-        }
-
-        if (!chimp_code_jump (code, &end_label)) {
-            return CHIMP_FALSE;
-        }
-
-        chimp_code_use_label (code, &next_label);
+    /* nothing matched: the arms that did popped the value themselves */
+    if (!chimp_code_pop (code)) {
+        return CHIMP_FALSE;
     }
 
     chimp_code_use_label (code, &end_label);
@@ -1077,11 +1696,14 @@ error:
 }
 
 static chimp_bool_t
-chimp_compile_ast_stmt_ret (ChimpCodeCompiler *c, ChimpRef *stmt)
+chimp_compile_ret (ChimpCodeCompiler *c, ChimpRef *expr)
 {
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
-    ChimpRef *expr = CHIMP_AST_STMT(stmt)->ret.expr;
-    if (expr != NULL) {
+    if (expr != NULL && CHIMP_AST_EXPR_TYPE(expr) == CHIMP_AST_EXPR_CALL) {
+        /* ret f(...) doesn't need to keep this frame around */
+        return chimp_compile_call (c, expr, CHIMP_TRUE);
+    }
+    else if (expr != NULL) {
         if (!chimp_compile_ast_expr (c, expr)) {
             return CHIMP_FALSE;
         }
@@ -1097,6 +1719,12 @@ chimp_compile_ast_stmt_ret (ChimpCodeCompiler *c, ChimpRef *stmt)
     return CHIMP_TRUE;
 }
 
+static chimp_bool_t
+chimp_compile_ast_stmt_ret (ChimpCodeCompiler *c, ChimpRef *stmt)
+{
+    return chimp_compile_ret (c, CHIMP_AST_STMT(stmt)->ret.expr);
+}
+
 static chimp_bool_t
 chimp_compile_ast_stmt_break_ (ChimpCodeCompiler *c, ChimpRef *stmt)
 {
@@ -1156,6 +1784,7 @@ chimp_compile_bytecode_method (ChimpCodeCompiler *c, ChimpRef *fn, ChimpRef *arg
     ChimpRef *symbols;
     ChimpRef *method;
     ChimpRef *ste;
+    ChimpRef *last;
     size_t i;
 
     func_code = chimp_code_compiler_push_code_unit (c, fn);
@@ -1185,13 +1814,25 @@ chimp_compile_bytecode_method (ChimpCodeCompiler *c, ChimpRef *fn, ChimpRef *arg
     /* unpack arguments */
     for (i = 0; i < CHIMP_ARRAY_SIZE(args); i++) {
         ChimpRef *var_decl = CHIMP_ARRAY_ITEM(args, CHIMP_ARRAY_SIZE(args) - i - 1);
-        if (!chimp_code_storename (func_code, CHIMP_AST_DECL(var_decl)->var.name)) {
-            CHIMP_BUG ("failed to emit STORENAME instruction");
+        if (!chimp_compile_store (c, CHIMP_AST_DECL(var_decl)->var.name)) {
+            CHIMP_BUG ("failed to store argument");
             return NULL;
         }
     }
-    
-    if (!chimp_compile_ast_stmts (c, body)) {
+
+    /* a body ending in an expression returns its value */
+    last = CHIMP_ARRAY_SIZE(body) > 0 ? CHIMP_ARRAY_LAST(body) : NULL;
+    if (last != NULL &&
+            CHIMP_ANY_CLASS(last) == chimp_ast_stmt_class &&
+            CHIMP_AST_STMT_TYPE(last) == CHIMP_AST_STMT_EXPR) {
+        if (!chimp_compile_ast_stmts_n (c, body, CHIMP_ARRAY_SIZE(body) - 1)) {
+            return NULL;
+        }
+        if (!chimp_compile_ret (c, CHIMP_AST_STMT(last)->expr.expr)) {
+            return NULL;
+        }
+    }
+    else if (!chimp_compile_ast_stmts (c, body)) {
         return NULL;
     }
 
@@ -1234,7 +1875,7 @@ chimp_compile_ast_decl_func (ChimpCodeCompiler *c, ChimpRef *decl)
             return CHIMP_FALSE;
         }
 
-        if (!chimp_code_storename (code, CHIMP_AST_DECL(decl)->func.name)) {
+        if (!chimp_compile_store (c, CHIMP_AST_DECL(decl)->func.name)) {
             return CHIMP_FALSE;
         }
     }
@@ -1380,15 +2021,7 @@ chimp_compile_ast_decl_var (ChimpCodeCompiler *c, ChimpRef *decl)
     else {
         /* TODO it's really about time we get ourselves a symbol table */
         if (value != NULL) {
-            ChimpRef *code = CHIMP_COMPILER_CODE(c);
-
-            if (!chimp_compile_ast_expr (c, value)) {
-                return CHIMP_FALSE;
-            }
-
-            if (!chimp_code_storename (code, name)) {
-                return CHIMP_FALSE;
-            }
+            return chimp_compile_assign (c, name, value);
         }
     }
     return CHIMP_TRUE;
@@ -1490,7 +2123,7 @@ chimp_compile_ast_expr (ChimpCodeCompiler *c, ChimpRef *expr)
 }
 
 static chimp_bool_t
-chimp_compile_ast_expr_call (ChimpCodeCompiler *c, ChimpRef *expr)
+chimp_compile_call (ChimpCodeCompiler *c, ChimpRef *expr, chimp_bool_t tail)
 {
     ChimpRef *target;
     ChimpRef *args;
@@ -1498,7 +2131,21 @@ chimp_compile_ast_expr_call (ChimpCodeCompiler *c, ChimpRef *expr)
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
 
     target = CHIMP_AST_EXPR(expr)->call.target;
-    if (!chimp_compile_ast_expr (c, target)) {
+    /* escape analysis, such as it is: the method bound by `x.name(...)`
+     * is only ever seen by the CALL, so it can live in a temp belonging to
+     * this frame. a tail call outlives the frame, so it gets a real one.
+     */
+    if (CHIMP_AST_EXPR(target)->type == CHIMP_AST_EXPR_GETATTR && !tail) {
+        if (!chimp_compile_ast_expr (c,
+                CHIMP_AST_EXPR(target)->getattr.target)) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_code_getmethod (code,
+                CHIMP_AST_EXPR(target)->getattr.attr)) {
+            return CHIMP_FALSE;
+        }
+    }
+    else if (!chimp_compile_ast_expr (c, target)) {
         return CHIMP_FALSE;
     }
 
@@ -1509,11 +2156,18 @@ chimp_compile_ast_expr_call (ChimpCodeCompiler *c, ChimpRef *expr)
         }
     }
 
-    if (!chimp_code_call (code, CHIMP_ARRAY_SIZE(args))) {
-        return CHIMP_FALSE;
+    if (tail) {
+        return chimp_code_tailcall (code, CHIMP_ARRAY_SIZE(args));
+    }
+    else {
+        return chimp_code_call (code, CHIMP_ARRAY_SIZE(args));
     }
+}
 
-    return CHIMP_TRUE;
+static chimp_bool_t
+chimp_compile_ast_expr_call (ChimpCodeCompiler *c, ChimpRef *expr)
+{
+    return chimp_compile_call (c, expr, CHIMP_FALSE);
 }
 
 static chimp_bool_t
@@ -1586,7 +2240,13 @@ chimp_compile_ast_expr_ident (ChimpCodeCompiler *c, ChimpRef *expr)
         }
     }
     else {
-        if (!chimp_code_pushname (code, id)) {
+        int reg = chimp_compile_reg_for_var (c, id);
+        if (reg != CHIMP_REG_STACK) {
+            if (!chimp_code_move (code, CHIMP_REG_STACK, reg)) {
+                return CHIMP_FALSE;
+            }
+        }
+        else if (!chimp_code_pushname (code, id)) {
             return CHIMP_FALSE;
         }
     }
@@ -1672,6 +2332,15 @@ static chimp_bool_t
 chimp_compile_ast_expr_binop (ChimpCodeCompiler *c, ChimpRef *expr)
 {
     ChimpRef *code = CHIMP_COMPILER_CODE(c);
+
+    if (chimp_compile_regop_for (c, expr) >= 0 &&
+            (chimp_compile_reg (c, CHIMP_AST_EXPR(expr)->binop.left) !=
+                CHIMP_REG_STACK ||
+             chimp_compile_reg (c, CHIMP_AST_EXPR(expr)->binop.right) !=
+                CHIMP_REG_STACK)) {
+        return chimp_compile_ast_expr_regop (c, expr, CHIMP_REG_STACK);
+    }
+
     if (!chimp_compile_ast_expr (c, CHIMP_AST_EXPR(expr)->binop.left)) {
         return CHIMP_FALSE;
     }
@@ -1916,7 +2585,7 @@ chimp_compile_ast_expr_spawn (ChimpCodeCompiler *c, ChimpRef *expr)
         return CHIMP_FALSE;
     }
 
-    if (!chimp_code_getattr (code, CHIMP_STR_NEW ("send"))) {
+    if (!chimp_code_getmethod (code, CHIMP_STR_NEW ("send"))) {
         return CHIMP_FALSE;
     }
 
@@ -2029,7 +2698,7 @@ is_file (const char *filename, chimp_bool_t *result)
 }
 
 ChimpRef *
-chimp_compile_file (ChimpRef *name, const char *filename)
+chimp_parse_file (const char *filename)
 {
     int rc;
     ChimpRef *filename_obj;
@@ -2065,36 +2734,41 @@ chimp_compile_file (ChimpRef *name, const char *filename)
     rc = yyparse(scanner, filename_obj, &mod);
     fclose (input);
     yylex_destroy (scanner);
-    if (rc == 0) {
-        /* keep a ptr to main_mod on the stack so it doesn't get collected */
-        if (name == NULL) {
-            ssize_t slash = -1;
-            ssize_t dot = -1;
-            size_t i;
-            size_t len = strlen (filename);
-
-            /* XXX this is just a shit O(n) basename() impl */
-            for (i = 0; i < len; i++) {
-                if (filename[i] == '/') {
-                    slash = i + 1;
-                    dot = -1;
-                }
-                else if (filename[i] == '.' && dot == -1) {
-                    dot = i;
-                }
-            }
-            if (dot == -1) dot = len;
-            if (slash == -1) slash = 0;
+    return rc == 0 ? mod : NULL;
+}
 
-            name = chimp_str_new (filename + slash, dot - slash);
-            if (name == NULL) {
-                return NULL;
+ChimpRef *
+chimp_compile_file (ChimpRef *name, const char *filename)
+{
+    /* keep a ptr to mod on the stack so it doesn't get collected */
+    ChimpRef *mod = chimp_parse_file (filename);
+    if (mod == NULL) {
+        return NULL;
+    }
+    if (name == NULL) {
+        ssize_t slash = -1;
+        ssize_t dot = -1;
+        size_t i;
+        size_t len = strlen (filename);
+
+        /* XXX this is just a shit O(n) basename() impl */
+        for (i = 0; i < len; i++) {
+            if (filename[i] == '/') {
+                slash = i + 1;
+                dot = -1;
+            }
+            else if (filename[i] == '.' && dot == -1) {
+                dot = i;
             }
         }
-        return chimp_compile_ast (name, filename, mod);
-    }
-    else {
-        return NULL;
+        if (dot == -1) dot = len;
+        if (slash == -1) slash = 0;
+
+        name = chimp_str_new (filename + slash, dot - slash);
+        if (name == NULL) {
+            return NULL;
+        }
     }
+    return chimp_compile_ast (name, filename, mod);
 }
 
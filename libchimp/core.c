@@ -187,8 +187,9 @@ chimp_str_str (ChimpRef *self)
     return self;
 }
 
+/* the (unbound) method called name on self's class or one of its bases */
 static ChimpRef *
-_chimp_object_getattr (ChimpRef *self, ChimpRef *name)
+chimp_object_find_method (ChimpRef *self, ChimpRef *name)
 {
     /* TODO check CHIMP_ANY(self)->attributes ? */
     ChimpRef *class = CHIMP_ANY_CLASS(self);
@@ -200,14 +201,51 @@ _chimp_object_getattr (ChimpRef *self, ChimpRef *name)
                 class = CHIMP_CLASS(class)->super;
                 continue;
             }
-            /* XXX binding on every access is probably dumb/slow */
-            return chimp_method_new_bound (method, self);
+            return method;
         }
         else break;
     }
     return NULL;
 }
 
+static ChimpRef *
+_chimp_object_getattr (ChimpRef *self, ChimpRef *name)
+{
+    ChimpRef *method = chimp_object_find_method (self, name);
+    if (method == NULL) {
+        return NULL;
+    }
+    /* XXX binding on every access is probably dumb/slow */
+    return chimp_method_new_bound (method, self);
+}
+
+ChimpRef *
+chimp_object_getmethod (ChimpRef *self, ChimpRef *name, ChimpRef **scratch)
+{
+    ChimpRef *method;
+
+    if (CHIMP_CLASS(CHIMP_ANY_CLASS(self))->getattr != _chimp_object_getattr) {
+        return chimp_object_getattr (self, name);
+    }
+    method = chimp_object_find_method (self, name);
+    if (method == NULL) {
+        return NULL;
+    }
+    /* pooled frames hold on to the bytecode method they last ran, so
+     * only native methods can be bound into scratch.
+     */
+    if (CHIMP_METHOD_TYPE(method) != CHIMP_METHOD_TYPE_NATIVE) {
+        return chimp_method_new_bound (method, self);
+    }
+    if (*scratch == NULL) {
+        *scratch = chimp_method_new_bound (method, self);
+    }
+    else {
+        chimp_method_rebind (*scratch, method, self);
+    }
+    return *scratch;
+}
+
 static ChimpRef *
 chimp_class_getattr (ChimpRef *self, ChimpRef *name)
 {
@@ -104,7 +104,12 @@ chimp_float_class_bootstrap (void)
 ChimpRef* 
 chimp_float_new (double value)
 {
-    ChimpRef *ref = chimp_class_new_instance (chimp_float_class, NULL);
+    /* skip chimp_class_new_instance: we don't need an args array */
+    ChimpRef *ref = chimp_gc_new_object (NULL);
+    if (ref == NULL) {
+        return NULL;
+    }
+    CHIMP_ANY(ref)->klass = chimp_float_class;
     CHIMP_FLOAT(ref)->value = value;
     return ref;
 }
@@ -24,14 +24,9 @@
 ChimpRef *chimp_frame_class = NULL;
 
 static ChimpRef *
-_chimp_frame_init (ChimpRef *self, ChimpRef *args)
+chimp_frame_init (ChimpRef *self, ChimpRef *method)
 {
     ChimpRef *locals;
-    ChimpRef *method;
-
-    if (!chimp_method_parse_args (args, "o", &method)) {
-        return NULL;
-    }
 
     locals = chimp_hash_new ();
     if (locals == NULL) {
@@ -51,6 +46,12 @@ _chimp_frame_init (ChimpRef *self, ChimpRef *args)
             code = CHIMP_METHOD(method)->closure.code;
         }
 
+        CHIMP_FRAME(self)->slots = chimp_array_new_with_capacity (
+            CHIMP_ARRAY_SIZE(CHIMP_CODE(code)->vars));
+        if (CHIMP_FRAME(self)->slots == NULL) {
+            return NULL;
+        }
+
         /* allocate ChimpVar entries in `locals` for each non-free var */
         for (i = 0; i < CHIMP_ARRAY_SIZE(CHIMP_CODE(code)->vars); i++) {
             ChimpRef *varname =
@@ -59,6 +60,9 @@ _chimp_frame_init (ChimpRef *self, ChimpRef *args)
             if (!chimp_hash_put (CHIMP_FRAME(self)->locals, varname, var)) {
                 return CHIMP_FALSE;
             }
+            if (!chimp_array_push (CHIMP_FRAME(self)->slots, var)) {
+                return CHIMP_FALSE;
+            }
         }
 
         if (CHIMP_METHOD_TYPE(method) == CHIMP_METHOD_TYPE_CLOSURE) {
@@ -75,6 +79,18 @@ _chimp_frame_init (ChimpRef *self, ChimpRef *args)
     return self;
 }
 
+static ChimpRef *
+_chimp_frame_init (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *method;
+
+    if (!chimp_method_parse_args (args, "o", &method)) {
+        return NULL;
+    }
+
+    return chimp_frame_init (self, method);
+}
+
 static void
 _chimp_frame_mark (ChimpGC *gc, ChimpRef *self)
 {
@@ -82,6 +98,8 @@ _chimp_frame_mark (ChimpGC *gc, ChimpRef *self)
 
     chimp_gc_mark_ref (gc, CHIMP_FRAME(self)->method);
     chimp_gc_mark_ref (gc, CHIMP_FRAME(self)->locals);
+    chimp_gc_mark_ref (gc, CHIMP_FRAME(self)->slots);
+    chimp_gc_mark_ref (gc, CHIMP_FRAME(self)->temps);
 }
 
 chimp_bool_t
@@ -101,6 +119,34 @@ chimp_frame_class_bootstrap (void)
 ChimpRef *
 chimp_frame_new (ChimpRef *method)
 {
-    return chimp_class_new_instance (chimp_frame_class, method, NULL);
+    /* skip chimp_class_new_instance: we don't need an args array */
+    ChimpRef *ref = chimp_gc_new_object (NULL);
+    if (ref == NULL) {
+        return NULL;
+    }
+    CHIMP_ANY(ref)->klass = chimp_frame_class;
+    return chimp_frame_init (ref, method);
+}
+
+void
+chimp_frame_clear (ChimpRef *self)
+{
+    ChimpRef *slots = CHIMP_FRAME(self)->slots;
+    ChimpRef *temps = CHIMP_FRAME(self)->temps;
+    size_t i;
+
+    if (slots != NULL) {
+        for (i = 0; i < CHIMP_ARRAY_SIZE(slots); i++) {
+            CHIMP_VAR(CHIMP_ARRAY_ITEM(slots, i))->value = NULL;
+        }
+    }
+    if (temps != NULL) {
+        for (i = 0; i < CHIMP_ARRAY_SIZE(temps); i++) {
+            CHIMP_METHOD(CHIMP_ARRAY_ITEM(temps, i))->self = NULL;
+        }
+    }
+    CHIMP_FRAME(self)->ntemps = 0;
+    CHIMP_FRAME(self)->pc = 0;
+    CHIMP_FRAME(self)->stack_base = 0;
 }
 
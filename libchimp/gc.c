@@ -16,6 +16,8 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <pthread.h>
+
 #ifdef HAVE_VALGRIND
 #include <valgrind/memcheck.h>
 #else
@@ -31,6 +33,12 @@
 /* 64k default heap (CHIMP_VALUE_SIZE * DEFAULT_SLAB_SIZE) */
 #define DEFAULT_SLAB_SIZE 256
 
+/* finished tasks hand their GC back for reuse by the next spawned task */
+#define MAX_RECYCLED_GCS 16
+
+/* don't hang on to heaps that grew large: just give the memory back */
+#define MAX_RECYCLED_SLABS 4
+
 struct _ChimpRef {
     chimp_bool_t marked;
     struct _ChimpRef *next;
@@ -62,8 +70,14 @@ struct _ChimpGC {
 
     void      *stack_start;
     uint64_t   collection_count;
+
+    struct _ChimpGC *next_recycled;
 };
 
+static pthread_mutex_t recycled_lock = PTHREAD_MUTEX_INITIALIZER;
+static ChimpGC *recycled = NULL;
+static size_t num_recycled = 0;
+
 #define CHIMP_HEAP_CURRENT_SLAB(heap) \
     (heap)->slabs[(heap)->slab_count - 1]
 
@@ -114,6 +128,24 @@ chimp_heap_init (ChimpHeap *heap, size_t slab_size)
     return CHIMP_TRUE;
 }
 
+/* relink every ref in every slab into a single free list */
+static ChimpRef *
+chimp_heap_reset (ChimpHeap *heap)
+{
+    size_t i, j;
+    ChimpRef *free_ = NULL;
+
+    for (i = heap->slab_count; i > 0; i--) {
+        ChimpRef *refs = heap->slabs[i-1]->refs;
+        for (j = heap->slab_size; j > 0; j--) {
+            refs[j-1].next = free_;
+            free_ = refs + (j-1);
+        }
+    }
+    heap->used = 0;
+    return free_;
+}
+
 static void
 chimp_heap_destroy (ChimpHeap *heap)
 {
@@ -202,17 +234,81 @@ chimp_gc_value_dtor (ChimpGC *gc, ChimpRef *ref)
     }
 }
 
+static void
+chimp_gc_destroy_live (ChimpGC *gc)
+{
+    ChimpRef *live = gc->live;
+    while (live != NULL) {
+        ChimpRef *next = live->next;
+        chimp_gc_value_dtor (gc, live);
+        live = next;
+    }
+    gc->live = NULL;
+}
+
+ChimpGC *
+chimp_gc_acquire (void *stack_start, chimp_bool_t *was_recycled)
+{
+    ChimpGC *gc;
+
+    pthread_mutex_lock (&recycled_lock);
+    gc = recycled;
+    if (gc != NULL) {
+        recycled = gc->next_recycled;
+        num_recycled--;
+    }
+    pthread_mutex_unlock (&recycled_lock);
+
+    if (was_recycled != NULL) {
+        *was_recycled = (gc != NULL);
+    }
+
+    if (gc == NULL) {
+        return chimp_gc_new (stack_start);
+    }
+    gc->next_recycled = NULL;
+    gc->stack_start = stack_start;
+    return gc;
+}
+
+void
+chimp_gc_release (ChimpGC *gc)
+{
+    if (gc == NULL) {
+        return;
+    }
+
+    if (gc->heap.slab_count > MAX_RECYCLED_SLABS) {
+        chimp_gc_delete (gc);
+        return;
+    }
+
+    chimp_gc_destroy_live (gc);
+    gc->free = chimp_heap_reset (&gc->heap);
+    gc->num_roots = 0;
+    gc->stack_start = NULL;
+    gc->collection_count = 0;
+
+    pthread_mutex_lock (&recycled_lock);
+    if (num_recycled < MAX_RECYCLED_GCS) {
+        gc->next_recycled = recycled;
+        recycled = gc;
+        num_recycled++;
+        gc = NULL;
+    }
+    pthread_mutex_unlock (&recycled_lock);
+
+    /* the recycle bin is full */
+    if (gc != NULL) {
+        chimp_gc_delete (gc);
+    }
+}
+
 void
 chimp_gc_delete (ChimpGC *gc)
 {
     if (gc != NULL) {
-        ChimpRef *live = gc->live;
-        while (live != NULL) {
-            ChimpRef *next = live->next;
-            chimp_gc_value_dtor (gc, live);
-            live = next;
-        }
-        gc->live = NULL;
+        chimp_gc_destroy_live (gc);
 
         chimp_heap_destroy (&gc->heap);
         CHIMP_FREE (gc->roots);
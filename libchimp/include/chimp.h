@@ -35,6 +35,8 @@
 #include <chimp/ast.h>
 #include <chimp/code.h>
 #include <chimp/compile.h>
+#include <chimp/code_cache.h>
+#include <chimp/jit.h>
 
 #endif
 
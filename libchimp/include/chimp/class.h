@@ -66,6 +66,15 @@ chimp_class_add_method (ChimpRef *klass, ChimpRef *name, ChimpRef *method);
 chimp_bool_t
 chimp_class_add_native_method (ChimpRef *klass, const char *name, ChimpNativeMethodFunc func);
 
+/* sig is checked here, once: see ChimpNativeSig */
+chimp_bool_t
+chimp_class_add_native_argv_method (
+    ChimpRef *klass,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc func
+);
+
 chimp_bool_t
 _chimp_bootstrap_L3 (void);
 
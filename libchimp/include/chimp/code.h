@@ -63,7 +63,34 @@ typedef enum _ChimpOpcode {
     CHIMP_OPCODE_MAKECLOSURE,
 
     /* XXX temporary until we get a better way to do it */
-    CHIMP_OPCODE_GETCLASS
+    CHIMP_OPCODE_GETCLASS,
+
+    /* prefix: bits 24-47 of the next instruction's operand */
+    CHIMP_OPCODE_EXTENDEDARG,
+
+    /* three-address register instructions (see CHIMP_INSTR_REG_*) */
+    CHIMP_OPCODE_MOVE,
+    CHIMP_OPCODE_ADDR,
+    CHIMP_OPCODE_SUBR,
+    CHIMP_OPCODE_MULR,
+    CHIMP_OPCODE_DIVR,
+    CHIMP_OPCODE_CMPEQR,
+    CHIMP_OPCODE_CMPNEQR,
+    CHIMP_OPCODE_CMPGTR,
+    CHIMP_OPCODE_CMPGTER,
+    CHIMP_OPCODE_CMPLTR,
+    CHIMP_OPCODE_CMPLTER,
+
+    /* CALL + RET, reusing the caller's frame */
+    CHIMP_OPCODE_TAILCALL,
+
+    /* GETATTR for the target of a CALL: see chimp_vm_getmethod */
+    CHIMP_OPCODE_GETMETHOD,
+
+    /* jump to the address a hash constant maps the top of the stack to
+     * (a str or int), or fall through if it has none.
+     */
+    CHIMP_OPCODE_SWITCH
 } ChimpOpcode;
 
 typedef enum _ChimpBinopType {
@@ -81,6 +108,11 @@ typedef enum _ChimpBinopType {
     CHIMP_BINOP_DIV
 } ChimpBinopType;
 
+struct _ChimpVM;
+
+typedef chimp_bool_t (*ChimpJitFunc)(
+    struct _ChimpVM *vm, ChimpRef *code, ChimpRef *frame);
+
 typedef struct _ChimpCode {
     ChimpAny base;
     ChimpRef *constants;
@@ -90,6 +122,10 @@ typedef struct _ChimpCode {
     size_t    allocated;
     ChimpRef *vars;
     ChimpRef *freevars;
+    /* native code for this code object once it's hot (see jit.h) */
+    uint32_t     calls;
+    ChimpJitFunc jit;
+    size_t       jit_size;
 } ChimpCode;
 
 typedef struct _ChimpLabel {
@@ -123,11 +159,18 @@ chimp_code_getclass (ChimpRef *self);
 chimp_bool_t
 chimp_code_getattr (ChimpRef *self, ChimpRef *id);
 
+/* like getattr, but the result must only ever be the target of a call */
+chimp_bool_t
+chimp_code_getmethod (ChimpRef *self, ChimpRef *id);
+
 chimp_bool_t
 chimp_code_getitem (ChimpRef *self);
 
 chimp_bool_t
-chimp_code_call (ChimpRef *self, uint8_t nargs);
+chimp_code_call (ChimpRef *self, size_t nargs);
+
+chimp_bool_t
+chimp_code_tailcall (ChimpRef *self, size_t nargs);
 
 chimp_bool_t
 chimp_code_ret (ChimpRef *self);
@@ -142,10 +185,10 @@ chimp_bool_t
 chimp_code_spawn (ChimpRef *self);
 
 chimp_bool_t
-chimp_code_makearray (ChimpRef *self, uint8_t nargs);
+chimp_code_makearray (ChimpRef *self, size_t nargs);
 
 chimp_bool_t
-chimp_code_makehash (ChimpRef *self, uint8_t nargs);
+chimp_code_makehash (ChimpRef *self, size_t nargs);
 
 chimp_bool_t
 chimp_code_makeclosure (ChimpRef *self);
@@ -159,6 +202,12 @@ chimp_code_jumpiffalse (ChimpRef *self, ChimpLabel *label);
 chimp_bool_t
 chimp_code_jump (ChimpRef *self, ChimpLabel *label);
 
+/* table maps str & int keys to code addresses. it isn't shared with any
+ * other instruction, so entries can be added once their code is emitted.
+ */
+chimp_bool_t
+chimp_code_switch (ChimpRef *self, ChimpRef *table);
+
 chimp_bool_t
 chimp_code_eq (ChimpRef *self);
 
@@ -192,6 +241,18 @@ chimp_code_div (ChimpRef *self);
 chimp_bool_t
 chimp_code_pop (ChimpRef *self);
 
+int
+chimp_code_reg_for_var (ChimpRef *self, ChimpRef *id);
+
+int
+chimp_code_reg_for_const (ChimpRef *self, ChimpRef *value);
+
+chimp_bool_t
+chimp_code_move (ChimpRef *self, int dst, int src);
+
+chimp_bool_t
+chimp_code_regop (ChimpRef *self, ChimpOpcode op, int dst, int left, int right);
+
 ChimpRef *
 chimp_code_dump (ChimpRef *self);
 
@@ -207,36 +268,49 @@ chimp_label_free (ChimpLabel *self);
 
 #define CHIMP_CODE_INSTR(ref, n) CHIMP_CODE(ref)->bytecode[n]
 
+/* an instruction is an 8-bit opcode & a 24-bit operand. the rare operand
+ * that doesn't fit gets an EXTENDEDARG prefix holding its next 24 bits,
+ * so decoding an operand is a mask plus one well-predicted look back.
+ */
+#define CHIMP_INSTR_ARG_BITS 24
+#define CHIMP_INSTR_ARG_MAX  0x00ffffff
+
 #define CHIMP_INSTR_OP(ref, n) ((ChimpOpcode)((CHIMP_CODE_INSTR(ref, n) & 0xff000000) >> 24))
-#define CHIMP_INSTR_ADDR(ref, n) (CHIMP_CODE_INSTR(ref, n) & 0x00ffffff)
+#define CHIMP_INSTR_ARG(ref, n) (CHIMP_CODE_INSTR(ref, n) & CHIMP_INSTR_ARG_MAX)
 
-#define CHIMP_INSTR_ARG1(ref, n) ((CHIMP_CODE_INSTR(ref, n) & 0x00ff0000) >> 16)
-#define CHIMP_INSTR_ARG2(ref, n) ((CHIMP_CODE_INSTR(ref, n) & 0x0000ff00) >> 8)
-#define CHIMP_INSTR_ARG3(ref, n) ((CHIMP_CODE_INSTR(ref, n) & 0x000000ff))
+#define CHIMP_INSTR_EXT(ref, n) \
+    (((n) > 0 && CHIMP_INSTR_OP(ref, (n)-1) == CHIMP_OPCODE_EXTENDEDARG) ? \
+        ((size_t) CHIMP_INSTR_ARG(ref, (n)-1) << CHIMP_INSTR_ARG_BITS) : 0)
 
-/* constants */
+#define CHIMP_INSTR_OPERAND(ref, n) \
+    (CHIMP_INSTR_EXT(ref, n) | (size_t) CHIMP_INSTR_ARG(ref, n))
 
-#define CHIMP_INSTR_CONST1(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(ref), CHIMP_INSTR_ARG1(ref, n))
+#define CHIMP_INSTR_ADDR(ref, n) CHIMP_INSTR_OPERAND(ref, n)
 
-#define CHIMP_INSTR_CONST2(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(ref), CHIMP_INSTR_ARG2(ref, n))
+/* constants */
 
-#define CHIMP_INSTR_CONST3(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(ref), CHIMP_INSTR_ARG3(ref, n))
+#define CHIMP_INSTR_CONST(ref, n) \
+    CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(ref), CHIMP_INSTR_OPERAND(ref, n))
 
 /* names */
 
-#define CHIMP_INSTR_NAME1(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_NAMES(ref), CHIMP_INSTR_ARG1(ref, n))
+#define CHIMP_INSTR_NAME(ref, n) \
+    CHIMP_ARRAY_ITEM(CHIMP_CODE_NAMES(ref), CHIMP_INSTR_OPERAND(ref, n))
 
-#define CHIMP_INSTR_NAME2(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_NAMES(ref), CHIMP_INSTR_ARG2(ref, n))
+/* register instructions pack three 8-bit operands: dst, left & right.
+ * an operand names one of the first 128 vars of the code object (its
+ * frame slot), one of the first 127 constants, or the value stack: as a
+ * source that pops, as a destination it pushes.
+ */
+#define CHIMP_REG_CONST 0x80
+#define CHIMP_REG_STACK 0xff
 
-#define CHIMP_INSTR_NAME3(ref, n) \
-    CHIMP_ARRAY_ITEM(CHIMP_CODE_NAMES(ref), CHIMP_INSTR_ARG3(ref, n))
+#define CHIMP_INSTR_REG_DST(ref, n)   ((CHIMP_CODE_INSTR(ref, n) >> 16) & 0xff)
+#define CHIMP_INSTR_REG_LEFT(ref, n)  ((CHIMP_CODE_INSTR(ref, n) >> 8) & 0xff)
+#define CHIMP_INSTR_REG_RIGHT(ref, n) (CHIMP_CODE_INSTR(ref, n) & 0xff)
 
 #define CHIMP_CODE_SIZE(ref) CHIMP_CODE(ref)->used
+#define CHIMP_CODE_JIT(ref) CHIMP_CODE(ref)->jit
 #define CHIMP_CODE_CONSTANTS(ref) CHIMP_CODE(ref)->constants
 #define CHIMP_CODE_NAMES(ref) CHIMP_CODE(ref)->names
 
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+#ifndef _CHIMP_CODE_CACHE_H_INCLUDED_
+#define _CHIMP_CODE_CACHE_H_INCLUDED_
+
+#include <chimp/any.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* compiled modules can be saved next to their source as foo.chimpc &
+ * loaded back without going anywhere near the parser or compiler.
+ *
+ * bump CHIMP_CODE_CACHE_VERSION whenever the bytecode or the file format
+ * changes: caches from other versions are ignored.
+ */
+#define CHIMP_CODE_CACHE_VERSION 7
+
+#define CHIMP_CODE_CACHE_SUFFIX "c"
+
+/* loads the module compiled from filename out of its .chimpc. returns
+ * chimp_nil if there's no cache, or if it's stale, corrupt or refers to
+ * constants, names, vars or code addresses that don't exist, in which
+ * case the caller should compile filename as usual. name may be NULL, in
+ * which case the module takes the name it was compiled with.
+ */
+ChimpRef *
+chimp_code_cache_load (ChimpRef *name, const char *filename);
+
+/* serializes module (compiled from filename) into filename's .chimpc */
+chimp_bool_t
+chimp_code_cache_write (ChimpRef *module, const char *filename);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
+
@@ -31,6 +31,10 @@ chimp_compile_ast (ChimpRef *name, const char *filename, ChimpRef *ast);
 ChimpRef *
 chimp_compile_file (ChimpRef *name, const char *filename);
 
+/* parses filename into an AST without compiling it */
+ChimpRef *
+chimp_parse_file (const char *filename);
+
 #define CHIMP_COMPILE_MODULE_FROM_AST(name, ast) \
     chimp_compile_ast (chimp_str_new ((name), strlen(name)), (ast))
 
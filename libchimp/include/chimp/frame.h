@@ -30,6 +30,22 @@ typedef struct _ChimpFrame {
     ChimpAny   base;
     ChimpRef  *method;
     ChimpRef  *locals;
+    /* the vars in `locals`, in CHIMP_CODE(code)->vars order */
+    ChimpRef  *slots;
+    /* where to resume when a call made from this frame returns (or the
+     * TAILCALL native code handed back: see chimp_vm_tailcall)
+     */
+    size_t     pc;
+    /* the size of the value stack before the args were pushed */
+    size_t     stack_base;
+    /* a closure holds on to one of our vars, so we can't be reused */
+    chimp_bool_t captured;
+    /* bound methods for GETMETHOD to reuse: the first `ntemps` are the
+     * targets of calls still being set up, the rest are free. see
+     * chimp_vm_getmethod.
+     */
+    ChimpRef  *temps;
+    size_t     ntemps;
 } ChimpFrame;
 
 chimp_bool_t
@@ -38,6 +54,12 @@ chimp_frame_class_bootstrap (void);
 ChimpRef *
 chimp_frame_new (ChimpRef *method);
 
+/* forget the values of all vars (& everything the temps were bound to)
+ * so the frame can be reused for another call to the same code.
+ */
+void
+chimp_frame_clear (ChimpRef *self);
+
 #define CHIMP_FRAME(ref) \
     CHIMP_CHECK_CAST(ChimpFrame, (ref), chimp_frame_class)
 
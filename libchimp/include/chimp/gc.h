@@ -63,6 +63,12 @@ chimp_gc_new (void *stack_start);
 void
 chimp_gc_delete (ChimpGC *gc);
 
+ChimpGC *
+chimp_gc_acquire (void *stack_start, chimp_bool_t *was_recycled);
+
+void
+chimp_gc_release (ChimpGC *gc);
+
 ChimpRef *
 chimp_gc_new_object (ChimpGC *gc);
 
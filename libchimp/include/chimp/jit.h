@@ -0,0 +1,66 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+
+#ifndef _CHIMP_JIT_H_INCLUDED_
+#define _CHIMP_JIT_H_INCLUDED_
+
+#include <chimp/any.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a baseline JIT for x86-64 Linux: code objects that get hot are
+ * translated to machine code by stitching together a template per
+ * instruction, each calling the same op functions as the interpreter.
+ *
+ * it's off unless CHIMP_JIT is set in the environment (or the library
+ * was built with the CHIMP_JIT cmake option, in which case CHIMP_JIT=0
+ * turns it off).
+ */
+#if defined(__x86_64__) && defined(__linux__) && !defined(CHIMP_NO_JIT)
+#define CHIMP_HAVE_JIT 1
+#endif
+
+/* calls before a code object is compiled. CHIMP_JIT_THRESHOLD in the
+ * environment overrides it.
+ */
+#define CHIMP_JIT_DEFAULT_THRESHOLD 1000
+
+chimp_bool_t
+chimp_jit_enabled (void);
+
+uint32_t
+chimp_jit_threshold (void);
+
+/* translates code, installing the result as CHIMP_CODE(code)->jit. code
+ * that can't be translated is left to the interpreter.
+ */
+chimp_bool_t
+chimp_jit_compile (ChimpRef *code);
+
+void
+chimp_jit_free (ChimpRef *code);
+
+#ifdef __cplusplus
+};
+#endif
+
+#endif
+
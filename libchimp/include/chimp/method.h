@@ -34,6 +34,33 @@ typedef enum _ChimpMethodType {
 
 typedef ChimpRef *(*ChimpNativeMethodFunc)(ChimpRef *, ChimpRef *);
 
+/* like ChimpNativeMethodFunc, but the args arrive as a C array that's only
+ * good for the duration of the call. the VM can call these without
+ * building an args array, & they're checked against the method's
+ * signature first: argc is in range & every argv[i] has the right type.
+ */
+typedef ChimpRef *(*ChimpNativeMethodArgvFunc)(
+    ChimpRef *self, size_t argc, ChimpRef **argv);
+
+#define CHIMP_NATIVE_MAX_ARGS 8
+
+/* a signature uses the chimp_method_parse_args format characters:
+ *
+ *   o   any object
+ *   s   str
+ *   i/I int
+ *   |   the rest are optional
+ *   *   any number of objects after this (must come last)
+ *
+ * it's parsed once, when the method is created.
+ */
+typedef struct _ChimpNativeSig {
+    const char *name;
+    size_t      min;
+    size_t      max; /* SIZE_MAX for varargs */
+    char        types[CHIMP_NATIVE_MAX_ARGS];
+} ChimpNativeSig;
+
 typedef struct _ChimpMethod {
     ChimpAny         base;
     ChimpRef        *self; /* NULL for unbound/function */
@@ -41,7 +68,10 @@ typedef struct _ChimpMethod {
     ChimpRef        *module;
     union {
         struct {
-            ChimpNativeMethodFunc func;
+            /* exactly one of these is set */
+            ChimpNativeMethodFunc     func;
+            ChimpNativeMethodArgvFunc argv;
+            ChimpNativeSig            sig; /* argv only */
         } native;
         struct {
             ChimpRef *code;
@@ -59,6 +89,18 @@ chimp_method_class_bootstrap (void);
 ChimpRef *
 chimp_method_new_native (ChimpRef *module, ChimpNativeMethodFunc func);
 
+ChimpRef *
+chimp_method_new_native_argv (
+    ChimpRef *module,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc func
+);
+
+/* checks args against self's signature, then calls it */
+ChimpRef *
+chimp_method_call_argv (ChimpRef *self, size_t argc, ChimpRef **argv);
+
 ChimpRef *
 chimp_method_new_bytecode (ChimpRef *module, ChimpRef *code);
 
@@ -68,6 +110,10 @@ chimp_method_new_closure (ChimpRef *method, ChimpRef *bindings);
 ChimpRef *
 chimp_method_new_bound (ChimpRef *unbound, ChimpRef *self);
 
+/* turns an existing bound method into unbound bound to self, in place */
+void
+chimp_method_rebind (ChimpRef *bound, ChimpRef *unbound, ChimpRef *self);
+
 chimp_bool_t
 chimp_method_no_args (ChimpRef *args);
 
@@ -79,6 +125,10 @@ chimp_method_parse_args (ChimpRef *args, const char *fmt, ...);
 #define CHIMP_METHOD_TYPE(ref) (CHIMP_METHOD(ref)->type)
 
 #define CHIMP_NATIVE_METHOD(ref) (&(CHIMP_METHOD(ref)->native))
+
+/* argv[i] of an argv method as a C int, or dflt if it wasn't passed */
+#define CHIMP_ARGV_INT(argc, argv, i, dflt) \
+    ((i) < (argc) ? CHIMP_INT((argv)[i])->value : (dflt))
 #define CHIMP_BYTECODE_METHOD(ref) (&(CHIMP_METHOD(ref)->bytecode))
 #define CHIMP_CLOSURE_METHOD(ref) (&(CHIMP_METHOD(ref)->closure))
 
@@ -51,6 +51,14 @@ chimp_module_add_method_str (
     ChimpNativeMethodFunc impl
 );
 
+chimp_bool_t
+chimp_module_add_argv_method_str (
+    ChimpRef *self,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc impl
+);
+
 chimp_bool_t
 chimp_module_add_local (
     ChimpRef *self,
@@ -19,6 +19,13 @@ chimp_module_mgr_load (ChimpRef *name);
 ChimpRef *
 chimp_module_mgr_compile (ChimpRef *name, ChimpRef *filename);
 
+/* makes sure every module pulled in by uses (an array of use decls) is
+ * loaded, compiling the ones that don't depend on each other in parallel.
+ * loads of modules that are already loaded never wait on the manager.
+ */
+chimp_bool_t
+chimp_module_mgr_load_uses (ChimpRef *uses);
+
 #ifdef __cplusplus
 };
 #endif
@@ -47,6 +47,16 @@ chimp_init_net_module (void);
 ChimpRef *
 chimp_init_http_module (void);
 
+ChimpRef *
+chimp_init_task_module (void);
+
+/* the calling task's buffered stdout (see io.print & io.flush) */
+void
+chimp_io_output (const char *data, size_t size);
+
+void
+chimp_io_flush_output (void);
+
 #ifdef __cplusplus
 };
 #endif
@@ -37,14 +37,17 @@ typedef struct _ChimpMsgCell {
         CHIMP_MSG_CELL_ARRAY,
         CHIMP_MSG_CELL_MODULE,
         CHIMP_MSG_CELL_METHOD,
-        CHIMP_MSG_CELL_TASK
+        CHIMP_MSG_CELL_TASK,
+        CHIMP_MSG_CELL_FLOAT,
+        CHIMP_MSG_CELL_ERROR
     } type;
     union {
         int64_t  int_;
+        double   float_;
         struct {
             char    *data;
             size_t   size;
-        } str;
+        } str;      /* strs & error messages */
         struct {
             struct _ChimpMsgCell *items;
             size_t                size;
@@ -57,6 +60,7 @@ typedef struct _ChimpMsgCell {
 
 typedef struct _ChimpMsgInternal {
     size_t                    size;
+    uint64_t                  tag;  /* 0 unless it's a reply (see recv_tagged) */
     ChimpMsgCell             *cell;
     struct _ChimpMsgInternal *next;
 } ChimpMsgInternal;
@@ -72,6 +72,14 @@ chimp_object_call_method (ChimpRef *target, const char *name, ChimpRef *args);
 ChimpRef *
 chimp_object_getattr (ChimpRef *self, ChimpRef *name);
 
+/* getattr for a value that's only going to be called. a method found on
+ * self's class is bound into *scratch (or a new bound method stored there
+ * if *scratch is NULL) instead of a fresh object, so the caller must be
+ * done calling the result before it reuses *scratch.
+ */
+ChimpRef *
+chimp_object_getmethod (ChimpRef *self, ChimpRef *name, ChimpRef **scratch);
+
 ChimpRef *
 chimp_object_getitem (ChimpRef *self, ChimpRef *key);
 
@@ -32,6 +32,8 @@ typedef struct _ChimpStr {
     ChimpAny  base;
     char     *data;
     size_t    size;
+    size_t    mapped;   /* length of the mapping if data is mmap'd, else 0 */
+    chimp_bool_t buffer; /* made by io.buffer, so file.read_into may reuse it */
 } ChimpStr;
 
 int
@@ -43,6 +45,12 @@ chimp_str_new (const char *data, size_t size);
 ChimpRef *
 chimp_str_new_take (char *data, size_t size);
 
+/* takes ownership of an mmap'd region of the given length. data[size]
+ * must be readable & NUL.
+ */
+ChimpRef *
+chimp_str_new_mapped (char *data, size_t size, size_t mapped);
+
 ChimpRef *
 chimp_str_new_format (const char *fmt, ...);
 
@@ -57,6 +65,12 @@ chimp_str_new_concat (const char *a, ...);
 chimp_bool_t
 chimp_str_append (ChimpRef *str, ChimpRef *append_me);
 
+/* makes room for at least size bytes (plus the NUL) in the str's own
+ * buffer & returns it. the caller fills it in & updates the size.
+ */
+char *
+chimp_str_reserve (ChimpRef *str, size_t size);
+
 chimp_bool_t
 chimp_str_append_str (ChimpRef *str, const char *s);
 
@@ -33,12 +33,46 @@ typedef struct _ChimpTask {
     chimp_bool_t       local;
 } ChimpTask;
 
+typedef enum _ChimpTaskPriority {
+    CHIMP_TASK_PRIORITY_NORMAL,
+    CHIMP_TASK_PRIORITY_LOW,
+    CHIMP_TASK_PRIORITY_HIGH
+} ChimpTaskPriority;
+
+/* placement & scheduling hints for chimp_task_new_with_options */
+typedef struct _ChimpTaskOptions {
+    int               cpu;          /* pin to this CPU, or -1 */
+    int               node;         /* pin to this NUMA node, or -1 */
+    ChimpTaskPriority priority;
+    size_t            stack_size;   /* 0 for the default */
+} ChimpTaskOptions;
+
+#define CHIMP_TASK_OPTIONS_INIT { -1, -1, CHIMP_TASK_PRIORITY_NORMAL, 0 }
+
+/* how a task hears about another task exiting */
+typedef enum _ChimpTaskWatchKind {
+    CHIMP_TASK_WATCH_LINK,      /* ["exit", task, reason], failures only */
+    CHIMP_TASK_WATCH_MONITOR    /* ["down", task, reason] */
+} ChimpTaskWatchKind;
+
+/* counters describing task startup costs (see chimp_task_get_stats) */
+typedef struct _ChimpTaskStats {
+    uint64_t spawned;
+    uint64_t recycled;          /* tasks that started on a recycled GC */
+    uint64_t total_latency_ns;  /* chimp_task_new -> task running */
+    uint64_t max_latency_ns;
+} ChimpTaskStats;
+
 chimp_bool_t
 chimp_task_class_bootstrap (void);
 
 ChimpRef *
 chimp_task_new (ChimpRef *callable);
 
+ChimpRef *
+chimp_task_new_with_options (
+    ChimpRef *callable, const ChimpTaskOptions *options);
+
 ChimpRef *
 chimp_task_new_from_internal (ChimpTaskInternal *task);
 
@@ -54,6 +88,30 @@ chimp_task_main_delete ();
 void
 chimp_task_join (ChimpTaskInternal *task);
 
+void
+chimp_task_get_stats (ChimpTaskStats *stats);
+
+void
+chimp_task_keep_result (ChimpTaskInternal *task);
+
+ChimpRef *
+chimp_task_take_result (ChimpTaskInternal *task);
+
+chimp_bool_t
+chimp_task_wait (ChimpTaskInternal *task, int64_t timeout_ms);
+
+ssize_t
+chimp_task_wait_any (ChimpTaskInternal **tasks, size_t n, int64_t timeout_ms);
+
+chimp_bool_t
+chimp_task_wait_all (ChimpTaskInternal **tasks, size_t n, int64_t timeout_ms);
+
+chimp_bool_t
+chimp_task_link (ChimpTaskInternal *a, ChimpTaskInternal *b);
+
+chimp_bool_t
+chimp_task_monitor (ChimpTaskInternal *watcher, ChimpTaskInternal *task);
+
 void
 chimp_task_ref (ChimpTaskInternal *task);
 
@@ -63,9 +121,26 @@ chimp_task_unref (ChimpTaskInternal *task);
 chimp_bool_t
 chimp_task_send (ChimpRef *self, ChimpRef *value);
 
+/* a descriptor that polls readable while the task has messages waiting */
+int
+chimp_task_inbox_fd (ChimpTaskInternal *task);
+
 ChimpRef *
 chimp_task_recv (ChimpRef *self);
 
+/* replies to a request travel under a tag the requester made up with
+ * chimp_task_new_tag: recv_tagged waits for that reply alone, leaving any
+ * other messages queued for recv (which never sees tagged messages).
+ */
+uint64_t
+chimp_task_new_tag (void);
+
+chimp_bool_t
+chimp_task_send_tagged (ChimpRef *self, ChimpRef *value, uint64_t tag);
+
+ChimpRef *
+chimp_task_recv_tagged (ChimpRef *self, uint64_t tag);
+
 void
 chimp_task_mark (ChimpGC *gc, ChimpTaskInternal *task);
 
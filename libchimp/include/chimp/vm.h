@@ -21,6 +21,7 @@
 
 #include <chimp/gc.h>
 #include <chimp/any.h>
+#include <chimp/code.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,6 +46,19 @@ chimp_vm_invoke (ChimpVM *vm, ChimpRef *method, ChimpRef *args);
 void
 chimp_vm_panic (ChimpVM *vm, ChimpRef *value);
 
+/* the VM's implementation of a single (non control flow) instruction,
+ * shared by the interpreter & the JIT.
+ */
+typedef chimp_bool_t (*ChimpVMOpFunc)(
+    ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc);
+
+ChimpVMOpFunc
+chimp_vm_op_func (ChimpOpcode op);
+
+/* pops a value & tests it for truthiness: 1 or 0, or -1 on error */
+int
+chimp_vm_test (ChimpVM *vm);
+
 #ifdef __cplusplus
 };
 #endif
@@ -111,7 +111,12 @@ chimp_int_class_bootstrap (void)
 ChimpRef *
 chimp_int_new (int64_t value)
 {
-    ChimpRef *ref = chimp_class_new_instance (chimp_int_class, NULL);
+    /* skip chimp_class_new_instance: we don't need an args array */
+    ChimpRef *ref = chimp_gc_new_object (NULL);
+    if (ref == NULL) {
+        return NULL;
+    }
+    CHIMP_ANY(ref)->klass = chimp_int_class;
     CHIMP_INT(ref)->value = value;
     return ref;
 }
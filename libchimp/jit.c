@@ -0,0 +1,359 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+
+#include "chimp/jit.h"
+
+#ifdef CHIMP_HAVE_JIT
+
+#include <sys/mman.h>
+
+#include "chimp/code.h"
+#include "chimp/vm.h"
+
+/* registers holding the arguments of the generated function across the
+ * helper calls: rbx = vm, r12 = code, r13 = frame. they're callee-saved,
+ * and three pushes leave the stack 16-byte aligned at each call.
+ */
+static const unsigned char chimp_jit_prologue[] = {
+    0x53,                   /* push rbx */
+    0x41, 0x54,             /* push r12 */
+    0x41, 0x55,             /* push r13 */
+    0x48, 0x89, 0xfb,       /* mov rbx, rdi */
+    0x49, 0x89, 0xf4,       /* mov r12, rsi */
+    0x49, 0x89, 0xd5        /* mov r13, rdx */
+};
+
+static const unsigned char chimp_jit_epilogue[] = {
+    0xb8, 0x01, 0x00, 0x00, 0x00,   /* done: mov eax, 1 */
+    0xeb, 0x02,                     /* jmp out */
+    0x31, 0xc0,                     /* fail: xor eax, eax */
+    0x41, 0x5d,                     /* out: pop r13 */
+    0x41, 0x5c,                     /* pop r12 */
+    0x5b,                           /* pop rbx */
+    0xc3                            /* ret */
+};
+
+#define CHIMP_JIT_DONE_OFFSET 0
+#define CHIMP_JIT_FAIL_OFFSET 7
+
+/* op(vm, code, frame, pc), bailing out if it returns false */
+#define CHIMP_JIT_OP_SIZE 34
+
+/* chimp_vm_test(vm), bailing out if it fails, then a conditional jump */
+#define CHIMP_JIT_TEST_SIZE 29
+
+#define CHIMP_JIT_JUMP_SIZE 5
+
+typedef struct _ChimpJitBuf {
+    unsigned char *data;
+    size_t         size;
+} ChimpJitBuf;
+
+static void
+chimp_jit_emit (ChimpJitBuf *buf, const void *bytes, size_t size)
+{
+    memcpy (buf->data + buf->size, bytes, size);
+    buf->size += size;
+}
+
+static void
+chimp_jit_emit_byte (ChimpJitBuf *buf, unsigned char b)
+{
+    buf->data[buf->size++] = b;
+}
+
+static void
+chimp_jit_emit_u32 (ChimpJitBuf *buf, uint32_t value)
+{
+    chimp_jit_emit (buf, &value, sizeof(value));
+}
+
+static void
+chimp_jit_emit_u64 (ChimpJitBuf *buf, uint64_t value)
+{
+    chimp_jit_emit (buf, &value, sizeof(value));
+}
+
+/* rel32 to `target`, for an instruction ending after the displacement */
+static void
+chimp_jit_emit_rel32 (ChimpJitBuf *buf, size_t target)
+{
+    chimp_jit_emit_u32 (buf, (uint32_t)(int32_t)(target - (buf->size + 4)));
+}
+
+static void
+chimp_jit_emit_call (ChimpJitBuf *buf, void *func)
+{
+    chimp_jit_emit_byte (buf, 0x48);        /* mov rax, imm64 */
+    chimp_jit_emit_byte (buf, 0xb8);
+    chimp_jit_emit_u64 (buf, (uint64_t)(uintptr_t) func);
+    chimp_jit_emit_byte (buf, 0xff);        /* call rax */
+    chimp_jit_emit_byte (buf, 0xd0);
+}
+
+static void
+chimp_jit_emit_op (
+    ChimpJitBuf *buf, ChimpVMOpFunc func, size_t pc, size_t fail)
+{
+    static const unsigned char args[] = {
+        0x48, 0x89, 0xdf,   /* mov rdi, rbx */
+        0x4c, 0x89, 0xe6,   /* mov rsi, r12 */
+        0x4c, 0x89, 0xea    /* mov rdx, r13 */
+    };
+    chimp_jit_emit (buf, args, sizeof(args));
+    chimp_jit_emit_byte (buf, 0xb9);        /* mov ecx, imm32 */
+    chimp_jit_emit_u32 (buf, (uint32_t) pc);
+    chimp_jit_emit_call (buf, func);
+    chimp_jit_emit_byte (buf, 0x85);        /* test eax, eax */
+    chimp_jit_emit_byte (buf, 0xc0);
+    chimp_jit_emit_byte (buf, 0x0f);        /* jz fail */
+    chimp_jit_emit_byte (buf, 0x84);
+    chimp_jit_emit_rel32 (buf, fail);
+}
+
+static void
+chimp_jit_emit_test (
+    ChimpJitBuf *buf, chimp_bool_t if_true, size_t target, size_t fail)
+{
+    chimp_jit_emit_byte (buf, 0x48);        /* mov rdi, rbx */
+    chimp_jit_emit_byte (buf, 0x89);
+    chimp_jit_emit_byte (buf, 0xdf);
+    chimp_jit_emit_call (buf, chimp_vm_test);
+    chimp_jit_emit_byte (buf, 0x85);        /* test eax, eax */
+    chimp_jit_emit_byte (buf, 0xc0);
+    chimp_jit_emit_byte (buf, 0x0f);        /* js fail */
+    chimp_jit_emit_byte (buf, 0x88);
+    chimp_jit_emit_rel32 (buf, fail);
+    chimp_jit_emit_byte (buf, 0x0f);        /* jnz/jz target */
+    chimp_jit_emit_byte (buf, if_true ? 0x85 : 0x84);
+    chimp_jit_emit_rel32 (buf, target);
+}
+
+static void
+chimp_jit_emit_jump (ChimpJitBuf *buf, size_t target)
+{
+    chimp_jit_emit_byte (buf, 0xe9);        /* jmp target */
+    chimp_jit_emit_rel32 (buf, target);
+}
+
+/* the size of the template for the instruction at pc, or 0 if we can't
+ * translate it.
+ */
+static size_t
+chimp_jit_instr_size (ChimpRef *code, size_t pc)
+{
+    ChimpOpcode op = CHIMP_INSTR_OP(code, pc);
+    switch (op) {
+        case CHIMP_OPCODE_JUMPIFTRUE:
+        case CHIMP_OPCODE_JUMPIFFALSE:
+            return CHIMP_JIT_TEST_SIZE;
+        case CHIMP_OPCODE_JUMP:
+        case CHIMP_OPCODE_RET:
+            return CHIMP_JIT_JUMP_SIZE;
+        case CHIMP_OPCODE_TAILCALL:
+            /* hands the call back to chimp_vm_eval_frame, then returns */
+            return CHIMP_JIT_OP_SIZE + CHIMP_JIT_JUMP_SIZE;
+        case CHIMP_OPCODE_EXTENDEDARG:
+            /* a sentinel: operands are decoded by the op functions */
+            return (size_t) -1;
+        default:
+            return chimp_vm_op_func (op) != NULL ? CHIMP_JIT_OP_SIZE : 0;
+    }
+}
+
+static chimp_bool_t
+chimp_jit_enabled_default (void)
+{
+#ifdef CHIMP_JIT_DEFAULT
+    return CHIMP_TRUE;
+#else
+    return CHIMP_FALSE;
+#endif
+}
+
+chimp_bool_t
+chimp_jit_enabled (void)
+{
+    static int enabled = -1;
+    if (enabled < 0) {
+        const char *value = getenv ("CHIMP_JIT");
+        if (value == NULL || *value == '\0') {
+            enabled = chimp_jit_enabled_default ();
+        }
+        else {
+            enabled = strcmp (value, "0") != 0;
+        }
+    }
+    return enabled;
+}
+
+uint32_t
+chimp_jit_threshold (void)
+{
+    static uint32_t threshold = 0;
+    if (threshold == 0) {
+        const char *value = getenv ("CHIMP_JIT_THRESHOLD");
+        long n = value != NULL ? strtol (value, NULL, 10) : 0;
+        threshold = n > 0 ? (uint32_t) n : CHIMP_JIT_DEFAULT_THRESHOLD;
+    }
+    return threshold;
+}
+
+chimp_bool_t
+chimp_jit_compile (ChimpRef *code)
+{
+    const size_t used = CHIMP_CODE_SIZE(code);
+    size_t *offsets;
+    size_t i;
+    size_t size;
+    size_t done;
+    size_t fail;
+    ChimpJitBuf buf;
+
+    if (CHIMP_CODE_JIT(code) != NULL) {
+        return CHIMP_TRUE;
+    }
+    if (used > INT32_MAX) {
+        return CHIMP_FALSE;
+    }
+
+    /* pass 1: lay out the templates so jumps know where they're going */
+    offsets = CHIMP_MALLOC(size_t, sizeof(*offsets) * (used + 1));
+    if (offsets == NULL) {
+        return CHIMP_FALSE;
+    }
+    size = sizeof(chimp_jit_prologue);
+    for (i = 0; i < used; i++) {
+        size_t instr_size = chimp_jit_instr_size (code, i);
+        if (instr_size == 0) {
+            CHIMP_FREE (offsets);
+            return CHIMP_FALSE;
+        }
+        offsets[i] = size;
+        if (instr_size != (size_t) -1) {
+            size += instr_size;
+        }
+    }
+    /* falling off the end is an implicit RET */
+    offsets[used] = size;
+    done = size + CHIMP_JIT_DONE_OFFSET;
+    fail = size + CHIMP_JIT_FAIL_OFFSET;
+    size += sizeof(chimp_jit_epilogue);
+
+    buf.data = mmap (NULL, size, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buf.data == MAP_FAILED) {
+        CHIMP_FREE (offsets);
+        return CHIMP_FALSE;
+    }
+    buf.size = 0;
+
+    /* pass 2: stitch the templates together */
+    chimp_jit_emit (&buf, chimp_jit_prologue, sizeof(chimp_jit_prologue));
+    for (i = 0; i < used; i++) {
+        ChimpOpcode op = CHIMP_INSTR_OP(code, i);
+        switch (op) {
+            case CHIMP_OPCODE_JUMPIFTRUE:
+            case CHIMP_OPCODE_JUMPIFFALSE:
+            {
+                size_t addr = CHIMP_INSTR_ADDR(code, i);
+                chimp_jit_emit_test (&buf,
+                    op == CHIMP_OPCODE_JUMPIFTRUE,
+                    offsets[addr < used ? addr : used], fail);
+                break;
+            }
+            case CHIMP_OPCODE_JUMP:
+            {
+                size_t addr = CHIMP_INSTR_ADDR(code, i);
+                chimp_jit_emit_jump (&buf, offsets[addr < used ? addr : used]);
+                break;
+            }
+            case CHIMP_OPCODE_RET:
+                chimp_jit_emit_jump (&buf, done);
+                break;
+            case CHIMP_OPCODE_TAILCALL:
+                chimp_jit_emit_op (&buf, chimp_vm_op_func (op), i, fail);
+                chimp_jit_emit_jump (&buf, done);
+                break;
+            case CHIMP_OPCODE_EXTENDEDARG:
+                break;
+            default:
+                chimp_jit_emit_op (&buf, chimp_vm_op_func (op), i, fail);
+                break;
+        }
+    }
+    chimp_jit_emit (&buf, chimp_jit_epilogue, sizeof(chimp_jit_epilogue));
+    CHIMP_FREE (offsets);
+
+    if (buf.size != size) {
+        CHIMP_BUG ("JIT template size mismatch: %zu != %zu", buf.size, size);
+        munmap (buf.data, size);
+        return CHIMP_FALSE;
+    }
+
+    if (mprotect (buf.data, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap (buf.data, size);
+        return CHIMP_FALSE;
+    }
+
+    /* code objects can be shared between tasks: first one in wins */
+    CHIMP_CODE(code)->jit_size = size;
+    if (!__sync_bool_compare_and_swap (
+            &CHIMP_CODE(code)->jit, NULL, (ChimpJitFunc) buf.data)) {
+        munmap (buf.data, size);
+    }
+    return CHIMP_TRUE;
+}
+
+void
+chimp_jit_free (ChimpRef *code)
+{
+    if (CHIMP_CODE_JIT(code) != NULL) {
+        munmap ((void *) CHIMP_CODE_JIT(code), CHIMP_CODE(code)->jit_size);
+        CHIMP_CODE(code)->jit = NULL;
+    }
+}
+
+#else
+
+chimp_bool_t
+chimp_jit_enabled (void)
+{
+    return CHIMP_FALSE;
+}
+
+uint32_t
+chimp_jit_threshold (void)
+{
+    return 0;
+}
+
+chimp_bool_t
+chimp_jit_compile (ChimpRef *code)
+{
+    return CHIMP_FALSE;
+}
+
+void
+chimp_jit_free (ChimpRef *code)
+{
+}
+
+#endif
+
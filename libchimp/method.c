@@ -32,6 +32,10 @@ static ChimpRef *
 chimp_method_call (ChimpRef *self, ChimpRef *args)
 {
     if (CHIMP_METHOD_TYPE(self) == CHIMP_METHOD_TYPE_NATIVE) {
+        if (CHIMP_NATIVE_METHOD(self)->argv != NULL) {
+            return chimp_method_call_argv (
+                self, CHIMP_ARRAY_SIZE(args), CHIMP_ARRAY(args)->items);
+        }
         return CHIMP_NATIVE_METHOD(self)->func (CHIMP_METHOD(self)->self, args);
     }
     else {
@@ -79,6 +83,140 @@ chimp_method_new_native (ChimpRef *module, ChimpNativeMethodFunc func)
     return ref;
 }
 
+static chimp_bool_t
+chimp_method_parse_sig (ChimpNativeSig *out, const char *name, const char *sig)
+{
+    const char *p;
+    chimp_bool_t optional = CHIMP_FALSE;
+
+    out->name = name;
+    out->min = 0;
+    out->max = 0;
+    memset (out->types, 'o', sizeof(out->types));
+    for (p = sig; *p != '\0'; p++) {
+        switch (*p) {
+            case 'o':
+            case 's':
+            case 'i':
+            case 'I':
+                if (out->max == CHIMP_NATIVE_MAX_ARGS) {
+                    CHIMP_BUG ("%s: signature \"%s\" has more than %d args",
+                        name, sig, CHIMP_NATIVE_MAX_ARGS);
+                    return CHIMP_FALSE;
+                }
+                out->types[out->max++] = *p;
+                if (!optional) {
+                    out->min++;
+                }
+                break;
+            case '*':
+                if (p[1] != '\0') {
+                    CHIMP_BUG ("%s: '*' must come last in signature \"%s\"",
+                        name, sig);
+                    return CHIMP_FALSE;
+                }
+                out->max = SIZE_MAX;
+                return CHIMP_TRUE;
+            case '|':
+                if (optional) {
+                    CHIMP_BUG ("%s: signature \"%s\" has more than one '|'",
+                        name, sig);
+                    return CHIMP_FALSE;
+                }
+                optional = CHIMP_TRUE;
+                break;
+            default:
+                CHIMP_BUG ("%s: unknown character '%c' in signature \"%s\"",
+                    name, *p, sig);
+                return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+ChimpRef *
+chimp_method_new_native_argv (
+    ChimpRef *module,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc func)
+{
+    ChimpNativeSig parsed;
+    ChimpRef *ref;
+
+    if (!chimp_method_parse_sig (&parsed, name, sig)) {
+        return NULL;
+    }
+    ref = chimp_class_new_instance (chimp_method_class, NULL);
+    if (ref == NULL) {
+        return NULL;
+    }
+    CHIMP_METHOD(ref)->type = CHIMP_METHOD_TYPE_NATIVE;
+    CHIMP_METHOD(ref)->module = module;
+    CHIMP_NATIVE_METHOD(ref)->argv = func;
+    CHIMP_NATIVE_METHOD(ref)->sig = parsed;
+    return ref;
+}
+
+static const char *
+chimp_method_sig_type_name (char type)
+{
+    switch (type) {
+        case 's':
+            return "str";
+        case 'i':
+        case 'I':
+            return "int";
+        default:
+            return "object";
+    }
+}
+
+ChimpRef *
+chimp_method_call_argv (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    const ChimpNativeSig *sig = &CHIMP_NATIVE_METHOD(self)->sig;
+    size_t i;
+
+    if (argc < sig->min || argc > sig->max) {
+        if (sig->min == sig->max) {
+            CHIMP_BUG ("%s takes %zu argument(s), got %zu",
+                sig->name, sig->min, argc);
+        }
+        else if (sig->max == SIZE_MAX) {
+            CHIMP_BUG ("%s takes at least %zu argument(s), got %zu",
+                sig->name, sig->min, argc);
+        }
+        else {
+            CHIMP_BUG ("%s takes %zu to %zu arguments, got %zu",
+                sig->name, sig->min, sig->max, argc);
+        }
+        return NULL;
+    }
+    for (i = 0; i < argc && i < CHIMP_NATIVE_MAX_ARGS; i++) {
+        ChimpRef *klass;
+        switch (sig->types[i]) {
+            case 's':
+                klass = chimp_str_class;
+                break;
+            case 'i':
+            case 'I':
+                klass = chimp_int_class;
+                break;
+            default:
+                continue;
+        }
+        if (CHIMP_ANY_CLASS(argv[i]) != klass) {
+            CHIMP_BUG ("%s: argument %zu must be %s, not %s",
+                sig->name, i + 1,
+                chimp_method_sig_type_name (sig->types[i]),
+                CHIMP_STR_DATA(CHIMP_CLASS_NAME(CHIMP_ANY_CLASS(argv[i]))));
+            return NULL;
+        }
+    }
+    return CHIMP_NATIVE_METHOD(self)->argv (CHIMP_METHOD(self)->self, argc, argv);
+}
+
 ChimpRef *
 chimp_method_new_bytecode (ChimpRef *module, ChimpRef *code)
 {
@@ -116,17 +254,25 @@ chimp_method_new_bound (ChimpRef *unbound, ChimpRef *self)
         return NULL;
     }
     CHIMP_ANY(ref)->klass = chimp_method_class;
-    CHIMP_METHOD(ref)->type = CHIMP_METHOD(unbound)->type;
-    CHIMP_METHOD(ref)->self = self;
-    CHIMP_METHOD(ref)->module = CHIMP_METHOD(unbound)->module;
-    if (CHIMP_METHOD(ref)->type == CHIMP_METHOD_TYPE_NATIVE) {
-        CHIMP_NATIVE_METHOD(ref)->func = CHIMP_NATIVE_METHOD(unbound)->func;
+    chimp_method_rebind (ref, unbound, self);
+    return ref;
+}
+
+void
+chimp_method_rebind (ChimpRef *bound, ChimpRef *unbound, ChimpRef *self)
+{
+    CHIMP_METHOD(bound)->type = CHIMP_METHOD(unbound)->type;
+    CHIMP_METHOD(bound)->self = self;
+    CHIMP_METHOD(bound)->module = CHIMP_METHOD(unbound)->module;
+    if (CHIMP_METHOD(bound)->type == CHIMP_METHOD_TYPE_NATIVE) {
+        CHIMP_NATIVE_METHOD(bound)->func = CHIMP_NATIVE_METHOD(unbound)->func;
+        CHIMP_NATIVE_METHOD(bound)->argv = CHIMP_NATIVE_METHOD(unbound)->argv;
+        CHIMP_NATIVE_METHOD(bound)->sig = CHIMP_NATIVE_METHOD(unbound)->sig;
     }
     else {
-        CHIMP_BYTECODE_METHOD(ref)->code =
+        CHIMP_BYTECODE_METHOD(bound)->code =
             CHIMP_BYTECODE_METHOD(unbound)->code;
     }
-    return ref;
 }
 
 chimp_bool_t
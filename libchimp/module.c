@@ -144,6 +144,30 @@ chimp_module_add_method_str (
     return chimp_hash_put (CHIMP_MODULE(self)->locals, nameref, method);
 }
 
+chimp_bool_t
+chimp_module_add_argv_method_str (
+    ChimpRef *self,
+    const char *name,
+    const char *sig,
+    ChimpNativeMethodArgvFunc impl
+)
+{
+    ChimpRef *nameref;
+    ChimpRef *method;
+
+    nameref = chimp_str_new (name, strlen(name));
+    if (nameref == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    method = chimp_method_new_native_argv (self, name, sig, impl);
+    if (method == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    return chimp_hash_put (CHIMP_MODULE(self)->locals, nameref, method);
+}
+
 chimp_bool_t
 chimp_module_add_local_str (
     ChimpRef *self,
@@ -1,21 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <sys/stat.h>
 
 #include "chimp/module_mgr.h"
 #include "chimp/object.h"
 #include "chimp/compile.h"
+#include "chimp/code_cache.h"
 #include "chimp/array.h"
 #include "chimp/str.h"
+#include "chimp/int.h"
+#include "chimp/ast.h"
 #include "chimp/task.h"
 #include "chimp/modules.h"
 
+/* an upper bound on the worker tasks used to compile modules in parallel */
+#define CHIMP_MODULE_MGR_MAX_WORKERS 8
+
+#define CHIMP_MODULE_MGR_BUCKETS 64
+
+/* every module the manager binds is also published here, where any task
+ * can look it up without a round trip through the manager. only the
+ * manager task writes to the table, and only ever by pushing a finished
+ * entry onto the head of a bucket, so readers don't need a lock. entries
+ * are freed by chimp_module_mgr_shutdown once the manager has been joined.
+ */
+typedef struct _ChimpPublishedModule {
+    struct _ChimpPublishedModule *next;
+    ChimpRef *module;
+    size_t    size;
+    char      name[1];
+} ChimpPublishedModule;
+
+typedef enum _ChimpModuleState {
+    CHIMP_MODULE_STATE_PENDING,
+    CHIMP_MODULE_STATE_RUNNING,
+    CHIMP_MODULE_STATE_DONE
+} ChimpModuleState;
+
+static ChimpPublishedModule *published[CHIMP_MODULE_MGR_BUCKETS];
+
 static ChimpRef *module_mgr_task = NULL;
 static ChimpRef *func = NULL;
 static ChimpRef *cache = NULL;
 static ChimpRef *builtins = NULL;
+static ChimpRef *worker_func = NULL;
+static ChimpRef *workers = NULL;
+/* the plan being built: workers compile from the ASTs in here */
+static ChimpRef *build_plan = NULL;
+/* ASTs compiled by the workers. their modules share strs & other constants
+ * with the AST, which lives in our heap, so we keep them for good.
+ */
+static ChimpRef *worker_asts = NULL;
+/* requests that arrived while we were busy building */
+static ChimpRef *backlog = NULL;
+static chimp_bool_t building = CHIMP_FALSE;
 
 #define IS_MODULE_MGR_TASK() \
     (chimp_task_current() == CHIMP_TASK(module_mgr_task)->priv)
 
+static size_t
+_chimp_module_mgr_bucket (const char *name, size_t size)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261u;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= (unsigned char) name[i];
+        hash *= 16777619u;
+    }
+    return hash % CHIMP_MODULE_MGR_BUCKETS;
+}
+
+static ChimpRef *
+_chimp_module_mgr_lookup (ChimpRef *name)
+{
+    const char *data = CHIMP_STR_DATA(name);
+    size_t size = CHIMP_STR_SIZE(name);
+    ChimpPublishedModule *entry = __atomic_load_n (
+        &published[_chimp_module_mgr_bucket (data, size)], __ATOMIC_ACQUIRE);
+
+    while (entry != NULL) {
+        if (entry->size == size && memcmp (entry->name, data, size) == 0) {
+            return entry->module;
+        }
+        entry = entry->next;
+    }
+    return NULL;
+}
+
+static chimp_bool_t
+_chimp_module_mgr_bind (ChimpRef *name, ChimpRef *module)
+{
+    size_t size = CHIMP_STR_SIZE(name);
+    size_t bucket = _chimp_module_mgr_bucket (CHIMP_STR_DATA(name), size);
+    ChimpPublishedModule *entry;
+
+    /* modules compiled by a worker belong to its heap: this doesn't keep
+     * them alive, but it does keep ours alive */
+    if (!chimp_hash_put (cache, name, module)) {
+        return CHIMP_FALSE;
+    }
+
+    entry = CHIMP_MALLOC(ChimpPublishedModule, sizeof(*entry) + size);
+    if (entry == NULL) {
+        return CHIMP_FALSE;
+    }
+    entry->module = module;
+    entry->size = size;
+    memcpy (entry->name, CHIMP_STR_DATA(name), size);
+    entry->name[size] = '\0';
+    entry->next = published[bucket];
+    __atomic_store_n (&published[bucket], entry, __ATOMIC_RELEASE);
+    return CHIMP_TRUE;
+}
+
 static chimp_bool_t
 _chimp_module_mgr_add_builtin (ChimpRef *module)
 {
@@ -26,6 +126,31 @@ _chimp_module_mgr_add_builtin (ChimpRef *module)
     return CHIMP_TRUE;
 }
 
+/* compiles filename without binding the result. ast may be NULL, in which
+ * case filename is parsed if there's no usable .chimpc.
+ */
+static ChimpRef *
+_chimp_module_mgr_compile_ast (
+    ChimpRef *name, ChimpRef *filename, ChimpRef *ast)
+{
+    ChimpRef *mod;
+
+    /* prefer a fresh .chimpc (see chimp --compile) to the source */
+    mod = chimp_code_cache_load (name, CHIMP_STR_DATA(filename));
+    if (mod == NULL) {
+        return NULL;
+    }
+    if (mod == chimp_nil) {
+        if (ast != NULL) {
+            mod = chimp_compile_ast (name, CHIMP_STR_DATA(filename), ast);
+        }
+        else {
+            mod = chimp_compile_file (name, CHIMP_STR_DATA(filename));
+        }
+    }
+    return mod;
+}
+
 static ChimpRef *
 _chimp_module_mgr_compile (
     ChimpRef *name, ChimpRef *filename, chimp_bool_t check)
@@ -33,63 +158,80 @@ _chimp_module_mgr_compile (
     ChimpRef *mod;
     
     if (check) {
-        if (chimp_hash_get (cache, name, NULL) == 0) {
+        if (_chimp_module_mgr_lookup (name) != NULL) {
             CHIMP_BUG ("attempt to bind the same module twice: %s",
                     CHIMP_STR_DATA(name));
             return NULL;
         }
     }
 
-    mod = chimp_compile_file (name, CHIMP_STR_DATA(filename));
+    mod = _chimp_module_mgr_compile_ast (name, filename, NULL);
     if (mod == NULL) {
         return NULL;
     }
-    if (!chimp_hash_put (cache, name, mod)) {
+    if (!_chimp_module_mgr_bind (name, mod)) {
         return NULL;
     }
     return mod;
 }
 
+/* returns the source file for the named module, or chimp_nil if there's
+ * no such file on the path.
+ */
 static ChimpRef *
-_chimp_module_mgr_load (ChimpRef *name, ChimpRef *path)
+_chimp_module_mgr_find (ChimpRef *name, ChimpRef *path)
 {
     size_t i;
-    int rc;
-    ChimpRef *mod;
 
-    /* TODO circular references ... ? */
-
-    rc = chimp_hash_get (cache, name, &mod);
-    if (rc < 0) {
-        CHIMP_BUG ("error looking up module %s in cache",
-                CHIMP_STR_DATA(name));
-        return NULL;
-    }
-    else if (rc == 0) {
-        return mod;
+    if (path == NULL) {
+        return chimp_nil;
     }
 
-    if (path != NULL) {
-        for (i = 0; i < CHIMP_ARRAY_SIZE(path); i++) {
-            ChimpRef *element = CHIMP_ARRAY_ITEM(path, i);
-            ChimpRef *filename = chimp_str_new_format (
-                "%s/%s.chimp", CHIMP_STR_DATA(element), CHIMP_STR_DATA(name));
-            struct stat st;
+    for (i = 0; i < CHIMP_ARRAY_SIZE(path); i++) {
+        ChimpRef *element = CHIMP_ARRAY_ITEM(path, i);
+        ChimpRef *filename = chimp_str_new_format (
+            "%s/%s.chimp", CHIMP_STR_DATA(element), CHIMP_STR_DATA(name));
+        struct stat st;
 
-            if (stat (CHIMP_STR_DATA(filename), &st) != 0) {
-                continue;
-            }
+        if (filename == NULL) {
+            return NULL;
+        }
 
-            if (S_ISREG(st.st_mode)) {
-                return _chimp_module_mgr_compile (name, filename, CHIMP_FALSE);
-            }
+        if (stat (CHIMP_STR_DATA(filename), &st) != 0) {
+            continue;
         }
+
+        if (S_ISREG(st.st_mode)) {
+            return filename;
+        }
+    }
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_module_mgr_load (ChimpRef *name, ChimpRef *path)
+{
+    int rc;
+    ChimpRef *mod;
+    ChimpRef *filename;
+
+    mod = _chimp_module_mgr_lookup (name);
+    if (mod != NULL) {
+        return mod;
+    }
+
+    filename = _chimp_module_mgr_find (name, path);
+    if (filename == NULL) {
+        return NULL;
+    }
+    else if (filename != chimp_nil) {
+        return _chimp_module_mgr_compile (name, filename, CHIMP_FALSE);
     }
 
     rc = chimp_hash_get (builtins, name, &mod);
 
     if (rc == 0) {
-        if (!chimp_hash_put (cache, name, mod)) {
+        if (!_chimp_module_mgr_bind (name, mod)) {
             return NULL;
         }
         return mod;
@@ -104,6 +246,461 @@ _chimp_module_mgr_load (ChimpRef *name, ChimpRef *path)
     }
 }
 
+/* the names of the modules pulled in by an array of use decls */
+static ChimpRef *
+_chimp_module_mgr_use_names (ChimpRef *uses)
+{
+    size_t i;
+    ChimpRef *names = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(uses));
+    if (names == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(uses); i++) {
+        ChimpRef *decl = CHIMP_ARRAY_ITEM(uses, i);
+        if (!chimp_array_push (names, CHIMP_AST_DECL(decl)->use.name)) {
+            return NULL;
+        }
+    }
+    return names;
+}
+
+/* each node in a build plan is a [name, filename, ast] triple */
+#define CHIMP_PLAN_NAME(node) CHIMP_ARRAY_ITEM((node), 0)
+#define CHIMP_PLAN_FILENAME(node) CHIMP_ARRAY_ITEM((node), 1)
+#define CHIMP_PLAN_AST(node) CHIMP_ARRAY_ITEM((node), 2)
+
+static ssize_t
+_chimp_module_mgr_plan_index (ChimpRef *plan, ChimpRef *name)
+{
+    size_t i;
+    for (i = 0; i < CHIMP_ARRAY_SIZE(plan); i++) {
+        ChimpRef *other = CHIMP_PLAN_NAME(CHIMP_ARRAY_ITEM(plan, i));
+        if (CHIMP_STR_SIZE(other) == CHIMP_STR_SIZE(name) &&
+                memcmp (CHIMP_STR_DATA(other), CHIMP_STR_DATA(name),
+                    CHIMP_STR_SIZE(name)) == 0) {
+            return (ssize_t) i;
+        }
+    }
+    return -1;
+}
+
+/* adds the named modules to plan if they still need compiling, along with
+ * everything they use in turn. builtins & modules that can't be found are
+ * left to _chimp_module_mgr_load.
+ */
+static chimp_bool_t
+_chimp_module_mgr_plan (ChimpRef *plan, ChimpRef *names)
+{
+    size_t i;
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(names); i++) {
+        ChimpRef *name = CHIMP_ARRAY_ITEM(names, i);
+        ChimpRef *filename;
+        ChimpRef *ast;
+        ChimpRef *node;
+        ChimpRef *uses;
+
+        if (_chimp_module_mgr_lookup (name) != NULL ||
+                _chimp_module_mgr_plan_index (plan, name) >= 0) {
+            continue;
+        }
+
+        filename = _chimp_module_mgr_find (name, chimp_module_path);
+        if (filename == NULL) {
+            return CHIMP_FALSE;
+        }
+        else if (filename == chimp_nil) {
+            continue;
+        }
+
+        ast = chimp_parse_file (CHIMP_STR_DATA(filename));
+        if (ast == NULL) {
+            return CHIMP_FALSE;
+        }
+
+        node = chimp_array_new_var (name, filename, ast, NULL);
+        if (node == NULL || !chimp_array_push (plan, node)) {
+            return CHIMP_FALSE;
+        }
+
+        uses = _chimp_module_mgr_use_names (CHIMP_AST_MOD(ast)->root.uses);
+        if (uses == NULL) {
+            return CHIMP_FALSE;
+        }
+        if (!_chimp_module_mgr_plan (plan, uses)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* a planned module can be compiled once everything it uses is done */
+static chimp_bool_t
+_chimp_module_mgr_is_ready (
+    ChimpRef *plan, const ChimpModuleState *state, ChimpRef *node)
+{
+    size_t i;
+    ChimpRef *uses = CHIMP_AST_MOD(CHIMP_PLAN_AST(node))->root.uses;
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(uses); i++) {
+        ChimpRef *decl = CHIMP_ARRAY_ITEM(uses, i);
+        ssize_t dep = _chimp_module_mgr_plan_index (
+            plan, CHIMP_AST_DECL(decl)->use.name);
+        if (dep >= 0 && state[dep] != CHIMP_MODULE_STATE_DONE) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_module_mgr_worker_func (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *mgr = CHIMP_ARRAY_ITEM(args, 0);
+
+    for (;;) {
+        ChimpRef *msg = chimp_task_recv (NULL);
+        ChimpRef *action;
+        if (msg == NULL) {
+            return NULL;
+        }
+
+        action = CHIMP_ARRAY_ITEM(msg, 0);
+        if (strcmp (CHIMP_STR_DATA(action), "compile") == 0) {
+            ChimpRef *node = CHIMP_ARRAY_ITEM(msg, 1);
+            ChimpRef *worker = CHIMP_ARRAY_ITEM(msg, 2);
+            ChimpRef *reply;
+            /* the manager won't touch the plan until we reply */
+            ChimpRef *ast = CHIMP_PLAN_AST(
+                CHIMP_ARRAY_ITEM(build_plan, CHIMP_INT_VALUE(node)));
+            ChimpRef *mod = _chimp_module_mgr_compile_ast (
+                CHIMP_ARRAY_ITEM(msg, 3), CHIMP_ARRAY_ITEM(msg, 4), ast);
+
+            /* the module lives in our heap: keep it for as long as we do */
+            if (mod != NULL && chimp_gc_make_root (NULL, mod)) {
+                reply = chimp_array_new_var (
+                    CHIMP_STR_NEW ("done"), node, worker, mod, NULL);
+            }
+            else {
+                reply = chimp_array_new_var (
+                    CHIMP_STR_NEW ("failed"), node, worker, NULL);
+            }
+            if (reply == NULL || !chimp_task_send (mgr, reply)) {
+                return NULL;
+            }
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "exit") == 0) {
+            break;
+        }
+        else {
+            CHIMP_BUG ("module compiler received unknown command: %s",
+                CHIMP_STR_DATA(chimp_object_str (action)));
+            return NULL;
+        }
+    }
+
+    return chimp_nil;
+}
+
+static size_t
+_chimp_module_mgr_num_workers (void)
+{
+    const char *value = getenv ("CHIMP_COMPILE_WORKERS");
+    long n;
+
+    if (value != NULL && *value != '\0') {
+        n = strtol (value, NULL, 10);
+    }
+    else {
+        /* the module manager compiles too */
+        n = sysconf (_SC_NPROCESSORS_ONLN) - 1;
+    }
+    if (n < 0) {
+        n = 0;
+    }
+    else if (n > CHIMP_MODULE_MGR_MAX_WORKERS) {
+        n = CHIMP_MODULE_MGR_MAX_WORKERS;
+    }
+    return (size_t) n;
+}
+
+static chimp_bool_t
+_chimp_module_mgr_spawn_workers (void)
+{
+    size_t i;
+    size_t n = _chimp_module_mgr_num_workers ();
+    ChimpRef *self = chimp_task_get_self (chimp_task_current ());
+
+    workers = chimp_array_new_with_capacity (n);
+    if (workers == NULL) {
+        return CHIMP_FALSE;
+    }
+    chimp_gc_make_root (NULL, workers);
+    if (n == 0) {
+        return CHIMP_TRUE;
+    }
+
+    worker_func = chimp_method_new_native (NULL, _chimp_module_mgr_worker_func);
+    if (worker_func == NULL) {
+        return CHIMP_FALSE;
+    }
+    chimp_gc_make_root (NULL, worker_func);
+
+    for (i = 0; i < n; i++) {
+        ChimpRef *worker = chimp_task_new (worker_func);
+        if (worker == NULL || !chimp_array_push (workers, worker)) {
+            return CHIMP_FALSE;
+        }
+        if (!chimp_task_send (worker, chimp_array_new_var (self, NULL))) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+static void
+_chimp_module_mgr_stop_workers (void)
+{
+    size_t i;
+
+    if (workers == NULL) {
+        return;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(workers); i++) {
+        ChimpRef *worker = CHIMP_ARRAY_ITEM(workers, i);
+        if (!chimp_task_send (
+                worker, chimp_array_new_var (CHIMP_STR_NEW ("exit"), NULL))) {
+            CHIMP_BUG ("failed to shutdown module compiler task");
+            continue;
+        }
+        chimp_task_join (CHIMP_TASK(worker)->priv);
+    }
+    workers = NULL;
+    worker_func = NULL;
+}
+
+/* replies to the load requests in waiting whose modules are now done */
+static chimp_bool_t
+_chimp_module_mgr_answer_waiting (ChimpRef *waiting)
+{
+    size_t n = CHIMP_ARRAY_SIZE(waiting);
+
+    while (n-- > 0) {
+        ChimpRef *msg = chimp_array_shift (waiting);
+        ChimpRef *mod = _chimp_module_mgr_lookup (CHIMP_ARRAY_ITEM(msg, 2));
+        if (mod == NULL) {
+            if (!chimp_array_push (waiting, msg)) {
+                return CHIMP_FALSE;
+            }
+        }
+        else if (!chimp_task_send (CHIMP_ARRAY_ITEM(msg, 1), mod)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* loads the named modules & everything they use, compiling modules that
+ * don't depend on one another in parallel on the worker tasks. we compile
+ * one module at a time ourselves, & everybody compiles from the AST parsed
+ * while planning.
+ */
+static chimp_bool_t
+_chimp_module_mgr_build (ChimpRef *names)
+{
+    ChimpRef *plan;
+    ChimpRef *waiting;
+    ChimpModuleState *state;
+    chimp_bool_t busy[CHIMP_MODULE_MGR_MAX_WORKERS];
+    size_t nworkers;
+    size_t remaining;
+    size_t running = 0;
+    chimp_bool_t result = CHIMP_FALSE;
+
+    plan = chimp_array_new ();
+    if (plan == NULL) {
+        return CHIMP_FALSE;
+    }
+    if (!_chimp_module_mgr_plan (plan, names)) {
+        return CHIMP_FALSE;
+    }
+
+    remaining = CHIMP_ARRAY_SIZE(plan);
+    if (remaining == 0) {
+        return CHIMP_TRUE;
+    }
+    if (remaining > 1 && workers == NULL) {
+        if (!_chimp_module_mgr_spawn_workers ()) {
+            return CHIMP_FALSE;
+        }
+    }
+    nworkers = workers != NULL ? CHIMP_ARRAY_SIZE(workers) : 0;
+
+    waiting = chimp_array_new ();
+    if (waiting == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    if (worker_asts == NULL) {
+        worker_asts = chimp_array_new ();
+        if (worker_asts == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, worker_asts);
+    }
+
+    state = CHIMP_MALLOC(ChimpModuleState, sizeof(*state) * remaining);
+    if (state == NULL) {
+        return CHIMP_FALSE;
+    }
+    memset (state, 0, sizeof(*state) * remaining);
+    memset (busy, 0, sizeof(busy));
+
+    building = CHIMP_TRUE;
+    build_plan = plan;
+    while (remaining > 0) {
+        ChimpRef *msg;
+        ChimpRef *action;
+        ssize_t mine = -1;
+        size_t w = 0;
+        size_t i;
+
+        for (i = 0; i < CHIMP_ARRAY_SIZE(plan); i++) {
+            ChimpRef *node = CHIMP_ARRAY_ITEM(plan, i);
+            ChimpRef *cmd;
+
+            if (state[i] != CHIMP_MODULE_STATE_PENDING ||
+                    !_chimp_module_mgr_is_ready (plan, state, node)) {
+                continue;
+            }
+            if (mine < 0) {
+                mine = i;
+                continue;
+            }
+
+            while (w < nworkers && busy[w]) w++;
+            if (w == nworkers) {
+                break;
+            }
+            cmd = chimp_array_new_var (
+                CHIMP_STR_NEW ("compile"),
+                chimp_int_new (i),
+                chimp_int_new (w),
+                CHIMP_PLAN_NAME(node),
+                CHIMP_PLAN_FILENAME(node),
+                NULL);
+            if (cmd == NULL ||
+                    !chimp_task_send (CHIMP_ARRAY_ITEM(workers, w), cmd)) {
+                goto done;
+            }
+            busy[w] = CHIMP_TRUE;
+            state[i] = CHIMP_MODULE_STATE_RUNNING;
+            running++;
+        }
+
+        if (mine >= 0) {
+            ChimpRef *node = CHIMP_ARRAY_ITEM(plan, mine);
+            ChimpRef *mod = _chimp_module_mgr_compile_ast (
+                CHIMP_PLAN_NAME(node),
+                CHIMP_PLAN_FILENAME(node),
+                CHIMP_PLAN_AST(node));
+            if (mod == NULL) {
+                goto done;
+            }
+            if (!_chimp_module_mgr_bind (CHIMP_PLAN_NAME(node), mod)) {
+                goto done;
+            }
+            state[mine] = CHIMP_MODULE_STATE_DONE;
+            remaining--;
+            if (!_chimp_module_mgr_answer_waiting (waiting)) {
+                goto done;
+            }
+            continue;
+        }
+
+        if (running == 0) {
+            for (i = 0; state[i] != CHIMP_MODULE_STATE_PENDING; i++);
+            CHIMP_BUG ("circular use of module %s",
+                CHIMP_STR_DATA(CHIMP_PLAN_NAME(CHIMP_ARRAY_ITEM(plan, i))));
+            goto done;
+        }
+
+        msg = chimp_task_recv (NULL);
+        if (msg == NULL) {
+            goto done;
+        }
+        action = CHIMP_ARRAY_ITEM(msg, 0);
+
+        if (strcmp (CHIMP_STR_DATA(action), "done") == 0) {
+            size_t node = (size_t) CHIMP_INT_VALUE(CHIMP_ARRAY_ITEM(msg, 1));
+            size_t worker = (size_t) CHIMP_INT_VALUE(CHIMP_ARRAY_ITEM(msg, 2));
+            if (!chimp_array_push (worker_asts,
+                    CHIMP_PLAN_AST(CHIMP_ARRAY_ITEM(plan, node)))) {
+                goto done;
+            }
+            if (!_chimp_module_mgr_bind (
+                    CHIMP_PLAN_NAME(CHIMP_ARRAY_ITEM(plan, node)),
+                    CHIMP_ARRAY_ITEM(msg, 3))) {
+                goto done;
+            }
+            state[node] = CHIMP_MODULE_STATE_DONE;
+            busy[worker] = CHIMP_FALSE;
+            running--;
+            remaining--;
+            if (!_chimp_module_mgr_answer_waiting (waiting)) {
+                goto done;
+            }
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "failed") == 0) {
+            /* the worker has already complained */
+            goto done;
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "load") == 0) {
+            ChimpRef *sender = CHIMP_ARRAY_ITEM(msg, 1);
+            ChimpRef *name = CHIMP_ARRAY_ITEM(msg, 2);
+            ChimpRef *mod = _chimp_module_mgr_lookup (name);
+
+            if (mod == NULL && _chimp_module_mgr_plan_index (plan, name) >= 0) {
+                if (!chimp_array_push (waiting, msg)) {
+                    goto done;
+                }
+                continue;
+            }
+            /* not part of the plan: load it the slow way right now, since
+             * the sender could be a worker we're waiting on */
+            if (mod == NULL) {
+                mod = _chimp_module_mgr_load (name, chimp_module_path);
+                if (mod == NULL) {
+                    goto done;
+                }
+            }
+            if (!chimp_task_send (sender, mod)) {
+                goto done;
+            }
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "build") == 0) {
+            /* the sender will just load its modules one at a time */
+            if (!chimp_task_send (CHIMP_ARRAY_ITEM(msg, 1), chimp_nil)) {
+                goto done;
+            }
+        }
+        else if (!chimp_array_push (backlog, msg)) {
+            goto done;
+        }
+    }
+    result = CHIMP_TRUE;
+
+done:
+    building = CHIMP_FALSE;
+    /* on failure a worker could still be reading the plan, and we're on
+     * our way out anyway: leave it be */
+    if (result) {
+        build_plan = NULL;
+    }
+    CHIMP_FREE (state);
+    return result;
+}
+
 static ChimpRef *
 _chimp_module_mgr_func (ChimpRef *self, ChimpRef *args)
 {
@@ -117,6 +714,11 @@ _chimp_module_mgr_func (ChimpRef *self, ChimpRef *args)
         return NULL;
     }
     chimp_gc_make_root (NULL, builtins);
+    backlog = chimp_array_new ();
+    if (backlog == NULL) {
+        return NULL;
+    }
+    chimp_gc_make_root (NULL, backlog);
 
     if (!_chimp_module_mgr_add_builtin (chimp_init_io_module ())) {
         return CHIMP_FALSE;
@@ -146,13 +748,23 @@ _chimp_module_mgr_func (ChimpRef *self, ChimpRef *args)
         return CHIMP_FALSE;
     }
 
+    if (!_chimp_module_mgr_add_builtin (chimp_init_task_module ())) {
+        return CHIMP_FALSE;
+    }
+
     if (!chimp_task_send (
             CHIMP_ARRAY_ITEM(args, 0), CHIMP_STR_NEW ("ready"))) {
         return NULL;
     }
 
     for (;;) {
-        ChimpRef *msg = chimp_task_recv (NULL);
+        ChimpRef *msg;
+        if (CHIMP_ARRAY_SIZE(backlog) > 0) {
+            msg = chimp_array_shift (backlog);
+        }
+        else {
+            msg = chimp_task_recv (NULL);
+        }
         if (msg == NULL) {
             return NULL;
         }
@@ -191,6 +803,16 @@ _chimp_module_mgr_func (ChimpRef *self, ChimpRef *args)
                     return NULL;
                 }
             }
+            else if (strcmp (CHIMP_STR_DATA(action), "build") == 0) {
+                ChimpRef *sender = CHIMP_ARRAY_ITEM(msg, 1);
+                ChimpRef *names = CHIMP_ARRAY_ITEM(msg, 2);
+                if (!_chimp_module_mgr_build (names)) {
+                    return NULL;
+                }
+                if (!chimp_task_send (sender, chimp_nil)) {
+                    return NULL;
+                }
+            }
             else if (strcmp (CHIMP_STR_DATA(action), "exit") == 0) {
                 break;
             }
@@ -207,6 +829,8 @@ _chimp_module_mgr_func (ChimpRef *self, ChimpRef *args)
         }
     }
 
+    _chimp_module_mgr_stop_workers ();
+
     return chimp_nil;
 }
 
@@ -241,6 +865,8 @@ chimp_module_mgr_init (void)
 void
 chimp_module_mgr_shutdown (void)
 {
+    size_t i;
+
     if (!chimp_task_send (
             module_mgr_task,
             chimp_array_new_var (CHIMP_STR_NEW ("exit"), NULL))) {
@@ -248,6 +874,17 @@ chimp_module_mgr_shutdown (void)
     }
     chimp_task_join (CHIMP_TASK(module_mgr_task)->priv);
 
+    /* the modules died with the heaps of the tasks that compiled them */
+    for (i = 0; i < CHIMP_MODULE_MGR_BUCKETS; i++) {
+        ChimpPublishedModule *entry = published[i];
+        while (entry != NULL) {
+            ChimpPublishedModule *next = entry->next;
+            CHIMP_FREE (entry);
+            entry = next;
+        }
+        published[i] = NULL;
+    }
+
     module_mgr_task = NULL;
     func = NULL;
 }
@@ -299,7 +936,11 @@ _chimp_module_mgr_send_cmd (
 ChimpRef *
 chimp_module_mgr_load (ChimpRef *name)
 {
-    if (IS_MODULE_MGR_TASK ()) {
+    ChimpRef *mod = _chimp_module_mgr_lookup (name);
+    if (mod != NULL) {
+        return mod;
+    }
+    else if (IS_MODULE_MGR_TASK ()) {
         return _chimp_module_mgr_load (name, chimp_module_path);
     }
     else {
@@ -319,3 +960,35 @@ chimp_module_mgr_compile (ChimpRef *name, ChimpRef *filename)
     }
 }
 
+chimp_bool_t
+chimp_module_mgr_load_uses (ChimpRef *uses)
+{
+    size_t i;
+    ChimpRef *names;
+
+    if (IS_MODULE_MGR_TASK ()) {
+        /* mid-build, everything we use was planned (& compiled) first */
+        if (building) {
+            return CHIMP_TRUE;
+        }
+        names = _chimp_module_mgr_use_names (uses);
+        return names != NULL && _chimp_module_mgr_build (names);
+    }
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(uses); i++) {
+        ChimpRef *decl = CHIMP_ARRAY_ITEM(uses, i);
+        if (_chimp_module_mgr_lookup (CHIMP_AST_DECL(decl)->use.name) == NULL) {
+            break;
+        }
+    }
+    if (i == CHIMP_ARRAY_SIZE(uses)) {
+        return CHIMP_TRUE;
+    }
+
+    names = _chimp_module_mgr_use_names (uses);
+    if (names == NULL) {
+        return CHIMP_FALSE;
+    }
+    return _chimp_module_mgr_send_cmd (
+            "build", sizeof("build")-1, names, NULL) != NULL;
+}
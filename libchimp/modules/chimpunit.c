@@ -21,6 +21,7 @@
 #include "chimp/array.h"
 #include "chimp/str.h"
 #include "chimp/vm.h"
+#include "chimp/modules.h"
 
 // ChimpTestRunner class we only use from within the ChimpUnit module
 ChimpRef *chimp_test_runner_class = NULL;
@@ -46,6 +47,7 @@ _chimp_test_runner_init (ChimpRef *self, ChimpRef *args)
 static void
 _chimp_test_runner_output_stats (ChimpRef *self, FILE* dest)
 {
+    chimp_io_flush_output ();
     fprintf(dest, "\nPassed: %ju, Failed: %ju\n",
         (intmax_t) CHIMP_TEST(self)->passed,
         (intmax_t) CHIMP_TEST(self)->failed);
@@ -60,6 +62,7 @@ _chimp_test_runner_dtor (ChimpRef *self)
 static void
 _chimp_failed_test(ChimpRef *self)
 {
+    chimp_io_flush_output ();
     fprintf (stderr, "\nTest failed: %s",
         CHIMP_STR_DATA(CHIMP_TEST_NAME(self)));
 
@@ -175,7 +178,7 @@ static ChimpRef *test_runner = NULL;
 static ChimpRef *
 _chimp_unit_test(ChimpRef *self, ChimpRef *args)
 {
-    fprintf (stdout, ".");
+    chimp_io_output (".", 1);
 
     // TODO: Size/argument validation on the incoming args
     ChimpRef *name = chimp_object_str (CHIMP_ARRAY_ITEM(args, 0));
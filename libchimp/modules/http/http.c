@@ -16,23 +16,77 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <strings.h>
+#include <time.h>
 #include <unistd.h>
 #include <glob.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 
 #include "chimp/any.h"
 #include "chimp/object.h"
 #include "chimp/array.h"
 #include "chimp/str.h"
+#include "chimp/hash.h"
+#include "chimp/error.h"
+#include "chimp/task.h"
 #include "http_parser.h"
 
+/*
+ * The parser is push-style: feed it whatever came off the wire & it hands
+ * back an array of events for everything it managed to parse:
+ *
+ *   ["request", req]        a complete request, body & all
+ *   ["headers", req]        a request whose body will be streamed ...
+ *   ["body", req, chunk]    ... one chunk at a time ...
+ *   ["end", req]            ... until it's done
+ *
+ * Bodies are streamed if they're chunked or larger than the parser's body
+ * limit. Pipelined requests simply produce several events per feed.
+ *
+ * URLs, header names & values may be split across feeds, so they're
+ * collected in per-parser buffers that are reused from one request to the
+ * next. Header name & method strs are cached for the life of the parser so
+ * that keep-alive connections don't allocate them over & over.
+ */
+
+typedef struct _ChimpHttpBuffer {
+    char   *data;
+    size_t  size;
+    size_t  capacity;
+} ChimpHttpBuffer;
+
+typedef enum _ChimpHttpHeaderState {
+    CHIMP_HTTP_HEADER_NONE,
+    CHIMP_HTTP_HEADER_FIELD,
+    CHIMP_HTTP_HEADER_VALUE
+} ChimpHttpHeaderState;
+
 typedef struct _ChimpHttpParser {
     ChimpAny base;
     http_parser impl;
     http_parser_settings conf;
     ChimpRef *request;
-    ChimpRef *header;
-    chimp_bool_t complete;
+    ChimpRef *events;       /* produced by the current feed */
+    ChimpRef *pending;      /* parsed, but not yet returned by parse_request */
+    ChimpRef *methods;      /* method strs, indexed by enum http_method */
+    ChimpRef *header_names; /* header name strs seen on this connection */
+    ChimpHttpBuffer url;
+    ChimpHttpBuffer field;
+    ChimpHttpBuffer value;
+    ChimpHttpBuffer body;
+    ChimpHttpHeaderState header_state;
+    chimp_bool_t streaming;
+    size_t body_limit;
 } ChimpHttpParser;
 
 typedef struct _ChimpHttpRequest {
@@ -42,8 +96,15 @@ typedef struct _ChimpHttpRequest {
     ChimpRef *url;
     ChimpRef *headers;
     ChimpRef *body;
+    chimp_bool_t keep_alive;
 } ChimpHttpRequest;
 
+/* bodies bigger than this are streamed by default */
+#define CHIMP_HTTP_DEFAULT_BODY_LIMIT 65536
+
+/* how many distinct header names a parser remembers */
+#define CHIMP_HTTP_MAX_CACHED_HEADER_NAMES 64
+
 static ChimpRef *chimp_http_parser_class = NULL;
 static ChimpRef *chimp_http_request_class = NULL;
 
@@ -53,62 +114,121 @@ static ChimpRef *chimp_http_request_class = NULL;
 #define CHIMP_HTTP_REQUEST(ref) \
     CHIMP_CHECK_CAST(ChimpHttpRequest, (ref), chimp_http_request_class)
 
-static int
-_chimp_http_parser_on_message_begin (http_parser *p)
+static chimp_bool_t
+chimp_http_buffer_append (ChimpHttpBuffer *buf, const char *data, size_t len)
 {
-    ChimpRef *self = p->data;
-    ChimpRef *req;
-    req = chimp_class_new_instance (chimp_http_request_class, NULL);
-    if (req == NULL) {
-        CHIMP_BUG ("http.request instantiation failed");
-        return 1;
+    if (buf->size + len > buf->capacity) {
+        char *temp;
+        size_t capacity = buf->capacity > 0 ? buf->capacity : 64;
+        while (capacity < buf->size + len) {
+            capacity *= 2;
+        }
+        temp = CHIMP_REALLOC(char, buf->data, capacity);
+        if (temp == NULL) {
+            return CHIMP_FALSE;
+        }
+        buf->data = temp;
+        buf->capacity = capacity;
     }
-    CHIMP_HTTP_PARSER(self)->request = req;
-    return 0;
+    memcpy (buf->data + buf->size, data, len);
+    buf->size += len;
+    return CHIMP_TRUE;
 }
 
-static int
-_chimp_http_parser_on_url (http_parser *p, const char *data, size_t len)
+static void
+chimp_http_buffer_free (ChimpHttpBuffer *buf)
 {
-    ChimpRef *req = CHIMP_HTTP_PARSER(p->data)->request;
-    CHIMP_HTTP_REQUEST(req)->url = chimp_str_new (data, len);
-    if (CHIMP_HTTP_REQUEST(req)->url == NULL) {
-        CHIMP_BUG ("failed to set request url");
-        return 1;
+    CHIMP_FREE (buf->data);
+    buf->data = NULL;
+    buf->size = buf->capacity = 0;
+}
+
+static chimp_bool_t
+chimp_http_parser_emit (ChimpRef *self, ChimpRef *event)
+{
+    if (event == NULL) {
+        return CHIMP_FALSE;
     }
-    return 0;
+    return chimp_array_push (CHIMP_HTTP_PARSER(self)->events, event);
 }
 
-static int
-_chimp_http_parser_on_header_field (
-        http_parser *p, const char *data, size_t len)
+/* the cached str for a header name, if we've seen it before */
+static ChimpRef *
+chimp_http_parser_header_name (ChimpRef *self, const char *data, size_t len)
 {
-    CHIMP_HTTP_PARSER(p->data)->header = chimp_str_new (data, len);
-    if (CHIMP_HTTP_PARSER(p->data)->header == NULL) {
-        CHIMP_BUG ("failed to allocate header");
-        return 1;
+    size_t i;
+    ChimpRef *name;
+    ChimpRef *names = CHIMP_HTTP_PARSER(self)->header_names;
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(names); i++) {
+        name = CHIMP_ARRAY_ITEM(names, i);
+        if (CHIMP_STR_SIZE(name) == len &&
+                memcmp (CHIMP_STR_DATA(name), data, len) == 0) {
+            return name;
+        }
     }
-    return 0;
+
+    name = chimp_str_new (data, len);
+    if (name == NULL) {
+        return NULL;
+    }
+    if (CHIMP_ARRAY_SIZE(names) < CHIMP_HTTP_MAX_CACHED_HEADER_NAMES) {
+        if (!chimp_array_push (names, name)) {
+            return NULL;
+        }
+    }
+    return name;
+}
+
+static ChimpRef *
+chimp_http_parser_method (ChimpRef *self, unsigned char method)
+{
+    ChimpRef *methods = CHIMP_HTTP_PARSER(self)->methods;
+    ChimpRef *str;
+    const char *method_str;
+
+    while (CHIMP_ARRAY_SIZE(methods) <= method) {
+        if (!chimp_array_push (methods, chimp_nil)) {
+            return NULL;
+        }
+    }
+    str = CHIMP_ARRAY_ITEM(methods, method);
+    if (str != chimp_nil) {
+        return str;
+    }
+
+    method_str = http_method_str (method);
+    str = chimp_str_new (method_str, strlen (method_str));
+    if (str == NULL) {
+        return NULL;
+    }
+    CHIMP_ARRAY(methods)->items[method] = str;
+    return str;
 }
 
+/* adds the header in the field & value buffers to the current request */
 static int
-_chimp_http_parser_on_header_value (
-        http_parser *p, const char *data, size_t len)
+chimp_http_parser_flush_header (ChimpRef *self)
 {
-    ChimpRef *req;
     ChimpRef *values;
     ChimpRef *headers;
     ChimpRef *header;
-    ChimpRef *self = p->data;
-    ChimpRef *value = chimp_str_new (data, len);
+    ChimpRef *value;
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+
+    header = chimp_http_parser_header_name (
+        self, parser->field.data, parser->field.size);
+    if (header == NULL) {
+        return 1;
+    }
+    value = chimp_str_new (parser->value.data, parser->value.size);
     if (value == NULL) {
-        CHIMP_BUG ("failed to allocate header value");
         return 1;
     }
-    
-    req = CHIMP_HTTP_PARSER(self)->request;
-    headers = CHIMP_HTTP_REQUEST(req)->headers;
-    header = CHIMP_HTTP_PARSER(self)->header;
+    parser->field.size = 0;
+    parser->value.size = 0;
+
+    headers = CHIMP_HTTP_REQUEST(parser->request)->headers;
     if (chimp_hash_get (headers, header, &values) < 0) {
         CHIMP_BUG ("failed to get header");
         return 1;
@@ -142,46 +262,94 @@ _chimp_http_parser_on_header_value (
             return 1;
         }
     }
-    CHIMP_HTTP_PARSER(self)->header = NULL;
     return 0;
 }
 
 static int
-_chimp_http_parser_on_headers_complete (http_parser *p)
+_chimp_http_parser_on_message_begin (http_parser *p)
 {
     ChimpRef *self = p->data;
-    CHIMP_HTTP_PARSER(self)->header = NULL;
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+    ChimpRef *req;
+    req = chimp_class_new_instance (chimp_http_request_class, NULL);
+    if (req == NULL) {
+        CHIMP_BUG ("http.request instantiation failed");
+        return 1;
+    }
+    parser->request = req;
+    parser->url.size = 0;
+    parser->field.size = 0;
+    parser->value.size = 0;
+    parser->body.size = 0;
+    parser->header_state = CHIMP_HTTP_HEADER_NONE;
+    parser->streaming = CHIMP_FALSE;
     return 0;
 }
 
 static int
-_chimp_http_parser_on_body (http_parser *p, const char *data, size_t len)
+_chimp_http_parser_on_url (http_parser *p, const char *data, size_t len)
+{
+    if (!chimp_http_buffer_append (&CHIMP_HTTP_PARSER(p->data)->url, data, len)) {
+        CHIMP_BUG ("failed to set request url");
+        return 1;
+    }
+    return 0;
+}
+
+static int
+_chimp_http_parser_on_header_field (
+        http_parser *p, const char *data, size_t len)
 {
     ChimpRef *self = p->data;
-    ChimpRef *req = CHIMP_HTTP_PARSER(self)->request;
-    if (CHIMP_HTTP_REQUEST(req)->body == NULL) {
-        CHIMP_HTTP_REQUEST(req)->body = chimp_str_new (data, len);
-        if (CHIMP_HTTP_REQUEST(req)->body == NULL) {
-            CHIMP_BUG ("failed to allocate body");
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+
+    if (parser->header_state == CHIMP_HTTP_HEADER_VALUE) {
+        if (chimp_http_parser_flush_header (self) != 0) {
             return 1;
         }
     }
-    else {
-        if (!chimp_str_append_strn (CHIMP_HTTP_REQUEST(req)->body, data, len)) {
-            CHIMP_BUG ("failed to append body content");
-            return 1;
-        }
+    parser->header_state = CHIMP_HTTP_HEADER_FIELD;
+    if (!chimp_http_buffer_append (&parser->field, data, len)) {
+        CHIMP_BUG ("failed to allocate header");
+        return 1;
     }
     return 0;
 }
 
 static int
-_chimp_http_parser_on_message_complete (http_parser *p)
+_chimp_http_parser_on_header_value (
+        http_parser *p, const char *data, size_t len)
+{
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(p->data);
+
+    parser->header_state = CHIMP_HTTP_HEADER_VALUE;
+    if (!chimp_http_buffer_append (&parser->value, data, len)) {
+        CHIMP_BUG ("failed to allocate header value");
+        return 1;
+    }
+    return 0;
+}
+
+static int
+_chimp_http_parser_on_headers_complete (http_parser *p)
 {
-    const char *method_str = http_method_str (p->method);
-    ChimpRef *req = CHIMP_HTTP_PARSER(p->data)->request;
-    CHIMP_HTTP_REQUEST(req)->method =
-        chimp_str_new (method_str, strlen (method_str));
+    ChimpRef *self = p->data;
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+    ChimpRef *req = parser->request;
+
+    if (parser->header_state == CHIMP_HTTP_HEADER_VALUE) {
+        if (chimp_http_parser_flush_header (self) != 0) {
+            return 1;
+        }
+    }
+    parser->header_state = CHIMP_HTTP_HEADER_NONE;
+
+    CHIMP_HTTP_REQUEST(req)->url = chimp_str_new (parser->url.data, parser->url.size);
+    if (CHIMP_HTTP_REQUEST(req)->url == NULL) {
+        CHIMP_BUG ("failed to set request url");
+        return 1;
+    }
+    CHIMP_HTTP_REQUEST(req)->method = chimp_http_parser_method (self, p->method);
     if (CHIMP_HTTP_REQUEST(req)->method == NULL) {
         CHIMP_BUG ("failed to allocate method");
         return 1;
@@ -195,7 +363,73 @@ _chimp_http_parser_on_message_complete (http_parser *p)
         CHIMP_BUG ("failed to allocate version");
         return 1;
     }
-    CHIMP_HTTP_PARSER(p->data)->complete = CHIMP_TRUE;
+    CHIMP_HTTP_REQUEST(req)->keep_alive =
+        http_should_keep_alive (p) ? CHIMP_TRUE : CHIMP_FALSE;
+
+    if ((p->flags & F_CHUNKED) ||
+            (p->content_length != ULLONG_MAX &&
+                p->content_length > parser->body_limit)) {
+        parser->streaming = CHIMP_TRUE;
+        if (!chimp_http_parser_emit (self, chimp_array_new_var (
+                CHIMP_STR_NEW("headers"), req, NULL))) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+_chimp_http_parser_on_body (http_parser *p, const char *data, size_t len)
+{
+    ChimpRef *self = p->data;
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+
+    if (parser->streaming) {
+        ChimpRef *chunk = chimp_str_new (data, len);
+        if (chunk == NULL) {
+            CHIMP_BUG ("failed to allocate body");
+            return 1;
+        }
+        if (!chimp_http_parser_emit (self, chimp_array_new_var (
+                CHIMP_STR_NEW("body"), parser->request, chunk, NULL))) {
+            return 1;
+        }
+    }
+    else if (!chimp_http_buffer_append (&parser->body, data, len)) {
+        CHIMP_BUG ("failed to append body content");
+        return 1;
+    }
+    return 0;
+}
+
+static int
+_chimp_http_parser_on_message_complete (http_parser *p)
+{
+    ChimpRef *self = p->data;
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+    ChimpRef *req = parser->request;
+
+    if (parser->streaming) {
+        if (!chimp_http_parser_emit (self, chimp_array_new_var (
+                CHIMP_STR_NEW("end"), req, NULL))) {
+            return 1;
+        }
+    }
+    else {
+        if (parser->body.size > 0) {
+            CHIMP_HTTP_REQUEST(req)->body =
+                chimp_str_new (parser->body.data, parser->body.size);
+            if (CHIMP_HTTP_REQUEST(req)->body == NULL) {
+                CHIMP_BUG ("failed to allocate body");
+                return 1;
+            }
+        }
+        if (!chimp_http_parser_emit (self, chimp_array_new_var (
+                CHIMP_STR_NEW("request"), req, NULL))) {
+            return 1;
+        }
+    }
+    parser->request = NULL;
     return 0;
 }
 
@@ -203,8 +437,28 @@ static ChimpRef *
 _chimp_http_parser_init (ChimpRef *self, ChimpRef *args)
 {
     http_parser_settings *conf;
+    int64_t body_limit = CHIMP_HTTP_DEFAULT_BODY_LIMIT;
+
+    if (!chimp_method_parse_args (args, "|I", &body_limit)) {
+        return NULL;
+    }
+
     http_parser_init (&CHIMP_HTTP_PARSER(self)->impl, HTTP_REQUEST);
     CHIMP_HTTP_PARSER(self)->impl.data = self;
+    CHIMP_HTTP_PARSER(self)->body_limit =
+        body_limit > 0 ? (size_t) body_limit : 0;
+    CHIMP_HTTP_PARSER(self)->pending = chimp_array_new ();
+    if (CHIMP_HTTP_PARSER(self)->pending == NULL) {
+        return NULL;
+    }
+    CHIMP_HTTP_PARSER(self)->methods = chimp_array_new ();
+    if (CHIMP_HTTP_PARSER(self)->methods == NULL) {
+        return NULL;
+    }
+    CHIMP_HTTP_PARSER(self)->header_names = chimp_array_new ();
+    if (CHIMP_HTTP_PARSER(self)->header_names == NULL) {
+        return NULL;
+    }
     conf = &CHIMP_HTTP_PARSER(self)->conf;
     memset (conf, 0, sizeof(*conf));
     conf->on_message_begin = _chimp_http_parser_on_message_begin;
@@ -220,24 +474,106 @@ _chimp_http_parser_init (ChimpRef *self, ChimpRef *args)
 static void
 _chimp_http_parser_dtor (ChimpRef *self)
 {
+    chimp_http_buffer_free (&CHIMP_HTTP_PARSER(self)->url);
+    chimp_http_buffer_free (&CHIMP_HTTP_PARSER(self)->field);
+    chimp_http_buffer_free (&CHIMP_HTTP_PARSER(self)->value);
+    chimp_http_buffer_free (&CHIMP_HTTP_PARSER(self)->body);
 }
 
 static void
 _chimp_http_parser_mark (ChimpGC *gc, ChimpRef *self)
 {
     chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->request);
-    chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->header);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->events);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->pending);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->methods);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_PARSER(self)->header_names);
+}
+
+/* runs data through the parser. returns the events it produced, or an
+ * error if the data wasn't valid HTTP. an empty str signals EOF.
+ */
+static ChimpRef *
+chimp_http_parser_feed (ChimpRef *self, const char *data, size_t size)
+{
+    ChimpHttpParser *parser = CHIMP_HTTP_PARSER(self);
+    ChimpRef *events;
+    size_t n;
+
+    events = chimp_array_new ();
+    if (events == NULL) {
+        return NULL;
+    }
+    parser->events = events;
+    n = http_parser_execute (&parser->impl, &parser->conf, data, size);
+    parser->events = NULL;
+
+    if (HTTP_PARSER_ERRNO(&parser->impl) != HPE_OK) {
+        return chimp_error_new_with_format ("http: %s",
+            http_errno_description (HTTP_PARSER_ERRNO(&parser->impl)));
+    }
+    else if (n != size && !parser->impl.upgrade) {
+        return chimp_error_new (CHIMP_STR_NEW("http: unparsed data"));
+    }
+    return events;
+}
+
+static ChimpRef *
+_chimp_http_parser_feed (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *data;
+
+    if (!chimp_method_parse_args (args, "o", &data)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(data) != chimp_str_class) {
+        CHIMP_BUG ("http.parser.feed expects a str");
+        return NULL;
+    }
+
+    return chimp_http_parser_feed (
+        self, CHIMP_STR_DATA(data), CHIMP_STR_SIZE(data));
+}
+
+/* queues the complete requests in events on the parser's pending list,
+ * gluing streamed bodies back together along the way.
+ */
+static chimp_bool_t
+chimp_http_parser_collect (ChimpRef *self, ChimpRef *events)
+{
+    size_t i;
+    ChimpRef *pending = CHIMP_HTTP_PARSER(self)->pending;
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(events); i++) {
+        ChimpRef *event = CHIMP_ARRAY_ITEM(events, i);
+        const char *kind = CHIMP_STR_DATA(CHIMP_ARRAY_ITEM(event, 0));
+        ChimpRef *req = CHIMP_ARRAY_ITEM(event, 1);
+        if (strcmp (kind, "body") == 0) {
+            if (!chimp_str_append (CHIMP_HTTP_REQUEST(req)->body,
+                    CHIMP_ARRAY_ITEM(event, 2))) {
+                return CHIMP_FALSE;
+            }
+        }
+        else if (strcmp (kind, "request") == 0 || strcmp (kind, "end") == 0) {
+            if (!chimp_array_push (pending, req)) {
+                return CHIMP_FALSE;
+            }
+        }
+    }
+    return CHIMP_TRUE;
 }
 
+/* parse_request(sock) reads from sock until a whole request is available.
+ * requests pipelined behind it are kept for subsequent calls. returns nil
+ * at EOF.
+ */
 static ChimpRef *
 _chimp_http_parser_parse_request (ChimpRef *self, ChimpRef *args)
 {
     ChimpRef *size;
     ChimpRef *recv_args;
     ChimpRef *data;
-    ChimpRef *req;
-    http_parser *p = &CHIMP_HTTP_PARSER(self)->impl;
-    http_parser_settings *conf = &CHIMP_HTTP_PARSER(self)->conf;
+    ChimpRef *pending = CHIMP_HTTP_PARSER(self)->pending;
     ChimpRef *sck;
     
     if (!chimp_method_parse_args (args, "o", &sck)) {
@@ -252,35 +588,32 @@ _chimp_http_parser_parse_request (ChimpRef *self, ChimpRef *args)
     if (recv_args == NULL) {
         return NULL;
     }
-    while (!CHIMP_HTTP_PARSER(self)->complete) {
-        size_t size;
+    while (CHIMP_ARRAY_SIZE(pending) == 0) {
+        ChimpRef *events;
         data = chimp_object_call_method (sck, "recv", recv_args);
         if (data == NULL) {
             return NULL;
         }
-        else if (CHIMP_STR_SIZE(data) == 0) {
-            http_parser_execute (p, conf, "", 0);
-            if (HTTP_PARSER_ERRNO(p) != HPE_OK) {
-                req = NULL;
-                CHIMP_BUG (http_errno_description (HTTP_PARSER_ERRNO(p)));
-                goto done;
-            }
-            break;
+        if (CHIMP_ANY_CLASS(data) != chimp_str_class) {
+            /* timeouts & errors */
+            return data;
+        }
+        events = chimp_http_parser_feed (
+            self, CHIMP_STR_DATA(data), CHIMP_STR_SIZE(data));
+        if (events == NULL || CHIMP_ANY_CLASS(events) != chimp_array_class) {
+            return events;
         }
-        size = CHIMP_STR_SIZE(data);
-        http_parser_execute (p, conf, CHIMP_STR_DATA(data), size); 
-        if (HTTP_PARSER_ERRNO(p) != HPE_OK) {
-            req = NULL;
-            CHIMP_BUG (http_errno_description (HTTP_PARSER_ERRNO(p)));
-            goto done;
+        if (!chimp_http_parser_collect (self, events)) {
+            return NULL;
+        }
+        if (CHIMP_STR_SIZE(data) == 0) {
+            break;
         }
     }
-    req = CHIMP_HTTP_PARSER(self)->request;
-done:
-    CHIMP_HTTP_PARSER(self)->request = NULL;
-    CHIMP_HTTP_PARSER(self)->header = NULL;
-    CHIMP_HTTP_PARSER(self)->complete = CHIMP_FALSE;
-    return (req == NULL) ? chimp_nil : req;
+    if (CHIMP_ARRAY_SIZE(pending) == 0) {
+        return chimp_nil;
+    }
+    return chimp_array_shift (pending);
 }
 
 static ChimpRef *
@@ -294,6 +627,10 @@ _chimp_init_http_parser_class (void)
     CHIMP_CLASS(klass)->init = _chimp_http_parser_init;
     CHIMP_CLASS(klass)->dtor = _chimp_http_parser_dtor;
     CHIMP_CLASS(klass)->mark = _chimp_http_parser_mark;
+    if (!chimp_class_add_native_method (
+            klass, "feed", _chimp_http_parser_feed)) {
+        return NULL;
+    }
     if (!chimp_class_add_native_method (
             klass, "parse_request", _chimp_http_parser_parse_request)) {
         return NULL;
@@ -342,6 +679,9 @@ _chimp_http_request_getattr (ChimpRef *self, ChimpRef *attr)
     else if (strcmp (CHIMP_STR_DATA(attr), "version") == 0) {
         return CHIMP_HTTP_REQUEST(self)->http_version;
     }
+    else if (strcmp (CHIMP_STR_DATA(attr), "keep_alive") == 0) {
+        return CHIMP_HTTP_REQUEST(self)->keep_alive ? chimp_true : chimp_false;
+    }
     else {
         CHIMP_BUG (
             "unknown attribute %s on http.request", CHIMP_STR_DATA(attr));
@@ -380,29 +720,1551 @@ _chimp_init_http_request_class (void)
     return klass;
 }
 
-ChimpRef *
-chimp_init_http_module (void)
+/*
+ * http.response(status[, headers[, body]])
+ *
+ * A response is serialized straight into a buffer owned by the response
+ * -- no intermediate strs -- and sent with one writev of that buffer &
+ * the body. Server & Date headers are added unless already present; the
+ * Date line is formatted at most once a second for the whole process.
+ */
+
+typedef struct _ChimpHttpResponse {
+    ChimpAny base;
+    int64_t status;
+    ChimpRef *headers;      /* name, value, name, value, ... */
+    ChimpRef *body;
+    ChimpHttpBuffer head;   /* status line & headers, reused between sends */
+} ChimpHttpResponse;
+
+static ChimpRef *chimp_http_response_class = NULL;
+
+#define CHIMP_HTTP_RESPONSE(ref) \
+    CHIMP_CHECK_CAST(ChimpHttpResponse, (ref), chimp_http_response_class)
+
+#define CHIMP_HTTP_SERVER_LINE "Server: chimp\r\n"
+
+static pthread_mutex_t chimp_http_date_lock = PTHREAD_MUTEX_INITIALIZER;
+static time_t chimp_http_date_time = 0;
+static char chimp_http_date_line[64];
+
+/* header lines common enough to be worth keeping pre-formatted */
+static const struct {
+    const char *value;
+    const char *line;
+} chimp_http_content_types[] = {
+    { "text/plain", "Content-Type: text/plain\r\n" },
+    { "text/html", "Content-Type: text/html\r\n" },
+    { "text/plain; charset=utf-8", "Content-Type: text/plain; charset=utf-8\r\n" },
+    { "text/html; charset=utf-8", "Content-Type: text/html; charset=utf-8\r\n" },
+    { "application/json", "Content-Type: application/json\r\n" },
+    { "application/octet-stream", "Content-Type: application/octet-stream\r\n" },
+    { NULL, NULL }
+};
+
+static const char *
+chimp_http_reason (int64_t status)
 {
-    ChimpRef *http;
-    ChimpRef *http_parser_class;
-    ChimpRef *http_request_class;
+    switch (status) {
+        case 100: return "Continue";
+        case 101: return "Switching Protocols";
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 408: return "Request Timeout";
+        case 409: return "Conflict";
+        case 411: return "Length Required";
+        case 413: return "Request Entity Too Large";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        default:  return "Unknown";
+    }
+}
 
-    http = chimp_module_new_str ("http", NULL);
-    if (http == NULL) {
-        return NULL;
+static chimp_bool_t
+chimp_http_buffer_append_str (ChimpHttpBuffer *buf, const char *s)
+{
+    return chimp_http_buffer_append (buf, s, strlen (s));
+}
+
+static chimp_bool_t
+chimp_http_append_date_line (ChimpHttpBuffer *buf)
+{
+    char line[64];
+    time_t now = time (NULL);
+
+    pthread_mutex_lock (&chimp_http_date_lock);
+    if (now != chimp_http_date_time) {
+        struct tm tm;
+        gmtime_r (&now, &tm);
+        strftime (chimp_http_date_line, sizeof(chimp_http_date_line),
+            "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        chimp_http_date_time = now;
     }
+    memcpy (line, chimp_http_date_line, sizeof(line));
+    pthread_mutex_unlock (&chimp_http_date_lock);
 
-    http_parser_class = _chimp_init_http_parser_class ();
-    if (!chimp_module_add_local_str (http, "parser", http_parser_class)) {
-        return NULL;
+    return chimp_http_buffer_append_str (buf, line);
+}
+
+/* CRs & LFs are dropped from header names & values: otherwise anybody who
+ * gets a str into a header could start a header (or a response) of their
+ * own.
+ */
+static chimp_bool_t
+chimp_http_buffer_append_field (ChimpHttpBuffer *buf, ChimpRef *str)
+{
+    const char *data = CHIMP_STR_DATA(str);
+    const char *end = data + CHIMP_STR_SIZE(str);
+
+    while (data < end) {
+        const char *p = data;
+        while (p < end && *p != '\r' && *p != '\n') {
+            p++;
+        }
+        if (p > data && !chimp_http_buffer_append (buf, data, p - data)) {
+            return CHIMP_FALSE;
+        }
+        data = p + 1;
     }
-    chimp_http_parser_class = http_parser_class;
+    return CHIMP_TRUE;
+}
 
-    http_request_class = _chimp_init_http_request_class ();
-    if (!chimp_module_add_local_str (http, "request", http_request_class)) {
-        return NULL;
+static chimp_bool_t
+chimp_http_append_header (ChimpHttpBuffer *buf, ChimpRef *name, ChimpRef *value)
+{
+    name = chimp_object_str (name);
+    value = chimp_object_str (value);
+    if (name == NULL || value == NULL) {
+        return CHIMP_FALSE;
     }
-    chimp_http_request_class = http_request_class;
+
+    if (CHIMP_STR_SIZE(name) == 12 &&
+            strcasecmp (CHIMP_STR_DATA(name), "Content-Type") == 0) {
+        size_t i;
+        for (i = 0; chimp_http_content_types[i].value != NULL; i++) {
+            if (strcmp (CHIMP_STR_DATA(value),
+                        chimp_http_content_types[i].value) == 0) {
+                return chimp_http_buffer_append_str (
+                    buf, chimp_http_content_types[i].line);
+            }
+        }
+    }
+
+    return chimp_http_buffer_append_field (buf, name) &&
+           chimp_http_buffer_append (buf, ": ", 2) &&
+           chimp_http_buffer_append_field (buf, value) &&
+           chimp_http_buffer_append (buf, "\r\n", 2);
+}
+
+/* headers may be nil, a hash or a flat array of names & values. sets
+ * *seen_server, *seen_date & *seen_length if Server, Date & Content-Length
+ * are among them.
+ */
+static chimp_bool_t
+chimp_http_append_headers (ChimpHttpBuffer *buf, ChimpRef *headers,
+        chimp_bool_t *seen_server, chimp_bool_t *seen_date,
+        chimp_bool_t *seen_length)
+{
+    ChimpRef **names;
+    ChimpRef **values;
+    size_t stride;
+    size_t size;
+    size_t i;
+
+    if (headers == NULL || headers == chimp_nil) {
+        return CHIMP_TRUE;
+    }
+    else if (CHIMP_ANY_CLASS(headers) == chimp_hash_class) {
+        names = CHIMP_HASH(headers)->keys;
+        values = CHIMP_HASH(headers)->values;
+        size = CHIMP_HASH_SIZE(headers);
+        stride = 1;
+    }
+    else if (CHIMP_ANY_CLASS(headers) == chimp_array_class) {
+        names = CHIMP_ARRAY(headers)->items;
+        values = CHIMP_ARRAY(headers)->items + 1;
+        size = CHIMP_ARRAY_SIZE(headers) / 2;
+        stride = 2;
+    }
+    else {
+        CHIMP_BUG ("http response headers must be a hash");
+        return CHIMP_FALSE;
+    }
+
+    for (i = 0; i < size; i++) {
+        ChimpRef *name = names[i * stride];
+        if (!chimp_http_append_header (buf, name, values[i * stride])) {
+            return CHIMP_FALSE;
+        }
+        if (CHIMP_ANY_CLASS(name) == chimp_str_class) {
+            if (strcasecmp (CHIMP_STR_DATA(name), "Server") == 0) {
+                *seen_server = CHIMP_TRUE;
+            }
+            else if (strcasecmp (CHIMP_STR_DATA(name), "Date") == 0) {
+                *seen_date = CHIMP_TRUE;
+            }
+            else if (strcasecmp (CHIMP_STR_DATA(name), "Content-Length") == 0) {
+                *seen_length = CHIMP_TRUE;
+            }
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* status line & headers, up to but not including the blank line */
+static chimp_bool_t
+chimp_http_write_head (ChimpHttpBuffer *buf, int http_minor,
+        int64_t status, ChimpRef *headers, const char *framing)
+{
+    char line[64];
+    chimp_bool_t seen_server = CHIMP_FALSE;
+    chimp_bool_t seen_date = CHIMP_FALSE;
+    chimp_bool_t seen_length = CHIMP_FALSE;
+
+    snprintf (line, sizeof(line), "HTTP/1.%d %d %s\r\n",
+        http_minor, (int) status, chimp_http_reason (status));
+    if (!chimp_http_buffer_append_str (buf, line)) {
+        return CHIMP_FALSE;
+    }
+    if (!chimp_http_append_headers (
+            buf, headers, &seen_server, &seen_date, &seen_length)) {
+        return CHIMP_FALSE;
+    }
+    if (!seen_server) {
+        if (!chimp_http_buffer_append_str (buf, CHIMP_HTTP_SERVER_LINE)) {
+            return CHIMP_FALSE;
+        }
+    }
+    if (!seen_date) {
+        if (!chimp_http_append_date_line (buf)) {
+            return CHIMP_FALSE;
+        }
+    }
+    /* a Content-Length set by the caller replaces the one we worked out */
+    if (seen_length && framing != NULL &&
+            strncasecmp (framing, "Content-Length:", 15) == 0) {
+        framing = NULL;
+    }
+    if (framing != NULL && !chimp_http_buffer_append_str (buf, framing)) {
+        return CHIMP_FALSE;
+    }
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_http_response_serialize (ChimpRef *self)
+{
+    char framing[64];
+    ChimpHttpResponse *res = CHIMP_HTTP_RESPONSE(self);
+    size_t size = res->body == chimp_nil ? 0 : CHIMP_STR_SIZE(res->body);
+
+    res->head.size = 0;
+    snprintf (framing, sizeof(framing), "Content-Length: %zu\r\n", size);
+    return chimp_http_write_head (
+                &res->head, 1, res->status, res->headers, framing) &&
+           chimp_http_buffer_append (&res->head, "\r\n", 2);
+}
+
+static chimp_bool_t
+chimp_http_response_set_body (ChimpRef *self, ChimpRef *body)
+{
+    if (body != chimp_nil && CHIMP_ANY_CLASS(body) != chimp_str_class) {
+        body = chimp_object_str (body);
+        if (body == NULL) {
+            return CHIMP_FALSE;
+        }
+    }
+    CHIMP_HTTP_RESPONSE(self)->body = body;
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_http_response_init (ChimpRef *self, ChimpRef *args)
+{
+    int64_t status = 200;
+    ChimpRef *headers = NULL;
+    ChimpRef *body = chimp_nil;
+
+    if (!chimp_method_parse_args (args, "|Ioo", &status, &headers, &body)) {
+        return NULL;
+    }
+    CHIMP_HTTP_RESPONSE(self)->status = status;
+    CHIMP_HTTP_RESPONSE(self)->headers = chimp_array_new ();
+    if (CHIMP_HTTP_RESPONSE(self)->headers == NULL) {
+        return NULL;
+    }
+    if (headers != NULL && headers != chimp_nil) {
+        size_t i;
+        if (CHIMP_ANY_CLASS(headers) != chimp_hash_class) {
+            CHIMP_BUG ("http.response headers must be a hash");
+            return NULL;
+        }
+        for (i = 0; i < CHIMP_HASH_SIZE(headers); i++) {
+            if (!chimp_array_push (CHIMP_HTTP_RESPONSE(self)->headers,
+                        CHIMP_HASH(headers)->keys[i]) ||
+                    !chimp_array_push (CHIMP_HTTP_RESPONSE(self)->headers,
+                        CHIMP_HASH(headers)->values[i])) {
+                return NULL;
+            }
+        }
+    }
+    if (!chimp_http_response_set_body (self, body)) {
+        return NULL;
+    }
+    return self;
+}
+
+static void
+_chimp_http_response_dtor (ChimpRef *self)
+{
+    chimp_http_buffer_free (&CHIMP_HTTP_RESPONSE(self)->head);
+}
+
+static void
+_chimp_http_response_mark (ChimpGC *gc, ChimpRef *self)
+{
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_RESPONSE(self)->headers);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_RESPONSE(self)->body);
+}
+
+static ChimpRef *
+_chimp_http_response_set_status (ChimpRef *self, ChimpRef *args)
+{
+    if (!chimp_method_parse_args (
+            args, "I", &CHIMP_HTTP_RESPONSE(self)->status)) {
+        return NULL;
+    }
+    return self;
+}
+
+/* add_header(name, value) adds a header, even if there's one by that name */
+static ChimpRef *
+_chimp_http_response_add_header (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *name;
+    ChimpRef *value;
+    ChimpRef *headers = CHIMP_HTTP_RESPONSE(self)->headers;
+
+    if (!chimp_method_parse_args (args, "oo", &name, &value)) {
+        return NULL;
+    }
+    if (!chimp_array_push (headers, name) || !chimp_array_push (headers, value)) {
+        return NULL;
+    }
+    return self;
+}
+
+/* set_header(name, value) replaces any existing headers by that name */
+static ChimpRef *
+_chimp_http_response_set_header (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *name;
+    ChimpRef *value;
+    ChimpRef *headers = CHIMP_HTTP_RESPONSE(self)->headers;
+    chimp_bool_t found = CHIMP_FALSE;
+
+    if (!chimp_method_parse_args (args, "oo", &name, &value)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(name) != chimp_str_class) {
+        CHIMP_BUG ("http.response header names must be strs");
+        return NULL;
+    }
+
+    i = 0;
+    while (i + 1 < CHIMP_ARRAY_SIZE(headers)) {
+        ChimpRef *existing = CHIMP_ARRAY_ITEM(headers, i);
+        if (CHIMP_ANY_CLASS(existing) == chimp_str_class &&
+                strcasecmp (CHIMP_STR_DATA(existing), CHIMP_STR_DATA(name)) == 0) {
+            if (!found) {
+                CHIMP_ARRAY(headers)->items[i + 1] = value;
+                found = CHIMP_TRUE;
+            }
+            else {
+                /* drop duplicates */
+                memmove (CHIMP_ARRAY(headers)->items + i,
+                         CHIMP_ARRAY(headers)->items + i + 2,
+                         sizeof(ChimpRef *) * (CHIMP_ARRAY_SIZE(headers) - i - 2));
+                CHIMP_ARRAY(headers)->size -= 2;
+                continue;
+            }
+        }
+        i += 2;
+    }
+    if (!found) {
+        if (!chimp_array_push (headers, name) ||
+                !chimp_array_push (headers, value)) {
+            return NULL;
+        }
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_http_response_set_body (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *body;
+
+    if (!chimp_method_parse_args (args, "o", &body)) {
+        return NULL;
+    }
+    if (!chimp_http_response_set_body (self, body)) {
+        return NULL;
+    }
+    return self;
+}
+
+/* send(sock[, timeout]) writes the response to sock with a single writev
+ * where possible. returns the number of bytes sent.
+ */
+static ChimpRef *
+_chimp_http_response_send (ChimpRef *self, ChimpRef *args)
+{
+    struct iovec iov[2];
+    struct iovec *next = iov;
+    ChimpRef *sock;
+    ChimpRef *fd_ref;
+    ChimpRef *body;
+    int64_t timeout = -1;
+    int n_iov;
+    int fd;
+    size_t sent = 0;
+
+    if (!chimp_method_parse_args (args, "o|I", &sock, &timeout)) {
+        return NULL;
+    }
+    fd_ref = chimp_object_getattr_str (sock, "fd");
+    if (fd_ref == NULL) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(fd_ref) != chimp_int_class) {
+        CHIMP_BUG ("http.response.send expects a socket");
+        return NULL;
+    }
+    fd = (int) CHIMP_INT(fd_ref)->value;
+
+    if (!chimp_http_response_serialize (self)) {
+        return NULL;
+    }
+    body = CHIMP_HTTP_RESPONSE(self)->body;
+    iov[0].iov_base = CHIMP_HTTP_RESPONSE(self)->head.data;
+    iov[0].iov_len = CHIMP_HTTP_RESPONSE(self)->head.size;
+    n_iov = 1;
+    if (body != chimp_nil && CHIMP_STR_SIZE(body) > 0) {
+        iov[1].iov_base = CHIMP_STR_DATA(body);
+        iov[1].iov_len = CHIMP_STR_SIZE(body);
+        n_iov = 2;
+    }
+
+    while (n_iov > 0) {
+        ssize_t n = writev (fd, next, n_iov);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd;
+                int rc;
+                pfd.fd = fd;
+                pfd.events = POLLOUT;
+                pfd.revents = 0;
+                do {
+                    rc = poll (&pfd, 1, timeout < 0 ? -1 : (int) timeout);
+                } while (rc < 0 && errno == EINTR);
+                if (rc > 0) {
+                    continue;
+                }
+                break;
+            }
+            if (sent == 0) {
+                return chimp_error_new_with_format (
+                    "writev: %s", strerror (errno));
+            }
+            break;
+        }
+        sent += (size_t) n;
+        while (n_iov > 0 && (size_t) n >= next->iov_len) {
+            n -= next->iov_len;
+            next++;
+            n_iov--;
+        }
+        if (n_iov > 0) {
+            next->iov_base = (char *) next->iov_base + n;
+            next->iov_len -= (size_t) n;
+        }
+    }
+    return chimp_int_new (sent);
+}
+
+/* serialize() returns the whole response as a str */
+static ChimpRef *
+_chimp_http_response_serialize (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *result;
+    ChimpRef *body = CHIMP_HTTP_RESPONSE(self)->body;
+
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+    if (!chimp_http_response_serialize (self)) {
+        return NULL;
+    }
+    result = chimp_str_new (CHIMP_HTTP_RESPONSE(self)->head.data,
+                            CHIMP_HTTP_RESPONSE(self)->head.size);
+    if (result == NULL) {
+        return NULL;
+    }
+    if (body != chimp_nil && !chimp_str_append (result, body)) {
+        return NULL;
+    }
+    return result;
+}
+
+static ChimpRef *
+_chimp_http_response_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp (CHIMP_STR_DATA(attr), "status") == 0) {
+        return chimp_int_new (CHIMP_HTTP_RESPONSE(self)->status);
+    }
+    else if (strcmp (CHIMP_STR_DATA(attr), "headers") == 0) {
+        /* [name, value] pairs, in the order they'll be sent */
+        size_t i;
+        ChimpRef *headers = CHIMP_HTTP_RESPONSE(self)->headers;
+        ChimpRef *pairs = chimp_array_new_with_capacity (
+                CHIMP_ARRAY_SIZE(headers) / 2);
+        if (pairs == NULL) {
+            return NULL;
+        }
+        for (i = 0; i + 1 < CHIMP_ARRAY_SIZE(headers); i += 2) {
+            ChimpRef *pair = chimp_array_new_var (
+                CHIMP_ARRAY_ITEM(headers, i),
+                CHIMP_ARRAY_ITEM(headers, i + 1),
+                NULL);
+            if (pair == NULL || !chimp_array_push (pairs, pair)) {
+                return NULL;
+            }
+        }
+        return pairs;
+    }
+    else if (strcmp (CHIMP_STR_DATA(attr), "body") == 0) {
+        return CHIMP_HTTP_RESPONSE(self)->body;
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static ChimpRef *
+_chimp_http_response_str (ChimpRef *self)
+{
+    return chimp_str_new_format ("http.response(status=%d)",
+        (int) CHIMP_HTTP_RESPONSE(self)->status);
+}
+
+static ChimpRef *
+_chimp_http_init_response_class (void)
+{
+    ChimpRef *klass = chimp_class_new (
+            CHIMP_STR_NEW("http.response"), NULL, sizeof(ChimpHttpResponse));
+    if (klass == NULL) {
+        return NULL;
+    }
+    CHIMP_CLASS(klass)->init = _chimp_http_response_init;
+    CHIMP_CLASS(klass)->dtor = _chimp_http_response_dtor;
+    CHIMP_CLASS(klass)->mark = _chimp_http_response_mark;
+    CHIMP_CLASS(klass)->getattr = _chimp_http_response_getattr;
+    CHIMP_CLASS(klass)->str = _chimp_http_response_str;
+    if (!chimp_class_add_native_method (
+            klass, "set_status", _chimp_http_response_set_status)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "add_header", _chimp_http_response_add_header)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "set_header", _chimp_http_response_set_header)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "set_body", _chimp_http_response_set_body)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "send", _chimp_http_response_send)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "serialize", _chimp_http_response_serialize)) {
+        return NULL;
+    }
+    return klass;
+}
+
+/*
+ * http.server(port, handler[, options])
+ *
+ * Accepting, parsing, keep-alive & response serialization all happen in C.
+ * serve() starts a pool of worker tasks -- the handler reaches each one
+ * through the message layer, like any other task argument -- and the
+ * workers accept connections off the shared listening socket. Each worker
+ * multiplexes the connections it accepted with epoll, so an idle
+ * keep-alive client costs a slot in its table rather than the whole
+ * worker. Requests are handed to handler(req, stream), which returns one
+ * of:
+ *
+ *   "body"                   200 OK
+ *   http.response(...)
+ *   [status, body]
+ *   [status, headers, body]  headers is a hash of name => value
+ *   nil                      204 No Content
+ *   error(...)               500 Internal Server Error
+ *
+ * or streams its response with stream.start(status[, headers]) and
+ * stream.write(chunk), in which case the return value is ignored & the
+ * body is sent chunked.
+ *
+ * Responses to pipelined requests are buffered & written together.
+ *
+ * Options are "workers" (default: one per CPU), "backlog" and
+ * "keepalive_timeout" in milliseconds (default 5000, negative to never
+ * drop idle connections).
+ */
+
+typedef struct _ChimpHttpConnection {
+    int fd;
+    int http_minor;
+    chimp_bool_t keep_alive;
+    size_t slot;        /* index into the worker's connection table */
+    int64_t deadline;   /* when an idle connection gets dropped (ms) */
+    ChimpHttpBuffer out;
+} ChimpHttpConnection;
+
+/* a worker's connections. parsers[i] belongs to conns[i]. */
+typedef struct _ChimpHttpWorker {
+    int epfd;
+    int listen_fd;      /* -1 once the server has been closed */
+    ChimpRef *handler;
+    int64_t timeout;
+    ChimpHttpConnection **conns;
+    size_t nconns;
+    size_t capacity;
+    ChimpRef *parsers;
+} ChimpHttpWorker;
+
+typedef struct _ChimpHttpServer {
+    ChimpAny base;
+    int fd;
+    ChimpRef *handler;
+    ChimpRef *workers;
+    int64_t nworkers;
+    int64_t keepalive_timeout;
+} ChimpHttpServer;
+
+typedef enum _ChimpHttpStreamState {
+    CHIMP_HTTP_STREAM_IDLE,
+    CHIMP_HTTP_STREAM_STARTED,
+    CHIMP_HTTP_STREAM_CLOSED
+} ChimpHttpStreamState;
+
+typedef struct _ChimpHttpStream {
+    ChimpAny base;
+    ChimpHttpConnection *conn;
+    ChimpHttpStreamState state;
+    chimp_bool_t chunked;
+} ChimpHttpStream;
+
+#define CHIMP_HTTP_DEFAULT_KEEPALIVE_TIMEOUT 5000
+
+/* how many ready sockets a worker picks up per epoll_wait */
+#define CHIMP_HTTP_SERVER_MAX_EVENTS 64
+
+static ChimpRef *chimp_http_server_class = NULL;
+static ChimpRef *chimp_http_stream_class = NULL;
+static ChimpRef *chimp_http_server_worker = NULL;
+
+#define CHIMP_HTTP_SERVER(ref) \
+    CHIMP_CHECK_CAST(ChimpHttpServer, (ref), chimp_http_server_class)
+
+#define CHIMP_HTTP_STREAM(ref) \
+    CHIMP_CHECK_CAST(ChimpHttpStream, (ref), chimp_http_stream_class)
+
+static chimp_bool_t
+chimp_http_send_all (int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = send (fd, data, size, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return CHIMP_FALSE;
+        }
+        data += n;
+        size -= (size_t) n;
+    }
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_http_connection_flush (ChimpHttpConnection *conn)
+{
+    chimp_bool_t ok = chimp_http_send_all (conn->fd, conn->out.data, conn->out.size);
+    conn->out.size = 0;
+    return ok;
+}
+
+static chimp_bool_t
+chimp_http_connection_write_head (ChimpHttpConnection *conn,
+        int64_t status, ChimpRef *headers, const char *framing)
+{
+    ChimpHttpBuffer *out = &conn->out;
+
+    if (!chimp_http_write_head (
+            out, conn->http_minor, status, headers, framing)) {
+        return CHIMP_FALSE;
+    }
+    if (!conn->keep_alive) {
+        if (!chimp_http_buffer_append_str (out, "Connection: close\r\n")) {
+            return CHIMP_FALSE;
+        }
+    }
+    else if (conn->http_minor == 0) {
+        if (!chimp_http_buffer_append_str (out, "Connection: keep-alive\r\n")) {
+            return CHIMP_FALSE;
+        }
+    }
+    return chimp_http_buffer_append (out, "\r\n", 2);
+}
+
+static chimp_bool_t
+chimp_http_connection_write_response (ChimpHttpConnection *conn,
+        int64_t status, ChimpRef *headers, const char *body, size_t size)
+{
+    char framing[64];
+
+    snprintf (framing, sizeof(framing), "Content-Length: %zu\r\n", size);
+    if (!chimp_http_connection_write_head (conn, status, headers, framing)) {
+        return CHIMP_FALSE;
+    }
+    return chimp_http_buffer_append (&conn->out, body, size);
+}
+
+static chimp_bool_t
+chimp_http_stream_start (ChimpRef *self, int64_t status, ChimpRef *headers)
+{
+    ChimpHttpStream *stream = CHIMP_HTTP_STREAM(self);
+    ChimpHttpConnection *conn = stream->conn;
+
+    /* HTTP/1.0 has no chunked encoding: the end of the body is the end
+     * of the connection.
+     */
+    stream->chunked = conn->http_minor > 0;
+    if (!stream->chunked) {
+        conn->keep_alive = CHIMP_FALSE;
+    }
+    if (!chimp_http_connection_write_head (conn, status, headers,
+            stream->chunked ? "Transfer-Encoding: chunked\r\n" : NULL)) {
+        return CHIMP_FALSE;
+    }
+    stream->state = CHIMP_HTTP_STREAM_STARTED;
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_http_stream_start (ChimpRef *self, ChimpRef *args)
+{
+    int64_t status;
+    ChimpRef *headers = NULL;
+
+    if (!chimp_method_parse_args (args, "I|o", &status, &headers)) {
+        return NULL;
+    }
+    if (CHIMP_HTTP_STREAM(self)->state != CHIMP_HTTP_STREAM_IDLE) {
+        return chimp_error_new (CHIMP_STR_NEW("http: response already started"));
+    }
+    if (!chimp_http_stream_start (self, status, headers)) {
+        return NULL;
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_http_stream_write (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *chunk;
+    ChimpHttpStream *stream = CHIMP_HTTP_STREAM(self);
+
+    if (!chimp_method_parse_args (args, "o", &chunk)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(chunk) != chimp_str_class) {
+        CHIMP_BUG ("http.stream.write expects a str");
+        return NULL;
+    }
+    if (stream->state == CHIMP_HTTP_STREAM_CLOSED) {
+        return chimp_error_new (CHIMP_STR_NEW("http: stream closed"));
+    }
+    if (stream->state == CHIMP_HTTP_STREAM_IDLE) {
+        if (!chimp_http_stream_start (self, 200, NULL)) {
+            return NULL;
+        }
+    }
+    /* an empty chunk would end the body */
+    if (CHIMP_STR_SIZE(chunk) == 0) {
+        return self;
+    }
+    if (stream->chunked) {
+        char size[32];
+        snprintf (size, sizeof(size), "%zx\r\n", CHIMP_STR_SIZE(chunk));
+        if (!chimp_http_buffer_append_str (&stream->conn->out, size)) {
+            return NULL;
+        }
+    }
+    if (!chimp_http_buffer_append (&stream->conn->out,
+            CHIMP_STR_DATA(chunk), CHIMP_STR_SIZE(chunk))) {
+        return NULL;
+    }
+    if (stream->chunked) {
+        if (!chimp_http_buffer_append (&stream->conn->out, "\r\n", 2)) {
+            return NULL;
+        }
+    }
+    if (!chimp_http_connection_flush (stream->conn)) {
+        stream->state = CHIMP_HTTP_STREAM_CLOSED;
+        return chimp_error_new_with_format ("http: %s", strerror (errno));
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_http_init_stream_class (void)
+{
+    ChimpRef *klass = chimp_class_new (
+            CHIMP_STR_NEW("http.stream"), NULL, sizeof(ChimpHttpStream));
+    if (klass == NULL) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "start", _chimp_http_stream_start)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "write", _chimp_http_stream_write)) {
+        return NULL;
+    }
+    return klass;
+}
+
+/* serializes whatever the handler returned into conn->out */
+static chimp_bool_t
+chimp_http_server_write_result (ChimpHttpConnection *conn, ChimpRef *result)
+{
+    ChimpRef *klass = CHIMP_ANY_CLASS(result);
+    ChimpRef *headers = NULL;
+    ChimpRef *body;
+    int64_t status;
+
+    if (result == chimp_nil) {
+        return chimp_http_connection_write_response (conn, 204, NULL, "", 0);
+    }
+    else if (klass == chimp_str_class) {
+        return chimp_http_connection_write_response (
+            conn, 200, NULL, CHIMP_STR_DATA(result), CHIMP_STR_SIZE(result));
+    }
+    else if (klass == chimp_http_response_class) {
+        body = CHIMP_HTTP_RESPONSE(result)->body;
+        return chimp_http_connection_write_response (
+            conn, CHIMP_HTTP_RESPONSE(result)->status,
+            CHIMP_HTTP_RESPONSE(result)->headers,
+            body == chimp_nil ? "" : CHIMP_STR_DATA(body),
+            body == chimp_nil ? 0 : CHIMP_STR_SIZE(body));
+    }
+    else if (klass == chimp_error_class) {
+        return chimp_http_connection_write_response (
+            conn, 500, NULL, "Internal Server Error\n", 22);
+    }
+    else if (klass != chimp_array_class ||
+                CHIMP_ARRAY_SIZE(result) < 2 || CHIMP_ARRAY_SIZE(result) > 3) {
+        CHIMP_BUG ("http handlers must return a str, "
+                   "[status, body] or [status, headers, body]");
+        return CHIMP_FALSE;
+    }
+
+    if (CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(result, 0)) != chimp_int_class) {
+        CHIMP_BUG ("http response status must be an int");
+        return CHIMP_FALSE;
+    }
+    status = CHIMP_INT(CHIMP_ARRAY_ITEM(result, 0))->value;
+    if (CHIMP_ARRAY_SIZE(result) == 3) {
+        headers = CHIMP_ARRAY_ITEM(result, 1);
+    }
+    body = CHIMP_ARRAY_ITEM(result, CHIMP_ARRAY_SIZE(result) - 1);
+    if (body == chimp_nil) {
+        return chimp_http_connection_write_response (
+            conn, status, headers, "", 0);
+    }
+    body = chimp_object_str (body);
+    if (body == NULL) {
+        return CHIMP_FALSE;
+    }
+    return chimp_http_connection_write_response (
+        conn, status, headers, CHIMP_STR_DATA(body), CHIMP_STR_SIZE(body));
+}
+
+/* runs the handler for a single request. returns NULL if the handler
+ * blew up, chimp_false if the connection should be dropped.
+ */
+static ChimpRef *
+chimp_http_server_respond (
+    ChimpHttpConnection *conn, ChimpRef *handler, ChimpRef *req)
+{
+    ChimpRef *stream;
+    ChimpRef *args;
+    ChimpRef *result;
+    chimp_bool_t ok;
+
+    conn->http_minor =
+        CHIMP_INT(CHIMP_ARRAY_ITEM(CHIMP_HTTP_REQUEST(req)->http_version, 1))->value > 0;
+    conn->keep_alive = CHIMP_HTTP_REQUEST(req)->keep_alive;
+
+    stream = chimp_class_new_instance (chimp_http_stream_class, NULL);
+    if (stream == NULL) {
+        return NULL;
+    }
+    CHIMP_HTTP_STREAM(stream)->conn = conn;
+    args = chimp_array_new_var (req, stream, NULL);
+    if (args == NULL) {
+        return NULL;
+    }
+    result = chimp_object_call (handler, args);
+    if (result == NULL) {
+        return NULL;
+    }
+
+    switch (CHIMP_HTTP_STREAM(stream)->state) {
+        case CHIMP_HTTP_STREAM_IDLE:
+            ok = chimp_http_server_write_result (conn, result);
+            break;
+        case CHIMP_HTTP_STREAM_STARTED:
+            ok = !CHIMP_HTTP_STREAM(stream)->chunked ||
+                    chimp_http_buffer_append_str (&conn->out, "0\r\n\r\n");
+            break;
+        default:
+            ok = CHIMP_FALSE;
+            break;
+    }
+    /* the stream is useless once the request is done */
+    CHIMP_HTTP_STREAM(stream)->state = CHIMP_HTTP_STREAM_CLOSED;
+    CHIMP_HTTP_STREAM(stream)->conn = NULL;
+    return ok ? chimp_true : chimp_false;
+}
+
+static int64_t
+chimp_http_now (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* reads whatever's waiting on conn & answers any requests it completes.
+ * returns chimp_true to keep the connection, chimp_false to drop it, or
+ * NULL if the handler blew up.
+ */
+static ChimpRef *
+chimp_http_connection_service (
+    ChimpHttpConnection *conn, ChimpRef *parser, ChimpRef *handler)
+{
+    char buf[16384];
+    ChimpRef *pending = CHIMP_HTTP_PARSER(parser)->pending;
+    ChimpRef *events;
+    ChimpRef *result;
+    chimp_bool_t eof;
+    ssize_t n;
+
+    n = recv (conn->fd, buf, sizeof(buf), 0);
+    if (n < 0) {
+        return (errno == EINTR || errno == EAGAIN) ? chimp_true : chimp_false;
+    }
+    eof = (n == 0);
+
+    events = chimp_http_parser_feed (parser, buf, (size_t) n);
+    if (events == NULL) {
+        return NULL;
+    }
+    else if (CHIMP_ANY_CLASS(events) != chimp_array_class) {
+        conn->keep_alive = CHIMP_FALSE;
+        chimp_http_connection_write_response (
+            conn, 400, NULL, "Bad Request\n", 12);
+        chimp_http_connection_flush (conn);
+        return chimp_false;
+    }
+    if (!chimp_http_parser_collect (parser, events)) {
+        return NULL;
+    }
+
+    while (CHIMP_ARRAY_SIZE(pending) > 0) {
+        ChimpRef *req = chimp_array_shift (pending);
+        result = chimp_http_server_respond (conn, handler, req);
+        if (result == NULL) {
+            return NULL;
+        }
+        if (result == chimp_false) {
+            chimp_http_connection_flush (conn);
+            return chimp_false;
+        }
+        if (!conn->keep_alive) {
+            break;
+        }
+    }
+    if (!chimp_http_connection_flush (conn)) {
+        return chimp_false;
+    }
+    return (conn->keep_alive && !eof) ? chimp_true : chimp_false;
+}
+
+static chimp_bool_t
+chimp_http_worker_add (ChimpHttpWorker *w, int fd, int64_t now)
+{
+    int one = 1;
+    struct epoll_event ev;
+    ChimpRef *parser;
+    ChimpHttpConnection *conn;
+
+    if (w->nconns == w->capacity) {
+        size_t capacity = w->capacity > 0 ? w->capacity * 2 : 16;
+        ChimpHttpConnection **conns = CHIMP_REALLOC(
+            ChimpHttpConnection *, w->conns, sizeof(*conns) * capacity);
+        if (conns == NULL) {
+            return CHIMP_FALSE;
+        }
+        w->conns = conns;
+        w->capacity = capacity;
+    }
+
+    parser = chimp_class_new_instance (chimp_http_parser_class, NULL);
+    if (parser == NULL) {
+        return CHIMP_FALSE;
+    }
+    conn = CHIMP_MALLOC(ChimpHttpConnection, sizeof(*conn));
+    if (conn == NULL) {
+        return CHIMP_FALSE;
+    }
+    memset (conn, 0, sizeof(*conn));
+    conn->fd = fd;
+    conn->http_minor = 1;
+    conn->keep_alive = CHIMP_TRUE;
+    conn->slot = w->nconns;
+    conn->deadline = now + w->timeout;
+
+    if (!chimp_array_push (w->parsers, parser)) {
+        CHIMP_FREE (conn);
+        return CHIMP_FALSE;
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = conn;
+    if (epoll_ctl (w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        chimp_array_pop (w->parsers);
+        CHIMP_FREE (conn);
+        return CHIMP_FALSE;
+    }
+    setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    w->conns[w->nconns++] = conn;
+    return CHIMP_TRUE;
+}
+
+static void
+chimp_http_worker_drop (ChimpHttpWorker *w, ChimpHttpConnection *conn)
+{
+    size_t last = w->nconns - 1;
+
+    /* closing the socket takes it out of the epoll set too */
+    close (conn->fd);
+    chimp_http_buffer_free (&conn->out);
+
+    w->conns[conn->slot] = w->conns[last];
+    w->conns[conn->slot]->slot = conn->slot;
+    CHIMP_ARRAY(w->parsers)->items[conn->slot] =
+        CHIMP_ARRAY_ITEM(w->parsers, last);
+    chimp_array_pop (w->parsers);
+    w->nconns--;
+    CHIMP_FREE (conn);
+}
+
+/* accepts everything that's waiting. stops listening for good once the
+ * server has been closed.
+ */
+static void
+chimp_http_worker_accept (ChimpHttpWorker *w, int64_t now)
+{
+    for (;;) {
+        int client = accept (w->listen_fd, NULL, NULL);
+        if (client < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno == EINVAL || errno == EBADF || errno == ENOTSOCK) {
+                epoll_ctl (w->epfd, EPOLL_CTL_DEL, w->listen_fd, NULL);
+                w->listen_fd = -1;
+            }
+            /* EAGAIN: another worker got there first */
+            return;
+        }
+        if (!chimp_http_worker_add (w, client, now)) {
+            close (client);
+        }
+    }
+}
+
+/* how long epoll_wait may sleep before an idle connection is due */
+static int
+chimp_http_worker_wait_time (ChimpHttpWorker *w, int64_t now)
+{
+    size_t i;
+    int64_t wait = -1;
+
+    if (w->timeout < 0) {
+        return -1;
+    }
+    for (i = 0; i < w->nconns; i++) {
+        int64_t left = w->conns[i]->deadline - now;
+        if (left < 0) {
+            left = 0;
+        }
+        if (wait < 0 || left < wait) {
+            wait = left;
+        }
+    }
+    return wait > INT_MAX ? INT_MAX : (int) wait;
+}
+
+static void
+chimp_http_worker_expire (ChimpHttpWorker *w, int64_t now)
+{
+    size_t i = 0;
+
+    if (w->timeout < 0) {
+        return;
+    }
+    while (i < w->nconns) {
+        if (w->conns[i]->deadline <= now) {
+            /* the last connection moves into slot i */
+            chimp_http_worker_drop (w, w->conns[i]);
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+static ChimpRef *
+_chimp_http_server_worker_func (ChimpRef *self, ChimpRef *args)
+{
+    int64_t fd;
+    ChimpHttpWorker w;
+    struct epoll_event ev;
+    ChimpRef *result = chimp_nil;
+
+    memset (&w, 0, sizeof(w));
+    if (!chimp_method_parse_args (
+            args, "IoI", &fd, &w.handler, &w.timeout)) {
+        return NULL;
+    }
+    w.listen_fd = (int) fd;
+    w.parsers = chimp_array_new ();
+    if (w.parsers == NULL) {
+        return NULL;
+    }
+    w.epfd = epoll_create1 (EPOLL_CLOEXEC);
+    if (w.epfd < 0) {
+        return chimp_error_new_with_format (
+            "http.server: epoll_create1: %s", strerror (errno));
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl (w.epfd, EPOLL_CTL_ADD, w.listen_fd, &ev) != 0) {
+        result = chimp_error_new_with_format (
+            "http.server: epoll_ctl: %s", strerror (errno));
+        close (w.epfd);
+        return result;
+    }
+
+    /* once the server is closed, finish up with the connections we have */
+    while (w.listen_fd >= 0 || w.nconns > 0) {
+        struct epoll_event events[CHIMP_HTTP_SERVER_MAX_EVENTS];
+        int64_t now = chimp_http_now ();
+        int i;
+        int n = epoll_wait (w.epfd, events, CHIMP_HTTP_SERVER_MAX_EVENTS,
+                    chimp_http_worker_wait_time (&w, now));
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            result = chimp_error_new_with_format (
+                "http.server: epoll_wait: %s", strerror (errno));
+            break;
+        }
+
+        now = chimp_http_now ();
+        for (i = 0; i < n; i++) {
+            ChimpHttpConnection *conn = events[i].data.ptr;
+            ChimpRef *status;
+
+            if (conn == NULL) {
+                chimp_http_worker_accept (&w, now);
+                continue;
+            }
+            /* a handler that blows up only costs its own connection */
+            status = chimp_http_connection_service (
+                conn, CHIMP_ARRAY_ITEM(w.parsers, conn->slot), w.handler);
+            if (status == chimp_true) {
+                conn->deadline = now + w.timeout;
+            }
+            else {
+                chimp_http_worker_drop (&w, conn);
+            }
+        }
+        chimp_http_worker_expire (&w, now);
+    }
+
+    while (w.nconns > 0) {
+        chimp_http_worker_drop (&w, w.conns[0]);
+    }
+    CHIMP_FREE (w.conns);
+    close (w.epfd);
+    return result;
+}
+
+static ChimpRef *
+chimp_http_server_get_option (ChimpRef *options, const char *name)
+{
+    ChimpRef *value;
+    ChimpRef *key = chimp_str_new (name, strlen (name));
+    if (key == NULL) {
+        return NULL;
+    }
+    if (chimp_hash_get (options, key, &value) != 0) {
+        return NULL;
+    }
+    return value;
+}
+
+/* sets *value from the named option, if there is one */
+static chimp_bool_t
+chimp_http_server_int_option (
+    ChimpRef *options, const char *name, int64_t *value)
+{
+    ChimpRef *ref = chimp_http_server_get_option (options, name);
+    if (ref == NULL) {
+        return CHIMP_TRUE;
+    }
+    if (CHIMP_ANY_CLASS(ref) != chimp_int_class) {
+        return CHIMP_FALSE;
+    }
+    *value = CHIMP_INT(ref)->value;
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_http_server_init (ChimpRef *self, ChimpRef *args)
+{
+    int one = 1;
+    int64_t port;
+    int64_t backlog = SOMAXCONN;
+    ChimpRef *handler;
+    ChimpRef *options = NULL;
+    struct sockaddr_in addr;
+    ChimpHttpServer *server = CHIMP_HTTP_SERVER(self);
+
+    server->fd = -1;
+    if (!chimp_method_parse_args (args, "Io|o", &port, &handler, &options)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(handler) != chimp_method_class) {
+        CHIMP_BUG ("http.server handler must be a method");
+        return NULL;
+    }
+    server->handler = handler;
+    server->nworkers = sysconf (_SC_NPROCESSORS_ONLN);
+    server->keepalive_timeout = CHIMP_HTTP_DEFAULT_KEEPALIVE_TIMEOUT;
+
+    if (options != NULL) {
+        if (CHIMP_ANY_CLASS(options) != chimp_hash_class) {
+            return chimp_error_new (
+                CHIMP_STR_NEW("http.server: options must be a hash"));
+        }
+        if (!chimp_http_server_int_option (
+                options, "workers", &server->nworkers)) {
+            return chimp_error_new (
+                CHIMP_STR_NEW("http.server: option 'workers' must be an int"));
+        }
+        if (!chimp_http_server_int_option (options, "backlog", &backlog)) {
+            return chimp_error_new (
+                CHIMP_STR_NEW("http.server: option 'backlog' must be an int"));
+        }
+        if (!chimp_http_server_int_option (
+                options, "keepalive_timeout", &server->keepalive_timeout)) {
+            return chimp_error_new (CHIMP_STR_NEW(
+                "http.server: option 'keepalive_timeout' must be an int"));
+        }
+    }
+    if (server->nworkers <= 0) {
+        server->nworkers = 1;
+    }
+    if (backlog < 0 || backlog > INT_MAX) {
+        return chimp_error_new (
+            CHIMP_STR_NEW("http.server: option 'backlog' is out of range"));
+    }
+
+    server->fd = socket (AF_INET, SOCK_STREAM, 0);
+    if (server->fd < 0) {
+        CHIMP_BUG ("http.server: socket: %s", strerror (errno));
+        return NULL;
+    }
+    setsockopt (server->fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    memset (&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((uint16_t) port);
+    addr.sin_addr.s_addr = INADDR_ANY;
+    if (bind (server->fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        return chimp_error_new_with_format (
+            "http.server: bind: %s", strerror (errno));
+    }
+    if (listen (server->fd, (int) backlog) < 0) {
+        return chimp_error_new_with_format (
+            "http.server: listen: %s", strerror (errno));
+    }
+    return self;
+}
+
+static void
+_chimp_http_server_dtor (ChimpRef *self)
+{
+    if (CHIMP_HTTP_SERVER(self)->fd >= 0) {
+        close (CHIMP_HTTP_SERVER(self)->fd);
+        CHIMP_HTTP_SERVER(self)->fd = -1;
+    }
+}
+
+static void
+_chimp_http_server_mark (ChimpGC *gc, ChimpRef *self)
+{
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_SERVER(self)->handler);
+    chimp_gc_mark_ref (gc, CHIMP_HTTP_SERVER(self)->workers);
+}
+
+/* start() spins up the worker tasks & returns immediately */
+static ChimpRef *
+_chimp_http_server_start (ChimpRef *self, ChimpRef *args)
+{
+    int64_t i;
+    ChimpHttpServer *server = CHIMP_HTTP_SERVER(self);
+
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+    if (server->workers != NULL) {
+        return self;
+    }
+    if (server->fd < 0) {
+        return chimp_error_new (CHIMP_STR_NEW("http.server: closed"));
+    }
+
+    /* the workers wait on the listening socket with epoll: accept must
+     * not block when another worker beats us to a connection */
+    if (fcntl (server->fd, F_SETFL,
+            fcntl (server->fd, F_GETFL, 0) | O_NONBLOCK) != 0) {
+        return chimp_error_new_with_format (
+            "http.server: fcntl: %s", strerror (errno));
+    }
+
+    server->workers = chimp_array_new_with_capacity ((size_t) server->nworkers);
+    if (server->workers == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < server->nworkers; i++) {
+        ChimpRef *worker = chimp_task_new (chimp_http_server_worker);
+        if (worker == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (server->workers, worker)) {
+            return NULL;
+        }
+        if (!chimp_task_send (worker, chimp_array_new_var (
+                chimp_int_new (server->fd),
+                server->handler,
+                chimp_int_new (server->keepalive_timeout),
+                NULL))) {
+            return NULL;
+        }
+    }
+    return self;
+}
+
+/* serve() starts the workers & waits for them to exit */
+static ChimpRef *
+_chimp_http_server_serve (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    size_t n;
+    ChimpRef *started;
+    ChimpRef *workers;
+    ChimpTaskInternal **tasks;
+
+    started = _chimp_http_server_start (self, args);
+    if (started != self) {
+        return started;
+    }
+
+    workers = CHIMP_HTTP_SERVER(self)->workers;
+    n = CHIMP_ARRAY_SIZE(workers);
+    tasks = CHIMP_MALLOC(ChimpTaskInternal *, sizeof(*tasks) * n);
+    if (tasks == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        tasks[i] = CHIMP_TASK(CHIMP_ARRAY_ITEM(workers, i))->priv;
+    }
+    chimp_task_wait_all (tasks, n, -1);
+    CHIMP_FREE (tasks);
+    return chimp_nil;
+}
+
+/* close() stops accepting: idle workers exit, busy ones finish up first */
+static ChimpRef *
+_chimp_http_server_close (ChimpRef *self, ChimpRef *args)
+{
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+    if (CHIMP_HTTP_SERVER(self)->fd >= 0) {
+        /* wakes up any workers blocked in accept */
+        shutdown (CHIMP_HTTP_SERVER(self)->fd, SHUT_RDWR);
+        if (CHIMP_HTTP_SERVER(self)->workers == NULL) {
+            close (CHIMP_HTTP_SERVER(self)->fd);
+            CHIMP_HTTP_SERVER(self)->fd = -1;
+        }
+    }
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_http_server_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp (CHIMP_STR_DATA(attr), "workers") == 0) {
+        ChimpRef *workers = CHIMP_HTTP_SERVER(self)->workers;
+        return workers == NULL ? chimp_array_new () : workers;
+    }
+    else if (strcmp (CHIMP_STR_DATA(attr), "fd") == 0) {
+        return chimp_int_new (CHIMP_HTTP_SERVER(self)->fd);
+    }
+    else if (strcmp (CHIMP_STR_DATA(attr), "port") == 0) {
+        /* the port actually bound, which is handy after binding port 0 */
+        struct sockaddr_in addr;
+        socklen_t addrlen = sizeof(addr);
+        if (getsockname (CHIMP_HTTP_SERVER(self)->fd,
+                    (struct sockaddr *)&addr, &addrlen) != 0) {
+            return chimp_error_new_with_format (
+                "http.server: getsockname: %s", strerror (errno));
+        }
+        return chimp_int_new (ntohs (addr.sin_port));
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static ChimpRef *
+_chimp_http_init_server_class (void)
+{
+    ChimpRef *klass = chimp_class_new (
+            CHIMP_STR_NEW("http.server"), NULL, sizeof(ChimpHttpServer));
+    if (klass == NULL) {
+        return NULL;
+    }
+    CHIMP_CLASS(klass)->init = _chimp_http_server_init;
+    CHIMP_CLASS(klass)->dtor = _chimp_http_server_dtor;
+    CHIMP_CLASS(klass)->mark = _chimp_http_server_mark;
+    CHIMP_CLASS(klass)->getattr = _chimp_http_server_getattr;
+    if (!chimp_class_add_native_method (
+            klass, "start", _chimp_http_server_start)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "serve", _chimp_http_server_serve)) {
+        return NULL;
+    }
+    if (!chimp_class_add_native_method (
+            klass, "close", _chimp_http_server_close)) {
+        return NULL;
+    }
+    return klass;
+}
+
+ChimpRef *
+chimp_init_http_module (void)
+{
+    ChimpRef *http;
+    ChimpRef *http_parser_class;
+    ChimpRef *http_request_class;
+
+    http = chimp_module_new_str ("http", NULL);
+    if (http == NULL) {
+        return NULL;
+    }
+
+    http_parser_class = _chimp_init_http_parser_class ();
+    if (!chimp_module_add_local_str (http, "parser", http_parser_class)) {
+        return NULL;
+    }
+    chimp_http_parser_class = http_parser_class;
+
+    http_request_class = _chimp_init_http_request_class ();
+    if (!chimp_module_add_local_str (http, "request", http_request_class)) {
+        return NULL;
+    }
+    chimp_http_request_class = http_request_class;
+
+    chimp_http_response_class = _chimp_http_init_response_class ();
+    if (!chimp_module_add_local_str (http, "response", chimp_http_response_class)) {
+        return NULL;
+    }
+
+    chimp_http_stream_class = _chimp_http_init_stream_class ();
+    if (!chimp_module_add_local_str (http, "stream", chimp_http_stream_class)) {
+        return NULL;
+    }
+
+    chimp_http_server_class = _chimp_http_init_server_class ();
+    if (!chimp_module_add_local_str (http, "server", chimp_http_server_class)) {
+        return NULL;
+    }
+
+    chimp_http_server_worker =
+        chimp_method_new_native (NULL, _chimp_http_server_worker_func);
+    if (chimp_http_server_worker == NULL) {
+        return NULL;
+    }
+    chimp_gc_make_root (NULL, chimp_http_server_worker);
 
     return http;
 }
@@ -16,59 +16,289 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
 
 #include "chimp/any.h"
 #include "chimp/object.h"
 #include "chimp/array.h"
 #include "chimp/str.h"
+#include "chimp/error.h"
+#include "chimp/task.h"
+#include "chimp/modules.h"
 
 typedef struct _ChimpIoFile {
     ChimpAny base;
     FILE *stream;
+    /* line reads go through a big buffer of our own. other reads drain
+     * it before going back to the stream.
+     */
+    char *rbuf;
+    size_t rpos;
+    size_t rlen;
 } ChimpIoFile;
 
+typedef struct _ChimpIoLines {
+    ChimpAny base;
+    ChimpRef *file;
+} ChimpIoLines;
+
+#define CHIMP_IO_READ_BUFFER_SIZE (1024 * 1024)
+
+#define CHIMP_IO_DEFAULT_READ_INTO_SIZE 65536
+
 static ChimpRef *chimp_io_file_class = NULL;
+static ChimpRef *chimp_io_lines_class = NULL;
+
+#define CHIMP_IO_LINES(ref) \
+    CHIMP_CHECK_CAST(ChimpIoLines, (ref), chimp_io_lines_class)
 
 #define CHIMP_IO_FILE(ref) \
     CHIMP_CHECK_CAST(ChimpIoFile, (ref), chimp_io_file_class)
 
+/* io.print & io.write collect output in a per-task (i.e. per-thread)
+ * buffer & only hand whole lines to stdio, so lines from concurrent tasks
+ * never interleave. on a terminal every finished line goes out straight
+ * away; otherwise lines pile up until the buffer passes
+ * CHIMP_IO_OUTPUT_FLUSH_SIZE, the task exits or it calls io.flush, so a
+ * busy task takes the stdout lock once per batch rather than once per
+ * print. lines from different tasks come out in the order their batches
+ * were flushed. every buffer is on a global list so that lines left
+ * behind by tasks that are still running get flushed at exit.
+ */
+typedef struct _ChimpIoOutput {
+    pthread_mutex_t lock;
+    char   *data;
+    size_t  size;
+    size_t  capacity;
+    struct _ChimpIoOutput *next;
+} ChimpIoOutput;
+
+#define CHIMP_IO_OUTPUT_FLUSH_SIZE 8192
+
+static pthread_key_t chimp_io_output_key;
+static pthread_once_t chimp_io_output_once = PTHREAD_ONCE_INIT;
+static chimp_bool_t chimp_io_output_tty = CHIMP_FALSE;
+static pthread_mutex_t chimp_io_outputs_lock = PTHREAD_MUTEX_INITIALIZER;
+static ChimpIoOutput *chimp_io_outputs = NULL;
+
+/* NOTE: assumes out->lock is held */
+static void
+chimp_io_output_write (ChimpIoOutput *out, size_t size)
+{
+    if (size == 0) {
+        return;
+    }
+    fwrite (out->data, 1, size, stdout);
+    if (chimp_io_output_tty) {
+        fflush (stdout);
+    }
+    memmove (out->data, out->data + size, out->size - size);
+    out->size -= size;
+}
+
+static void
+chimp_io_output_dtor (void *arg)
+{
+    ChimpIoOutput *out = (ChimpIoOutput *) arg;
+    ChimpIoOutput **link;
+
+    pthread_mutex_lock (&chimp_io_outputs_lock);
+    for (link = &chimp_io_outputs; *link != NULL; link = &(*link)->next) {
+        if (*link == out) {
+            *link = out->next;
+            break;
+        }
+    }
+    pthread_mutex_unlock (&chimp_io_outputs_lock);
+
+    pthread_mutex_lock (&out->lock);
+    chimp_io_output_write (out, out->size);
+    pthread_mutex_unlock (&out->lock);
+    pthread_mutex_destroy (&out->lock);
+    free (out->data);
+    free (out);
+}
+
+static void
+chimp_io_output_atexit (void)
+{
+    ChimpIoOutput *out;
+
+    pthread_mutex_lock (&chimp_io_outputs_lock);
+    for (out = chimp_io_outputs; out != NULL; out = out->next) {
+        pthread_mutex_lock (&out->lock);
+        chimp_io_output_write (out, out->size);
+        pthread_mutex_unlock (&out->lock);
+    }
+    pthread_mutex_unlock (&chimp_io_outputs_lock);
+    fflush (stdout);
+}
+
+static void
+chimp_io_output_init_once (void)
+{
+    pthread_key_create (&chimp_io_output_key, chimp_io_output_dtor);
+    chimp_io_output_tty = isatty (STDOUT_FILENO) ? CHIMP_TRUE : CHIMP_FALSE;
+    /* the main thread exits without running key destructors, and other
+     * tasks may not have exited at all
+     */
+    atexit (chimp_io_output_atexit);
+}
+
+static ChimpIoOutput *
+chimp_io_output_get (void)
+{
+    ChimpIoOutput *out;
+
+    pthread_once (&chimp_io_output_once, chimp_io_output_init_once);
+    out = pthread_getspecific (chimp_io_output_key);
+    if (out == NULL) {
+        out = calloc (1, sizeof(*out));
+        if (out == NULL) {
+            return NULL;
+        }
+        out->capacity = CHIMP_IO_OUTPUT_FLUSH_SIZE * 2;
+        out->data = malloc (out->capacity);
+        if (out->data == NULL) {
+            free (out);
+            return NULL;
+        }
+        pthread_mutex_init (&out->lock, NULL);
+        pthread_setspecific (chimp_io_output_key, out);
+
+        pthread_mutex_lock (&chimp_io_outputs_lock);
+        out->next = chimp_io_outputs;
+        chimp_io_outputs = out;
+        pthread_mutex_unlock (&chimp_io_outputs_lock);
+    }
+    return out;
+}
+
+void
+chimp_io_output (const char *data, size_t size)
+{
+    ChimpIoOutput *out = chimp_io_output_get ();
+    size_t end;
+
+    if (out == NULL) {
+        fwrite (data, 1, size, stdout);
+        return;
+    }
+
+    pthread_mutex_lock (&out->lock);
+    if (out->size + size > out->capacity) {
+        /* too big to buffer: write it out along with what we have */
+        flockfile (stdout);
+        chimp_io_output_write (out, out->size);
+        fwrite (data, 1, size, stdout);
+        funlockfile (stdout);
+        if (chimp_io_output_tty) {
+            fflush (stdout);
+        }
+        pthread_mutex_unlock (&out->lock);
+        return;
+    }
+
+    memcpy (out->data + out->size, data, size);
+    out->size += size;
+
+    if (out->size < CHIMP_IO_OUTPUT_FLUSH_SIZE &&
+            !(chimp_io_output_tty && memchr (data, '\n', size) != NULL)) {
+        pthread_mutex_unlock (&out->lock);
+        return;
+    }
+
+    /* keep any partial line back until it's finished */
+    end = out->size;
+    while (end > 0 && out->data[end-1] != '\n') {
+        end--;
+    }
+    if (end == 0 && out->size >= CHIMP_IO_OUTPUT_FLUSH_SIZE) {
+        /* one enormous line: no point holding on to it */
+        end = out->size;
+    }
+    chimp_io_output_write (out, end);
+    pthread_mutex_unlock (&out->lock);
+}
+
+void
+chimp_io_flush_output (void)
+{
+    ChimpIoOutput *out;
+
+    pthread_once (&chimp_io_output_once, chimp_io_output_init_once);
+    out = pthread_getspecific (chimp_io_output_key);
+    if (out != NULL) {
+        pthread_mutex_lock (&out->lock);
+        chimp_io_output_write (out, out->size);
+        pthread_mutex_unlock (&out->lock);
+    }
+    fflush (stdout);
+}
+
 static ChimpRef *
-_chimp_io_output (ChimpRef *self, ChimpRef *args, char* separator)
+_chimp_io_output (size_t argc, ChimpRef **argv, const char *separator)
 {
     size_t i;
+    size_t seplen = strlen (separator);
 
-    for (i = 0; i < CHIMP_ARRAY_SIZE(args); i++) {
-        ChimpRef *str = chimp_object_str (CHIMP_ARRAY_ITEM (args, i));
-        printf ("%s%s", CHIMP_STR_DATA(str), separator);
+    for (i = 0; i < argc; i++) {
+        ChimpRef *str = chimp_object_str (argv[i]);
+        if (str == NULL) {
+            return NULL;
+        }
+        chimp_io_output (CHIMP_STR_DATA(str), CHIMP_STR_SIZE(str));
+        if (seplen > 0) {
+            chimp_io_output (separator, seplen);
+        }
     }
 
     return chimp_nil;
 }
 
 static ChimpRef *
-_chimp_io_print (ChimpRef *self, ChimpRef *args)
+_chimp_io_print (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    return _chimp_io_output(self, args, "\n");
+    return _chimp_io_output(argc, argv, "\n");
 }
 
 
 static ChimpRef *
-_chimp_io_write (ChimpRef *self, ChimpRef *args)
+_chimp_io_write (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    return _chimp_io_output(self, args, "");
+    return _chimp_io_output(argc, argv, "");
 }
 
+static ChimpRef *
+_chimp_io_flush (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    chimp_io_flush_output ();
+    return chimp_nil;
+}
 
 static ChimpRef *
-_chimp_io_readline (ChimpRef *self, ChimpRef *args)
+_chimp_io_readline (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     char buf[1024];
     size_t len;
 
+    /* make sure any prompt is visible first */
+    chimp_io_flush_output ();
+
     if (fgets (buf, sizeof(buf), stdin) == NULL) {
         return chimp_nil;
     }
@@ -80,6 +310,94 @@ _chimp_io_readline (ChimpRef *self, ChimpRef *args)
     return chimp_str_new (buf, len);
 }
 
+/* io.mmap(path[, advice]) maps a file read-only & returns its contents as
+ * a str without reading it into memory. advice is one of "sequential"
+ * (the default), "random", "willneed" or "normal". the mapping goes away
+ * when the str is collected. truncating the file while it's mapped is
+ * fatal, as it is in C.
+ */
+static ChimpRef *
+_chimp_io_mmap (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    const char *path;
+    const char *advice = "sequential";
+    int advice_flag;
+    struct stat st;
+    size_t size;
+    size_t page;
+    size_t mapped;
+    char *data;
+    int fd;
+
+    path = CHIMP_STR_DATA(argv[0]);
+    if (argc > 1) {
+        advice = CHIMP_STR_DATA(argv[1]);
+    }
+    if (strcmp (advice, "sequential") == 0) {
+        advice_flag = MADV_SEQUENTIAL;
+    }
+    else if (strcmp (advice, "random") == 0) {
+        advice_flag = MADV_RANDOM;
+    }
+    else if (strcmp (advice, "willneed") == 0) {
+        advice_flag = MADV_WILLNEED;
+    }
+    else if (strcmp (advice, "normal") == 0) {
+        advice_flag = MADV_NORMAL;
+    }
+    else {
+        CHIMP_BUG ("unknown mmap advice: %s", advice);
+        return NULL;
+    }
+
+    fd = open (path, O_RDONLY);
+    if (fd < 0) {
+        return chimp_error_new_with_format (
+            "mmap: %s: %s", path, strerror (errno));
+    }
+    if (fstat (fd, &st) != 0) {
+        close (fd);
+        return chimp_error_new_with_format (
+            "mmap: %s: %s", path, strerror (errno));
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close (fd);
+        return chimp_error_new_with_format (
+            "mmap: %s: not a regular file", path);
+    }
+    size = (size_t) st.st_size;
+    if (size == 0) {
+        close (fd);
+        return CHIMP_STR_NEW("");
+    }
+
+    /* strs are NUL-terminated, so reserve at least one byte past the end
+     * of the file. the tail of the last page of a mapping is zero-filled,
+     * but if the file ends on a page boundary the NUL lands on the spare
+     * anonymous page instead.
+     */
+    page = (size_t) sysconf (_SC_PAGESIZE);
+    mapped = (size / page + 1) * page;
+    data = mmap (NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+        close (fd);
+        return chimp_error_new_with_format (
+            "mmap: %s: %s", path, strerror (errno));
+    }
+    if (mmap (data, size, PROT_READ,
+            MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        int err = errno;
+        munmap (data, mapped);
+        close (fd);
+        return chimp_error_new_with_format (
+            "mmap: %s: %s", path, strerror (err));
+    }
+    close (fd);
+    madvise (data, size, advice_flag);
+
+    return chimp_str_new_mapped (data, size, mapped);
+}
+
 static void
 _chimp_io_file_close_internal (ChimpRef *self)
 {
@@ -87,6 +405,9 @@ _chimp_io_file_close_internal (ChimpRef *self)
         fclose (CHIMP_IO_FILE(self)->stream);
         CHIMP_IO_FILE(self)->stream = NULL;
     }
+    free (CHIMP_IO_FILE(self)->rbuf);
+    CHIMP_IO_FILE(self)->rbuf = NULL;
+    CHIMP_IO_FILE(self)->rpos = CHIMP_IO_FILE(self)->rlen = 0;
 }
 
 static ChimpRef *
@@ -115,23 +436,210 @@ _chimp_io_file_dtor (ChimpRef *self)
 }
 
 static ChimpRef *
-_chimp_io_file_close (ChimpRef *self, ChimpRef *args)
+_chimp_io_file_close (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     _chimp_io_file_close_internal (self);
     return chimp_nil;
 }
 
+/* copies up to size bytes out of the read buffer, then reads the rest
+ * straight from the stream.
+ */
+static size_t
+chimp_io_file_read_buffered (ChimpRef *self, char *buf, size_t size)
+{
+    ChimpIoFile *file = CHIMP_IO_FILE(self);
+    size_t n = file->rlen - file->rpos;
+
+    if (n > size) {
+        n = size;
+    }
+    if (n > 0) {
+        memcpy (buf, file->rbuf + file->rpos, n);
+        file->rpos += n;
+    }
+    if (n < size) {
+        n += fread (buf + n, 1, size - n, file->stream);
+    }
+    return n;
+}
+
+static chimp_bool_t
+chimp_io_file_fill (ChimpRef *self)
+{
+    ChimpIoFile *file = CHIMP_IO_FILE(self);
+
+    if (file->rbuf == NULL) {
+        file->rbuf = malloc (CHIMP_IO_READ_BUFFER_SIZE);
+        if (file->rbuf == NULL) {
+            CHIMP_BUG ("out of memory");
+            return CHIMP_FALSE;
+        }
+    }
+    file->rpos = 0;
+    file->rlen = fread (file->rbuf, 1, CHIMP_IO_READ_BUFFER_SIZE, file->stream);
+    return file->rlen > 0;
+}
+
+/* the next line without its line ending, or nil at end of file */
+static ChimpRef *
+chimp_io_file_read_line (ChimpRef *self)
+{
+    ChimpIoFile *file = CHIMP_IO_FILE(self);
+    ChimpRef *line = NULL;
+
+    if (file->stream == NULL) {
+        CHIMP_BUG ("attempt to read from closed stream");
+        return NULL;
+    }
+
+    for (;;) {
+        char *start;
+        char *nl;
+        size_t len;
+        ChimpRef *piece;
+
+        if (file->rpos == file->rlen && !chimp_io_file_fill (self)) {
+            if (file->rbuf == NULL) {
+                return NULL;
+            }
+            return line != NULL ? line : chimp_nil;
+        }
+
+        start = file->rbuf + file->rpos;
+        nl = memchr (start, '\n', file->rlen - file->rpos);
+        len = (nl != NULL ? (size_t)(nl - start) : file->rlen - file->rpos);
+        file->rpos += len + (nl != NULL ? 1 : 0);
+
+        if (line == NULL) {
+            if (nl != NULL && len > 0 && start[len-1] == '\r') {
+                len--;
+            }
+            line = chimp_str_new (start, len);
+            if (line == NULL || nl != NULL) {
+                return line;
+            }
+        }
+        else {
+            /* a line that straddles buffer refills */
+            piece = chimp_str_new (start, len);
+            if (piece == NULL || !chimp_str_append (line, piece)) {
+                return NULL;
+            }
+            if (nl != NULL) {
+                if (CHIMP_STR_SIZE(line) > 0 &&
+                        CHIMP_STR_DATA(line)[CHIMP_STR_SIZE(line)-1] == '\r') {
+                    CHIMP_STR(line)->size--;
+                    CHIMP_STR_DATA(line)[CHIMP_STR_SIZE(line)] = '\0';
+                }
+                return line;
+            }
+        }
+    }
+}
+
+static ChimpRef *
+_chimp_io_file_read_line (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_io_file_read_line (self);
+}
+
+static ChimpRef *
+chimp_io_file_each_line (ChimpRef *self, ChimpRef *fn)
+{
+    for (;;) {
+        ChimpRef *fn_args;
+        ChimpRef *line = chimp_io_file_read_line (self);
+        if (line == NULL) {
+            return NULL;
+        }
+        if (line == chimp_nil) {
+            return chimp_nil;
+        }
+        fn_args = chimp_array_new_var (line, NULL);
+        if (fn_args == NULL) {
+            return NULL;
+        }
+        if (chimp_object_call (fn, fn_args) == NULL) {
+            return NULL;
+        }
+    }
+}
+
+/* file.each_line(fn) calls fn with each line in turn, holding only one
+ * line in memory at a time.
+ */
 static ChimpRef *
-_chimp_io_file_read (ChimpRef *self, ChimpRef *args)
+_chimp_io_file_each_line (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpRef *fn;
+    fn = argv[0];
+    return chimp_io_file_each_line (self, fn);
+}
+
+/* file.lines() returns an iterator: lines.next() gives the next line or
+ * nil, lines.each(fn) is file.each_line(fn).
+ */
+static ChimpRef *
+_chimp_io_file_lines (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_class_new_instance (chimp_io_lines_class, self, NULL);
+}
+
+/* file.read_into(buf[, n]) reads up to n bytes (by default, the size of
+ * buf, or 64KB if buf is empty) into buf, replacing its contents & reusing
+ * its memory. returns the number of bytes read: 0 at end of file. buf must
+ * come from io.buffer: any other str may be shared, so it's never
+ * overwritten.
+ */
+static ChimpRef *
+_chimp_io_file_read_into (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpRef *buf;
+    int64_t size = -1;
+    size_t n;
+    char *data;
+
+    buf = argv[0];
+    if (argc > 1) {
+        size = CHIMP_INT(argv[1])->value;
+    }
+    if (CHIMP_ANY_CLASS(buf) != chimp_str_class) {
+        CHIMP_BUG ("io.file.read_into expects a str buffer");
+        return NULL;
+    }
+    if (!CHIMP_STR(buf)->buffer) {
+        return chimp_error_new (
+            CHIMP_STR_NEW("io.file.read_into expects a buffer from io.buffer"));
+    }
+    if (CHIMP_IO_FILE(self)->stream == NULL) {
+        CHIMP_BUG ("attempt to read from closed stream");
+        return NULL;
+    }
+    if (size < 0) {
+        size = CHIMP_STR_SIZE(buf) > 0 ?
+            (int64_t) CHIMP_STR_SIZE(buf) : CHIMP_IO_DEFAULT_READ_INTO_SIZE;
+    }
+
+    data = chimp_str_reserve (buf, (size_t) size);
+    if (data == NULL) {
+        return NULL;
+    }
+    n = chimp_io_file_read_buffered (self, data, (size_t) size);
+    CHIMP_STR(buf)->size = n;
+    data[n] = '\0';
+    return chimp_int_new ((int64_t) n);
+}
+
+static ChimpRef *
+_chimp_io_file_read (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int64_t size;
     int64_t rsize;
     char *buf;
 
-    if (CHIMP_ARRAY_SIZE(args) > 0) {
-        if (!chimp_method_parse_args (args, "I", &size)) {
-            return NULL;
-        }
+    if (argc > 0) {
+        size = CHIMP_INT(argv[0])->value;
     }
     else {
         struct stat buf;
@@ -158,7 +666,7 @@ _chimp_io_file_read (ChimpRef *self, ChimpRef *args)
         return NULL;
     }
 
-    rsize = fread (buf, 1, (size_t) size, CHIMP_IO_FILE(self)->stream);
+    rsize = chimp_io_file_read_buffered (self, buf, (size_t) size);
 
     if (rsize <= 0) {
         free (buf);
@@ -179,14 +687,12 @@ _chimp_io_file_read (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_io_file_write (ChimpRef *self, ChimpRef *args)
+_chimp_io_file_write (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     ChimpRef *s;
     FILE *stream;
 
-    if (!chimp_method_parse_args (args, "o", &s)) {
-        return NULL;
-    }
+    s = argv[0];
 
     if (CHIMP_IO_FILE(self)->stream == NULL) {
         CHIMP_BUG ("attempt to write to closed stream");
@@ -203,6 +709,21 @@ _chimp_io_file_write (ChimpRef *self, ChimpRef *args)
         fwrite (CHIMP_STR_DATA(s), 1, CHIMP_STR_SIZE(s), stream));
 }
 
+static ChimpRef *
+_chimp_io_file_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp ("fd", CHIMP_STR_DATA(attr)) == 0) {
+        if (CHIMP_IO_FILE(self)->stream == NULL) {
+            return chimp_int_new (-1);
+        }
+        return chimp_int_new (fileno (CHIMP_IO_FILE(self)->stream));
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
 static ChimpRef *
 _chimp_init_io_file_class (void)
 {
@@ -213,15 +734,672 @@ _chimp_init_io_file_class (void)
     }
     CHIMP_CLASS(klass)->init = _chimp_io_file_init;
     CHIMP_CLASS(klass)->dtor = _chimp_io_file_dtor;
-    if (!chimp_class_add_native_method (klass, "read", _chimp_io_file_read))
+    CHIMP_CLASS(klass)->getattr = _chimp_io_file_getattr;
+    if (!chimp_class_add_native_argv_method (klass, "read", "|I", _chimp_io_file_read))
         return NULL;
-    if (!chimp_class_add_native_method (klass, "write", _chimp_io_file_write))
+    if (!chimp_class_add_native_argv_method (klass, "write", "o", _chimp_io_file_write))
         return NULL;
-    if (!chimp_class_add_native_method (klass, "close", _chimp_io_file_close))
+    if (!chimp_class_add_native_argv_method (klass, "close", "", _chimp_io_file_close))
+        return NULL;
+    if (!chimp_class_add_native_argv_method (klass, "read_line", "", _chimp_io_file_read_line))
+        return NULL;
+    if (!chimp_class_add_native_argv_method (klass, "each_line", "o", _chimp_io_file_each_line))
+        return NULL;
+    if (!chimp_class_add_native_argv_method (klass, "lines", "", _chimp_io_file_lines))
+        return NULL;
+    if (!chimp_class_add_native_argv_method (klass, "read_into", "o|I", _chimp_io_file_read_into))
         return NULL;
     return klass;
 }
 
+static ChimpRef *
+_chimp_io_lines_init (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *file;
+    if (!chimp_method_parse_args (args, "o", &file)) {
+        return NULL;
+    }
+    CHIMP_IO_LINES(self)->file = file;
+    return self;
+}
+
+static void
+_chimp_io_lines_mark (ChimpGC *gc, ChimpRef *self)
+{
+    chimp_gc_mark_ref (gc, CHIMP_IO_LINES(self)->file);
+}
+
+static ChimpRef *
+_chimp_io_lines_next (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_io_file_read_line (CHIMP_IO_LINES(self)->file);
+}
+
+static ChimpRef *
+_chimp_io_lines_each (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpRef *fn;
+    fn = argv[0];
+    return chimp_io_file_each_line (CHIMP_IO_LINES(self)->file, fn);
+}
+
+static ChimpRef *
+_chimp_init_io_lines_class (void)
+{
+    ChimpRef *klass =
+        chimp_class_new (CHIMP_STR_NEW("io.lines"), NULL, sizeof(ChimpIoLines));
+    if (klass == NULL) {
+        return NULL;
+    }
+    CHIMP_CLASS(klass)->init = _chimp_io_lines_init;
+    CHIMP_CLASS(klass)->mark = _chimp_io_lines_mark;
+    if (!chimp_class_add_native_argv_method (klass, "next", "", _chimp_io_lines_next))
+        return NULL;
+    if (!chimp_class_add_native_argv_method (klass, "each", "o", _chimp_io_lines_each))
+        return NULL;
+    return klass;
+}
+
+/* io.buffer(size) returns a fresh, zero-filled str to hand to read_into */
+static ChimpRef *
+_chimp_io_buffer (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    int64_t size;
+    char *data;
+    ChimpRef *buf;
+
+    size = CHIMP_INT(argv[0])->value;
+    if (size < 0) {
+        CHIMP_BUG ("io.buffer size must not be negative");
+        return NULL;
+    }
+    data = calloc ((size_t) size + 1, 1);
+    if (data == NULL) {
+        CHIMP_BUG ("out of memory");
+        return NULL;
+    }
+    buf = chimp_str_new_take (data, (size_t) size);
+    if (buf == NULL) {
+        free (data);
+        return NULL;
+    }
+    CHIMP_STR(buf)->buffer = CHIMP_TRUE;
+    return buf;
+}
+
+/*
+ * io.submit(ops[, tag]) hands a batch of file operations to a pool of I/O
+ * tasks & returns straight away. when the whole batch is done, the
+ * submitting task receives ["io", tag, results] with one result per op:
+ *
+ *   ["read", file, offset, size]    a str (size < 0 reads to the end)
+ *   ["write", file, offset, data]   bytes written (offset < 0 appends)
+ *   ["glob", pattern]               an array of paths
+ *
+ * file is a path or a descriptor (e.g. io.file(...).fd). failed ops
+ * produce an error instead of a result; if the worker can't build the
+ * results at all (out of memory), results itself is an error. tasks are
+ * threads, so blocking on file I/O only ever stalls the task doing it --
+ * but handing it off lets a task keep servicing sockets (the reply wakes
+ * net.poller) while the disk catches up.
+ *
+ * on Linux each worker pushes all the reads & writes in a batch through
+ * io_uring with a single io_uring_enter; elsewhere, or if the kernel
+ * won't give us a ring, they fall back to pread/pwrite.
+ */
+
+#define CHIMP_IO_WORKERS 4
+
+#define CHIMP_IO_RING_ENTRIES 64
+
+typedef enum _ChimpIoOpKind {
+    CHIMP_IO_OP_READ,
+    CHIMP_IO_OP_WRITE,
+    CHIMP_IO_OP_GLOB
+} ChimpIoOpKind;
+
+typedef struct _ChimpIoOp {
+    ChimpIoOpKind kind;
+    int fd;
+    chimp_bool_t owns_fd;
+    int64_t offset;
+    char *data;
+    size_t size;        /* bytes to transfer */
+    size_t done;        /* bytes transferred so far */
+    int error;          /* errno, if the op failed */
+} ChimpIoOp;
+
+#ifdef __linux__
+typedef struct _ChimpIoRing {
+    int fd;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned sq_entries;
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+} ChimpIoRing;
+#endif
+
+static pthread_mutex_t chimp_io_workers_lock = PTHREAD_MUTEX_INITIALIZER;
+static ChimpTaskInternal *chimp_io_workers[CHIMP_IO_WORKERS];
+static size_t chimp_io_next_worker = 0;
+static ChimpRef *chimp_io_worker_method = NULL;
+
+#ifdef __linux__
+static chimp_bool_t
+chimp_io_ring_init (ChimpIoRing *ring)
+{
+    struct io_uring_params params;
+    size_t sq_size;
+    size_t cq_size;
+    char *sq;
+    char *cq;
+
+    memset (&params, 0, sizeof(params));
+    ring->fd = (int) syscall (
+        __NR_io_uring_setup, CHIMP_IO_RING_ENTRIES, &params);
+    if (ring->fd < 0) {
+        return CHIMP_FALSE;
+    }
+
+    sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size = params.cq_off.cqes +
+        params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (cq_size > sq_size) {
+            sq_size = cq_size;
+        }
+        cq_size = sq_size;
+    }
+
+    sq = mmap (NULL, sq_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (sq == MAP_FAILED) {
+        close (ring->fd);
+        return CHIMP_FALSE;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq = sq;
+    }
+    else {
+        cq = mmap (NULL, cq_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (cq == MAP_FAILED) {
+            munmap (sq, sq_size);
+            close (ring->fd);
+            return CHIMP_FALSE;
+        }
+    }
+    ring->sqes = mmap (NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        if (cq != sq) {
+            munmap (cq, cq_size);
+        }
+        munmap (sq, sq_size);
+        close (ring->fd);
+        return CHIMP_FALSE;
+    }
+
+    ring->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(sq + params.sq_off.array);
+    ring->sq_entries = params.sq_entries;
+    ring->cq_head = (unsigned *)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return CHIMP_TRUE;
+}
+
+/* submits the reads & writes in ops[0..n) with one system call & waits
+ * for them all. short transfers are left for pread/pwrite to finish.
+ */
+static void
+chimp_io_ring_run (ChimpIoRing *ring, ChimpIoOp *ops, size_t n)
+{
+    size_t i;
+    unsigned tail = *ring->sq_tail;
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    unsigned pending;
+
+    for (i = 0; i < n && submitted < ring->sq_entries; i++) {
+        struct io_uring_sqe *sqe;
+        unsigned index;
+
+        if (ops[i].kind == CHIMP_IO_OP_GLOB || ops[i].error != 0 ||
+                ops[i].size == 0) {
+            continue;
+        }
+        index = tail & *ring->sq_mask;
+        sqe = &ring->sqes[index];
+        memset (sqe, 0, sizeof(*sqe));
+        sqe->opcode = ops[i].kind == CHIMP_IO_OP_READ ?
+                        IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = ops[i].fd;
+        sqe->addr = (unsigned long) ops[i].data;
+        sqe->len = (unsigned) ops[i].size;
+        sqe->off = (uint64_t) ops[i].offset;
+        sqe->user_data = i;
+        ring->sq_array[index] = index;
+        tail++;
+        submitted++;
+    }
+    if (submitted == 0) {
+        return;
+    }
+    __atomic_store_n (ring->sq_tail, tail, __ATOMIC_RELEASE);
+
+    pending = submitted;
+    while (completed < submitted) {
+        unsigned head;
+        /* don't wait on completions for sqes the kernel hasn't taken yet */
+        long rc = syscall (__NR_io_uring_enter, ring->fd, pending,
+            pending > 0 ? 0 : submitted - completed,
+            IORING_ENTER_GETEVENTS, NULL, 0);
+        if (rc < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+                continue;
+            }
+            /* the kernel may still own our buffers: no way to back out */
+            CHIMP_BUG ("io_uring_enter: %s", strerror (errno));
+            return;
+        }
+        pending -= (unsigned) rc;
+        head = *ring->cq_head;
+        while (head != __atomic_load_n (ring->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+            ChimpIoOp *op = &ops[cqe->user_data];
+            if (cqe->res >= 0) {
+                op->done = (size_t) cqe->res;
+            }
+            else if (cqe->res != -EINVAL && cqe->res != -EOPNOTSUPP) {
+                /* EINVAL: an old kernel without READ/WRITE. retry below */
+                op->error = -cqe->res;
+            }
+            head++;
+            completed++;
+        }
+        __atomic_store_n (ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+}
+#endif
+
+/* finishes ops (or the parts of them) the ring didn't get to */
+static void
+chimp_io_op_finish (ChimpIoOp *op)
+{
+    while (op->error == 0 && op->done < op->size) {
+        ssize_t n;
+        char *p = op->data + op->done;
+        size_t left = op->size - op->done;
+
+        if (op->kind == CHIMP_IO_OP_READ) {
+            n = pread (op->fd, p, left, (off_t) op->offset + op->done);
+        }
+        else if (op->offset < 0) {
+            n = write (op->fd, p, left);
+        }
+        else {
+            n = pwrite (op->fd, p, left, (off_t) op->offset + op->done);
+        }
+        if (n < 0) {
+            if (errno != EINTR) {
+                op->error = errno;
+            }
+        }
+        else if (n == 0) {
+            /* end of file */
+            break;
+        }
+        else {
+            op->done += (size_t) n;
+        }
+    }
+}
+
+/* opens the op's file & sets up its buffer. problems are left in
+ * op->error for the submitter to see.
+ */
+static void
+chimp_io_op_prepare (ChimpIoOp *op, ChimpRef *spec)
+{
+    const char *kind;
+    ChimpRef *target;
+
+    memset (op, 0, sizeof(*op));
+    op->fd = -1;
+    kind = CHIMP_STR_DATA(CHIMP_ARRAY_ITEM(spec, 0));
+    if (strcmp (kind, "glob") == 0) {
+        op->kind = CHIMP_IO_OP_GLOB;
+        return;
+    }
+    op->kind = strcmp (kind, "read") == 0 ? CHIMP_IO_OP_READ : CHIMP_IO_OP_WRITE;
+    op->offset = CHIMP_INT(CHIMP_ARRAY_ITEM(spec, 2))->value;
+
+    target = CHIMP_ARRAY_ITEM(spec, 1);
+    if (CHIMP_ANY_CLASS(target) == chimp_int_class) {
+        op->fd = (int) CHIMP_INT(target)->value;
+    }
+    else {
+        int flags = O_RDONLY;
+        if (op->kind == CHIMP_IO_OP_WRITE) {
+            flags = O_WRONLY | O_CREAT | (op->offset < 0 ? O_APPEND : 0);
+        }
+        op->fd = open (CHIMP_STR_DATA(target), flags, 0666);
+        if (op->fd < 0) {
+            op->error = errno;
+            return;
+        }
+        op->owns_fd = CHIMP_TRUE;
+    }
+
+    if (op->kind == CHIMP_IO_OP_READ) {
+        int64_t size = CHIMP_INT(CHIMP_ARRAY_ITEM(spec, 3))->value;
+        if (op->offset < 0) {
+            op->offset = 0;
+        }
+        if (size < 0) {
+            struct stat st;
+            if (fstat (op->fd, &st) != 0) {
+                op->error = errno;
+                return;
+            }
+            size = st.st_size > op->offset ? st.st_size - op->offset : 0;
+        }
+        op->size = (size_t) size;
+        op->data = malloc (op->size + 1);
+        if (op->data == NULL) {
+            op->error = ENOMEM;
+        }
+    }
+    else {
+        ChimpRef *data = CHIMP_ARRAY_ITEM(spec, 3);
+        /* the str lives in this task's heap until the batch is done */
+        op->data = CHIMP_STR_DATA(data);
+        op->size = CHIMP_STR_SIZE(data);
+    }
+}
+
+static ChimpRef *
+chimp_io_op_result (ChimpIoOp *op, ChimpRef *spec)
+{
+    ChimpRef *result;
+
+    if (op->kind == CHIMP_IO_OP_GLOB) {
+        size_t i;
+        glob_t g;
+        int rc = glob (CHIMP_STR_DATA(CHIMP_ARRAY_ITEM(spec, 1)), 0, NULL, &g);
+        result = chimp_array_new ();
+        if (result == NULL) {
+            return NULL;
+        }
+        if (rc == GLOB_NOMATCH) {
+            return result;
+        }
+        else if (rc != 0) {
+            return chimp_error_new (CHIMP_STR_NEW("glob: failed"));
+        }
+        for (i = 0; i < g.gl_pathc; i++) {
+            ChimpRef *path = chimp_str_new (g.gl_pathv[i], strlen (g.gl_pathv[i]));
+            if (path == NULL || !chimp_array_push (result, path)) {
+                globfree (&g);
+                return NULL;
+            }
+        }
+        globfree (&g);
+        return result;
+    }
+
+    if (op->error != 0) {
+        result = chimp_error_new_with_format ("%s: %s",
+            op->kind == CHIMP_IO_OP_READ ? "read" : "write",
+            strerror (op->error));
+    }
+    else if (op->kind == CHIMP_IO_OP_READ) {
+        op->data[op->done] = '\0';
+        result = chimp_str_new_take (op->data, op->done);
+        op->data = NULL;
+    }
+    else {
+        result = chimp_int_new ((int64_t) op->done);
+    }
+    return result;
+}
+
+static void
+chimp_io_op_cleanup (ChimpIoOp *op)
+{
+    if (op->owns_fd && op->fd >= 0) {
+        close (op->fd);
+    }
+    if (op->kind == CHIMP_IO_OP_READ) {
+        free (op->data);
+    }
+}
+
+static ChimpRef *
+_chimp_io_worker_func (ChimpRef *self, ChimpRef *args)
+{
+#ifdef __linux__
+    ChimpIoRing ring;
+    chimp_bool_t have_ring;
+
+    memset (&ring, 0, sizeof(ring));
+    have_ring = chimp_io_ring_init (&ring);
+#endif
+
+    for (;;) {
+        size_t i;
+        size_t n;
+        ChimpIoOp *ops;
+        ChimpRef *specs;
+        ChimpRef *results = NULL;
+        ChimpRef *reply;
+        ChimpRef *reply_to;
+        ChimpRef *msg = chimp_task_recv (NULL);
+        if (msg == NULL) {
+            return NULL;
+        }
+
+        /* [reply_to, tag, ops] */
+        specs = CHIMP_ARRAY_ITEM(msg, 2);
+        n = CHIMP_ARRAY_SIZE(specs);
+        ops = CHIMP_MALLOC(ChimpIoOp, sizeof(*ops) * (n > 0 ? n : 1));
+        if (ops == NULL) {
+            goto failed;
+        }
+        for (i = 0; i < n; i++) {
+            chimp_io_op_prepare (&ops[i], CHIMP_ARRAY_ITEM(specs, i));
+        }
+
+#ifdef __linux__
+        if (have_ring) {
+            size_t start;
+            /* the ring only holds so many at a time */
+            for (start = 0; start < n; start += ring.sq_entries) {
+                size_t count = n - start;
+                if (count > ring.sq_entries) {
+                    count = ring.sq_entries;
+                }
+                chimp_io_ring_run (&ring, ops + start, count);
+            }
+        }
+#endif
+
+        /* every op still gets finished & cleaned up, even if we can't
+         * hang on to its result.
+         */
+        results = chimp_array_new_with_capacity (n);
+        for (i = 0; i < n; i++) {
+            ChimpRef *result;
+            chimp_io_op_finish (&ops[i]);
+            result = NULL;
+            if (results != NULL) {
+                result = chimp_io_op_result (
+                    &ops[i], CHIMP_ARRAY_ITEM(specs, i));
+            }
+            chimp_io_op_cleanup (&ops[i]);
+            if (result == NULL || !chimp_array_push (results, result)) {
+                results = NULL;
+            }
+        }
+        CHIMP_FREE (ops);
+
+failed:
+        /* whatever happened, the submitter is waiting on this tag */
+        if (results == NULL) {
+            results = chimp_error_new (CHIMP_STR_NEW("io.submit: out of memory"));
+        }
+        reply = NULL;
+        if (results != NULL) {
+            reply = chimp_array_new_var (
+                CHIMP_STR_NEW("io"), CHIMP_ARRAY_ITEM(msg, 1), results, NULL);
+        }
+        /* the submitter may be long gone: not our problem */
+        reply_to = CHIMP_ARRAY_ITEM(msg, 0);
+        if (reply != NULL) {
+            chimp_task_send (reply_to, reply);
+        }
+
+        /* drop the ref io.submit took for us. reply_to itself lets go of
+         * the submitter whenever we next collect.
+         */
+        chimp_task_unref (CHIMP_TASK(reply_to)->priv);
+    }
+}
+
+static ChimpTaskInternal *
+chimp_io_get_worker (void)
+{
+    ChimpTaskInternal *worker;
+
+    pthread_mutex_lock (&chimp_io_workers_lock);
+    worker = chimp_io_workers[chimp_io_next_worker];
+    if (worker != NULL && chimp_task_wait (worker, 0)) {
+        /* a worker that died would swallow every batch sent its way */
+        chimp_task_unref (worker);
+        chimp_io_workers[chimp_io_next_worker] = NULL;
+        worker = NULL;
+    }
+    if (worker == NULL) {
+        ChimpRef *ref = chimp_task_new (chimp_io_worker_method);
+        if (ref == NULL) {
+            pthread_mutex_unlock (&chimp_io_workers_lock);
+            return NULL;
+        }
+        if (!chimp_task_send (ref, chimp_array_new ())) {
+            pthread_mutex_unlock (&chimp_io_workers_lock);
+            return NULL;
+        }
+        worker = CHIMP_TASK(ref)->priv;
+        /* the pool lives as long as the process */
+        chimp_task_ref (worker);
+        chimp_io_workers[chimp_io_next_worker] = worker;
+    }
+    chimp_io_next_worker = (chimp_io_next_worker + 1) % CHIMP_IO_WORKERS;
+    pthread_mutex_unlock (&chimp_io_workers_lock);
+    return worker;
+}
+
+static chimp_bool_t
+chimp_io_check_op (ChimpRef *op)
+{
+    const char *kind;
+    ChimpRef *target;
+
+    if (CHIMP_ANY_CLASS(op) != chimp_array_class || CHIMP_ARRAY_SIZE(op) < 2 ||
+            CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(op, 0)) != chimp_str_class) {
+        CHIMP_BUG ("io.submit ops must be arrays like [\"read\", ...]");
+        return CHIMP_FALSE;
+    }
+    kind = CHIMP_STR_DATA(CHIMP_ARRAY_ITEM(op, 0));
+    target = CHIMP_ARRAY_ITEM(op, 1);
+    if (strcmp (kind, "glob") == 0) {
+        if (CHIMP_ARRAY_SIZE(op) != 2 ||
+                CHIMP_ANY_CLASS(target) != chimp_str_class) {
+            CHIMP_BUG ("expected [\"glob\", pattern]");
+            return CHIMP_FALSE;
+        }
+        return CHIMP_TRUE;
+    }
+    if (strcmp (kind, "read") != 0 && strcmp (kind, "write") != 0) {
+        CHIMP_BUG ("unknown io.submit op: %s", kind);
+        return CHIMP_FALSE;
+    }
+    if (CHIMP_ARRAY_SIZE(op) != 4 ||
+            (CHIMP_ANY_CLASS(target) != chimp_str_class &&
+                CHIMP_ANY_CLASS(target) != chimp_int_class) ||
+            CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(op, 2)) != chimp_int_class) {
+        CHIMP_BUG ("expected [\"%s\", file, offset, %s]",
+            kind, kind[0] == 'r' ? "size" : "data");
+        return CHIMP_FALSE;
+    }
+    if (kind[0] == 'r' &&
+            CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(op, 3)) != chimp_int_class) {
+        CHIMP_BUG ("read size must be an int");
+        return CHIMP_FALSE;
+    }
+    if (kind[0] == 'w' &&
+            CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(op, 3)) != chimp_str_class) {
+        CHIMP_BUG ("write data must be a str");
+        return CHIMP_FALSE;
+    }
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_io_submit (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    size_t i;
+    ChimpRef *ops;
+    ChimpRef *tag = chimp_nil;
+    ChimpRef *worker;
+    ChimpRef *msg;
+    ChimpTaskInternal *priv;
+
+    ops = argv[0];
+    if (argc > 1) {
+        tag = argv[1];
+    }
+    if (CHIMP_ANY_CLASS(ops) != chimp_array_class) {
+        CHIMP_BUG ("io.submit expects an array of ops");
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(ops); i++) {
+        if (!chimp_io_check_op (CHIMP_ARRAY_ITEM(ops, i))) {
+            return NULL;
+        }
+    }
+
+    priv = chimp_io_get_worker ();
+    if (priv == NULL) {
+        return NULL;
+    }
+    worker = chimp_task_new_from_internal (priv);
+    if (worker == NULL) {
+        return NULL;
+    }
+    msg = chimp_array_new_var (
+        chimp_task_get_self (chimp_task_current ()), tag, ops, NULL);
+    if (msg == NULL) {
+        return NULL;
+    }
+    /* held by the worker until it has replied */
+    chimp_task_ref (chimp_task_current ());
+    if (!chimp_task_send (worker, msg)) {
+        chimp_task_unref (chimp_task_current ());
+        return NULL;
+    }
+    return chimp_nil;
+}
+
 ChimpRef *
 chimp_init_io_module (void)
 {
@@ -233,18 +1411,41 @@ chimp_init_io_module (void)
         return NULL;
     }
 
-    if (!chimp_module_add_method_str (io, "print", _chimp_io_print)) {
+    if (!chimp_module_add_argv_method_str (io, "print", "*", _chimp_io_print)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_argv_method_str (io, "write", "*", _chimp_io_write)) {
         return NULL;
     }
 
-    if (!chimp_module_add_method_str (io, "write", _chimp_io_write)) {
+    if (!chimp_module_add_argv_method_str (io, "flush", "", _chimp_io_flush)) {
         return NULL;
     }
 
-    if (!chimp_module_add_method_str (io, "readline", _chimp_io_readline)) {
+    if (!chimp_module_add_argv_method_str (io, "readline", "", _chimp_io_readline)) {
         return NULL;
     }
 
+    if (!chimp_module_add_argv_method_str (io, "mmap", "s|s", _chimp_io_mmap)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_argv_method_str (io, "buffer", "I", _chimp_io_buffer)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_argv_method_str (io, "submit", "o|o", _chimp_io_submit)) {
+        return NULL;
+    }
+
+    chimp_io_worker_method =
+        chimp_method_new_native (NULL, _chimp_io_worker_func);
+    if (chimp_io_worker_method == NULL) {
+        return NULL;
+    }
+    chimp_gc_make_root (NULL, chimp_io_worker_method);
+
     io_file_class = _chimp_init_io_file_class ();
     if (io_file_class == NULL)
         return NULL;
@@ -253,6 +1454,11 @@ chimp_init_io_module (void)
     if (!chimp_module_add_local_str (io, "file", chimp_io_file_class))
         return NULL;
 
+    chimp_io_lines_class = _chimp_init_io_lines_class ();
+    if (chimp_io_lines_class == NULL)
+        return NULL;
+    chimp_gc_make_root (NULL, chimp_io_lines_class);
+
     return io;
 }
 
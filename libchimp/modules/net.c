@@ -16,16 +16,31 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <arpa/inet.h>
+#include <limits.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
 
 #include "chimp/any.h"
 #include "chimp/object.h"
 #include "chimp/array.h"
 #include "chimp/str.h"
+#include "chimp/task.h"
+#include "chimp/error.h"
 
 #define CHIMP_MODULE_INT_CONSTANT(mod, name, value) \
     do { \
@@ -49,16 +64,153 @@
         } \
     } while (0)
 
+/*
+ * Sockets are non-blocking under the hood. Operations that would block
+ * instead wait for the descriptor to become ready, which lets them take
+ * an optional timeout (in milliseconds).
+ *
+ * A task that wants to juggle many sockets at once -- e.g. lots of idle
+ * keep-alive connections -- can register them with a net.poller (epoll on
+ * Linux) & only touch the ones that are ready. The task's own inbox can be
+ * registered too, so messages & I/O are handled by the same loop. Remove a
+ * socket from any pollers before closing it.
+ */
+
 typedef struct _ChimpNetSocket {
     ChimpAny base;
     int fd;
 } ChimpNetSocket;
 
+/*
+ * A reader buffers what comes off a socket so that line & frame oriented
+ * protocols don't have to glue strs together in chimp code. Unconsumed
+ * bytes live in [start, end) of a single buffer per connection. The buffer
+ * is compacted before it's grown, so it stays as small as the longest
+ * line or frame.
+ *
+ * EOF & I/O errors come back as error objects: `error("eof")` for the
+ * former, so callers can tell the two apart. Timeouts come back as nil.
+ */
+
+typedef struct _ChimpNetReader {
+    ChimpAny      base;
+    ChimpRef     *sock;
+    char         *buf;
+    size_t        start;
+    size_t        end;
+    size_t        capacity;
+    size_t        limit;
+    chimp_bool_t  eof;
+} ChimpNetReader;
+
+typedef struct _ChimpNetPoller {
+    ChimpAny   base;
+    int        fd;
+    ChimpRef **watched;  /* indexed by fd */
+    size_t     watched_size;
+    size_t     num_watched;
+} ChimpNetPoller;
+
 static ChimpRef *chimp_net_socket_class = NULL;
+static ChimpRef *chimp_net_poller_class = NULL;
+static ChimpRef *chimp_net_reader_class = NULL;
 
 #define CHIMP_NET_SOCKET(ref) \
     CHIMP_CHECK_CAST(ChimpNetSocket, (ref), chimp_net_socket_class)
 
+#define CHIMP_NET_READER(ref) \
+    CHIMP_CHECK_CAST(ChimpNetReader, (ref), chimp_net_reader_class)
+
+#define CHIMP_NET_POLLER(ref) \
+    CHIMP_CHECK_CAST(ChimpNetPoller, (ref), chimp_net_poller_class)
+
+/* reads of up to this many bytes don't touch the heap */
+#define CHIMP_NET_RECV_STACK_SIZE 16384
+
+#define CHIMP_NET_TIMED_OUT (-2)
+
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+/* how much sock.sendfile moves per system call */
+#define CHIMP_NET_SENDFILE_CHUNK_SIZE (1024 * 1024)
+
+/* how much a reader buffers by default: anything longer than this between
+ * two delimiters is an error.
+ */
+#define CHIMP_NET_READER_DEFAULT_LIMIT (1024 * 1024)
+
+#define CHIMP_NET_READER_INITIAL_SIZE 4096
+
+/* the most events a single call to poller.wait will report */
+#define CHIMP_NET_POLLER_MAX_EVENTS 256
+
+static chimp_bool_t
+chimp_net_set_nonblocking (int fd)
+{
+    int flags = fcntl (fd, F_GETFL, 0);
+    if (flags < 0) {
+        return CHIMP_FALSE;
+    }
+    if ((flags & O_NONBLOCK) == 0) {
+        if (fcntl (fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* reads at most size bytes, waiting for data if necessary. returns the
+ * number of bytes read, 0 on EOF, CHIMP_NET_TIMED_OUT or -1 on error.
+ */
+static ssize_t
+chimp_net_recv_some (int fd, char *buf, size_t size, int64_t timeout_ms);
+
+/* waits until fd is ready for the given poll(2) events. a negative timeout
+ * waits forever. returns 1 if ready, 0 on timeout & -1 on error.
+ */
+static int
+chimp_net_wait_fd (int fd, short events, int64_t timeout_ms)
+{
+    struct pollfd pfd;
+    int rc;
+
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    do {
+        rc = poll (&pfd, 1, timeout_ms < 0 ? -1 : (int) timeout_ms);
+    } while (rc < 0 && errno == EINTR);
+    return rc;
+}
+
+static ssize_t
+chimp_net_recv_some (int fd, char *buf, size_t size, int64_t timeout_ms)
+{
+    for (;;) {
+        int rc;
+        ssize_t n = recv (fd, buf, size, 0);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            return -1;
+        }
+        rc = chimp_net_wait_fd (fd, POLLIN, timeout_ms);
+        if (rc == 0) {
+            return CHIMP_NET_TIMED_OUT;
+        }
+        else if (rc < 0) {
+            return -1;
+        }
+    }
+}
+
 static ChimpRef *
 _chimp_socket_init (ChimpRef *self, ChimpRef *args)
 {
@@ -75,6 +227,10 @@ _chimp_socket_init (ChimpRef *self, ChimpRef *args)
             CHIMP_BUG ("socket() failed");
             return NULL;
         }
+        if (!chimp_net_set_nonblocking (CHIMP_NET_SOCKET(self)->fd)) {
+            CHIMP_BUG ("could not make socket non-blocking");
+            return NULL;
+        }
         return self;
     }
     else if (CHIMP_ARRAY_SIZE(args) == 1) {
@@ -82,6 +238,10 @@ _chimp_socket_init (ChimpRef *self, ChimpRef *args)
             return NULL;
         }
         CHIMP_NET_SOCKET(self)->fd = fd;
+        if (!chimp_net_set_nonblocking (CHIMP_NET_SOCKET(self)->fd)) {
+            CHIMP_BUG ("could not make socket non-blocking");
+            return NULL;
+        }
         return self;
     }
     else {
@@ -89,16 +249,43 @@ _chimp_socket_init (ChimpRef *self, ChimpRef *args)
     }
 }
 
+/* net.socketpair() returns a pair of connected (AF_UNIX) sockets */
+static ChimpRef *
+_chimp_net_socketpair (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    int fds[2];
+    ChimpRef *a;
+    ChimpRef *b;
+
+    if (socketpair (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+        return chimp_error_new_with_format (
+            "socketpair: %s", strerror (errno));
+    }
+
+    a = chimp_class_new_instance (
+            chimp_net_socket_class, chimp_int_new (fds[0]), NULL);
+    if (a == NULL) {
+        close (fds[0]);
+        close (fds[1]);
+        return NULL;
+    }
+    b = chimp_class_new_instance (
+            chimp_net_socket_class, chimp_int_new (fds[1]), NULL);
+    if (b == NULL) {
+        close (fds[1]);
+        return NULL;
+    }
+    return chimp_array_new_var (a, b, NULL);
+}
+
 static ChimpRef *
-_chimp_socket_bind (ChimpRef *self, ChimpRef *args)
+_chimp_socket_bind (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     struct sockaddr_in addr;
     int64_t port;
     int fd;
 
-    if (!chimp_method_parse_args (args, "I", &port)) {
-        return NULL;
-    }
+    port = CHIMP_INT(argv[0])->value;
 
     addr.sin_family = AF_INET;
     addr.sin_addr.s_addr = INADDR_ANY;
@@ -116,13 +303,13 @@ _chimp_socket_bind (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_socket_listen (ChimpRef *self, ChimpRef *args)
+_chimp_socket_listen (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int64_t backlog = SOMAXCONN;
     int fd = CHIMP_NET_SOCKET(self)->fd;
 
-    if (!chimp_method_parse_args (args, "|I", &backlog)) {
-        return NULL;
+    if (argc > 0) {
+        backlog = CHIMP_INT(argv[0])->value;
     }
 
     if (listen (fd, backlog) < 0) {
@@ -133,13 +320,13 @@ _chimp_socket_listen (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_socket_setsockopt (ChimpRef *self, ChimpRef *args)
+_chimp_socket_setsockopt (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int32_t level, optname, optval;
 
-    if (!chimp_method_parse_args (args, "iii", &level, &optname, &optval)) {
-        return NULL;
-    }
+    level = (int32_t) CHIMP_INT(argv[0])->value;
+    optname = (int32_t) CHIMP_INT(argv[1])->value;
+    optval = (int32_t) CHIMP_INT(argv[2])->value;
 
     if (setsockopt (CHIMP_NET_SOCKET(self)->fd, level, optname, &optval, sizeof(optval)) != 0) {
         return chimp_false;
@@ -149,18 +336,41 @@ _chimp_socket_setsockopt (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_socket_accept (ChimpRef *self, ChimpRef *args)
+_chimp_socket_accept (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int fd = CHIMP_NET_SOCKET(self)->fd;
     struct sockaddr_in addr;
-    uint32_t addrlen = sizeof(addr);
+    socklen_t addrlen;
     int cfd;
+    int64_t timeout = -1;
     ChimpRef *fd_obj;
 
-    cfd = accept (fd, (struct sockaddr *)&addr, &addrlen);
-    if (cfd < 0) {
-        CHIMP_BUG ("accept() failed");
-        return NULL;
+    if (argc > 0) {
+        timeout = CHIMP_INT(argv[0])->value;
+    }
+
+    for (;;) {
+        int rc;
+        addrlen = sizeof(addr);
+        cfd = accept (fd, (struct sockaddr *)&addr, &addrlen);
+        if (cfd >= 0) {
+            break;
+        }
+        if (errno == EINTR || errno == ECONNABORTED) {
+            continue;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            CHIMP_BUG ("accept() failed");
+            return NULL;
+        }
+        rc = chimp_net_wait_fd (fd, POLLIN, timeout);
+        if (rc == 0) {
+            return chimp_nil;
+        }
+        else if (rc < 0) {
+            CHIMP_BUG ("accept() failed");
+            return NULL;
+        }
     }
 
     fd_obj = chimp_int_new (cfd);
@@ -171,8 +381,57 @@ _chimp_socket_accept (ChimpRef *self, ChimpRef *args)
             chimp_net_socket_class, fd_obj, NULL);
 }
 
+/* sock.connect(host, port[, timeout]) connects to an IPv4 address.
+ * returns nil on timeout.
+ */
 static ChimpRef *
-_chimp_socket_close (ChimpRef *self, ChimpRef *args)
+_chimp_socket_connect (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    struct sockaddr_in addr;
+    int fd = CHIMP_NET_SOCKET(self)->fd;
+    int64_t timeout = -1;
+    int err = 0;
+    socklen_t errlen = sizeof(err);
+    int rc;
+
+    if (argc > 2) {
+        timeout = CHIMP_INT(argv[2])->value;
+    }
+
+    memset (&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons ((int) CHIMP_INT(argv[1])->value);
+    if (inet_pton (AF_INET, CHIMP_STR_DATA(argv[0]), &addr.sin_addr) != 1) {
+        return chimp_error_new_with_format (
+            "connect: bad address: %s", CHIMP_STR_DATA(argv[0]));
+    }
+
+    do {
+        rc = connect (fd, (struct sockaddr *)&addr, sizeof(addr));
+    } while (rc < 0 && errno == EINTR);
+    if (rc == 0) {
+        return self;
+    }
+    if (errno != EINPROGRESS) {
+        return chimp_error_new_with_format ("connect: %s", strerror (errno));
+    }
+
+    rc = chimp_net_wait_fd (fd, POLLOUT, timeout);
+    if (rc == 0) {
+        return chimp_nil;
+    }
+    else if (rc < 0 ||
+            getsockopt (fd, SOL_SOCKET, SO_ERROR, &err, &errlen) != 0) {
+        return chimp_error_new_with_format ("connect: %s", strerror (errno));
+    }
+    else if (err != 0) {
+        return chimp_error_new_with_format ("connect: %s", strerror (err));
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_socket_close (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     if (CHIMP_NET_SOCKET(self)->fd > 0) {
         close (CHIMP_NET_SOCKET(self)->fd);
@@ -182,13 +441,11 @@ _chimp_socket_close (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_socket_shutdown (ChimpRef *self, ChimpRef *args)
+_chimp_socket_shutdown (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     int32_t how = SHUT_RDWR;
 
-    if (!chimp_method_parse_args (args, "i", &how)) {
-        return NULL;
-    }
+    how = (int32_t) CHIMP_INT(argv[0])->value;
 
     if (shutdown (CHIMP_NET_SOCKET (self)->fd, how) != 0) {
         return chimp_false;
@@ -197,55 +454,290 @@ _chimp_socket_shutdown (ChimpRef *self, ChimpRef *args)
 }
 
 static ChimpRef *
-_chimp_socket_send (ChimpRef *self, ChimpRef *args)
+_chimp_socket_send (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
     ChimpRef *data;
-    int rc;
+    int fd = CHIMP_NET_SOCKET (self)->fd;
+    int64_t timeout = -1;
+    size_t sent = 0;
 
-    if (!chimp_method_parse_args (args, "o", &data)) {
-        return NULL;
+    data = argv[0];
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
     }
 
-    rc = send (CHIMP_NET_SOCKET (self)->fd,
-                CHIMP_STR_DATA(data), CHIMP_STR_SIZE(data), 0);
+    /* keep going until it's all out, the peer goes away or we time out */
+    while (sent < CHIMP_STR_SIZE(data)) {
+        ssize_t rc = send (fd, CHIMP_STR_DATA(data) + sent,
+                            CHIMP_STR_SIZE(data) - sent, 0);
+        if (rc >= 0) {
+            sent += rc;
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (chimp_net_wait_fd (fd, POLLOUT, timeout) > 0) {
+                continue;
+            }
+            /* timed out: report what made it */
+            break;
+        }
+        if (sent == 0) {
+            return chimp_int_new (-1);
+        }
+        break;
+    }
 
-    return chimp_int_new (rc);
+    return chimp_int_new (sent);
 }
 
+/* pushes file data straight from the page cache to the socket: it never
+ * passes through the chimp heap. returns what sendfile(2) does.
+ */
+static ssize_t
+chimp_net_sendfile_some (int out_fd, int in_fd, off_t *offset, size_t count)
+{
+#ifdef __linux__
+    return sendfile (out_fd, in_fd, offset, count);
+#else
+    char buf[CHIMP_NET_RECV_STACK_SIZE];
+    ssize_t n;
+    ssize_t sent;
+
+    if (count > sizeof(buf)) {
+        count = sizeof(buf);
+    }
+    n = pread (in_fd, buf, count, *offset);
+    if (n <= 0) {
+        return n;
+    }
+    sent = send (out_fd, buf, (size_t) n, 0);
+    if (sent > 0) {
+        *offset += sent;
+    }
+    return sent;
+#endif
+}
+
+/* the descriptor behind an io.file (or anything else with an fd attr) */
+static int
+chimp_net_file_fd (ChimpRef *file)
+{
+    ChimpRef *fd;
+
+    if (CHIMP_ANY_CLASS(file) == chimp_int_class) {
+        return (int) CHIMP_INT(file)->value;
+    }
+    fd = chimp_object_getattr_str (file, "fd");
+    if (fd == NULL || CHIMP_ANY_CLASS(fd) != chimp_int_class) {
+        CHIMP_BUG ("sendfile expects an io.file or a file descriptor");
+        return -1;
+    }
+    return (int) CHIMP_INT(fd)->value;
+}
+
+/* sock.sendfile(file[, offset[, count[, timeout]]]). count defaults to
+ * everything from offset to the end of the file. the file's own position
+ * is left alone. returns the number of bytes sent.
+ */
 static ChimpRef *
-_chimp_socket_recv (ChimpRef *self, ChimpRef *args)
+_chimp_socket_sendfile (ChimpRef *self, size_t argc, ChimpRef **argv)
 {
-    int32_t size;
-    char *buf;
-    int n;
+    ChimpRef *file;
+    int64_t offset = 0;
+    int64_t count = -1;
+    int64_t timeout = -1;
+    int fd = CHIMP_NET_SOCKET(self)->fd;
+    int in_fd;
+    off_t pos;
+    size_t sent = 0;
+
+    file = argv[0];
+    if (argc > 1) {
+        offset = CHIMP_INT(argv[1])->value;
+    }
+    if (argc > 2) {
+        count = CHIMP_INT(argv[2])->value;
+    }
+    if (argc > 3) {
+        timeout = CHIMP_INT(argv[3])->value;
+    }
 
-    if (!chimp_method_parse_args (args, "i", &size)) {
+    in_fd = chimp_net_file_fd (file);
+    if (in_fd < 0) {
         return NULL;
     }
 
-    buf = malloc (size + 1);
-    if (buf == NULL) {
-        CHIMP_BUG ("Failed to allocate recv buffer");
+    if (count < 0) {
+        struct stat st;
+        if (fstat (in_fd, &st) != 0) {
+            return chimp_error_new_with_format ("fstat: %s", strerror (errno));
+        }
+        count = (st.st_size > offset) ? st.st_size - offset : 0;
+    }
+
+    pos = (off_t) offset;
+    while (sent < (size_t) count) {
+        size_t chunk = (size_t) count - sent;
+        ssize_t n;
+        if (chunk > CHIMP_NET_SENDFILE_CHUNK_SIZE) {
+            chunk = CHIMP_NET_SENDFILE_CHUNK_SIZE;
+        }
+        n = chimp_net_sendfile_some (fd, in_fd, &pos, chunk);
+        if (n > 0) {
+            sent += n;
+            continue;
+        }
+        if (n == 0) {
+            /* the file is shorter than we were told */
+            break;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (chimp_net_wait_fd (fd, POLLOUT, timeout) > 0) {
+                continue;
+            }
+            break;
+        }
+        if (sent == 0) {
+            return chimp_error_new_with_format (
+                "sendfile: %s", strerror (errno));
+        }
+        break;
+    }
+
+    return chimp_int_new (sent);
+}
+
+/* sock.sendv([chunk, ...][, timeout]) writes all the chunks with as few
+ * system calls as possible, without joining them into one str first.
+ * returns the number of bytes sent.
+ */
+static ChimpRef *
+_chimp_socket_sendv (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    struct iovec iov[IOV_MAX];
+    ChimpRef *chunks;
+    int64_t timeout = -1;
+    int fd = CHIMP_NET_SOCKET(self)->fd;
+    size_t next = 0;       /* first chunk not yet in iov */
+    size_t skip = 0;       /* bytes of iov[0] that already went out */
+    size_t sent = 0;
+    size_t i;
+
+    chunks = argv[0];
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
+    }
+    if (CHIMP_ANY_CLASS(chunks) != chimp_array_class) {
+        CHIMP_BUG ("sock.sendv expects an array of strs");
         return NULL;
     }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(chunks); i++) {
+        if (CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(chunks, i)) != chimp_str_class) {
+            CHIMP_BUG ("sock.sendv expects an array of strs");
+            return NULL;
+        }
+    }
 
-    n = recv (CHIMP_NET_SOCKET (self)->fd, buf, size, 0);
-    /* XXX can't distinguish between an error and an EOF atm */
-    if (n <= 0) {
-        return CHIMP_STR_NEW ("");
+    while (next < CHIMP_ARRAY_SIZE(chunks)) {
+        size_t n_iov = 0;
+        size_t j;
+        ssize_t n;
+
+        for (j = next; j < CHIMP_ARRAY_SIZE(chunks) && n_iov < IOV_MAX; j++) {
+            ChimpRef *chunk = CHIMP_ARRAY_ITEM(chunks, j);
+            size_t offset = (j == next) ? skip : 0;
+            iov[n_iov].iov_base = CHIMP_STR_DATA(chunk) + offset;
+            iov[n_iov].iov_len = CHIMP_STR_SIZE(chunk) - offset;
+            n_iov++;
+        }
+
+        n = writev (fd, iov, (int) n_iov);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (chimp_net_wait_fd (fd, POLLOUT, timeout) > 0) {
+                    continue;
+                }
+                break;
+            }
+            if (sent == 0) {
+                return chimp_error_new_with_format (
+                    "writev: %s", strerror (errno));
+            }
+            break;
+        }
+        sent += n;
+
+        /* work out where the next writev picks up */
+        for (j = 0; j < n_iov; j++) {
+            if ((size_t) n < iov[j].iov_len) {
+                skip = (j == 0 ? skip : 0) + (size_t) n;
+                break;
+            }
+            n -= iov[j].iov_len;
+            next++;
+            skip = 0;
+        }
     }
 
-    if (n < size) {
-        char *temp = realloc (buf, n + 1);
-        if (temp == NULL) {
-            CHIMP_BUG ("Failed to shrink recv buffer");
+    return chimp_int_new (sent);
+}
+
+static ChimpRef *
+_chimp_socket_recv (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    size_t size;
+    int64_t timeout = -1;
+    char stack_buf[CHIMP_NET_RECV_STACK_SIZE];
+    char *buf = stack_buf;
+    ChimpRef *result;
+    ssize_t n;
+
+    if (CHIMP_INT(argv[0])->value < 0) {
+        return chimp_error_new (CHIMP_STR_NEW ("recv: size must not be negative"));
+    }
+    size = (size_t) CHIMP_INT(argv[0])->value;
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
+    }
+
+    /* small reads land on the stack & get copied into a str of the right
+     * size: cheaper than a malloc/realloc pair per call.
+     */
+    if (size > CHIMP_NET_RECV_STACK_SIZE) {
+        buf = malloc (size + 1);
+        if (buf == NULL) {
+            CHIMP_BUG ("Failed to allocate recv buffer");
             return NULL;
         }
-        buf = temp;
     }
-    buf[n] = '\0';
 
-    return chimp_str_new_take (buf, n);
+    n = chimp_net_recv_some (CHIMP_NET_SOCKET (self)->fd, buf, size, timeout);
+    if (n > 0) {
+        result = chimp_str_new (buf, n);
+    }
+    else if (n == 0) {
+        result = CHIMP_STR_NEW ("");
+    }
+    else if (n == CHIMP_NET_TIMED_OUT) {
+        result = chimp_nil;
+    }
+    else {
+        result = chimp_error_new_with_format ("recv: %s", strerror (errno));
+    }
+
+    if (buf != stack_buf) {
+        free (buf);
+    }
+    return result;
 }
 
 static ChimpRef *
@@ -264,10 +756,597 @@ static void
 _chimp_socket_dtor (ChimpRef *self)
 {
 #if 0
-    _chimp_socket_close (self, NULL);
+    _chimp_socket_close (self, 0, NULL);
 #endif
 }
 
+/* reads more data into the buffer. returns what chimp_net_recv_some does,
+ * except that running out of room is reported as an error (ENOBUFS).
+ */
+static ssize_t
+chimp_net_reader_fill (ChimpNetReader *reader, int64_t timeout_ms)
+{
+    ssize_t n;
+
+    if (reader->start > 0 && reader->end == reader->capacity) {
+        memmove (reader->buf, reader->buf + reader->start,
+                    reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == reader->capacity) {
+        char *buf;
+        size_t capacity = reader->capacity * 2;
+        if (reader->capacity >= reader->limit) {
+            errno = ENOBUFS;
+            return -1;
+        }
+        if (capacity > reader->limit) {
+            capacity = reader->limit;
+        }
+        buf = CHIMP_REALLOC(char, reader->buf, capacity);
+        if (buf == NULL) {
+            errno = ENOMEM;
+            return -1;
+        }
+        reader->buf = buf;
+        reader->capacity = capacity;
+    }
+
+    n = chimp_net_recv_some (CHIMP_NET_SOCKET(reader->sock)->fd,
+            reader->buf + reader->end, reader->capacity - reader->end,
+            timeout_ms);
+    if (n > 0) {
+        reader->end += n;
+    }
+    else if (n == 0) {
+        reader->eof = CHIMP_TRUE;
+    }
+    return n;
+}
+
+/* the error (or nil, on timeout) to hand back when a fill didn't pan out */
+static ChimpRef *
+chimp_net_reader_fill_failed (ssize_t n)
+{
+    if (n == 0) {
+        return chimp_error_new (CHIMP_STR_NEW("eof"));
+    }
+    else if (n == CHIMP_NET_TIMED_OUT) {
+        return chimp_nil;
+    }
+    else if (errno == ENOBUFS) {
+        return chimp_error_new (CHIMP_STR_NEW("reader limit exceeded"));
+    }
+    else {
+        return chimp_error_new_with_format ("recv: %s", strerror (errno));
+    }
+}
+
+/* consumes `size` buffered bytes, plus `skip` more that the caller isn't
+ * interested in (e.g. a delimiter).
+ */
+static ChimpRef *
+chimp_net_reader_take (ChimpNetReader *reader, size_t size, size_t skip)
+{
+    ChimpRef *result = chimp_str_new (reader->buf + reader->start, size);
+    if (result == NULL) {
+        return NULL;
+    }
+    reader->start += size + skip;
+    if (reader->start == reader->end) {
+        reader->start = reader->end = 0;
+    }
+    return result;
+}
+
+static ChimpRef *
+chimp_net_reader_read_until (
+    ChimpRef *self, const char *delim, size_t delim_size, int64_t timeout)
+{
+    ChimpNetReader *reader = CHIMP_NET_READER(self);
+    /* no need to rescan what we've already looked at */
+    size_t scanned = 0;
+
+    for (;;) {
+        size_t avail = reader->end - reader->start;
+        while (scanned + delim_size <= avail) {
+            const char *p = reader->buf + reader->start + scanned;
+            const char *match = memchr (p, delim[0], avail - scanned);
+            if (match == NULL) {
+                scanned = avail;
+                break;
+            }
+            scanned = match - (reader->buf + reader->start);
+            if (scanned + delim_size > avail) {
+                break;
+            }
+            if (memcmp (match, delim, delim_size) == 0) {
+                return chimp_net_reader_take (reader, scanned, delim_size);
+            }
+            scanned++;
+        }
+
+        if (!reader->eof) {
+            ssize_t n = chimp_net_reader_fill (reader, timeout);
+            if (n > 0) {
+                continue;
+            }
+            if (n != 0) {
+                return chimp_net_reader_fill_failed (n);
+            }
+        }
+
+        /* EOF: hand over whatever's left as the final chunk */
+        if (reader->end > reader->start) {
+            return chimp_net_reader_take (
+                reader, reader->end - reader->start, 0);
+        }
+        return chimp_net_reader_fill_failed (0);
+    }
+}
+
+static ChimpRef *
+_chimp_reader_read_line (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    int64_t timeout = -1;
+    ChimpRef *line;
+
+    if (argc > 0) {
+        timeout = CHIMP_INT(argv[0])->value;
+    }
+
+    line = chimp_net_reader_read_until (self, "\n", 1, timeout);
+    if (line == NULL || CHIMP_ANY_CLASS(line) != chimp_str_class) {
+        return line;
+    }
+    /* tolerate CRLF line endings */
+    if (CHIMP_STR_SIZE(line) > 0 &&
+            CHIMP_STR_DATA(line)[CHIMP_STR_SIZE(line) - 1] == '\r') {
+        CHIMP_STR(line)->size--;
+        CHIMP_STR_DATA(line)[CHIMP_STR_SIZE(line)] = '\0';
+    }
+    return line;
+}
+
+static ChimpRef *
+_chimp_reader_read_until (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpRef *delim;
+    int64_t timeout = -1;
+
+    delim = argv[0];
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
+    }
+    if (CHIMP_ANY_CLASS(delim) != chimp_str_class ||
+            CHIMP_STR_SIZE(delim) == 0) {
+        CHIMP_BUG ("read_until requires a non-empty delimiter");
+        return NULL;
+    }
+
+    return chimp_net_reader_read_until (
+        self, CHIMP_STR_DATA(delim), CHIMP_STR_SIZE(delim), timeout);
+}
+
+static ChimpRef *
+_chimp_reader_read_exact (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpNetReader *reader = CHIMP_NET_READER(self);
+    int64_t size;
+    int64_t timeout = -1;
+
+    size = CHIMP_INT(argv[0])->value;
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
+    }
+    if (size < 0) {
+        CHIMP_BUG ("read_exact requires a non-negative size");
+        return NULL;
+    }
+
+    while (reader->end - reader->start < (size_t) size) {
+        ssize_t n;
+        if (reader->eof) {
+            return chimp_net_reader_fill_failed (0);
+        }
+        n = chimp_net_reader_fill (reader, timeout);
+        if (n < 0) {
+            return chimp_net_reader_fill_failed (n);
+        }
+    }
+    return chimp_net_reader_take (reader, (size_t) size, 0);
+}
+
+/* up to n buffered bytes, without consuming them. waits for data only if
+ * there isn't any buffered.
+ */
+static ChimpRef *
+_chimp_reader_peek (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpNetReader *reader = CHIMP_NET_READER(self);
+    int64_t size = -1;
+    int64_t timeout = -1;
+    size_t avail;
+
+    if (argc > 0) {
+        size = CHIMP_INT(argv[0])->value;
+    }
+    if (argc > 1) {
+        timeout = CHIMP_INT(argv[1])->value;
+    }
+
+    if (reader->end == reader->start && !reader->eof) {
+        ssize_t n = chimp_net_reader_fill (reader, timeout);
+        if (n < 0) {
+            return chimp_net_reader_fill_failed (n);
+        }
+    }
+
+    avail = reader->end - reader->start;
+    if (size >= 0 && (size_t) size < avail) {
+        avail = (size_t) size;
+    }
+    return chimp_str_new (reader->buf + reader->start, avail);
+}
+
+static ChimpRef *
+_chimp_reader_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    ChimpNetReader *reader = CHIMP_NET_READER(self);
+
+    if (strcmp ("socket", CHIMP_STR_DATA(attr)) == 0) {
+        return reader->sock;
+    }
+    else if (strcmp ("buffered", CHIMP_STR_DATA(attr)) == 0) {
+        return chimp_int_new (reader->end - reader->start);
+    }
+    else if (strcmp ("eof", CHIMP_STR_DATA(attr)) == 0) {
+        return (reader->eof && reader->end == reader->start) ?
+                    chimp_true : chimp_false;
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static ChimpRef *
+_chimp_reader_init (ChimpRef *self, ChimpRef *args)
+{
+    ChimpNetReader *reader = CHIMP_NET_READER(self);
+    ChimpRef *sock;
+    int64_t limit = CHIMP_NET_READER_DEFAULT_LIMIT;
+
+    if (!chimp_method_parse_args (args, "o|I", &sock, &limit)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(sock) != chimp_net_socket_class) {
+        CHIMP_BUG ("net.reader expects a net.socket");
+        return NULL;
+    }
+    if (limit <= 0) {
+        CHIMP_BUG ("net.reader limit must be positive");
+        return NULL;
+    }
+
+    reader->sock = sock;
+    reader->limit = (size_t) limit;
+    reader->capacity = CHIMP_NET_READER_INITIAL_SIZE;
+    if (reader->capacity > reader->limit) {
+        reader->capacity = reader->limit;
+    }
+    reader->buf = CHIMP_MALLOC(char, reader->capacity);
+    if (reader->buf == NULL) {
+        return NULL;
+    }
+    return self;
+}
+
+static void
+_chimp_reader_mark (ChimpGC *gc, ChimpRef *self)
+{
+    CHIMP_SUPER(self)->mark (gc, self);
+
+    chimp_gc_mark_ref (gc, CHIMP_NET_READER(self)->sock);
+}
+
+static void
+_chimp_reader_dtor (ChimpRef *self)
+{
+    CHIMP_FREE (CHIMP_NET_READER(self)->buf);
+    CHIMP_NET_READER(self)->buf = NULL;
+}
+
+static chimp_bool_t
+_chimp_reader_class_bootstrap (void)
+{
+    if (chimp_net_reader_class == NULL) {
+        chimp_net_reader_class = chimp_class_new (
+            CHIMP_STR_NEW("net.reader"), NULL, sizeof(ChimpNetReader));
+        if (chimp_net_reader_class == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_net_reader_class);
+
+        CHIMP_CLASS(chimp_net_reader_class)->init = _chimp_reader_init;
+        CHIMP_CLASS(chimp_net_reader_class)->dtor = _chimp_reader_dtor;
+        CHIMP_CLASS(chimp_net_reader_class)->mark = _chimp_reader_mark;
+        CHIMP_CLASS(chimp_net_reader_class)->getattr = _chimp_reader_getattr;
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_reader_class, "read_line", "|I", _chimp_reader_read_line)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (chimp_net_reader_class,
+                "read_until", "o|I", _chimp_reader_read_until)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (chimp_net_reader_class,
+                "read_exact", "I|I", _chimp_reader_read_exact)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_reader_class, "peek", "|II", _chimp_reader_peek)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+#ifdef __linux__
+
+/* the descriptor behind a socket, or behind the inbox of the current task */
+static int
+chimp_net_poller_target_fd (ChimpRef *target)
+{
+    if (CHIMP_ANY_CLASS(target) == chimp_net_socket_class) {
+        return CHIMP_NET_SOCKET(target)->fd;
+    }
+    else if (CHIMP_ANY_CLASS(target) == chimp_task_class) {
+        if (CHIMP_TASK(target)->priv != chimp_task_current ()) {
+            CHIMP_BUG ("a poller can only watch the inbox of its own task");
+            return -1;
+        }
+        return chimp_task_inbox_fd (CHIMP_TASK(target)->priv);
+    }
+    else {
+        CHIMP_BUG ("a poller can only watch sockets & self()");
+        return -1;
+    }
+}
+
+static ChimpRef *
+chimp_net_poller_ctl (ChimpRef *self, size_t argc, ChimpRef **argv, int op)
+{
+    ChimpRef *target;
+    int64_t events = EPOLLIN;
+    struct epoll_event ev;
+    int fd;
+
+    target = argv[0];
+    if (argc > 1) {
+        events = CHIMP_INT(argv[1])->value;
+    }
+
+    fd = chimp_net_poller_target_fd (target);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    memset (&ev, 0, sizeof(ev));
+    ev.events = (uint32_t) events;
+    ev.data.fd = fd;
+    if (epoll_ctl (CHIMP_NET_POLLER(self)->fd, op, fd, &ev) != 0) {
+        return chimp_false;
+    }
+
+    if (op == EPOLL_CTL_ADD) {
+        ChimpNetPoller *poller = CHIMP_NET_POLLER(self);
+        if ((size_t) fd >= poller->watched_size) {
+            size_t i;
+            size_t size = poller->watched_size > 0 ? poller->watched_size : 64;
+            ChimpRef **watched;
+            while (size <= (size_t) fd) {
+                size *= 2;
+            }
+            watched = CHIMP_REALLOC(
+                ChimpRef *, poller->watched, size * sizeof(*watched));
+            if (watched == NULL) {
+                epoll_ctl (poller->fd, EPOLL_CTL_DEL, fd, &ev);
+                return NULL;
+            }
+            for (i = poller->watched_size; i < size; i++) {
+                watched[i] = NULL;
+            }
+            poller->watched = watched;
+            poller->watched_size = size;
+        }
+        poller->watched[fd] = target;
+        poller->num_watched++;
+    }
+    else if (op == EPOLL_CTL_DEL) {
+        CHIMP_NET_POLLER(self)->watched[fd] = NULL;
+        CHIMP_NET_POLLER(self)->num_watched--;
+    }
+    return chimp_true;
+}
+
+static ChimpRef *
+_chimp_poller_add (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_net_poller_ctl (self, argc, argv, EPOLL_CTL_ADD);
+}
+
+static ChimpRef *
+_chimp_poller_modify (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_net_poller_ctl (self, argc, argv, EPOLL_CTL_MOD);
+}
+
+static ChimpRef *
+_chimp_poller_remove (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_net_poller_ctl (self, argc, argv, EPOLL_CTL_DEL);
+}
+
+/* returns an array of [target, events] pairs. empty if we timed out. */
+static ChimpRef *
+_chimp_poller_wait (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    struct epoll_event events[CHIMP_NET_POLLER_MAX_EVENTS];
+    ChimpNetPoller *poller = CHIMP_NET_POLLER(self);
+    int64_t timeout = -1;
+    ChimpRef *result;
+    int i, n;
+
+    if (argc > 0) {
+        timeout = CHIMP_INT(argv[0])->value;
+    }
+
+    do {
+        n = epoll_wait (poller->fd, events, CHIMP_NET_POLLER_MAX_EVENTS,
+                        timeout < 0 ? -1 : (int) timeout);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        CHIMP_BUG ("epoll_wait() failed");
+        return NULL;
+    }
+
+    result = chimp_array_new_with_capacity (n);
+    if (result == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        ChimpRef *target = poller->watched[events[i].data.fd];
+        ChimpRef *pair;
+        if (target == NULL) {
+            continue;
+        }
+        pair = chimp_array_new_var (
+            target, chimp_int_new (events[i].events), NULL);
+        if (pair == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (result, pair)) {
+            return NULL;
+        }
+    }
+    return result;
+}
+
+static ChimpRef *
+_chimp_poller_close (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    ChimpNetPoller *poller = CHIMP_NET_POLLER(self);
+    if (poller->fd >= 0) {
+        close (poller->fd);
+        poller->fd = -1;
+    }
+    CHIMP_FREE (poller->watched);
+    poller->watched = NULL;
+    poller->watched_size = 0;
+    poller->num_watched = 0;
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_poller_init (ChimpRef *self, ChimpRef *args)
+{
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+
+    CHIMP_NET_POLLER(self)->fd = epoll_create1 (EPOLL_CLOEXEC);
+    if (CHIMP_NET_POLLER(self)->fd < 0) {
+        CHIMP_BUG ("epoll_create1() failed");
+        return NULL;
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_poller_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp ("size", CHIMP_STR_DATA(attr)) == 0) {
+        return chimp_int_new (CHIMP_NET_POLLER(self)->num_watched);
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static void
+_chimp_poller_mark (ChimpGC *gc, ChimpRef *self)
+{
+    size_t i;
+    ChimpNetPoller *poller = CHIMP_NET_POLLER(self);
+
+    CHIMP_SUPER(self)->mark (gc, self);
+
+    for (i = 0; i < poller->watched_size; i++) {
+        if (poller->watched[i] != NULL) {
+            chimp_gc_mark_ref (gc, poller->watched[i]);
+        }
+    }
+}
+
+static void
+_chimp_poller_dtor (ChimpRef *self)
+{
+    _chimp_poller_close (self, 0, NULL);
+}
+
+static chimp_bool_t
+_chimp_poller_class_bootstrap (void)
+{
+    if (chimp_net_poller_class == NULL) {
+        chimp_net_poller_class = chimp_class_new (
+            CHIMP_STR_NEW("net.poller"), NULL, sizeof(ChimpNetPoller));
+        if (chimp_net_poller_class == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_net_poller_class);
+
+        CHIMP_CLASS(chimp_net_poller_class)->init = _chimp_poller_init;
+        CHIMP_CLASS(chimp_net_poller_class)->dtor = _chimp_poller_dtor;
+        CHIMP_CLASS(chimp_net_poller_class)->mark = _chimp_poller_mark;
+        CHIMP_CLASS(chimp_net_poller_class)->getattr = _chimp_poller_getattr;
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_poller_class, "add", "o|I", _chimp_poller_add)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_poller_class, "modify", "o|I", _chimp_poller_modify)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_poller_class, "remove", "o|I", _chimp_poller_remove)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_poller_class, "wait", "|I", _chimp_poller_wait)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                chimp_net_poller_class, "close", "", _chimp_poller_close)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+#endif
+
 static chimp_bool_t
 _chimp_socket_class_bootstrap (void)
 {
@@ -286,43 +1365,58 @@ _chimp_socket_class_bootstrap (void)
         CHIMP_CLASS(net_socket_class)->dtor = _chimp_socket_dtor;
         CHIMP_CLASS(net_socket_class)->getattr = _chimp_socket_getattr;
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "close", _chimp_socket_close)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "close", "", _chimp_socket_close)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "bind", "I", _chimp_socket_bind)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "setsockopt", "iii", _chimp_socket_setsockopt)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "listen", "|I", _chimp_socket_listen)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "bind", _chimp_socket_bind)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "connect", "sI|I", _chimp_socket_connect)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "setsockopt", _chimp_socket_setsockopt)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "accept", "|I", _chimp_socket_accept)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "listen", _chimp_socket_listen)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "recv", "i|I", _chimp_socket_recv)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "accept", _chimp_socket_accept)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "send", "o|I", _chimp_socket_send)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "recv", _chimp_socket_recv)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "shutdown", "i", _chimp_socket_shutdown)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "send", _chimp_socket_send)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "sendfile", "o|III", _chimp_socket_sendfile)) {
             return CHIMP_FALSE;
         }
 
-        if (!chimp_class_add_native_method (
-                net_socket_class, "shutdown", _chimp_socket_shutdown)) {
+        if (!chimp_class_add_native_argv_method (
+                net_socket_class, "sendv", "o|I", _chimp_socket_sendv)) {
             return CHIMP_FALSE;
         }
     }
@@ -359,6 +1453,30 @@ chimp_init_net_module (void)
 
     CHIMP_MODULE_ADD_CLASS(net, "socket", net_socket);
 
+    if (!chimp_module_add_argv_method_str (
+            net, "socketpair", "", _chimp_net_socketpair)) {
+        return NULL;
+    }
+
+    if (!_chimp_reader_class_bootstrap ()) {
+        return NULL;
+    }
+
+    CHIMP_MODULE_ADD_CLASS(net, "reader", chimp_net_reader_class);
+
+#ifdef __linux__
+    CHIMP_MODULE_INT_CONSTANT(net, "POLLIN", EPOLLIN);
+    CHIMP_MODULE_INT_CONSTANT(net, "POLLOUT", EPOLLOUT);
+    CHIMP_MODULE_INT_CONSTANT(net, "POLLHUP", EPOLLHUP);
+    CHIMP_MODULE_INT_CONSTANT(net, "POLLERR", EPOLLERR);
+
+    if (!_chimp_poller_class_bootstrap ()) {
+        return NULL;
+    }
+
+    CHIMP_MODULE_ADD_CLASS(net, "poller", chimp_net_poller_class);
+#endif
+
     return net;
 }
 
@@ -0,0 +1,1372 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "chimp/any.h"
+#include "chimp/object.h"
+#include "chimp/array.h"
+#include "chimp/str.h"
+#include "chimp/task.h"
+#include "chimp/hash.h"
+#include "chimp/error.h"
+
+/*
+ * A pool keeps a fixed set of worker tasks alive so that callers can farm
+ * out work without paying for a new thread, GC & VM per unit of work.
+ *
+ * Work is split into (at most) one chunk per worker. Each chunk is shipped
+ * to a worker as a message:
+ *
+ *   [action, sender, fn, index, chunk, tag]
+ *
+ * and the worker replies with [index, result], sent under the tag the
+ * caller picked for the call (see chimp_task_recv_tagged) so that replies
+ * can't be mixed up with anything else the caller receives. If fn fails,
+ * the worker replies with [index, nil, error] instead & carries on with
+ * the next request, so the caller gets an error rather than waiting forever
+ * on a dead worker. Since there's only ever one
+ * chunk in flight per worker, no worker can block on a full inbox while
+ * the caller is still dispatching.
+ *
+ * As with spawn, fn cannot be a closure: it must survive the trip through
+ * the message layer.
+ */
+
+typedef struct _ChimpTaskPool {
+    ChimpAny  base;
+    ChimpRef *workers;
+} ChimpTaskPool;
+
+/*
+ * A future wraps a task spawned by task.async. The task's return value is
+ * packed by the message layer when it finishes & unpacked (once) into the
+ * heap of the task holding the future. Futures only ever come out of
+ * task.async: the class isn't exported, since a future with no task behind
+ * it would have nothing to await.
+ */
+
+typedef struct _ChimpTaskFuture {
+    ChimpAny  base;
+    ChimpRef *task;
+    ChimpRef *value;
+} ChimpTaskFuture;
+
+/*
+ * A supervisor is a task that starts a set of children from specs like
+ * [fn, args...] and monitors them. A child that fails (i.e. whose exit
+ * reason isn't "normal") is restarted from its spec, unless more than
+ * `intensity` restarts happened within the last `period` milliseconds: then
+ * the supervisor gives up and exits with a failure of its own, which its
+ * own monitors & links get to hear about. Children that finish normally are
+ * not restarted, but the supervisor sticks around until it's stopped.
+ *
+ * The supervisor talks to its handle through messages:
+ *
+ *   ["which", sender, tag] -> replies (under tag) with the current children
+ *   ["stop"]            -> stops supervising (running children are left be)
+ */
+
+typedef struct _ChimpTaskSupervisor {
+    ChimpAny  base;
+    ChimpRef *task;
+} ChimpTaskSupervisor;
+
+#define CHIMP_TASK_SUPERVISOR_DEFAULT_INTENSITY 3
+#define CHIMP_TASK_SUPERVISOR_DEFAULT_PERIOD    5000
+
+static ChimpRef *chimp_task_pool_class = NULL;
+static ChimpRef *chimp_task_pool_worker = NULL;
+static ChimpRef *chimp_task_future_class = NULL;
+static ChimpRef *chimp_task_supervisor_class = NULL;
+static ChimpRef *chimp_task_supervisor_loop = NULL;
+
+#define CHIMP_TASK_POOL(ref) \
+    CHIMP_CHECK_CAST(ChimpTaskPool, (ref), chimp_task_pool_class)
+
+#define CHIMP_TASK_FUTURE(ref) \
+    CHIMP_CHECK_CAST(ChimpTaskFuture, (ref), chimp_task_future_class)
+
+#define CHIMP_TASK_FUTURE_PRIV(ref) \
+    CHIMP_TASK(CHIMP_TASK_FUTURE(ref)->task)->priv
+
+#define CHIMP_TASK_SUPERVISOR(ref) \
+    CHIMP_CHECK_CAST(ChimpTaskSupervisor, (ref), chimp_task_supervisor_class)
+
+static ChimpRef *
+_chimp_task_pool_worker_func (ChimpRef *self, ChimpRef *args)
+{
+    for (;;) {
+        size_t i;
+        ChimpRef *action;
+        ChimpRef *sender;
+        ChimpRef *fn;
+        ChimpRef *chunk;
+        ChimpRef *result;
+        ChimpRef *reply;
+        uint64_t tag;
+        ChimpRef *msg = chimp_task_recv (NULL);
+        if (msg == NULL) {
+            return NULL;
+        }
+
+        if (CHIMP_ANY_CLASS(msg) != chimp_array_class ||
+                CHIMP_ARRAY_SIZE(msg) == 0) {
+            CHIMP_BUG ("pool worker received unexpected message: %s",
+                CHIMP_STR_DATA(chimp_object_str (msg)));
+            return NULL;
+        }
+
+        action = CHIMP_ARRAY_ITEM(msg, 0);
+        if (strcmp (CHIMP_STR_DATA(action), "exit") == 0) {
+            break;
+        }
+
+        if (CHIMP_ARRAY_SIZE(msg) != 6) {
+            CHIMP_BUG ("pool worker received malformed %s request",
+                CHIMP_STR_DATA(action));
+            return NULL;
+        }
+        sender = CHIMP_ARRAY_ITEM(msg, 1);
+        fn = CHIMP_ARRAY_ITEM(msg, 2);
+        chunk = CHIMP_ARRAY_ITEM(msg, 4);
+        tag = (uint64_t) CHIMP_INT(CHIMP_ARRAY_ITEM(msg, 5))->value;
+
+        if (strcmp (CHIMP_STR_DATA(action), "map") == 0) {
+            result = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(chunk));
+            if (result == NULL) {
+                return NULL;
+            }
+            for (i = 0; i < CHIMP_ARRAY_SIZE(chunk); i++) {
+                ChimpRef *value = chimp_object_call (
+                    fn, chimp_array_new_var (CHIMP_ARRAY_ITEM(chunk, i), NULL));
+                if (value == NULL) {
+                    result = NULL;
+                    break;
+                }
+                if (!chimp_array_push (result, value)) {
+                    return NULL;
+                }
+            }
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "each") == 0) {
+            result = chimp_nil;
+            for (i = 0; i < CHIMP_ARRAY_SIZE(chunk); i++) {
+                ChimpRef *value = chimp_object_call (
+                    fn, chimp_array_new_var (CHIMP_ARRAY_ITEM(chunk, i), NULL));
+                if (value == NULL) {
+                    result = NULL;
+                    break;
+                }
+            }
+        }
+        else if (strcmp (CHIMP_STR_DATA(action), "reduce") == 0) {
+            result = CHIMP_ARRAY_ITEM(chunk, 0);
+            for (i = 1; i < CHIMP_ARRAY_SIZE(chunk); i++) {
+                result = chimp_object_call (
+                    fn, chimp_array_new_var (
+                        result, CHIMP_ARRAY_ITEM(chunk, i), NULL));
+                if (result == NULL) {
+                    break;
+                }
+            }
+        }
+        else {
+            CHIMP_BUG ("pool worker received unknown action: %s",
+                CHIMP_STR_DATA(action));
+            return NULL;
+        }
+
+        if (result != NULL) {
+            reply = chimp_array_new_var (CHIMP_ARRAY_ITEM(msg, 3), result, NULL);
+        }
+        else {
+            reply = chimp_array_new_var (
+                CHIMP_ARRAY_ITEM(msg, 3), chimp_nil,
+                chimp_error_new (chimp_str_new_format (
+                    "pool.%s: fn failed", CHIMP_STR_DATA(action))),
+                NULL);
+        }
+        if (reply == NULL || !chimp_task_send_tagged (sender, reply, tag)) {
+            return NULL;
+        }
+    }
+
+    return chimp_nil;
+}
+
+/* splits `array` across the pool's workers & gathers the results in order.
+ * if fn failed on any chunk, returns the error once every worker is done.
+ */
+static ChimpRef *
+chimp_task_pool_dispatch (
+    ChimpRef *self, const char *action, ChimpRef *fn, ChimpRef *array)
+{
+    size_t i;
+    size_t num_chunks;
+    size_t chunk_size;
+    ChimpRef *results;
+    ChimpRef *failure = NULL;
+    ChimpRef *workers = CHIMP_TASK_POOL(self)->workers;
+    ChimpRef *sender = chimp_task_get_self (chimp_task_current ());
+    const size_t size = CHIMP_ARRAY_SIZE(array);
+    const uint64_t tag = chimp_task_new_tag ();
+
+    if (CHIMP_ANY_CLASS(fn) == chimp_method_class &&
+            CHIMP_METHOD_TYPE(fn) == CHIMP_METHOD_TYPE_CLOSURE) {
+        CHIMP_BUG ("pool.%s cannot be used with a closure", action);
+        return NULL;
+    }
+
+    if (CHIMP_ARRAY_SIZE(workers) == 0) {
+        CHIMP_BUG ("pool.%s called on a closed pool", action);
+        return NULL;
+    }
+
+    chunk_size = (size + CHIMP_ARRAY_SIZE(workers) - 1) /
+                    CHIMP_ARRAY_SIZE(workers);
+    num_chunks = (chunk_size > 0) ? (size + chunk_size - 1) / chunk_size : 0;
+
+    for (i = 0; i < num_chunks; i++) {
+        size_t j;
+        const size_t end =
+            ((i + 1) * chunk_size < size) ? (i + 1) * chunk_size : size;
+        ChimpRef *msg;
+        ChimpRef *chunk = chimp_array_new_with_capacity (end - i * chunk_size);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        for (j = i * chunk_size; j < end; j++) {
+            if (!chimp_array_push (chunk, CHIMP_ARRAY_ITEM(array, j))) {
+                return NULL;
+            }
+        }
+        msg = chimp_array_new_var (
+            chimp_str_new (action, strlen (action)),
+            sender, fn, chimp_int_new (i), chunk,
+            chimp_int_new ((int64_t) tag), NULL);
+        if (msg == NULL) {
+            return NULL;
+        }
+        if (!chimp_task_send (CHIMP_ARRAY_ITEM(workers, i), msg)) {
+            CHIMP_BUG ("pool.%s failed to dispatch chunk %zu", action, i);
+            return NULL;
+        }
+    }
+
+    results = chimp_array_new_with_capacity (num_chunks);
+    if (results == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < num_chunks; i++) {
+        if (!chimp_array_push (results, chimp_nil)) {
+            return NULL;
+        }
+    }
+    for (i = 0; i < num_chunks; i++) {
+        ChimpRef *reply = chimp_task_recv_tagged (NULL, tag);
+        if (reply == NULL) {
+            return NULL;
+        }
+        if (CHIMP_ANY_CLASS(reply) != chimp_array_class ||
+                CHIMP_ARRAY_SIZE(reply) < 2 || CHIMP_ARRAY_SIZE(reply) > 3 ||
+                CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(reply, 0)) != chimp_int_class) {
+            CHIMP_BUG ("pool.%s received unexpected reply: %s",
+                action, CHIMP_STR_DATA(chimp_object_str (reply)));
+            return NULL;
+        }
+        /* keep going: the other replies mustn't be left in our inbox */
+        if (CHIMP_ARRAY_SIZE(reply) == 3 && failure == NULL) {
+            failure = CHIMP_ARRAY_ITEM(reply, 2);
+        }
+        CHIMP_ARRAY(results)->items[CHIMP_INT(CHIMP_ARRAY_ITEM(reply, 0))->value] =
+            CHIMP_ARRAY_ITEM(reply, 1);
+    }
+    return failure != NULL ? failure : results;
+}
+
+static ChimpRef *
+_chimp_task_pool_map (ChimpRef *self, ChimpRef *args)
+{
+    size_t i, j;
+    ChimpRef *fn;
+    ChimpRef *array;
+    ChimpRef *chunks;
+    ChimpRef *result;
+
+    if (!chimp_method_parse_args (args, "oo", &fn, &array)) {
+        return NULL;
+    }
+
+    chunks = chimp_task_pool_dispatch (self, "map", fn, array);
+    if (chunks == NULL || CHIMP_ANY_CLASS(chunks) == chimp_error_class) {
+        return chunks;
+    }
+
+    result = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(array));
+    if (result == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(chunks); i++) {
+        ChimpRef *chunk = CHIMP_ARRAY_ITEM(chunks, i);
+        for (j = 0; j < CHIMP_ARRAY_SIZE(chunk); j++) {
+            if (!chimp_array_push (result, CHIMP_ARRAY_ITEM(chunk, j))) {
+                return NULL;
+            }
+        }
+    }
+    return result;
+}
+
+static ChimpRef *
+_chimp_task_pool_each (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *fn;
+    ChimpRef *array;
+    ChimpRef *result;
+
+    if (!chimp_method_parse_args (args, "oo", &fn, &array)) {
+        return NULL;
+    }
+
+    result = chimp_task_pool_dispatch (self, "each", fn, array);
+    if (result == NULL || CHIMP_ANY_CLASS(result) == chimp_error_class) {
+        return result;
+    }
+    return chimp_nil;
+}
+
+/* fn must be associative: chunks are folded in parallel, then the partial
+ * results are folded (in order) by the calling task.
+ */
+static ChimpRef *
+_chimp_task_pool_reduce (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *fn;
+    ChimpRef *array;
+    ChimpRef *partials;
+    ChimpRef *result = NULL;
+
+    if (!chimp_method_parse_args (args, "oo|o", &fn, &array, &result)) {
+        return NULL;
+    }
+
+    partials = chimp_task_pool_dispatch (self, "reduce", fn, array);
+    if (partials == NULL || CHIMP_ANY_CLASS(partials) == chimp_error_class) {
+        return partials;
+    }
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(partials); i++) {
+        if (result == NULL) {
+            result = CHIMP_ARRAY_ITEM(partials, i);
+            continue;
+        }
+        result = chimp_object_call (
+            fn, chimp_array_new_var (
+                result, CHIMP_ARRAY_ITEM(partials, i), NULL));
+        if (result == NULL) {
+            return NULL;
+        }
+    }
+    return result != NULL ? result : chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_pool_close (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *workers = CHIMP_TASK_POOL(self)->workers;
+
+    for (i = 0; i < CHIMP_ARRAY_SIZE(workers); i++) {
+        ChimpRef *worker = CHIMP_ARRAY_ITEM(workers, i);
+        if (!chimp_task_send (
+                worker, chimp_array_new_var (CHIMP_STR_NEW("exit"), NULL))) {
+            continue;
+        }
+        chimp_task_join (CHIMP_TASK(worker)->priv);
+    }
+    CHIMP_ARRAY(workers)->size = 0;
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_pool_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp ("size", CHIMP_STR_DATA(attr)) == 0) {
+        return chimp_int_new (CHIMP_ARRAY_SIZE(CHIMP_TASK_POOL(self)->workers));
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static ChimpRef *
+_chimp_task_pool_init (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    int64_t size = 0;
+    ChimpRef *workers;
+
+    if (!chimp_method_parse_args (args, "|I", &size)) {
+        return NULL;
+    }
+
+    if (size <= 0) {
+        size = sysconf (_SC_NPROCESSORS_ONLN);
+        if (size <= 0) {
+            size = 1;
+        }
+    }
+
+    workers = chimp_array_new_with_capacity ((size_t) size);
+    if (workers == NULL) {
+        return NULL;
+    }
+    CHIMP_TASK_POOL(self)->workers = workers;
+
+    for (i = 0; i < (size_t) size; i++) {
+        ChimpRef *worker = chimp_task_new (chimp_task_pool_worker);
+        if (worker == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (workers, worker)) {
+            return NULL;
+        }
+        /* send args */
+        if (!chimp_task_send (worker, chimp_array_new ())) {
+            return NULL;
+        }
+    }
+    return self;
+}
+
+static void
+_chimp_task_pool_mark (ChimpGC *gc, ChimpRef *self)
+{
+    CHIMP_SUPER(self)->mark (gc, self);
+
+    chimp_gc_mark_ref (gc, CHIMP_TASK_POOL(self)->workers);
+}
+
+static chimp_bool_t
+_chimp_task_pool_class_bootstrap (void)
+{
+    if (chimp_task_pool_class == NULL) {
+        chimp_task_pool_class = chimp_class_new (
+            CHIMP_STR_NEW("task.pool"), NULL, sizeof(ChimpTaskPool));
+        if (chimp_task_pool_class == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_task_pool_class);
+
+        CHIMP_CLASS(chimp_task_pool_class)->init = _chimp_task_pool_init;
+        CHIMP_CLASS(chimp_task_pool_class)->mark = _chimp_task_pool_mark;
+        CHIMP_CLASS(chimp_task_pool_class)->getattr = _chimp_task_pool_getattr;
+
+        if (!chimp_class_add_native_method (
+                chimp_task_pool_class, "map", _chimp_task_pool_map)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_method (
+                chimp_task_pool_class, "each", _chimp_task_pool_each)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_method (
+                chimp_task_pool_class, "reduce", _chimp_task_pool_reduce)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_method (
+                chimp_task_pool_class, "close", _chimp_task_pool_close)) {
+            return CHIMP_FALSE;
+        }
+
+        chimp_task_pool_worker =
+            chimp_method_new_native (NULL, _chimp_task_pool_worker_func);
+        if (chimp_task_pool_worker == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_task_pool_worker);
+    }
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+chimp_task_future_value (ChimpRef *self)
+{
+    if (CHIMP_TASK_FUTURE(self)->value == NULL) {
+        CHIMP_TASK_FUTURE(self)->value =
+            chimp_task_take_result (CHIMP_TASK_FUTURE_PRIV(self));
+    }
+    return CHIMP_TASK_FUTURE(self)->value;
+}
+
+static ChimpRef *
+_chimp_task_future_await (ChimpRef *self, ChimpRef *args)
+{
+    int64_t timeout = -1;
+
+    if (!chimp_method_parse_args (args, "|I", &timeout)) {
+        return NULL;
+    }
+
+    if (!chimp_task_wait (CHIMP_TASK_FUTURE_PRIV(self), timeout)) {
+        return chimp_nil;
+    }
+    return chimp_task_future_value (self);
+}
+
+static ChimpRef *
+_chimp_task_future_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp ("done", CHIMP_STR_DATA(attr)) == 0) {
+        return chimp_task_wait (CHIMP_TASK_FUTURE_PRIV(self), 0) ?
+                    chimp_true : chimp_false;
+    }
+    else if (strcmp ("task", CHIMP_STR_DATA(attr)) == 0) {
+        return CHIMP_TASK_FUTURE(self)->task;
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static void
+_chimp_task_future_mark (ChimpGC *gc, ChimpRef *self)
+{
+    CHIMP_SUPER(self)->mark (gc, self);
+
+    chimp_gc_mark_ref (gc, CHIMP_TASK_FUTURE(self)->task);
+    chimp_gc_mark_ref (gc, CHIMP_TASK_FUTURE(self)->value);
+}
+
+static chimp_bool_t
+_chimp_task_future_class_bootstrap (void)
+{
+    if (chimp_task_future_class == NULL) {
+        chimp_task_future_class = chimp_class_new (
+            CHIMP_STR_NEW("task.future"), NULL, sizeof(ChimpTaskFuture));
+        if (chimp_task_future_class == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_task_future_class);
+
+        CHIMP_CLASS(chimp_task_future_class)->mark = _chimp_task_future_mark;
+        CHIMP_CLASS(chimp_task_future_class)->getattr =
+            _chimp_task_future_getattr;
+
+        if (!chimp_class_add_native_method (
+                chimp_task_future_class, "await", _chimp_task_future_await)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+/* collects the tasks behind an array of futures for chimp_task_wait_* */
+static ChimpTaskInternal **
+chimp_task_futures_to_tasks (ChimpRef *futures)
+{
+    size_t i;
+    ChimpTaskInternal **tasks;
+
+    if (CHIMP_ANY_CLASS(futures) != chimp_array_class) {
+        CHIMP_BUG ("expected an array of futures");
+        return NULL;
+    }
+
+    tasks = CHIMP_MALLOC(ChimpTaskInternal *,
+                sizeof(*tasks) * (CHIMP_ARRAY_SIZE(futures) + 1));
+    if (tasks == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(futures); i++) {
+        ChimpRef *future = CHIMP_ARRAY_ITEM(futures, i);
+        if (CHIMP_ANY_CLASS(future) != chimp_task_future_class ||
+                CHIMP_TASK_FUTURE(future)->task == NULL) {
+            CHIMP_BUG ("expected an array of futures from task.async");
+            CHIMP_FREE (tasks);
+            return NULL;
+        }
+        tasks[i] = CHIMP_TASK_FUTURE_PRIV(future);
+    }
+    return tasks;
+}
+
+static ChimpRef *
+_chimp_task_async (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *fn;
+    ChimpRef *fn_args;
+    ChimpRef *task;
+    ChimpRef *future;
+
+    if (CHIMP_ARRAY_SIZE(args) < 1) {
+        CHIMP_BUG ("task.async requires at least one argument");
+        return NULL;
+    }
+
+    fn = CHIMP_ARRAY_ITEM(args, 0);
+    if (CHIMP_ANY_CLASS(fn) != chimp_method_class) {
+        CHIMP_BUG ("task.async requires a method");
+        return NULL;
+    }
+    if (CHIMP_METHOD_TYPE(fn) == CHIMP_METHOD_TYPE_CLOSURE) {
+        CHIMP_BUG ("task.async cannot be used with a closure");
+        return NULL;
+    }
+
+    fn_args = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(args) - 1);
+    if (fn_args == NULL) {
+        return NULL;
+    }
+    for (i = 1; i < CHIMP_ARRAY_SIZE(args); i++) {
+        if (!chimp_array_push (fn_args, CHIMP_ARRAY_ITEM(args, i))) {
+            return NULL;
+        }
+    }
+
+    task = chimp_task_new (fn);
+    if (task == NULL) {
+        return NULL;
+    }
+
+    /* the task can't finish before it gets its args, so this isn't racy */
+    chimp_task_keep_result (CHIMP_TASK(task)->priv);
+
+    future = chimp_class_new_instance (chimp_task_future_class, NULL);
+    if (future == NULL) {
+        return NULL;
+    }
+    CHIMP_TASK_FUTURE(future)->task = task;
+
+    if (!chimp_task_send (task, fn_args)) {
+        return NULL;
+    }
+    return future;
+}
+
+/* reads an option like "stack" from the options hash. returns NULL if the
+ * option is not present.
+ */
+static ChimpRef *
+chimp_task_get_option (ChimpRef *opts, const char *name)
+{
+    ChimpRef *value;
+    int rc = chimp_hash_get (
+        opts, chimp_str_new (name, strlen (name)), &value);
+    if (rc != 0) {
+        return NULL;
+    }
+    return value;
+}
+
+/* accepts plain byte counts as well as strings like "256k" or "8m" */
+static chimp_bool_t
+chimp_task_parse_size (ChimpRef *value, size_t *size)
+{
+    if (CHIMP_ANY_CLASS(value) == chimp_int_class) {
+        if (CHIMP_INT(value)->value < 0) {
+            return CHIMP_FALSE;
+        }
+        *size = (size_t) CHIMP_INT(value)->value;
+        return CHIMP_TRUE;
+    }
+    else if (CHIMP_ANY_CLASS(value) == chimp_str_class) {
+        char *end;
+        unsigned long long n;
+        unsigned long long scale = 1;
+
+        /* strtoull would happily negate "-1" into a huge size */
+        if (!isdigit ((unsigned char) CHIMP_STR_DATA(value)[0])) {
+            return CHIMP_FALSE;
+        }
+        n = strtoull (CHIMP_STR_DATA(value), &end, 10);
+        switch (*end) {
+            case 'k': case 'K':
+                scale = 1024;
+                end++;
+                break;
+            case 'm': case 'M':
+                scale = 1024 * 1024;
+                end++;
+                break;
+            default:
+                break;
+        }
+        if (*end != '\0' || n > SIZE_MAX / scale) {
+            return CHIMP_FALSE;
+        }
+        n *= scale;
+        *size = (size_t) n;
+        return CHIMP_TRUE;
+    }
+    return CHIMP_FALSE;
+}
+
+static chimp_bool_t
+chimp_task_parse_options (ChimpRef *opts, ChimpTaskOptions *options)
+{
+    ChimpRef *value;
+
+    if (CHIMP_ANY_CLASS(opts) != chimp_hash_class) {
+        CHIMP_BUG ("task options must be a hash");
+        return CHIMP_FALSE;
+    }
+
+    if ((value = chimp_task_get_option (opts, "cpu")) != NULL) {
+        if (CHIMP_ANY_CLASS(value) != chimp_int_class) {
+            CHIMP_BUG ("task option 'cpu' must be an int");
+            return CHIMP_FALSE;
+        }
+        options->cpu = (int) CHIMP_INT(value)->value;
+    }
+
+    if ((value = chimp_task_get_option (opts, "node")) != NULL) {
+        if (CHIMP_ANY_CLASS(value) != chimp_int_class) {
+            CHIMP_BUG ("task option 'node' must be an int");
+            return CHIMP_FALSE;
+        }
+        options->node = (int) CHIMP_INT(value)->value;
+    }
+
+    if ((value = chimp_task_get_option (opts, "stack")) != NULL) {
+        if (!chimp_task_parse_size (value, &options->stack_size)) {
+            CHIMP_BUG ("bad value for task option 'stack': %s",
+                CHIMP_STR_DATA(chimp_object_str (value)));
+            return CHIMP_FALSE;
+        }
+    }
+
+    if ((value = chimp_task_get_option (opts, "priority")) != NULL) {
+        const char *priority;
+        if (CHIMP_ANY_CLASS(value) != chimp_str_class) {
+            CHIMP_BUG ("task option 'priority' must be a str");
+            return CHIMP_FALSE;
+        }
+        priority = CHIMP_STR_DATA(value);
+        if (strcmp (priority, "low") == 0) {
+            options->priority = CHIMP_TASK_PRIORITY_LOW;
+        }
+        else if (strcmp (priority, "normal") == 0) {
+            options->priority = CHIMP_TASK_PRIORITY_NORMAL;
+        }
+        else if (strcmp (priority, "high") == 0) {
+            options->priority = CHIMP_TASK_PRIORITY_HIGH;
+        }
+        else {
+            CHIMP_BUG ("unknown task priority: %s", priority);
+            return CHIMP_FALSE;
+        }
+    }
+
+    return CHIMP_TRUE;
+}
+
+/* task.start(fn, opts, args...) is `spawn fn(args...)` with options */
+static ChimpRef *
+_chimp_task_start (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *fn;
+    ChimpRef *fn_args;
+    ChimpRef *task;
+    ChimpTaskOptions options = CHIMP_TASK_OPTIONS_INIT;
+
+    if (CHIMP_ARRAY_SIZE(args) < 2) {
+        CHIMP_BUG ("task.start requires a method and an options hash");
+        return NULL;
+    }
+
+    fn = CHIMP_ARRAY_ITEM(args, 0);
+    if (CHIMP_ANY_CLASS(fn) != chimp_method_class) {
+        CHIMP_BUG ("task.start requires a method");
+        return NULL;
+    }
+    if (CHIMP_METHOD_TYPE(fn) == CHIMP_METHOD_TYPE_CLOSURE) {
+        CHIMP_BUG ("task.start cannot be used with a closure");
+        return NULL;
+    }
+
+    if (!chimp_task_parse_options (CHIMP_ARRAY_ITEM(args, 1), &options)) {
+        return NULL;
+    }
+
+    fn_args = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(args) - 2);
+    if (fn_args == NULL) {
+        return NULL;
+    }
+    for (i = 2; i < CHIMP_ARRAY_SIZE(args); i++) {
+        if (!chimp_array_push (fn_args, CHIMP_ARRAY_ITEM(args, i))) {
+            return NULL;
+        }
+    }
+
+    task = chimp_task_new_with_options (fn, &options);
+    if (task == NULL) {
+        return NULL;
+    }
+    if (!chimp_task_send (task, fn_args)) {
+        return NULL;
+    }
+    return task;
+}
+
+static int64_t
+chimp_task_now_ms (void)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (int64_t) now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/* starts (or restarts) a supervised child from a spec like [fn, args...] */
+static ChimpRef *
+chimp_task_supervisor_start_child (ChimpRef *spec)
+{
+    size_t i;
+    ChimpRef *child;
+    ChimpRef *fn_args;
+
+    fn_args = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(spec) - 1);
+    if (fn_args == NULL) {
+        return NULL;
+    }
+    for (i = 1; i < CHIMP_ARRAY_SIZE(spec); i++) {
+        if (!chimp_array_push (fn_args, CHIMP_ARRAY_ITEM(spec, i))) {
+            return NULL;
+        }
+    }
+
+    child = chimp_task_new (CHIMP_ARRAY_ITEM(spec, 0));
+    if (child == NULL) {
+        return NULL;
+    }
+    /* watch before sending args: the child can't exit until it has them */
+    if (!chimp_task_monitor (chimp_task_current (), CHIMP_TASK(child)->priv)) {
+        return NULL;
+    }
+    if (!chimp_task_send (child, fn_args)) {
+        return NULL;
+    }
+    return child;
+}
+
+static ChimpRef *
+_chimp_task_supervisor_loop_func (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *specs;
+    ChimpRef *children;
+    ChimpRef *restarts;
+    int64_t intensity;
+    int64_t period;
+
+    if (!chimp_method_parse_args (args, "oII", &specs, &intensity, &period)) {
+        return NULL;
+    }
+
+    children = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(specs));
+    if (children == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(specs); i++) {
+        ChimpRef *child =
+            chimp_task_supervisor_start_child (CHIMP_ARRAY_ITEM(specs, i));
+        if (child == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (children, child)) {
+            return NULL;
+        }
+    }
+    /* start times (in ms) of recent restarts */
+    restarts = chimp_array_new ();
+    if (restarts == NULL) {
+        return NULL;
+    }
+
+    for (;;) {
+        size_t slot;
+        ChimpRef *tag;
+        ChimpRef *child;
+        ChimpRef *reason;
+        ChimpRef *recent;
+        int64_t now;
+        ChimpRef *msg = chimp_task_recv (NULL);
+        if (msg == NULL) {
+            return NULL;
+        }
+
+        if (CHIMP_ANY_CLASS(msg) != chimp_array_class ||
+                CHIMP_ARRAY_SIZE(msg) == 0 ||
+                CHIMP_ANY_CLASS(CHIMP_ARRAY_ITEM(msg, 0)) != chimp_str_class) {
+            CHIMP_BUG ("supervisor received unexpected message: %s",
+                CHIMP_STR_DATA(chimp_object_str (msg)));
+            return NULL;
+        }
+
+        tag = CHIMP_ARRAY_ITEM(msg, 0);
+        if (strcmp (CHIMP_STR_DATA(tag), "stop") == 0) {
+            break;
+        }
+        else if (strcmp (CHIMP_STR_DATA(tag), "which") == 0) {
+            if (CHIMP_ARRAY_SIZE(msg) != 3) {
+                CHIMP_BUG ("supervisor received malformed which request");
+                return NULL;
+            }
+            chimp_task_send_tagged (CHIMP_ARRAY_ITEM(msg, 1), children,
+                (uint64_t) CHIMP_INT(CHIMP_ARRAY_ITEM(msg, 2))->value);
+            continue;
+        }
+        else if (strcmp (CHIMP_STR_DATA(tag), "down") != 0 ||
+                    CHIMP_ARRAY_SIZE(msg) != 3) {
+            CHIMP_BUG ("supervisor received unexpected message: %s",
+                CHIMP_STR_DATA(chimp_object_str (msg)));
+            return NULL;
+        }
+
+        child = CHIMP_ARRAY_ITEM(msg, 1);
+        reason = CHIMP_ARRAY_ITEM(msg, 2);
+        for (slot = 0; slot < CHIMP_ARRAY_SIZE(children); slot++) {
+            if (chimp_object_cmp (
+                    CHIMP_ARRAY_ITEM(children, slot), child) == CHIMP_CMP_EQ) {
+                break;
+            }
+        }
+        if (slot == CHIMP_ARRAY_SIZE(children)) {
+            continue;
+        }
+
+        if (strcmp (CHIMP_STR_DATA(reason), "normal") == 0) {
+            CHIMP_ARRAY(children)->items[slot] = chimp_nil;
+            continue;
+        }
+
+        /* forget restarts that fell out of the window */
+        now = chimp_task_now_ms ();
+        recent = chimp_array_new ();
+        if (recent == NULL) {
+            return NULL;
+        }
+        for (i = 0; i < CHIMP_ARRAY_SIZE(restarts); i++) {
+            ChimpRef *when = CHIMP_ARRAY_ITEM(restarts, i);
+            if (now - CHIMP_INT(when)->value < period) {
+                if (!chimp_array_push (recent, when)) {
+                    return NULL;
+                }
+            }
+        }
+        restarts = recent;
+        if ((int64_t) CHIMP_ARRAY_SIZE(restarts) >= intensity) {
+            return chimp_error_new (CHIMP_STR_NEW("restart intensity exceeded"));
+        }
+        if (!chimp_array_push (restarts, chimp_int_new (now))) {
+            return NULL;
+        }
+
+        child = chimp_task_supervisor_start_child (CHIMP_ARRAY_ITEM(specs, slot));
+        if (child == NULL) {
+            return NULL;
+        }
+        CHIMP_ARRAY(children)->items[slot] = child;
+    }
+
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_supervisor_init (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    ChimpRef *specs;
+    ChimpRef *opts = NULL;
+    ChimpRef *value;
+    ChimpRef *task;
+    int64_t intensity = CHIMP_TASK_SUPERVISOR_DEFAULT_INTENSITY;
+    int64_t period = CHIMP_TASK_SUPERVISOR_DEFAULT_PERIOD;
+
+    if (!chimp_method_parse_args (args, "o|o", &specs, &opts)) {
+        return NULL;
+    }
+
+    if (CHIMP_ANY_CLASS(specs) != chimp_array_class) {
+        CHIMP_BUG ("task.supervisor expects an array of child specs");
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(specs); i++) {
+        ChimpRef *spec = CHIMP_ARRAY_ITEM(specs, i);
+        ChimpRef *fn;
+        if (CHIMP_ANY_CLASS(spec) != chimp_array_class ||
+                CHIMP_ARRAY_SIZE(spec) == 0) {
+            CHIMP_BUG ("child spec must look like [fn, args...]");
+            return NULL;
+        }
+        fn = CHIMP_ARRAY_ITEM(spec, 0);
+        if (CHIMP_ANY_CLASS(fn) != chimp_method_class ||
+                CHIMP_METHOD_TYPE(fn) == CHIMP_METHOD_TYPE_CLOSURE) {
+            CHIMP_BUG ("child spec must start with a method (not a closure)");
+            return NULL;
+        }
+    }
+
+    if (opts != NULL) {
+        if (CHIMP_ANY_CLASS(opts) != chimp_hash_class) {
+            CHIMP_BUG ("supervisor options must be a hash");
+            return NULL;
+        }
+        if ((value = chimp_task_get_option (opts, "intensity")) != NULL) {
+            if (CHIMP_ANY_CLASS(value) != chimp_int_class) {
+                CHIMP_BUG ("supervisor option 'intensity' must be an int");
+                return NULL;
+            }
+            intensity = CHIMP_INT(value)->value;
+        }
+        if ((value = chimp_task_get_option (opts, "period")) != NULL) {
+            if (CHIMP_ANY_CLASS(value) != chimp_int_class) {
+                CHIMP_BUG ("supervisor option 'period' must be an int");
+                return NULL;
+            }
+            period = CHIMP_INT(value)->value;
+        }
+    }
+
+    task = chimp_task_new (chimp_task_supervisor_loop);
+    if (task == NULL) {
+        return NULL;
+    }
+    CHIMP_TASK_SUPERVISOR(self)->task = task;
+    if (!chimp_task_send (task, chimp_array_new_var (
+            specs, chimp_int_new (intensity), chimp_int_new (period), NULL))) {
+        return NULL;
+    }
+    return self;
+}
+
+static ChimpRef *
+_chimp_task_supervisor_children (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *request;
+    const uint64_t tag = chimp_task_new_tag ();
+
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+
+    request = chimp_array_new_var (
+        CHIMP_STR_NEW("which"),
+        chimp_task_get_self (chimp_task_current ()),
+        chimp_int_new ((int64_t) tag), NULL);
+    if (request == NULL) {
+        return NULL;
+    }
+    /* the supervisor is gone: it has no children to speak of */
+    if (!chimp_task_send (CHIMP_TASK_SUPERVISOR(self)->task, request)) {
+        return chimp_array_new ();
+    }
+    return chimp_task_recv_tagged (NULL, tag);
+}
+
+static ChimpRef *
+_chimp_task_supervisor_stop (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *task = CHIMP_TASK_SUPERVISOR(self)->task;
+
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+
+    if (chimp_task_send (task, chimp_array_new_var (CHIMP_STR_NEW("stop"), NULL))) {
+        chimp_task_join (CHIMP_TASK(task)->priv);
+    }
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_supervisor_getattr (ChimpRef *self, ChimpRef *attr)
+{
+    if (strcmp ("task", CHIMP_STR_DATA(attr)) == 0) {
+        return CHIMP_TASK_SUPERVISOR(self)->task;
+    }
+    else {
+        ChimpRef *super = CHIMP_CLASS_SUPER(CHIMP_ANY_CLASS(self));
+        return CHIMP_CLASS(super)->getattr (self, attr);
+    }
+}
+
+static void
+_chimp_task_supervisor_mark (ChimpGC *gc, ChimpRef *self)
+{
+    CHIMP_SUPER(self)->mark (gc, self);
+
+    chimp_gc_mark_ref (gc, CHIMP_TASK_SUPERVISOR(self)->task);
+}
+
+static chimp_bool_t
+_chimp_task_supervisor_class_bootstrap (void)
+{
+    if (chimp_task_supervisor_class == NULL) {
+        chimp_task_supervisor_class = chimp_class_new (
+            CHIMP_STR_NEW("task.supervisor"), NULL, sizeof(ChimpTaskSupervisor));
+        if (chimp_task_supervisor_class == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_task_supervisor_class);
+
+        CHIMP_CLASS(chimp_task_supervisor_class)->init =
+            _chimp_task_supervisor_init;
+        CHIMP_CLASS(chimp_task_supervisor_class)->mark =
+            _chimp_task_supervisor_mark;
+        CHIMP_CLASS(chimp_task_supervisor_class)->getattr =
+            _chimp_task_supervisor_getattr;
+
+        if (!chimp_class_add_native_method (chimp_task_supervisor_class,
+                "children", _chimp_task_supervisor_children)) {
+            return CHIMP_FALSE;
+        }
+
+        if (!chimp_class_add_native_method (
+                chimp_task_supervisor_class, "stop", _chimp_task_supervisor_stop)) {
+            return CHIMP_FALSE;
+        }
+
+        chimp_task_supervisor_loop =
+            chimp_method_new_native (NULL, _chimp_task_supervisor_loop_func);
+        if (chimp_task_supervisor_loop == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_gc_make_root (NULL, chimp_task_supervisor_loop);
+    }
+    return CHIMP_TRUE;
+}
+
+static ChimpRef *
+_chimp_task_link (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *other;
+
+    if (!chimp_method_parse_args (args, "o", &other)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(other) != chimp_task_class) {
+        CHIMP_BUG ("task.link expects a task");
+        return NULL;
+    }
+
+    if (!chimp_task_link (chimp_task_current (), CHIMP_TASK(other)->priv)) {
+        return NULL;
+    }
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_monitor (ChimpRef *self, ChimpRef *args)
+{
+    ChimpRef *other;
+
+    if (!chimp_method_parse_args (args, "o", &other)) {
+        return NULL;
+    }
+    if (CHIMP_ANY_CLASS(other) != chimp_task_class) {
+        CHIMP_BUG ("task.monitor expects a task");
+        return NULL;
+    }
+
+    if (!chimp_task_monitor (chimp_task_current (), CHIMP_TASK(other)->priv)) {
+        return NULL;
+    }
+    return chimp_nil;
+}
+
+static ChimpRef *
+_chimp_task_await_any (ChimpRef *self, ChimpRef *args)
+{
+    ssize_t index;
+    ChimpRef *futures;
+    ChimpTaskInternal **tasks;
+    int64_t timeout = -1;
+
+    if (!chimp_method_parse_args (args, "o|I", &futures, &timeout)) {
+        return NULL;
+    }
+
+    tasks = chimp_task_futures_to_tasks (futures);
+    if (tasks == NULL) {
+        return NULL;
+    }
+    /* nothing could ever finish: don't wait around for it */
+    if (CHIMP_ARRAY_SIZE(futures) == 0) {
+        CHIMP_FREE (tasks);
+        return chimp_nil;
+    }
+    index = chimp_task_wait_any (tasks, CHIMP_ARRAY_SIZE(futures), timeout);
+    CHIMP_FREE (tasks);
+
+    if (index < 0) {
+        return chimp_nil;
+    }
+    return CHIMP_ARRAY_ITEM(futures, index);
+}
+
+static ChimpRef *
+_chimp_task_await_all (ChimpRef *self, ChimpRef *args)
+{
+    size_t i;
+    chimp_bool_t done;
+    ChimpRef *futures;
+    ChimpRef *result;
+    ChimpTaskInternal **tasks;
+    int64_t timeout = -1;
+
+    if (!chimp_method_parse_args (args, "o|I", &futures, &timeout)) {
+        return NULL;
+    }
+
+    tasks = chimp_task_futures_to_tasks (futures);
+    if (tasks == NULL) {
+        return NULL;
+    }
+    done = chimp_task_wait_all (tasks, CHIMP_ARRAY_SIZE(futures), timeout);
+    CHIMP_FREE (tasks);
+
+    if (!done) {
+        return chimp_nil;
+    }
+
+    result = chimp_array_new_with_capacity (CHIMP_ARRAY_SIZE(futures));
+    if (result == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < CHIMP_ARRAY_SIZE(futures); i++) {
+        ChimpRef *value = chimp_task_future_value (CHIMP_ARRAY_ITEM(futures, i));
+        if (value == NULL) {
+            return NULL;
+        }
+        if (!chimp_array_push (result, value)) {
+            return NULL;
+        }
+    }
+    return result;
+}
+
+static ChimpRef *
+_chimp_task_stats (ChimpRef *self, ChimpRef *args)
+{
+    ChimpTaskStats stats;
+    ChimpRef *result;
+
+    if (!chimp_method_no_args (args)) {
+        return NULL;
+    }
+
+    chimp_task_get_stats (&stats);
+
+    result = chimp_hash_new ();
+    if (result == NULL) {
+        return NULL;
+    }
+    if (!chimp_hash_put_str (result, "spawned", chimp_int_new (stats.spawned))) {
+        return NULL;
+    }
+    if (!chimp_hash_put_str (result, "recycled", chimp_int_new (stats.recycled))) {
+        return NULL;
+    }
+    if (!chimp_hash_put_str (
+            result, "total_latency_ns", chimp_int_new (stats.total_latency_ns))) {
+        return NULL;
+    }
+    if (!chimp_hash_put_str (
+            result, "max_latency_ns", chimp_int_new (stats.max_latency_ns))) {
+        return NULL;
+    }
+    return result;
+}
+
+ChimpRef *
+chimp_init_task_module (void)
+{
+    ChimpRef *task;
+
+    task = chimp_module_new_str ("task", NULL);
+    if (task == NULL) {
+        return NULL;
+    }
+
+    if (!_chimp_task_pool_class_bootstrap ()) {
+        return NULL;
+    }
+
+    if (!_chimp_task_future_class_bootstrap ()) {
+        return NULL;
+    }
+
+    if (!_chimp_task_supervisor_class_bootstrap ()) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_local_str (task, "pool", chimp_task_pool_class)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_local_str (
+            task, "supervisor", chimp_task_supervisor_class)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (task, "start", _chimp_task_start)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (task, "async", _chimp_task_async)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (
+            task, "await_any", _chimp_task_await_any)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (
+            task, "await_all", _chimp_task_await_all)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (task, "link", _chimp_task_link)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (task, "monitor", _chimp_task_monitor)) {
+        return NULL;
+    }
+
+    if (!chimp_module_add_method_str (task, "stats", _chimp_task_stats)) {
+        return NULL;
+    }
+
+    return task;
+}
@@ -23,13 +23,19 @@
 #include "chimp/object.h"
 #include "chimp/array.h"
 #include "chimp/task.h"
+#include "chimp/float.h"
+#include "chimp/error.h"
 
 #define chimp_msg_int_cell_size(ref) sizeof(ChimpMsgCell)
+#define chimp_msg_float_cell_size(ref) sizeof(ChimpMsgCell)
 #define chimp_msg_nil_cell_size(ref) sizeof(ChimpMsgCell)
 #define chimp_msg_method_cell_size(ref) sizeof(ChimpMsgCell)
 #define chimp_msg_module_cell_size(ref) sizeof(ChimpMsgCell)
 #define chimp_msg_str_cell_size(ref) \
     (sizeof(ChimpMsgCell) + CHIMP_STR_SIZE(ref) + 1)
+/* errors travel as their message: backtraces & causes stay behind */
+#define chimp_msg_error_cell_size(ref) \
+    chimp_msg_str_cell_size(CHIMP_ERROR_MESSAGE(ref))
 
 static chimp_bool_t
 chimp_msg_value_cell_encode (char **buf_ptr, ChimpRef *ref);
@@ -65,6 +71,9 @@ chimp_msg_value_cell_size (ChimpRef *ref)
     if (klass == chimp_int_class) {
         return chimp_msg_int_cell_size(ref);
     }
+    else if (klass == chimp_float_class) {
+        return chimp_msg_float_cell_size(ref);
+    }
     else if (klass == chimp_str_class) {
         return chimp_msg_str_cell_size(ref);
     }
@@ -83,6 +92,9 @@ chimp_msg_value_cell_size (ChimpRef *ref)
     else if (klass == chimp_task_class) {
         return chimp_msg_task_cell_size (ref);
     }
+    else if (klass == chimp_error_class) {
+        return chimp_msg_error_cell_size (ref);
+    }
     else {
         CHIMP_BUG ("unsupported message type in array encode: %s",
                 CHIMP_STR_DATA(CHIMP_CLASS_NAME(CHIMP_ANY_CLASS(ref))));
@@ -96,6 +108,7 @@ chimp_msg_nil_cell_encode (char **buf_ptr, ChimpRef *ref)
     char *buf = *buf_ptr;
     ChimpMsgCell *cell = (ChimpMsgCell *)buf;
     cell->type = CHIMP_MSG_CELL_NIL;
+    buf += chimp_msg_nil_cell_size (ref);
     *buf_ptr = buf;
     return CHIMP_TRUE;
 }
@@ -112,6 +125,18 @@ chimp_msg_int_cell_encode (char **buf_ptr, ChimpRef *ref)
     return CHIMP_TRUE;
 }
 
+static chimp_bool_t
+chimp_msg_float_cell_encode (char **buf_ptr, ChimpRef *ref)
+{
+    char *buf = *buf_ptr;
+    ChimpMsgCell *cell = (ChimpMsgCell *)buf;
+    cell->type = CHIMP_MSG_CELL_FLOAT;
+    cell->float_ = CHIMP_FLOAT(ref)->value;
+    buf += chimp_msg_float_cell_size (ref);
+    *buf_ptr = buf;
+    return CHIMP_TRUE;
+}
+
 static chimp_bool_t
 chimp_msg_str_cell_encode (char **buf_ptr, ChimpRef *ref)
 {
@@ -126,6 +151,17 @@ chimp_msg_str_cell_encode (char **buf_ptr, ChimpRef *ref)
     return CHIMP_TRUE;
 }
 
+static chimp_bool_t
+chimp_msg_error_cell_encode (char **buf_ptr, ChimpRef *ref)
+{
+    ChimpMsgCell *cell = (ChimpMsgCell *)*buf_ptr;
+    if (!chimp_msg_str_cell_encode (buf_ptr, CHIMP_ERROR_MESSAGE(ref))) {
+        return CHIMP_FALSE;
+    }
+    cell->type = CHIMP_MSG_CELL_ERROR;
+    return CHIMP_TRUE;
+}
+
 static chimp_bool_t
 chimp_msg_array_cell_encode (char **buf_ptr, ChimpRef *ref)
 {
@@ -195,6 +231,11 @@ chimp_msg_value_cell_encode (char **buf_ptr, ChimpRef *ref)
             return CHIMP_FALSE;
         }
     }
+    else if (klass == chimp_float_class) {
+        if (!chimp_msg_float_cell_encode (buf_ptr, ref)) {
+            return CHIMP_FALSE;
+        }
+    }
     else if (klass == chimp_str_class) {
         if (!chimp_msg_str_cell_encode (buf_ptr, ref)) {
             return CHIMP_FALSE;
@@ -229,6 +270,11 @@ chimp_msg_value_cell_encode (char **buf_ptr, ChimpRef *ref)
             return CHIMP_FALSE;
         }
     }
+    else if (klass == chimp_error_class) {
+        if (!chimp_msg_error_cell_encode (buf_ptr, ref)) {
+            return CHIMP_FALSE;
+        }
+    }
     else {
         CHIMP_BUG ("unsupported message type in encode: %s",
                 CHIMP_STR_DATA(CHIMP_CLASS_NAME(CHIMP_ANY_CLASS(ref))));
@@ -259,6 +305,7 @@ chimp_msg_pack (ChimpRef *value)
     }
     temp = (ChimpMsgInternal *) buf;
     temp->size = size;
+    temp->tag = 0;
     temp->next = NULL;
     buf += sizeof(ChimpMsgInternal);
     temp->cell = (ChimpMsgCell *) buf;
@@ -361,6 +408,16 @@ chimp_msg_value_cell_decode (char **buf_ptr, ChimpRef **ref)
                 *buf_ptr = buf;
                 break;
             }
+        case CHIMP_MSG_CELL_FLOAT:
+            {
+                *ref = chimp_float_new (cell->float_);
+                if (*ref == NULL) {
+                    return CHIMP_FALSE;
+                }
+                buf += sizeof(ChimpMsgCell);
+                *buf_ptr = buf;
+                break;
+            }
         case CHIMP_MSG_CELL_STR:
             {
                 *ref = chimp_str_new (cell->str.data, cell->str.size);
@@ -371,6 +428,20 @@ chimp_msg_value_cell_decode (char **buf_ptr, ChimpRef **ref)
                 *buf_ptr = buf;
                 break;
             }
+        case CHIMP_MSG_CELL_ERROR:
+            {
+                ChimpRef *message = chimp_str_new (cell->str.data, cell->str.size);
+                if (message == NULL) {
+                    return CHIMP_FALSE;
+                }
+                *ref = chimp_error_new (message);
+                if (*ref == NULL) {
+                    return CHIMP_FALSE;
+                }
+                buf += sizeof(ChimpMsgCell) + cell->str.size + 1;
+                *buf_ptr = buf;
+                break;
+            }
         case CHIMP_MSG_CELL_ARRAY:
             {
                 if (!chimp_msg_array_cell_decode (buf_ptr, ref)) {
@@ -16,6 +16,8 @@
  *                                                                           *
  *****************************************************************************/
 
+#include <sys/mman.h>
+
 #include "chimp/object.h"
 #include "chimp/str.h"
 
@@ -43,6 +45,17 @@ chimp_str_new_take (char *data, size_t size)
     return ref;
 }
 
+ChimpRef *
+chimp_str_new_mapped (char *data, size_t size, size_t mapped)
+{
+    ChimpRef *ref = chimp_str_new_take (data, size);
+    if (ref == NULL) {
+        return NULL;
+    }
+    CHIMP_STR(ref)->mapped = mapped;
+    return ref;
+}
+
 ChimpRef *
 chimp_str_new_format (const char *fmt, ...)
 {
@@ -119,16 +132,44 @@ chimp_str_new_concat (const char *a, ...)
     return chimp_str_new_take (ptr, size);
 }
 
+char *
+chimp_str_reserve (ChimpRef *self, size_t size)
+{
+    char *data;
+    if (CHIMP_STR(self)->mapped > 0) {
+        /* mappings can't grow: move onto the heap first */
+        size_t copy_size = CHIMP_STR_SIZE(self);
+        data = CHIMP_MALLOC (char, (size > copy_size ? size : copy_size) + 1);
+        if (data == NULL) {
+            return NULL;
+        }
+        memcpy (data, CHIMP_STR_DATA(self), copy_size + 1);
+        munmap (CHIMP_STR(self)->data, CHIMP_STR(self)->mapped);
+        CHIMP_STR(self)->data = data;
+        CHIMP_STR(self)->mapped = 0;
+        return data;
+    }
+    if (size <= CHIMP_STR_SIZE(self)) {
+        return CHIMP_STR(self)->data;
+    }
+    data = CHIMP_REALLOC (char, CHIMP_STR(self)->data, size + 1);
+    if (data == NULL) {
+        return NULL;
+    }
+    CHIMP_STR(self)->data = data;
+    return data;
+}
+
 chimp_bool_t
 chimp_str_append (ChimpRef *self, ChimpRef *append_me)
 {
     ChimpRef *append_str = chimp_object_str (append_me);
     /* TODO error checking */
-    char *data = CHIMP_REALLOC (char, CHIMP_STR(self)->data, CHIMP_STR_SIZE(self) + CHIMP_STR_SIZE(append_str) + 1);
+    char *data = chimp_str_reserve (
+        self, CHIMP_STR_SIZE(self) + CHIMP_STR_SIZE(append_str));
     if (data == NULL) {
         return CHIMP_FALSE;
     }
-    CHIMP_STR(self)->data = data;
     memcpy (CHIMP_STR_DATA(self) + CHIMP_STR_SIZE(self), CHIMP_STR_DATA(append_str), CHIMP_STR_SIZE(append_str));
     CHIMP_STR(self)->size += CHIMP_STR_SIZE(append_str);
     CHIMP_STR(self)->data[CHIMP_STR(self)->size] = '\0';
@@ -16,12 +16,26 @@
  *                                                                           *
  *****************************************************************************/
 
+#ifdef __linux__
+#define _GNU_SOURCE /* CPU_SET & pthread_attr_setaffinity_np */
+#endif
+
 #include <pthread.h>
 
 #include <stddef.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#ifdef __linux__
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#endif
 
 #include "chimp/gc.h"
 #include "chimp/task.h"
@@ -29,6 +43,10 @@
 #include "chimp/array.h"
 #include "chimp/frame.h"
 #include "chimp/vm.h"
+#include "chimp/modules.h"
+#include "chimp/msg.h"
+#include "chimp/error.h"
+#include "chimp/str.h"
 
 /* XXX this stuff leaks like a sieve */
 
@@ -37,10 +55,16 @@ ChimpTaskInternal *main_task = NULL;
 
 static pthread_once_t current_task_key_once = PTHREAD_ONCE_INIT;
 
+/* signalled whenever *any* task finishes (see chimp_task_wait_any) */
+static pthread_mutex_t done_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  done_cond = PTHREAD_COND_INITIALIZER;
+
 enum {
     CHIMP_TASK_FLAG_MAIN        = 0x01,
     CHIMP_TASK_FLAG_READY       = 0x02,
     CHIMP_TASK_FLAG_INBOX_FULL  = 0x08,
+    CHIMP_TASK_FLAG_KEEP_RESULT = 0x10,
+    CHIMP_TASK_FLAG_EXITING     = 0x20,
     CHIMP_TASK_FLAG_DONE        = 0x80,
 };
 
@@ -53,6 +77,13 @@ enum {
 #define CHIMP_TASK_IS_DONE(task) \
     ((((task)->flags) & CHIMP_TASK_FLAG_DONE) == CHIMP_TASK_FLAG_DONE)
 
+#define CHIMP_TASK_IS_KEEP_RESULT(task) \
+    ((((task)->flags) & CHIMP_TASK_FLAG_KEEP_RESULT) \
+        == CHIMP_TASK_FLAG_KEEP_RESULT)
+
+#define CHIMP_TASK_IS_EXITING(task) \
+    ((((task)->flags) & CHIMP_TASK_FLAG_EXITING) == CHIMP_TASK_FLAG_EXITING)
+
 #define CHIMP_TASK_IS_INBOX_FULL(task) \
     ((((task)->flags) & CHIMP_TASK_FLAG_INBOX_FULL) \
         == CHIMP_TASK_FLAG_INBOX_FULL)
@@ -65,6 +96,13 @@ enum {
 
 static pthread_key_t current_task_key;
 
+/* a task to be told when another task exits (see chimp_task_link) */
+typedef struct _ChimpTaskWatcher {
+    ChimpTaskInternal        *task;
+    ChimpTaskWatchKind        kind;
+    struct _ChimpTaskWatcher *next;
+} ChimpTaskWatcher;
+
 struct _ChimpTaskInternal {
     ChimpGC           *gc;
     ChimpVM           *vm;
@@ -78,11 +116,204 @@ struct _ChimpTaskInternal {
     pthread_mutex_t    lock;
     int                refs;
     ChimpMsgInternal  *inbox;
+    ChimpMsgInternal  *inbox_tail;
+    size_t             inbox_size;
+    int                inbox_fd; /* readable while the inbox isn't empty */
+    ChimpMsgInternal  *result;  /* packed return value, see KEEP_RESULT */
+    ChimpTaskWatcher  *watchers;
+    char              *exit_reason; /* NULL for a normal exit */
+    struct timespec    spawned_at;
+    ChimpTaskOptions   options;
 };
 
+/* senders block once this many messages are waiting in an inbox */
+#define CHIMP_TASK_MAX_INBOX_SIZE 64
+
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static ChimpTaskStats stats;
+
 static void
 chimp_task_cleanup (ChimpTaskInternal *task);
 
+static chimp_bool_t
+chimp_task_deliver (
+    ChimpTaskInternal *task, ChimpMsgInternal *msg, chimp_bool_t block);
+
+static void
+chimp_task_exit (ChimpTaskInternal *task, char *reason);
+
+static void
+chimp_task_free_inbox (ChimpTaskInternal *task)
+{
+    /* NOTE: we assume the task lock is held here */
+
+    while (task->inbox != NULL) {
+        ChimpMsgInternal *next = task->inbox->next;
+        CHIMP_FREE (task->inbox);
+        task->inbox = next;
+    }
+    task->inbox_tail = NULL;
+    task->inbox_size = 0;
+}
+
+/* NOTE: the following assume the task lock is held */
+
+static void
+chimp_task_signal_inbox_fd (ChimpTaskInternal *task)
+{
+    if (task->inbox_fd >= 0) {
+        uint64_t one = 1;
+        if (write (task->inbox_fd, &one, sizeof(one)) < 0) {
+            /* the counter is already non-zero: nothing to do */
+        }
+    }
+}
+
+static void
+chimp_task_drain_inbox_fd (ChimpTaskInternal *task)
+{
+    if (task->inbox_fd >= 0) {
+        uint64_t count;
+        if (read (task->inbox_fd, &count, sizeof(count)) < 0) {
+            /* EAGAIN: already drained */
+        }
+    }
+}
+
+static void
+chimp_task_stats_add_spawn (
+    const struct timespec *start, const struct timespec *end,
+    chimp_bool_t recycled_gc)
+{
+    uint64_t latency = (uint64_t)(end->tv_sec - start->tv_sec) * 1000000000 +
+                       (end->tv_nsec - start->tv_nsec);
+
+    pthread_mutex_lock (&stats_lock);
+    stats.spawned++;
+    if (recycled_gc) {
+        stats.recycled++;
+    }
+    stats.total_latency_ns += latency;
+    if (latency > stats.max_latency_ns) {
+        stats.max_latency_ns = latency;
+    }
+    pthread_mutex_unlock (&stats_lock);
+}
+
+void
+chimp_task_get_stats (ChimpTaskStats *out)
+{
+    pthread_mutex_lock (&stats_lock);
+    memcpy (out, &stats, sizeof(*out));
+    pthread_mutex_unlock (&stats_lock);
+}
+
+#ifdef __linux__
+
+/* add the CPUs of a NUMA node (e.g. "0-3,8-11") to the given set */
+static chimp_bool_t
+chimp_task_add_node_cpus (int node, cpu_set_t *cpus)
+{
+    FILE *f;
+    char path[64];
+    int lo, hi;
+
+    snprintf (path, sizeof(path),
+        "/sys/devices/system/node/node%d/cpulist", node);
+    f = fopen (path, "r");
+    if (f == NULL) {
+        return CHIMP_FALSE;
+    }
+    while (fscanf (f, "%d", &lo) == 1) {
+        hi = lo;
+        if (fscanf (f, "-%d", &hi) < 0) {
+            break;
+        }
+        for (; lo <= hi && lo < CPU_SETSIZE; lo++) {
+            CPU_SET (lo, cpus);
+        }
+        if (fgetc (f) != ',') {
+            break;
+        }
+    }
+    fclose (f);
+    return CHIMP_TRUE;
+}
+
+/* cpu & node are hints: a node the kernel doesn't know about (say, on a
+ * machine without NUMA) or a cpu we're not allowed to run on leaves the
+ * task unpinned rather than failing to start it.
+ */
+static chimp_bool_t
+chimp_task_set_affinity (pthread_attr_t *attrs, const ChimpTaskOptions *options)
+{
+    cpu_set_t cpus;
+    cpu_set_t allowed;
+
+    if (options->cpu < 0 && options->node < 0) {
+        return CHIMP_TRUE;
+    }
+
+    CPU_ZERO (&cpus);
+    if (options->node >= 0) {
+        if (!chimp_task_add_node_cpus (options->node, &cpus)) {
+            return CHIMP_TRUE;
+        }
+    }
+    if (options->cpu >= 0) {
+        /* with a node too, the cpu had better be one of the node's */
+        chimp_bool_t in_node = options->cpu < CPU_SETSIZE &&
+                                CPU_ISSET (options->cpu, &cpus);
+        CPU_ZERO (&cpus);
+        if (options->cpu < CPU_SETSIZE &&
+                (options->node < 0 || in_node)) {
+            CPU_SET (options->cpu, &cpus);
+        }
+    }
+    if (sched_getaffinity (0, sizeof(allowed), &allowed) == 0) {
+        CPU_AND (&cpus, &cpus, &allowed);
+    }
+    if (CPU_COUNT (&cpus) == 0) {
+        return CHIMP_TRUE;
+    }
+    return pthread_attr_setaffinity_np (attrs, sizeof(cpus), &cpus) == 0;
+}
+
+#else
+
+static chimp_bool_t
+chimp_task_set_affinity (pthread_attr_t *attrs, const ChimpTaskOptions *options)
+{
+    /* XXX no portable way to pin threads: treat it as a hint */
+    return CHIMP_TRUE;
+}
+
+#endif
+
+static void
+chimp_task_apply_priority (ChimpTaskInternal *task)
+{
+    int nice;
+
+    switch (task->options.priority) {
+        case CHIMP_TASK_PRIORITY_LOW:
+            nice = 10;
+            break;
+        case CHIMP_TASK_PRIORITY_HIGH:
+            nice = -5;
+            break;
+        default:
+            return;
+    }
+
+#ifdef __linux__
+    /* on Linux, nice values are per-thread. raising priority needs
+     * CAP_SYS_NICE: without it we quietly run at normal priority.
+     */
+    setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid), nice);
+#endif
+}
+
 static void
 chimp_task_init_per_thread_key (void)
 {
@@ -109,50 +340,147 @@ chimp_task_new_local (ChimpTaskInternal *task)
     return taskobj;
 }
 
+/* the thread couldn't get as far as running the task: record why & finish
+ * up the same way a task that ran would, so that nobody joining or waiting
+ * on us hangs. watchers only hear about it if we got as far as a heap to
+ * pack their notices into.
+ */
+static void *
+chimp_task_start_failed (ChimpTaskInternal *task, const char *why)
+{
+    char *reason = strdup (why);
+
+    if (task->gc != NULL) {
+        chimp_task_exit (task, reason);
+        if (task->options.node >= 0) {
+            chimp_gc_delete (task->gc);
+        }
+        else {
+            chimp_gc_release (task->gc);
+        }
+        task->gc = NULL;
+    }
+    else {
+        ChimpTaskWatcher *watchers;
+
+        CHIMP_TASK_LOCK(task);
+        task->flags |= CHIMP_TASK_FLAG_EXITING;
+        task->exit_reason = reason;
+        watchers = task->watchers;
+        task->watchers = NULL;
+        CHIMP_TASK_UNLOCK(task);
+
+        while (watchers != NULL) {
+            ChimpTaskWatcher *next = watchers->next;
+            chimp_task_unref (watchers->task);
+            CHIMP_FREE (watchers);
+            watchers = next;
+        }
+    }
+
+    CHIMP_TASK_LOCK(task);
+    chimp_task_free_inbox (task);
+    task->flags |= CHIMP_TASK_FLAG_DONE;
+    pthread_cond_broadcast (&task->flags_cond);
+    CHIMP_TASK_UNLOCK(task);
+
+    /* NOTE: never hold a task lock while taking done_lock */
+    pthread_mutex_lock (&done_lock);
+    pthread_cond_broadcast (&done_cond);
+    pthread_mutex_unlock (&done_lock);
+
+    return NULL;
+}
+
 static void *
 chimp_task_thread_func (void *arg)
 {
-    /* NOTE: task->lock will be held by chimp_task_new at this point.    */
-    /*       this will prevent other threads fiddling before we're ready */
+    /* NOTE: chimp_task_new doesn't wait for us to get this far: other tasks */
+    /*       may already be sending messages our way.                      */
 
     /* TODO better error handling */
 
     ChimpTaskInternal *task = (ChimpTaskInternal *) arg;
+    chimp_bool_t recycled_gc;
+    char *reason = NULL;
+    struct timespec now;
 
     /* printf ("[%p] started\n", task); */
-    task->gc = chimp_gc_new ((void *)&task);
+    chimp_task_apply_priority (task);
+
+    /* a recycled heap may live on another node: start fresh so that the
+     * slabs are first touched (and thus allocated) on our node.
+     */
+    if (task->options.node >= 0) {
+        recycled_gc = CHIMP_FALSE;
+        task->gc = chimp_gc_new ((void *)&task);
+    }
+    else {
+        task->gc = chimp_gc_acquire ((void *)&task, &recycled_gc);
+    }
     if (task->gc == NULL) {
-        return NULL;
+        return chimp_task_start_failed (task, "failed to create a heap");
     }
 
     chimp_task_init_per_thread_key_once (task);
 
     task->vm = chimp_vm_new ();
     if (task->vm == NULL) {
-        return NULL;
+        return chimp_task_start_failed (task, "failed to create a vm");
     }
 
+    CHIMP_TASK_LOCK(task);
     task->flags |= CHIMP_TASK_FLAG_READY;
     pthread_cond_broadcast (&task->flags_cond);
 
     /* take an extra ref to keep the task around after the GC dies */
     task->refs++;
+    CHIMP_TASK_UNLOCK(task);
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    chimp_task_stats_add_spawn (&task->spawned_at, &now, recycled_gc);
 
     if (task->method != NULL) {
         ChimpRef *args;
-        ChimpRef *taskobj = chimp_task_new_local (task);
+        ChimpRef *ret;
+        ChimpRef *taskobj;
+
+        CHIMP_TASK_LOCK(task);
+        taskobj = chimp_task_new_local (task);
+        CHIMP_TASK_UNLOCK(task);
         if (taskobj == NULL) {
-            /* XXX we already have a lock, unref has its own locking code */
-            chimp_task_unref (task);
-            return NULL;
+            reason = strdup ("failed to create a task handle");
+            goto finished;
         }
         task->self = taskobj;
-        CHIMP_TASK_UNLOCK(task);
         args = chimp_task_recv (task->self);
-        if (chimp_vm_invoke (task->vm, task->method, args) == NULL) {
-            chimp_task_unref (task);
-            return NULL;
+        ret = chimp_vm_invoke (task->vm, task->method, args);
+        if (ret == NULL) {
+            /* fall through so that peers see us finish */
+            reason = strdup ("crashed");
+        }
+        else if (CHIMP_ANY_CLASS(ret) == chimp_error_class) {
+            ChimpRef *message = CHIMP_ERROR(ret)->message;
+            if (message != NULL) {
+                message = chimp_object_str (message);
+            }
+            reason = strdup (message != NULL ? CHIMP_STR_DATA(message) : "error");
         }
+        else {
+            /* the heap is about to go away: pack the result if anybody cares */
+            CHIMP_TASK_LOCK(task);
+            if (CHIMP_TASK_IS_KEEP_RESULT(task)) {
+                task->result = chimp_msg_pack (ret);
+            }
+            CHIMP_TASK_UNLOCK(task);
+        }
+
+finished:
+        /* anybody waiting on us should see our output first */
+        chimp_io_flush_output ();
+
+        /* tell links & monitors while we still have a heap to pack into */
+        chimp_task_exit (task, reason);
     }
 
     /************************************************************************
@@ -168,15 +496,16 @@ chimp_task_thread_func (void *arg)
 
     chimp_vm_delete (task->vm);
     task->vm = NULL;
-    chimp_gc_delete (task->gc);
+    if (task->options.node >= 0) {
+        chimp_gc_delete (task->gc);
+    }
+    else {
+        chimp_gc_release (task->gc);
+    }
     task->gc = NULL;
 
     CHIMP_TASK_LOCK(task);
-    if (task->inbox != NULL) {
-        CHIMP_FREE (task->inbox);
-        task->inbox = NULL;
-    }
-    task->inbox = NULL;
+    chimp_task_free_inbox (task);
 
     /* XXX pretty much a copy/paste of chimp_task_unref without locking crap */
     if (task->refs > 0) {
@@ -192,12 +521,25 @@ chimp_task_thread_func (void *arg)
     pthread_cond_broadcast (&task->flags_cond);
     CHIMP_TASK_UNLOCK(task);
 
+    /* NOTE: never hold a task lock while taking done_lock */
+    pthread_mutex_lock (&done_lock);
+    pthread_cond_broadcast (&done_cond);
+    pthread_mutex_unlock (&done_lock);
+
     return NULL;
 }
 
 ChimpRef *
 chimp_task_new (ChimpRef *callable)
 {
+    return chimp_task_new_with_options (callable, NULL);
+}
+
+ChimpRef *
+chimp_task_new_with_options (
+    ChimpRef *callable, const ChimpTaskOptions *options)
+{
+    static const ChimpTaskOptions default_options = CHIMP_TASK_OPTIONS_INIT;
     ChimpRef *taskobj;
     pthread_attr_t attrs;
     ChimpTaskInternal *task = CHIMP_MALLOC(ChimpTaskInternal, sizeof(*task));
@@ -205,10 +547,21 @@ chimp_task_new (ChimpRef *callable)
         return NULL;
     }
     memset (task, 0, sizeof (*task));
+    memcpy (&task->options,
+        (options != NULL ? options : &default_options), sizeof(task->options));
+    task->inbox_fd = -1;
+
+    /* create the heap-local handle up front: nothing to clean up if it fails */
+    taskobj = chimp_class_new_instance (chimp_task_class, NULL);
+    if (taskobj == NULL) {
+        CHIMP_FREE (task);
+        return NULL;
+    }
 
     /* XXX can we guarantee callable won't be collected? think so ... */
     task->method = callable;
     task->flags = 0;
+    clock_gettime (CLOCK_MONOTONIC, &task->spawned_at);
     /* !!! important to incref *BEFORE* we start the task thread !!! */
     /* (otherwise, short-lived tasks can prematurely kill the TaskInternal) */
     task->refs++;
@@ -224,49 +577,54 @@ chimp_task_new (ChimpRef *callable)
     if (pthread_attr_init (&attrs) != 0) {
         pthread_cond_destroy (&task->flags_cond);
         pthread_mutex_destroy (&task->lock);
+        CHIMP_FREE (task);
         return NULL;
     }
     if (pthread_attr_setdetachstate (&attrs, PTHREAD_CREATE_DETACHED) != 0) {
-        pthread_attr_destroy (&attrs);
-        pthread_cond_destroy (&task->flags_cond);
-        pthread_mutex_destroy (&task->lock);
-        return NULL;
-    }
-    CHIMP_TASK_LOCK(task);
-    if (pthread_create (&task->thread, &attrs, chimp_task_thread_func, task) != 0) {
         pthread_attr_destroy (&attrs);
         pthread_cond_destroy (&task->flags_cond);
         pthread_mutex_destroy (&task->lock);
         CHIMP_FREE (task);
         return NULL;
     }
-    pthread_attr_destroy (&attrs);
-
-    /* XXX error handling code is probably all kinds of wrong/unsafe from
-     *     this point, but meh.
-     */
-    while (!CHIMP_TASK_IS_READY(task)) {
-        if (pthread_cond_wait (&task->flags_cond, &task->lock) != 0) {
-            CHIMP_TASK_UNLOCK(task);
+    if (task->options.stack_size > 0) {
+        size_t stack_size = task->options.stack_size;
+        if (stack_size < PTHREAD_STACK_MIN) {
+            stack_size = PTHREAD_STACK_MIN;
+        }
+        if (pthread_attr_setstacksize (&attrs, stack_size) != 0) {
+            pthread_attr_destroy (&attrs);
             pthread_cond_destroy (&task->flags_cond);
             pthread_mutex_destroy (&task->lock);
             CHIMP_FREE (task);
             return NULL;
         }
     }
-
-    /* create a heap-local handle for this task */
-    taskobj = chimp_class_new_instance (chimp_task_class, NULL);
-    if (taskobj == NULL) {
-        CHIMP_TASK_UNLOCK (task);
+    if (!chimp_task_set_affinity (&attrs, &task->options)) {
+        pthread_attr_destroy (&attrs);
         pthread_cond_destroy (&task->flags_cond);
         pthread_mutex_destroy (&task->lock);
         CHIMP_FREE (task);
         return NULL;
     }
+
+    /* the handle must be wired up before the thread can possibly finish */
     CHIMP_TASK(taskobj)->priv = task;
     CHIMP_TASK(taskobj)->local = CHIMP_FALSE;
-    CHIMP_TASK_UNLOCK(task);
+
+    /* no need to wait for the task to be READY: messages sent before it
+     * starts running simply queue up in its inbox.
+     */
+    if (pthread_create (&task->thread, &attrs, chimp_task_thread_func, task) != 0) {
+        CHIMP_TASK(taskobj)->priv = NULL;
+        pthread_attr_destroy (&attrs);
+        pthread_cond_destroy (&task->flags_cond);
+        pthread_mutex_destroy (&task->lock);
+        CHIMP_FREE (task);
+        return NULL;
+    }
+    pthread_attr_destroy (&attrs);
+
     return taskobj;
 }
 
@@ -277,14 +635,7 @@ chimp_task_new_from_internal (ChimpTaskInternal *priv)
     if (ref == NULL) {
         return NULL;
     }
-    /* XXX blatant copy/paste from chimp_task_new */
     CHIMP_TASK_LOCK(priv);
-    while (!CHIMP_TASK_IS_READY(priv)) {
-        if (pthread_cond_wait (&priv->flags_cond, &priv->lock) != 0) {
-            CHIMP_TASK_UNLOCK(priv);
-            return NULL;
-        }
-    }
     CHIMP_TASK(ref)->priv = priv;
     CHIMP_TASK(ref)->local = CHIMP_FALSE;
     priv->refs++;
@@ -316,6 +667,7 @@ chimp_task_new_main (void *stack_start)
     main_task = task;
     memset (task, 0, sizeof (*task));
     task->flags = CHIMP_TASK_FLAG_MAIN;
+    task->inbox_fd = -1;
     task->gc = chimp_gc_new (stack_start);
     if (task->gc == NULL) {
         CHIMP_FREE (task);
@@ -372,6 +724,24 @@ chimp_task_main_delete ()
 {
     ChimpTaskInternal *task = CHIMP_CURRENT_TASK;
     if (task != NULL) {
+        /* like any other task, tear down our heap on the way out rather
+         * than when the last ref goes: a peer that still holds one (say,
+         * an io worker that just replied to us) only keeps the struct.
+         */
+        chimp_task_ref (task);
+        if (task->vm != NULL) {
+            chimp_vm_delete (task->vm);
+            task->vm = NULL;
+        }
+        if (task->gc != NULL) {
+            chimp_gc_delete (task->gc);
+            task->gc = NULL;
+        }
+        CHIMP_TASK_LOCK(task);
+        chimp_task_free_inbox (task);
+        task->flags |= CHIMP_TASK_FLAG_DONE;
+        pthread_cond_broadcast (&task->flags_cond);
+        CHIMP_TASK_UNLOCK(task);
         chimp_task_unref (task);
         main_task = NULL;
         pthread_setspecific (current_task_key, NULL);
@@ -402,39 +772,99 @@ chimp_task_unref (ChimpTaskInternal *task)
     CHIMP_TASK_UNLOCK(task);
 }
 
+int
+chimp_task_inbox_fd (ChimpTaskInternal *task)
+{
+#ifdef __linux__
+    int fd;
+
+    CHIMP_TASK_LOCK(task);
+    if (task->inbox_fd < 0) {
+        task->inbox_fd = eventfd (
+            task->inbox != NULL ? 1 : 0, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    fd = task->inbox_fd;
+    CHIMP_TASK_UNLOCK(task);
+    return fd;
+#else
+    errno = ENOSYS;
+    return -1;
+#endif
+}
+
 chimp_bool_t
 chimp_task_send (ChimpRef *self, ChimpRef *value)
+{
+    return chimp_task_send_tagged (self, value, 0);
+}
+
+uint64_t
+chimp_task_new_tag (void)
+{
+    static uint64_t last_tag = 0;
+    return __sync_add_and_fetch (&last_tag, 1);
+}
+
+chimp_bool_t
+chimp_task_send_tagged (ChimpRef *self, ChimpRef *value, uint64_t tag)
 {
     ChimpMsgInternal *msg;
-    ChimpTaskInternal *task = CHIMP_TASK(self)->priv;
+
+    if (CHIMP_TASK(self)->local) {
+        CHIMP_BUG ("cannot send using local task object");
+        return CHIMP_FALSE;
+    }
 
     msg = chimp_msg_pack (value);
     if (msg == NULL) {
         return CHIMP_FALSE;
     }
+    msg->tag = tag;
 
+    return chimp_task_deliver (CHIMP_TASK(self)->priv, msg, CHIMP_TRUE);
+}
+
+/* queues msg (which we own) in task's inbox. if block is false, a full
+ * inbox is ignored: exit notices mustn't wedge a dying task.
+ */
+static chimp_bool_t
+chimp_task_deliver (
+    ChimpTaskInternal *task, ChimpMsgInternal *msg, chimp_bool_t block)
+{
     CHIMP_TASK_LOCK(task);
 
-    if (CHIMP_TASK(self)->local) {
-        CHIMP_BUG ("cannot send using local task object");
-        CHIMP_FREE (msg);
-        return CHIMP_FALSE;
-    }
-    else if (CHIMP_TASK_IS_DONE(task)) {
+    /* an exiting task will never recv again */
+    if (CHIMP_TASK_IS_DONE(task) || CHIMP_TASK_IS_EXITING(task)) {
         /* this is *not* a bug: we can fail gracefully if recipient died */
+        CHIMP_TASK_UNLOCK(task);
         CHIMP_FREE (msg);
         return CHIMP_FALSE;
     }
 
-    while (CHIMP_TASK_IS_INBOX_FULL(task)) {
+    while (block && CHIMP_TASK_IS_INBOX_FULL(task) &&
+            !CHIMP_TASK_IS_DONE(task) && !CHIMP_TASK_IS_EXITING(task)) {
         if (pthread_cond_wait (&task->flags_cond, &task->lock) != 0) {
             CHIMP_FREE(msg);
             CHIMP_TASK_UNLOCK(task);
             return CHIMP_FALSE;
         }
     }
-    task->inbox = msg;
-    task->flags |= CHIMP_TASK_FLAG_INBOX_FULL;
+    if (CHIMP_TASK_IS_DONE(task) || CHIMP_TASK_IS_EXITING(task)) {
+        CHIMP_TASK_UNLOCK(task);
+        CHIMP_FREE (msg);
+        return CHIMP_FALSE;
+    }
+    if (task->inbox_tail != NULL) {
+        task->inbox_tail->next = msg;
+    }
+    else {
+        task->inbox = msg;
+    }
+    task->inbox_tail = msg;
+    if (++task->inbox_size >= CHIMP_TASK_MAX_INBOX_SIZE) {
+        task->flags |= CHIMP_TASK_FLAG_INBOX_FULL;
+    }
+    chimp_task_signal_inbox_fd (task);
     if (pthread_cond_broadcast (&task->flags_cond) != 0) {
         CHIMP_TASK_UNLOCK(task);
         return CHIMP_FALSE;
@@ -443,8 +873,46 @@ chimp_task_send (ChimpRef *self, ChimpRef *value)
     return CHIMP_TRUE;
 }
 
+/* unlinks & returns the first message in task's inbox carrying tag */
+static ChimpMsgInternal *
+chimp_task_take_msg (ChimpTaskInternal *task, uint64_t tag)
+{
+    ChimpMsgInternal *prev = NULL;
+    ChimpMsgInternal *msg = task->inbox;
+
+    while (msg != NULL && msg->tag != tag) {
+        prev = msg;
+        msg = msg->next;
+    }
+    if (msg == NULL) {
+        return NULL;
+    }
+
+    if (prev != NULL) {
+        prev->next = msg->next;
+    }
+    else {
+        task->inbox = msg->next;
+    }
+    if (task->inbox_tail == msg) {
+        task->inbox_tail = prev;
+    }
+    if (task->inbox == NULL) {
+        chimp_task_drain_inbox_fd (task);
+    }
+    task->inbox_size--;
+    task->flags &= ~CHIMP_TASK_FLAG_INBOX_FULL;
+    return msg;
+}
+
 ChimpRef *
 chimp_task_recv (ChimpRef *self)
+{
+    return chimp_task_recv_tagged (self, 0);
+}
+
+ChimpRef *
+chimp_task_recv_tagged (ChimpRef *self, uint64_t tag)
 {
     ChimpMsgInternal *msg;
     ChimpRef *value;
@@ -467,7 +935,8 @@ chimp_task_recv (ChimpRef *self)
         return NULL;
     }
 
-    while (!CHIMP_TASK_IS_DONE(task) && !CHIMP_TASK_IS_INBOX_FULL(task)) {
+    while (!CHIMP_TASK_IS_DONE(task) &&
+            (msg = chimp_task_take_msg (task, tag)) == NULL) {
         if (pthread_cond_wait (&task->flags_cond, &task->lock) != 0) {
             CHIMP_TASK_UNLOCK(task);
             return NULL;
@@ -477,9 +946,6 @@ chimp_task_recv (ChimpRef *self)
         CHIMP_TASK_UNLOCK(task);
         return NULL;
     }
-    msg = task->inbox;
-    task->inbox = NULL;
-    task->flags &= ~CHIMP_TASK_FLAG_INBOX_FULL;
     if (pthread_cond_broadcast (&task->flags_cond) != 0) {
         CHIMP_FREE (msg);
         CHIMP_TASK_UNLOCK(task);
@@ -508,9 +974,24 @@ chimp_task_cleanup (ChimpTaskInternal *task)
         chimp_gc_delete (task->gc);
         task->gc = NULL;
     }
-    if (task->inbox != NULL) {
-        CHIMP_FREE (task->inbox);
-        task->inbox = NULL;
+    chimp_task_free_inbox (task);
+    if (task->inbox_fd >= 0) {
+        close (task->inbox_fd);
+        task->inbox_fd = -1;
+    }
+    if (task->result != NULL) {
+        CHIMP_FREE (task->result);
+        task->result = NULL;
+    }
+    while (task->watchers != NULL) {
+        ChimpTaskWatcher *watcher = task->watchers;
+        task->watchers = watcher->next;
+        chimp_task_unref (watcher->task);
+        CHIMP_FREE (watcher);
+    }
+    if (task->exit_reason != NULL) {
+        CHIMP_FREE (task->exit_reason);
+        task->exit_reason = NULL;
     }
     pthread_cond_destroy (&task->flags_cond);
     pthread_mutex_destroy (&task->lock);
@@ -532,10 +1013,272 @@ chimp_task_join (ChimpTaskInternal *task)
     CHIMP_TASK_UNLOCK(task);
 }
 
+/* sends ["down", task, reason] or ["exit", task, reason] to watcher */
+static void
+chimp_task_notify (
+    ChimpTaskInternal *watcher,
+    ChimpTaskWatchKind kind,
+    ChimpTaskInternal *task,
+    const char *reason)
+{
+    ChimpRef *notice;
+    ChimpMsgInternal *msg;
+
+    /* links only care about failures */
+    if (kind == CHIMP_TASK_WATCH_LINK && reason == NULL) {
+        return;
+    }
+
+    notice = chimp_array_new_var (
+        (kind == CHIMP_TASK_WATCH_LINK ?
+            CHIMP_STR_NEW("exit") : CHIMP_STR_NEW("down")),
+        chimp_task_new_from_internal (task),
+        (reason != NULL ?
+            chimp_str_new (reason, strlen (reason)) : CHIMP_STR_NEW("normal")),
+        NULL);
+    if (notice == NULL) {
+        return;
+    }
+
+    msg = chimp_msg_pack (notice);
+    if (msg == NULL) {
+        return;
+    }
+    chimp_task_deliver (watcher, msg, CHIMP_FALSE);
+}
+
+/* called by a task thread on its way out. takes ownership of reason. */
+static void
+chimp_task_exit (ChimpTaskInternal *task, char *reason)
+{
+    ChimpTaskWatcher *watchers;
+
+    CHIMP_TASK_LOCK(task);
+    task->flags |= CHIMP_TASK_FLAG_EXITING;
+    task->exit_reason = reason;
+    watchers = task->watchers;
+    task->watchers = NULL;
+    pthread_cond_broadcast (&task->flags_cond);
+    CHIMP_TASK_UNLOCK(task);
+
+    while (watchers != NULL) {
+        ChimpTaskWatcher *next = watchers->next;
+        chimp_task_notify (watchers->task, watchers->kind, task, reason);
+        chimp_task_unref (watchers->task);
+        CHIMP_FREE (watchers);
+        watchers = next;
+    }
+}
+
+static chimp_bool_t
+chimp_task_watch (
+    ChimpTaskInternal *task,
+    ChimpTaskInternal *watcher,
+    ChimpTaskWatchKind kind)
+{
+    char *reason = NULL;
+    ChimpTaskWatcher *node = CHIMP_MALLOC(ChimpTaskWatcher, sizeof(*node));
+    if (node == NULL) {
+        return CHIMP_FALSE;
+    }
+    node->task = watcher;
+    node->kind = kind;
+
+    /* NOTE: ref before taking task's lock so we never hold two task locks */
+    chimp_task_ref (watcher);
+
+    CHIMP_TASK_LOCK(task);
+    if (!CHIMP_TASK_IS_EXITING(task)) {
+        node->next = task->watchers;
+        task->watchers = node;
+        CHIMP_TASK_UNLOCK(task);
+        return CHIMP_TRUE;
+    }
+    if (task->exit_reason != NULL) {
+        reason = strdup (task->exit_reason);
+        if (reason == NULL) {
+            CHIMP_TASK_UNLOCK(task);
+            chimp_task_unref (watcher);
+            CHIMP_FREE (node);
+            return CHIMP_FALSE;
+        }
+    }
+    CHIMP_TASK_UNLOCK(task);
+
+    /* too late to watch: the task is already gone. say so right away. */
+    chimp_task_notify (watcher, kind, task, reason);
+    chimp_task_unref (watcher);
+    CHIMP_FREE (node);
+    if (reason != NULL) {
+        CHIMP_FREE (reason);
+    }
+    return CHIMP_TRUE;
+}
+
+chimp_bool_t
+chimp_task_monitor (ChimpTaskInternal *watcher, ChimpTaskInternal *task)
+{
+    if (CHIMP_TASK_IS_MAIN(task)) {
+        CHIMP_BUG ("cannot monitor the main task");
+        return CHIMP_FALSE;
+    }
+    return chimp_task_watch (task, watcher, CHIMP_TASK_WATCH_MONITOR);
+}
+
+chimp_bool_t
+chimp_task_link (ChimpTaskInternal *a, ChimpTaskInternal *b)
+{
+    if (a == b) {
+        CHIMP_BUG ("a task cannot be linked to itself");
+        return CHIMP_FALSE;
+    }
+    /* the main task never exits via the thread func, so it only listens */
+    if (!CHIMP_TASK_IS_MAIN(a)) {
+        if (!chimp_task_watch (a, b, CHIMP_TASK_WATCH_LINK)) {
+            return CHIMP_FALSE;
+        }
+    }
+    if (!CHIMP_TASK_IS_MAIN(b)) {
+        if (!chimp_task_watch (b, a, CHIMP_TASK_WATCH_LINK)) {
+            return CHIMP_FALSE;
+        }
+    }
+    return CHIMP_TRUE;
+}
+
+void
+chimp_task_keep_result (ChimpTaskInternal *task)
+{
+    CHIMP_TASK_LOCK(task);
+    task->flags |= CHIMP_TASK_FLAG_KEEP_RESULT;
+    CHIMP_TASK_UNLOCK(task);
+}
+
+ChimpRef *
+chimp_task_take_result (ChimpTaskInternal *task)
+{
+    ChimpRef *value;
+    ChimpMsgInternal *msg;
+
+    CHIMP_TASK_LOCK(task);
+    if (!CHIMP_TASK_IS_DONE(task)) {
+        CHIMP_TASK_UNLOCK(task);
+        CHIMP_BUG ("attempt to take the result of a running task");
+        return NULL;
+    }
+    msg = task->result;
+    task->result = NULL;
+    CHIMP_TASK_UNLOCK(task);
+
+    /* the task died or its result was already taken */
+    if (msg == NULL) {
+        return chimp_nil;
+    }
+
+    value = chimp_msg_unpack (msg);
+    CHIMP_FREE (msg);
+    return value;
+}
+
+static void
+chimp_task_deadline (struct timespec *ts, int64_t timeout_ms)
+{
+    clock_gettime (CLOCK_REALTIME, ts);
+    ts->tv_sec += timeout_ms / 1000;
+    ts->tv_nsec += (timeout_ms % 1000) * 1000000;
+    if (ts->tv_nsec >= 1000000000) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000;
+    }
+}
+
+static chimp_bool_t
+chimp_task_is_done (ChimpTaskInternal *task)
+{
+    chimp_bool_t done;
+    CHIMP_TASK_LOCK(task);
+    done = CHIMP_TASK_IS_DONE(task);
+    CHIMP_TASK_UNLOCK(task);
+    return done;
+}
+
+/*
+ * Wait for one (all == CHIMP_FALSE) or all (all == CHIMP_TRUE) of the given
+ * tasks to finish. A negative timeout waits forever. Returns the index of a
+ * finished task (or n if all == CHIMP_TRUE), or -1 if the timeout expired.
+ */
+static ssize_t
+chimp_task_wait_tasks (
+    ChimpTaskInternal **tasks, size_t n, chimp_bool_t all, int64_t timeout_ms)
+{
+    size_t i;
+    ssize_t index = -1;
+    struct timespec deadline;
+
+    if (timeout_ms >= 0) {
+        chimp_task_deadline (&deadline, timeout_ms);
+    }
+
+    pthread_mutex_lock (&done_lock);
+    for (;;) {
+        size_t num_done = 0;
+        for (i = 0; i < n; i++) {
+            if (chimp_task_is_done (tasks[i])) {
+                if (!all) {
+                    index = (ssize_t) i;
+                    break;
+                }
+                num_done++;
+            }
+        }
+        if (index >= 0) {
+            break;
+        }
+        if (all && num_done == n) {
+            index = (ssize_t) n;
+            break;
+        }
+        if (timeout_ms < 0) {
+            if (pthread_cond_wait (&done_cond, &done_lock) != 0) {
+                break;
+            }
+        }
+        else {
+            int rc = pthread_cond_timedwait (&done_cond, &done_lock, &deadline);
+            if (rc != 0 && rc != EINTR) {
+                break;
+            }
+        }
+    }
+    pthread_mutex_unlock (&done_lock);
+    return index;
+}
+
+chimp_bool_t
+chimp_task_wait (ChimpTaskInternal *task, int64_t timeout_ms)
+{
+    return chimp_task_wait_tasks (&task, 1, CHIMP_TRUE, timeout_ms) >= 0;
+}
+
+ssize_t
+chimp_task_wait_any (ChimpTaskInternal **tasks, size_t n, int64_t timeout_ms)
+{
+    return chimp_task_wait_tasks (tasks, n, CHIMP_FALSE, timeout_ms);
+}
+
+chimp_bool_t
+chimp_task_wait_all (ChimpTaskInternal **tasks, size_t n, int64_t timeout_ms)
+{
+    return chimp_task_wait_tasks (tasks, n, CHIMP_TRUE, timeout_ms) >= 0;
+}
+
 static void
 _chimp_task_mark (ChimpGC *gc, ChimpRef *self)
 {
     ChimpTaskInternal *task = CHIMP_TASK(self)->priv;
+    if (task == NULL) {
+        return;
+    }
     chimp_gc_mark_ref (gc, task->method);
     chimp_gc_mark_ref (gc, task->modules);
 }
@@ -624,6 +1367,9 @@ _chimp_task_init (ChimpRef *self, ChimpRef *args)
 static void
 _chimp_task_dtor (ChimpRef *self)
 {
+    if (CHIMP_TASK(self)->priv == NULL) {
+        return;
+    }
     chimp_task_unref (CHIMP_TASK(self)->priv);
 }
 
@@ -19,18 +19,34 @@
 #include "chimp/vm.h"
 #include "chimp/array.h"
 #include "chimp/code.h"
+#include "chimp/jit.h"
 #include "chimp/object.h"
 #include "chimp/task.h"
 
+/* frames of returned calls we hang on to for reuse */
+#define CHIMP_VM_FRAME_POOL_SIZE 32
+
 struct _ChimpVM {
     ChimpRef  *stack;
     ChimpRef  *frames;
+    ChimpRef  *frame_pool;
 };
 
+#define CHIMP_IS_BYTECODE_METHOD(ref) \
+    (CHIMP_ANY_CLASS(ref) == chimp_method_class && \
+        ( \
+            (CHIMP_METHOD(ref)->type == CHIMP_METHOD_TYPE_BYTECODE) || \
+            (CHIMP_METHOD(ref)->type == CHIMP_METHOD_TYPE_CLOSURE) \
+        ) \
+    )
+
 static chimp_bool_t
 chimp_vm_resolvename (
     ChimpVM *vm, ChimpRef *name, ChimpRef **value, chimp_bool_t binding);
 
+static ChimpRef *
+chimp_vm_eval_frame (ChimpVM *vm, ChimpRef *frame);
+
 ChimpVM *
 chimp_vm_new (void)
 {
@@ -48,8 +64,14 @@ chimp_vm_new (void)
         CHIMP_FREE (vm);
         return NULL;
     }
+    vm->frame_pool = chimp_array_new_with_capacity (CHIMP_VM_FRAME_POOL_SIZE);
+    if (vm->frame_pool == NULL) {
+        CHIMP_FREE (vm);
+        return NULL;
+    }
     chimp_gc_make_root (NULL, vm->stack);
     chimp_gc_make_root (NULL, vm->frames);
+    chimp_gc_make_root (NULL, vm->frame_pool);
     return vm;
 }
 
@@ -77,10 +99,62 @@ chimp_vm_push (ChimpVM *vm, ChimpRef *value)
     return chimp_array_push (vm->stack, value);
 }
 
+/* a frame for a call to method, recycled from an earlier call to the
+ * same code if we can.
+ */
+static ChimpRef *
+chimp_vm_frame_new (ChimpVM *vm, ChimpRef *method)
+{
+    ChimpArray *pool = CHIMP_ARRAY(vm->frame_pool);
+    size_t i;
+
+    if (CHIMP_METHOD_TYPE(method) != CHIMP_METHOD_TYPE_BYTECODE) {
+        return chimp_frame_new (method);
+    }
+    /* most recently returned first: recursion & loops hit straight away */
+    for (i = pool->size; i > 0; i--) {
+        ChimpRef *frame = pool->items[i-1];
+        if (CHIMP_FRAME_CODE(frame) == CHIMP_BYTECODE_METHOD(method)->code) {
+            pool->items[i-1] = pool->items[pool->size-1];
+            pool->size--;
+            CHIMP_FRAME(frame)->method = method;
+            return frame;
+        }
+    }
+    return chimp_frame_new (method);
+}
+
+/* frame's call has returned: keep it around if nothing else can see it */
+static void
+chimp_vm_frame_release (ChimpVM *vm, ChimpRef *frame)
+{
+    if (CHIMP_FRAME(frame)->captured ||
+            CHIMP_METHOD_TYPE(CHIMP_FRAME(frame)->method) !=
+                CHIMP_METHOD_TYPE_BYTECODE ||
+            CHIMP_ARRAY_SIZE(vm->frame_pool) >= CHIMP_VM_FRAME_POOL_SIZE) {
+        return;
+    }
+    chimp_frame_clear (frame);
+    chimp_array_push (vm->frame_pool, frame);
+}
+
+/* drop the value stack entry `nargs` below the top (i.e. the target of a
+ * call), shuffling the args down over it.
+ */
+static void
+chimp_vm_drop_target (ChimpVM *vm, size_t nargs)
+{
+    ChimpArray *stack = CHIMP_ARRAY(vm->stack);
+    memmove (stack->items + stack->size - nargs - 1,
+             stack->items + stack->size - nargs,
+             sizeof(*stack->items) * nargs);
+    stack->size--;
+}
+
 static chimp_bool_t
-chimp_vm_pushconst (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_pushconst (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
-    ChimpRef *value = CHIMP_INSTR_CONST1(code, pc);
+    ChimpRef *value = CHIMP_INSTR_CONST(code, pc);
     if (value == NULL) {
         CHIMP_BUG ("unknown or missing const at pc=%d", pc);
         return CHIMP_FALSE;
@@ -96,11 +170,11 @@ chimp_vm_pushconst (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
 }
 
 static chimp_bool_t
-chimp_vm_storename (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_storename (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *value;
     ChimpRef *var;
-    ChimpRef *target = CHIMP_INSTR_NAME1(code, pc);
+    ChimpRef *target = CHIMP_INSTR_NAME(code, pc);
     if (target == NULL) {
         CHIMP_BUG ("unknown or missing name #%d at pc=%d", pc);
         return CHIMP_FALSE;
@@ -114,7 +188,7 @@ chimp_vm_storename (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
         CHIMP_BUG ("empty stack during assignment to %s", CHIMP_STR_DATA(target));
         return CHIMP_FALSE;
     }
-    if (chimp_hash_get (locals, target, &var) != 0) {
+    if (chimp_hash_get (CHIMP_FRAME(frame)->locals, target, &var) != 0) {
         CHIMP_BUG ("could not find local for %s", CHIMP_STR_DATA(target));
         return CHIMP_FALSE;
     }
@@ -146,6 +220,8 @@ chimp_vm_resolvename (
                 if (!binding && CHIMP_ANY_CLASS(*value) == chimp_var_class) {
                     *value = CHIMP_VAR(*value)->value;
                 }
+                /* the closure now shares this var with frame */
+                CHIMP_FRAME(frame)->captured = CHIMP_TRUE;
                 return CHIMP_TRUE;
             }
         } while (i > 0);
@@ -193,13 +269,13 @@ chimp_vm_resolvename (
 }
 
 static chimp_bool_t
-chimp_vm_pushname (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_pushname (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *value;
-    ChimpRef *name = CHIMP_INSTR_NAME1(code, pc);
+    ChimpRef *name = CHIMP_INSTR_NAME(code, pc);
     if (name == NULL) {
-        int n = CHIMP_INSTR_ARG1(code, pc);
-        CHIMP_BUG ("unknown or missing name #%d at pc=%d", n, pc);
+        size_t n = CHIMP_INSTR_OPERAND(code, pc);
+        CHIMP_BUG ("unknown or missing name #%zu at pc=%zu", n, pc);
         return CHIMP_FALSE;
     }
 
@@ -215,13 +291,13 @@ chimp_vm_pushname (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
 }
 
 static chimp_bool_t
-chimp_vm_getattr (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_getattr (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *attr;
     ChimpRef *target;
     ChimpRef *result;
     
-    attr = CHIMP_INSTR_NAME1 (code, pc);
+    attr = CHIMP_INSTR_NAME (code, pc);
     if (attr == NULL) {
         return CHIMP_FALSE;
     }
@@ -243,31 +319,154 @@ chimp_vm_getattr (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
     return CHIMP_TRUE;
 }
 
+/* where a SWITCH sends the value on top of the stack: only strs & ints are
+ * ever looked up, since only their literals make it into the table.
+ */
+static size_t
+chimp_vm_switch (ChimpVM *vm, ChimpRef *code, size_t pc)
+{
+    ChimpRef *value = CHIMP_ARRAY_LAST(vm->stack);
+    ChimpRef *klass = CHIMP_ANY_CLASS(value);
+    ChimpRef *addr;
+
+    if ((klass == chimp_str_class || klass == chimp_int_class) &&
+            chimp_hash_get (CHIMP_INSTR_CONST(code, pc), value, &addr) == 0) {
+        return (size_t) CHIMP_INT(addr)->value;
+    }
+    return pc + 1;
+}
+
+/* GETATTR for a call target the compiler has shown can't escape the frame:
+ * a method is bound into one of the frame's temps rather than a new object.
+ * temps are handed out like a stack: calls nest, so the innermost call is
+ * always the first to give its temp back (see chimp_vm_release_temp).
+ */
 static chimp_bool_t
-chimp_vm_call (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_getmethod (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
-    ChimpRef *args;
+    ChimpFrame *f = CHIMP_FRAME(frame);
+    ChimpRef *attr;
     ChimpRef *target;
     ChimpRef *result;
-    uint8_t nargs;
-    uint8_t i;
+    ChimpRef *scratch = NULL;
 
-    nargs = CHIMP_INSTR_ARG1 (code, pc);
-    args = chimp_array_new_with_capacity (nargs);
-    if (args == NULL) {
+    attr = CHIMP_INSTR_NAME (code, pc);
+    if (attr == NULL) {
         return CHIMP_FALSE;
     }
-    for (i = 0; i < nargs; i++) {
-        chimp_array_unshift (args, chimp_vm_pop (vm));
-    }
     target = chimp_vm_pop (vm);
     if (target == NULL) {
         return CHIMP_FALSE;
     }
+    if (f->temps == NULL) {
+        f->temps = chimp_array_new ();
+        if (f->temps == NULL) {
+            return CHIMP_FALSE;
+        }
+    }
+    if (f->ntemps < CHIMP_ARRAY_SIZE(f->temps)) {
+        scratch = CHIMP_ARRAY_ITEM(f->temps, f->ntemps);
+    }
+    result = chimp_object_getmethod (target, attr, &scratch);
+    if (result == NULL) {
+        return CHIMP_FALSE;
+    }
+    if (result == scratch) {
+        if (f->ntemps == CHIMP_ARRAY_SIZE(f->temps) &&
+                !chimp_array_push (f->temps, scratch)) {
+            return CHIMP_FALSE;
+        }
+        f->ntemps++;
+    }
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] GETMETHOD %s = %s\n",
+            vm, CHIMP_STR_DATA(attr), CHIMP_STR_DATA (chimp_object_str (result)));
+#endif
+    if (!chimp_vm_push (vm, result)) {
+        return CHIMP_FALSE;
+    }
+    return CHIMP_TRUE;
+}
+
+/* target is about to be called: if it's the newest of frame's temps it's
+ * free for the next GETMETHOD (nothing holds on to a native method once
+ * it's been called).
+ */
+static void
+chimp_vm_release_temp (ChimpRef *frame, ChimpRef *target)
+{
+    ChimpFrame *f = CHIMP_FRAME(frame);
+
+    if (f->ntemps > 0 && CHIMP_ARRAY_ITEM(f->temps, f->ntemps - 1) == target) {
+        f->ntemps--;
+    }
+}
+
+/* native code can't replace its own frame: it leaves the target & args on
+ * the stack, returns & lets chimp_vm_eval_frame make the call.
+ */
+static chimp_bool_t
+chimp_vm_tailcall (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    CHIMP_FRAME(frame)->pc = pc;
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_vm_call (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *args;
+    ChimpRef *target;
+    ChimpRef *result;
+    size_t nargs;
+    size_t i;
+
+    nargs = CHIMP_INSTR_OPERAND (code, pc);
+    if (CHIMP_ARRAY_SIZE(vm->stack) < nargs + 1) {
+        CHIMP_BUG ("not enough values on the stack for CALL %zu", nargs);
+        return CHIMP_FALSE;
+    }
+    target = CHIMP_ARRAY_ITEM(vm->stack, CHIMP_ARRAY_SIZE(vm->stack) - nargs - 1);
 #ifdef CHIMP_VM_DEBUG
     printf ("[%p] CALL %zu = ", vm, (intmax_t) nargs);
 #endif
-    result = chimp_object_call (target, args);
+    chimp_vm_release_temp (frame, target);
+    if (CHIMP_IS_BYTECODE_METHOD(target)) {
+        /* the callee picks its args straight up off the stack */
+        ChimpRef *callee = chimp_vm_frame_new (vm, target);
+        if (callee == NULL) {
+            return CHIMP_FALSE;
+        }
+        chimp_vm_drop_target (vm, nargs);
+        CHIMP_FRAME(callee)->stack_base = CHIMP_ARRAY_SIZE(vm->stack) - nargs;
+        result = chimp_vm_eval_frame (vm, callee);
+    }
+    else if (CHIMP_ANY_CLASS(target) == chimp_method_class &&
+             CHIMP_METHOD_TYPE(target) == CHIMP_METHOD_TYPE_NATIVE &&
+             CHIMP_NATIVE_METHOD(target)->argv != NULL &&
+             nargs <= CHIMP_NATIVE_MAX_ARGS) {
+        /* the stack may move if the callee calls back into the VM, so it
+         * gets a copy of the args. the originals stay on the stack until
+         * the call's done, which keeps them reachable.
+         */
+        ChimpRef *argv[CHIMP_NATIVE_MAX_ARGS];
+        ChimpArray *stack = CHIMP_ARRAY(vm->stack);
+        memcpy (argv, stack->items + stack->size - nargs,
+                sizeof(*argv) * nargs);
+        result = chimp_method_call_argv (target, nargs, argv);
+        CHIMP_ARRAY(vm->stack)->size -= nargs + 1;
+    }
+    else {
+        args = chimp_array_new_with_capacity (nargs);
+        if (args == NULL) {
+            return CHIMP_FALSE;
+        }
+        for (i = 0; i < nargs; i++) {
+            chimp_array_unshift (args, chimp_vm_pop (vm));
+        }
+        chimp_vm_pop (vm);
+        result = chimp_object_call (target, args);
+    }
     if (result == NULL) {
         CHIMP_BUG ("target (%s) is not callable",
             CHIMP_STR_DATA(chimp_object_str (target)));
@@ -283,11 +482,11 @@ chimp_vm_call (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
 }
 
 static chimp_bool_t
-chimp_vm_makearray (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_makearray (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *array;
-    int32_t nargs = CHIMP_INSTR_ARG1(code, pc);
-    int32_t i;
+    size_t nargs = CHIMP_INSTR_OPERAND(code, pc);
+    size_t i;
 
     array = chimp_array_new_with_capacity (nargs);
     if (array == NULL) {
@@ -309,11 +508,11 @@ chimp_vm_makearray (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
 }
 
 static chimp_bool_t
-chimp_vm_makehash (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
+chimp_vm_makehash (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *hash;
-    int32_t nargs = CHIMP_INSTR_ARG1(code, pc);
-    int32_t i;
+    size_t nargs = CHIMP_INSTR_OPERAND(code, pc);
+    size_t i;
 
     hash = chimp_hash_new ();
     if (hash == NULL) {
@@ -343,7 +542,7 @@ chimp_vm_makehash (ChimpVM *vm, ChimpRef *code, ChimpRef *locals, size_t pc)
 }
 
 static chimp_bool_t
-chimp_vm_makeclosure (ChimpVM *vm, ChimpRef *code, size_t pc)
+chimp_vm_makeclosure (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
 {
     ChimpRef *freevars;
     size_t i;
@@ -416,232 +615,630 @@ chimp_vm_cmp (ChimpVM *vm)
     return actual;
 }
 
+/* register operands: a frame slot, a constant or the top of the stack */
+static ChimpRef *
+chimp_vm_load (ChimpVM *vm, ChimpRef *code, ChimpRef *slots, int reg)
+{
+    ChimpRef *value;
+    if (reg < CHIMP_REG_CONST) {
+        value = CHIMP_VAR(CHIMP_ARRAY_ITEM(slots, reg))->value;
+        if (value == NULL) {
+            CHIMP_BUG ("local %s used before assignment",
+                CHIMP_STR_DATA(CHIMP_ARRAY_ITEM(CHIMP_CODE(code)->vars, reg)));
+        }
+        return value;
+    }
+    else if (reg != CHIMP_REG_STACK) {
+        return CHIMP_ARRAY_ITEM(CHIMP_CODE_CONSTANTS(code), reg - CHIMP_REG_CONST);
+    }
+    else {
+        return chimp_vm_pop (vm);
+    }
+}
+
+static chimp_bool_t
+chimp_vm_store (ChimpVM *vm, ChimpRef *slots, int reg, ChimpRef *value)
+{
+    if (value == NULL) {
+        return CHIMP_FALSE;
+    }
+    if (reg == CHIMP_REG_STACK) {
+        return chimp_vm_push (vm, value);
+    }
+    CHIMP_VAR(CHIMP_ARRAY_ITEM(slots, reg))->value = value;
+    return CHIMP_TRUE;
+}
+
+static chimp_bool_t
+chimp_vm_regop (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *slots = CHIMP_FRAME(frame)->slots;
+    ChimpRef *left;
+    ChimpRef *right;
+    ChimpRef *result;
+    ChimpCmpResult r;
+
+    /* the right operand is on top if both came from the stack */
+    right = chimp_vm_load (vm, code, slots, CHIMP_INSTR_REG_RIGHT(code, pc));
+    if (right == NULL) {
+        return CHIMP_FALSE;
+    }
+    left = chimp_vm_load (vm, code, slots, CHIMP_INSTR_REG_LEFT(code, pc));
+    if (left == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    switch (CHIMP_INSTR_OP(code, pc)) {
+        case CHIMP_OPCODE_ADDR:
+            result = chimp_object_add (left, right);
+            break;
+        case CHIMP_OPCODE_SUBR:
+            result = chimp_object_sub (left, right);
+            break;
+        case CHIMP_OPCODE_MULR:
+            result = chimp_object_mul (left, right);
+            break;
+        case CHIMP_OPCODE_DIVR:
+            result = chimp_object_div (left, right);
+            break;
+        default:
+            r = chimp_object_cmp (left, right);
+            if (r == CHIMP_CMP_ERROR) {
+                CHIMP_BUG ("TODO raise an exception");
+                return CHIMP_FALSE;
+            }
+            switch (CHIMP_INSTR_OP(code, pc)) {
+                case CHIMP_OPCODE_CMPEQR:
+                    result = (r == CHIMP_CMP_EQ) ? chimp_true : chimp_false;
+                    break;
+                case CHIMP_OPCODE_CMPNEQR:
+                    result = (r != CHIMP_CMP_EQ) ? chimp_true : chimp_false;
+                    break;
+                case CHIMP_OPCODE_CMPGTR:
+                    result = (r == CHIMP_CMP_GT) ? chimp_true : chimp_false;
+                    break;
+                case CHIMP_OPCODE_CMPGTER:
+                    result = (r == CHIMP_CMP_GT || r == CHIMP_CMP_EQ) ?
+                                chimp_true : chimp_false;
+                    break;
+                case CHIMP_OPCODE_CMPLTR:
+                    result = (r == CHIMP_CMP_LT) ? chimp_true : chimp_false;
+                    break;
+                case CHIMP_OPCODE_CMPLTER:
+                    result = (r == CHIMP_CMP_LT || r == CHIMP_CMP_EQ) ?
+                                chimp_true : chimp_false;
+                    break;
+                default:
+                    CHIMP_BUG ("unknown register opcode: %d",
+                        CHIMP_INSTR_OP(code, pc));
+                    return CHIMP_FALSE;
+            }
+            break;
+    }
+
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] REGOP %d = %s\n",
+            vm, CHIMP_INSTR_OP(code, pc),
+            CHIMP_STR_DATA (chimp_object_str (result)));
+#endif
+    return chimp_vm_store (vm, slots, CHIMP_INSTR_REG_DST(code, pc), result);
+}
+
+static chimp_bool_t
+chimp_vm_pushnil (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    return chimp_vm_push (vm, chimp_nil);
+}
+
+static chimp_bool_t
+chimp_vm_getclass (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *value = chimp_vm_pop (vm);
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] GETCLASS = %s\n",
+            vm, CHIMP_STR_DATA(CHIMP_CLASS_NAME(CHIMP_ANY_CLASS(value))));
+#endif
+    if (value == NULL) {
+        return CHIMP_FALSE;
+    }
+    return chimp_vm_push (vm, CHIMP_ANY_CLASS(value));
+}
+
+static chimp_bool_t
+chimp_vm_getitem (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *result;
+    ChimpRef *key;
+    ChimpRef *target;
+
+    key = chimp_vm_pop (vm);
+    if (key == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    target = chimp_vm_pop (vm);
+    if (target == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    result = chimp_object_getitem (target, key);
+    if (result == NULL) {
+        return CHIMP_FALSE;
+    }
+
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] GETITEM = %s\n",
+            vm,
+            CHIMP_STR_DATA(chimp_object_str (result)));
+#endif
+
+    return chimp_vm_push (vm, result);
+}
+
+static chimp_bool_t
+chimp_vm_spawn (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *task;
+    ChimpRef *target;
+
+    target = chimp_vm_pop (vm);
+    if (target == NULL) {
+        return CHIMP_FALSE;
+    }
+    if (CHIMP_METHOD_TYPE(target) == CHIMP_METHOD_TYPE_CLOSURE) {
+        CHIMP_BUG ("cannot use the spawn keyword with a closure");
+        return CHIMP_FALSE;
+    }
+    task = chimp_task_new (target);
+    if (task == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    return chimp_vm_push (vm, task);
+}
+
+static chimp_bool_t
+chimp_vm_dup (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *top = chimp_vm_top (vm);
+
+    if (top == NULL) {
+        return CHIMP_FALSE;
+    }
+
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] DUP = %s\n",
+            vm,
+            CHIMP_STR_DATA (chimp_object_str (top)));
+#endif
+
+    return chimp_vm_push (vm, top);
+}
+
+static chimp_bool_t
+chimp_vm_not (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *value = chimp_vm_pop (vm);
+    if (value == NULL) {
+        return CHIMP_FALSE;
+    }
+    if (chimp_vm_truthy (value)) {
+        return chimp_vm_pushfalse (vm);
+    }
+    else {
+        return chimp_vm_pushtrue (vm);
+    }
+}
+
+static chimp_bool_t
+chimp_vm_cmpop (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    chimp_bool_t result;
+    ChimpCmpResult r = chimp_vm_cmp (vm);
+    if (r == CHIMP_CMP_ERROR) {
+        return CHIMP_FALSE;
+    }
+    switch (CHIMP_INSTR_OP(code, pc)) {
+        case CHIMP_OPCODE_CMPEQ:
+            result = (r == CHIMP_CMP_EQ);
+            break;
+        case CHIMP_OPCODE_CMPNEQ:
+            result = (r != CHIMP_CMP_EQ);
+            break;
+        case CHIMP_OPCODE_CMPGT:
+            result = (r == CHIMP_CMP_GT);
+            break;
+        case CHIMP_OPCODE_CMPGTE:
+            result = (r == CHIMP_CMP_GT || r == CHIMP_CMP_EQ);
+            break;
+        case CHIMP_OPCODE_CMPLT:
+            result = (r == CHIMP_CMP_LT);
+            break;
+        case CHIMP_OPCODE_CMPLTE:
+            result = (r == CHIMP_CMP_LT || r == CHIMP_CMP_EQ);
+            break;
+        default:
+            CHIMP_BUG ("unknown comparison opcode: %d",
+                CHIMP_INSTR_OP(code, pc));
+            return CHIMP_FALSE;
+    }
+    return result ? chimp_vm_pushtrue (vm) : chimp_vm_pushfalse (vm);
+}
+
+static chimp_bool_t
+chimp_vm_discard (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] POP = %s\n",
+            vm, CHIMP_STR_DATA (chimp_object_str (chimp_vm_top (vm))));
+#endif
+    return chimp_vm_pop (vm) != NULL;
+}
+
+static chimp_bool_t
+chimp_vm_binop (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *left;
+    ChimpRef *right;
+    ChimpRef *result;
+
+    right = chimp_vm_pop (vm);
+    if (right == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    left = chimp_vm_pop (vm);
+    if (left == NULL) {
+        return CHIMP_FALSE;
+    }
+
+    switch (CHIMP_INSTR_OP(code, pc)) {
+        case CHIMP_OPCODE_ADD:
+            result = chimp_object_add (left, right);
+            break;
+        case CHIMP_OPCODE_SUB:
+            result = chimp_object_sub (left, right);
+            break;
+        case CHIMP_OPCODE_MUL:
+            result = chimp_object_mul (left, right);
+            break;
+        case CHIMP_OPCODE_DIV:
+            result = chimp_object_div (left, right);
+            break;
+        default:
+            CHIMP_BUG ("unknown arithmetic opcode: %d",
+                CHIMP_INSTR_OP(code, pc));
+            return CHIMP_FALSE;
+    }
+#ifdef CHIMP_VM_DEBUG
+    printf ("[%p] BINOP %d = %s\n",
+            vm, CHIMP_INSTR_OP(code, pc),
+            CHIMP_STR_DATA (chimp_object_str (result)));
+#endif
+    return chimp_vm_push (vm, result);
+}
+
+static chimp_bool_t
+chimp_vm_move (ChimpVM *vm, ChimpRef *code, ChimpRef *frame, size_t pc)
+{
+    ChimpRef *slots = CHIMP_FRAME(frame)->slots;
+    ChimpRef *value =
+        chimp_vm_load (vm, code, slots, CHIMP_INSTR_REG_LEFT(code, pc));
+    return chimp_vm_store (vm, slots, CHIMP_INSTR_REG_DST(code, pc), value);
+}
+
+int
+chimp_vm_test (ChimpVM *vm)
+{
+    ChimpRef *value = chimp_vm_pop (vm);
+    if (value == NULL) {
+        CHIMP_BUG ("NULL value on the stack");
+        return -1;
+    }
+    return chimp_vm_truthy (value);
+}
+
+ChimpVMOpFunc
+chimp_vm_op_func (ChimpOpcode op)
+{
+    switch (op) {
+        case CHIMP_OPCODE_PUSHCONST:
+            return chimp_vm_pushconst;
+        case CHIMP_OPCODE_STORENAME:
+            return chimp_vm_storename;
+        case CHIMP_OPCODE_PUSHNAME:
+            return chimp_vm_pushname;
+        case CHIMP_OPCODE_PUSHNIL:
+            return chimp_vm_pushnil;
+        case CHIMP_OPCODE_GETCLASS:
+            return chimp_vm_getclass;
+        case CHIMP_OPCODE_GETATTR:
+            return chimp_vm_getattr;
+        case CHIMP_OPCODE_GETMETHOD:
+            return chimp_vm_getmethod;
+        case CHIMP_OPCODE_GETITEM:
+            return chimp_vm_getitem;
+        case CHIMP_OPCODE_CALL:
+            return chimp_vm_call;
+        case CHIMP_OPCODE_TAILCALL:
+            return chimp_vm_tailcall;
+        case CHIMP_OPCODE_SPAWN:
+            return chimp_vm_spawn;
+        case CHIMP_OPCODE_DUP:
+            return chimp_vm_dup;
+        case CHIMP_OPCODE_NOT:
+            return chimp_vm_not;
+        case CHIMP_OPCODE_MAKEARRAY:
+            return chimp_vm_makearray;
+        case CHIMP_OPCODE_MAKEHASH:
+            return chimp_vm_makehash;
+        case CHIMP_OPCODE_MAKECLOSURE:
+            return chimp_vm_makeclosure;
+        case CHIMP_OPCODE_CMPEQ:
+        case CHIMP_OPCODE_CMPNEQ:
+        case CHIMP_OPCODE_CMPGT:
+        case CHIMP_OPCODE_CMPGTE:
+        case CHIMP_OPCODE_CMPLT:
+        case CHIMP_OPCODE_CMPLTE:
+            return chimp_vm_cmpop;
+        case CHIMP_OPCODE_POP:
+            return chimp_vm_discard;
+        case CHIMP_OPCODE_ADD:
+        case CHIMP_OPCODE_SUB:
+        case CHIMP_OPCODE_MUL:
+        case CHIMP_OPCODE_DIV:
+            return chimp_vm_binop;
+        case CHIMP_OPCODE_MOVE:
+            return chimp_vm_move;
+        case CHIMP_OPCODE_ADDR:
+        case CHIMP_OPCODE_SUBR:
+        case CHIMP_OPCODE_MULR:
+        case CHIMP_OPCODE_DIVR:
+        case CHIMP_OPCODE_CMPEQR:
+        case CHIMP_OPCODE_CMPNEQR:
+        case CHIMP_OPCODE_CMPGTR:
+        case CHIMP_OPCODE_CMPGTER:
+        case CHIMP_OPCODE_CMPLTR:
+        case CHIMP_OPCODE_CMPLTER:
+            return chimp_vm_regop;
+        default:
+            /* control flow: the caller has to deal with these itself */
+            return NULL;
+    }
+}
+
+/* runs frame & any bytecode it calls in a single C activation: calls
+ * between bytecode methods push a frame & continue, returns pop it.
+ * only calls into native code (& the JIT) recurse.
+ */
 static ChimpRef *
 chimp_vm_eval_frame (ChimpVM *vm, ChimpRef *frame)
 {
-    ChimpRef *code = CHIMP_FRAME_CODE(frame);
-    ChimpRef *locals = CHIMP_FRAME(frame)->locals;
+    const size_t depth = CHIMP_ARRAY_SIZE(vm->frames);
+    ChimpRef *code;
+    ChimpRef *result;
+    size_t pc;
 
     if (!chimp_array_push (vm->frames, frame)) {
-        return CHIMP_FALSE;
+        return NULL;
     }
 
-    size_t pc = 0;
+enter:
+    code = CHIMP_FRAME_CODE(frame);
+    pc = 0;
+
+#ifdef CHIMP_HAVE_JIT
+    if (CHIMP_CODE_JIT(code) == NULL &&
+            ++CHIMP_CODE(code)->calls == chimp_jit_threshold () &&
+            chimp_jit_enabled ()) {
+        chimp_jit_compile (code);
+    }
+    if (CHIMP_CODE_JIT(code) != NULL) {
+        if (!CHIMP_CODE_JIT(code) (vm, code, frame)) {
+            goto error;
+        }
+        pc = CHIMP_FRAME(frame)->pc;
+        if (pc == 0 || CHIMP_INSTR_OP(code, pc) != CHIMP_OPCODE_TAILCALL) {
+            goto ret;
+        }
+        /* see chimp_vm_tailcall */
+        goto resume;
+    }
+#endif
+
+resume:
     while (pc < CHIMP_CODE_SIZE(code)) {
         switch (CHIMP_INSTR_OP(code, pc)) {
             case CHIMP_OPCODE_PUSHCONST:
             {
-                if (!chimp_vm_pushconst (vm, code, locals, pc)) {
+                if (!chimp_vm_pushconst (vm, code, frame, pc)) {
                     CHIMP_BUG ("PUSHCONST instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_STORENAME:
             {
-                if (!chimp_vm_storename (vm, code, locals, pc)) {
+                if (!chimp_vm_storename (vm, code, frame, pc)) {
                     CHIMP_BUG ("STORENAME instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_PUSHNAME:
             {
-                if (!chimp_vm_pushname (vm, code, locals, pc)) {
+                if (!chimp_vm_pushname (vm, code, frame, pc)) {
                     CHIMP_BUG ("PUSHNAME instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_PUSHNIL:
             {
-                if (!chimp_vm_push (vm, chimp_nil)) {
+                if (!chimp_vm_pushnil (vm, code, frame, pc)) {
                     CHIMP_BUG ("PUSHNIL instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_GETCLASS:
             {
-                ChimpRef *value = chimp_vm_pop (vm);
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] GETCLASS = %s\n",
-                        vm, CHIMP_STR_DATA(CHIMP_CLASS_NAME(CHIMP_ANY_CLASS(value))));
-#endif
-                if (value == NULL) {
+                if (!chimp_vm_getclass (vm, code, frame, pc)) {
                     CHIMP_BUG ("GETCLASS instruction failed");
-                    return NULL;
-                }
-                if (!chimp_vm_push (vm, CHIMP_ANY_CLASS(value))) {
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_GETATTR:
             {
-                if (!chimp_vm_getattr (vm, code, locals, pc)) {
+                if (!chimp_vm_getattr (vm, code, frame, pc)) {
                     CHIMP_BUG ("GETATTR instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
-            case CHIMP_OPCODE_GETITEM:
+            case CHIMP_OPCODE_GETMETHOD:
             {
-                ChimpRef *result;
-                ChimpRef *key;
-                ChimpRef *target;
-                
-                key = chimp_vm_pop (vm);
-                if (key == NULL) {
-                    CHIMP_BUG ("GETITEM instruction failed 1");
-                    return NULL;
-                }
-
-                target = chimp_vm_pop (vm);
-                if (target == NULL) {
-                    CHIMP_BUG ("GETITEM instruction failed 2");
-                    return NULL;
+                if (!chimp_vm_getmethod (vm, code, frame, pc)) {
+                    CHIMP_BUG ("GETMETHOD instruction failed");
+                    goto error;
                 }
-
-                result = chimp_object_getitem (target, key);
-                if (result == NULL) {
-                    CHIMP_BUG ("GETITEM instruction failed 3");
-                    return NULL;
-                }
-
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] GETITEM = %s\n",
-                        vm,
-                        CHIMP_STR_DATA(chimp_object_str (result)));
-#endif
-
-                if (!chimp_vm_push (vm, result)) {
-                    CHIMP_BUG ("GETITEM instruction failed 4");
-                    return NULL;
+                pc++;
+                break;
+            }
+            case CHIMP_OPCODE_GETITEM:
+            {
+                if (!chimp_vm_getitem (vm, code, frame, pc)) {
+                    CHIMP_BUG ("GETITEM instruction failed");
+                    goto error;
                 }
-
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_CALL:
             {
-                if (!chimp_vm_call (vm, code, locals, pc)) {
+                size_t nargs = CHIMP_INSTR_OPERAND(code, pc);
+                ChimpRef *target = CHIMP_ARRAY_ITEM(
+                    vm->stack, CHIMP_ARRAY_SIZE(vm->stack) - nargs - 1);
+                if (CHIMP_IS_BYTECODE_METHOD(target)) {
+                    ChimpRef *callee = chimp_vm_frame_new (vm, target);
+                    if (callee == NULL) {
+                        goto error;
+                    }
+                    chimp_vm_drop_target (vm, nargs);
+                    CHIMP_FRAME(callee)->stack_base =
+                        CHIMP_ARRAY_SIZE(vm->stack) - nargs;
+                    if (!chimp_array_push (vm->frames, callee)) {
+                        goto error;
+                    }
+                    CHIMP_FRAME(frame)->pc = pc + 1;
+                    frame = callee;
+                    goto enter;
+                }
+                if (!chimp_vm_call (vm, code, frame, pc)) {
                     CHIMP_BUG ("CALL instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
+            case CHIMP_OPCODE_TAILCALL:
+            {
+                size_t nargs = CHIMP_INSTR_OPERAND(code, pc);
+                ChimpArray *stack = CHIMP_ARRAY(vm->stack);
+                ChimpRef *target = stack->items[stack->size - nargs - 1];
+                if (CHIMP_IS_BYTECODE_METHOD(target)) {
+                    size_t base = CHIMP_FRAME(frame)->stack_base;
+                    ChimpRef *callee = chimp_vm_frame_new (vm, target);
+                    if (callee == NULL) {
+                        goto error;
+                    }
+                    /* the args replace everything this frame put on the stack */
+                    memmove (stack->items + base,
+                             stack->items + stack->size - nargs,
+                             sizeof(*stack->items) * nargs);
+                    stack->size = base + nargs;
+                    chimp_vm_frame_release (vm, frame);
+                    frame = callee;
+                    CHIMP_FRAME(frame)->stack_base = base;
+                    CHIMP_ARRAY(vm->frames)->items[
+                        CHIMP_ARRAY_SIZE(vm->frames) - 1] = frame;
+                    goto enter;
+                }
+                if (!chimp_vm_call (vm, code, frame, pc)) {
+                    CHIMP_BUG ("TAILCALL instruction failed");
+                    goto error;
+                }
+                goto ret;
+            }
             case CHIMP_OPCODE_RET:
             {
-                goto done;
+                goto ret;
             }
             case CHIMP_OPCODE_SPAWN:
             {
-                ChimpRef *task;
-                ChimpRef *target;
-
-                target = chimp_vm_pop (vm);
-                if (target == NULL) {
-                    return CHIMP_FALSE;
-                }
-                if (CHIMP_METHOD_TYPE(target) == CHIMP_METHOD_TYPE_CLOSURE) {
-                    CHIMP_BUG ("cannot use the spawn keyword with a closure");
-                    return CHIMP_FALSE;
-                }
-                task = chimp_task_new (target);
-                if (task == NULL) {
-                    return CHIMP_FALSE;
+                if (!chimp_vm_spawn (vm, code, frame, pc)) {
+                    goto error;
                 }
-
-                if (!chimp_vm_push (vm, task)) {
-                    return CHIMP_FALSE;
-                }
-
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_DUP:
             {
-                ChimpRef *top = chimp_vm_top (vm);
-
-                if (top == NULL) {
-                    return CHIMP_FALSE;
-                }
-
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] DUP = %s\n",
-                        vm,
-                        CHIMP_STR_DATA (chimp_object_str (top)));
-#endif
-
-                if (!chimp_vm_push (vm, top)) {
-                    return CHIMP_FALSE;
+                if (!chimp_vm_dup (vm, code, frame, pc)) {
+                    goto error;
                 }
-
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_NOT:
             {
-                ChimpRef *value = chimp_vm_pop (vm);
-                if (value == NULL) {
-                    return CHIMP_FALSE;
-                }
-                if (chimp_vm_truthy (value)) {
-                    if (!chimp_vm_push (vm, chimp_false)) {
-                        return CHIMP_FALSE;
-                    }
-                }
-                else {
-                    if (!chimp_vm_push (vm, chimp_true)) {
-                        return CHIMP_FALSE;
-                    }
+                if (!chimp_vm_not (vm, code, frame, pc)) {
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_MAKEARRAY:
             {
-                if (!chimp_vm_makearray (vm, code, locals, pc)) {
+                if (!chimp_vm_makearray (vm, code, frame, pc)) {
                     CHIMP_BUG ("MAKEARRAY instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_MAKEHASH:
             {
-                if (!chimp_vm_makehash (vm, code, locals, pc)) {
+                if (!chimp_vm_makehash (vm, code, frame, pc)) {
                     CHIMP_BUG ("MAKEHASH instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_MAKECLOSURE:
             {
-                if (!chimp_vm_makeclosure (vm, code, pc)) {
+                if (!chimp_vm_makeclosure (vm, code, frame, pc)) {
                     CHIMP_BUG ("MAKECLOSURE instruction failed");
-                    return NULL;
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_JUMPIFTRUE:
             {
-                ChimpRef *value = chimp_vm_pop (vm);
-                if (value == NULL) {
-                    CHIMP_BUG ("NULL value on the stack");
-                    return NULL;
+                int r = chimp_vm_test (vm);
+                if (r < 0) {
+                    goto error;
                 }
-                if (chimp_vm_truthy (value)) {
+                if (r) {
 #ifdef CHIMP_VM_DEBUG
                     printf ("[%p] JUMPIFTRUE %zu\n", vm, (intmax_t) pc);
 #endif
@@ -654,13 +1251,11 @@ chimp_vm_eval_frame (ChimpVM *vm, ChimpRef *frame)
             }
             case CHIMP_OPCODE_JUMPIFFALSE:
             {
-                ChimpRef *value = chimp_vm_pop (vm);
-                if (value == NULL) {
-                    CHIMP_BUG ("NULL value on the stack");
-                    return NULL;
+                int r = chimp_vm_test (vm);
+                if (r < 0) {
+                    goto error;
                 }
-                /* TODO test for non-truthiness */
-                if (value == chimp_false || value == chimp_nil) {
+                if (!r) {
 #ifdef CHIMP_VM_DEBUG
                     printf ("[%p] JUMPIFFALSE %zu\n", vm, (intmax_t) pc);
 #endif
@@ -676,247 +1271,111 @@ chimp_vm_eval_frame (ChimpVM *vm, ChimpRef *frame)
                 pc = CHIMP_INSTR_ADDR(code, pc);
                 break;
             }
-            case CHIMP_OPCODE_CMPEQ:
+            case CHIMP_OPCODE_SWITCH:
             {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_EQ) {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
-                }
-                pc++;
+                pc = chimp_vm_switch (vm, code, pc);
                 break;
             }
+            case CHIMP_OPCODE_CMPEQ:
             case CHIMP_OPCODE_CMPNEQ:
-            {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_EQ) {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                pc++;
-                break;
-            }
             case CHIMP_OPCODE_CMPGT:
-            {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_GT) {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
-                }
-                pc++;
-                break;
-            }
             case CHIMP_OPCODE_CMPGTE:
-            {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_GT || r == CHIMP_CMP_EQ) {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
-                }
-                pc++;
-                break;
-            }
             case CHIMP_OPCODE_CMPLT:
-            {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_LT) {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
-                }
-                pc++;
-                break;
-            }
             case CHIMP_OPCODE_CMPLTE:
             {
-                ChimpCmpResult r = chimp_vm_cmp (vm);
-                if (r == CHIMP_CMP_ERROR) {
-                    return NULL;
-                }
-                else if (r == CHIMP_CMP_LT || r == CHIMP_CMP_EQ) {
-                    if (!chimp_vm_pushtrue (vm)) {
-                        return NULL;
-                    }
-                }
-                else {
-                    if (!chimp_vm_pushfalse (vm)) {
-                        return NULL;
-                    }
+                if (!chimp_vm_cmpop (vm, code, frame, pc)) {
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_POP:
             {
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] POP = %s\n",
-                        vm, CHIMP_STR_DATA (chimp_object_str (chimp_vm_top (vm))));
-#endif
-                if (!chimp_vm_pop (vm)) {
-                    return NULL;
+                if (!chimp_vm_discard (vm, code, frame, pc)) {
+                    goto error;
                 }
                 pc++;
                 break;
             }
             case CHIMP_OPCODE_ADD:
+            case CHIMP_OPCODE_SUB:
+            case CHIMP_OPCODE_MUL:
+            case CHIMP_OPCODE_DIV:
             {
-                ChimpRef *left;
-                ChimpRef *right;
-                ChimpRef *result;
-
-                right = chimp_vm_pop (vm);
-                if (right == NULL) {
-                    return NULL;
-                }
-
-                left = chimp_vm_pop (vm);
-                if (left == NULL) {
-                    return NULL;
-                }
-
-                result = chimp_object_add (left, right);
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] ADD = %s\n", vm, CHIMP_STR_DATA (chimp_object_str (result)));
-#endif
-                if (!chimp_vm_push (vm, result)) {
-                    return NULL;
+                if (!chimp_vm_binop (vm, code, frame, pc)) {
+                    goto error;
                 }
                 pc++;
                 break;
             }
-            case CHIMP_OPCODE_SUB:
+            case CHIMP_OPCODE_MOVE:
             {
-                ChimpRef *left;
-                ChimpRef *right;
-                ChimpRef *result;
-
-                right = chimp_vm_pop (vm);
-                if (right == NULL) {
-                    return NULL;
-                }
-
-                left = chimp_vm_pop (vm);
-                if (left == NULL) {
-                    return NULL;
-                }
-
-                result = chimp_object_sub (left, right);
-                if (!chimp_vm_push (vm, result)) {
-                    return NULL;
+                if (!chimp_vm_move (vm, code, frame, pc)) {
+                    CHIMP_BUG ("MOVE instruction failed");
+                    goto error;
                 }
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] SUB = %s\n", vm, CHIMP_STR_DATA (chimp_object_str (result)));
-#endif
                 pc++;
                 break;
             }
-            case CHIMP_OPCODE_MUL:
+            case CHIMP_OPCODE_ADDR:
+            case CHIMP_OPCODE_SUBR:
+            case CHIMP_OPCODE_MULR:
+            case CHIMP_OPCODE_DIVR:
+            case CHIMP_OPCODE_CMPEQR:
+            case CHIMP_OPCODE_CMPNEQR:
+            case CHIMP_OPCODE_CMPGTR:
+            case CHIMP_OPCODE_CMPGTER:
+            case CHIMP_OPCODE_CMPLTR:
+            case CHIMP_OPCODE_CMPLTER:
             {
-                ChimpRef *left;
-                ChimpRef *right;
-                ChimpRef *result;
-
-                right = chimp_vm_pop (vm);
-                if (right == NULL) {
-                    return NULL;
+                if (!chimp_vm_regop (vm, code, frame, pc)) {
+                    goto error;
                 }
-
-                left = chimp_vm_pop (vm);
-                if (left == NULL) {
-                    return NULL;
-                }
-
-                result = chimp_object_mul (left, right);
-                if (!chimp_vm_push (vm, result)) {
-                    return NULL;
-                }
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] MUL = %s\n", vm, CHIMP_STR_DATA (chimp_object_str (result)));
-#endif
                 pc++;
                 break;
             }
-            case CHIMP_OPCODE_DIV:
+            case CHIMP_OPCODE_EXTENDEDARG:
             {
-                ChimpRef *left;
-                ChimpRef *right;
-                ChimpRef *result;
-
-                right = chimp_vm_pop (vm);
-                if (right == NULL) {
-                    return NULL;
-                }
-
-                left = chimp_vm_pop (vm);
-                if (left == NULL) {
-                    return NULL;
-                }
-
-                result = chimp_object_div (left, right);
-                if (!chimp_vm_push (vm, result)) {
-                    return NULL;
-                }
-#ifdef CHIMP_VM_DEBUG
-                printf ("[%p] DIV = %s\n", vm, CHIMP_STR_DATA (chimp_object_str (result)));
-#endif
+                /* the next instruction picks this up itself */
                 pc++;
                 break;
             }
             default:
             {
                 CHIMP_BUG ("unknown opcode: %d", CHIMP_INSTR_OP(code, pc));
-                return NULL;
+                goto error;
             }
         };
     }
+    goto ret;
 
-done:
+ret:
+    /* falling off the end of a method leaves nothing behind: nil */
+    if (CHIMP_ARRAY_SIZE(vm->stack) > CHIMP_FRAME(frame)->stack_base) {
+        result = chimp_vm_pop (vm);
+        CHIMP_ARRAY(vm->stack)->size = CHIMP_FRAME(frame)->stack_base;
+    }
+    else {
+        result = chimp_nil;
+    }
     chimp_array_pop (vm->frames);
-    return chimp_vm_pop(vm);
+    chimp_vm_frame_release (vm, frame);
+    if (CHIMP_ARRAY_SIZE(vm->frames) == depth) {
+        return result;
+    }
+
+    /* back to the caller */
+    frame = CHIMP_ARRAY_LAST(vm->frames);
+    code = CHIMP_FRAME_CODE(frame);
+    pc = CHIMP_FRAME(frame)->pc;
+    if (!chimp_vm_push (vm, result)) {
+        goto error;
+    }
+    goto resume;
+
+error:
+    CHIMP_ARRAY(vm->frames)->size = depth;
+    return NULL;
 }
 
 /*
@@ -939,14 +1398,6 @@ chimp_vm_eval (ChimpVM *vm, ChimpRef *code, ChimpRef *locals)
 }
 */
 
-#define CHIMP_IS_BYTECODE_METHOD(ref) \
-    (CHIMP_ANY_CLASS(ref) == chimp_method_class && \
-        ( \
-            (CHIMP_METHOD(ref)->type == CHIMP_METHOD_TYPE_BYTECODE) || \
-            (CHIMP_METHOD(ref)->type == CHIMP_METHOD_TYPE_CLOSURE) \
-        ) \
-    )
-
 ChimpRef *
 chimp_vm_invoke (ChimpVM *vm, ChimpRef *method, ChimpRef *args)
 {
@@ -966,11 +1417,12 @@ chimp_vm_invoke (ChimpVM *vm, ChimpRef *method, ChimpRef *args)
     /* save the stack */
     stack_size = CHIMP_ARRAY_SIZE(vm->stack);
 
-    frame = chimp_frame_new (method);
+    frame = chimp_vm_frame_new (vm, method);
     if (frame == NULL) {
         CHIMP_BUG ("chimp_vm_invoke failed to create a new execution frame");
         return NULL;
     }
+    CHIMP_FRAME(frame)->stack_base = stack_size;
 
     /* push args */
     for (i = 0; i < CHIMP_ARRAY_SIZE(args); i++) {
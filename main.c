@@ -64,6 +64,28 @@ parse_args (int argc, char **argv)
     return args;
 }
 
+/* chimp --compile <file>... writes a .chimpc beside each source file */
+static int
+compile_main (int argc, char **argv)
+{
+    int i;
+    int rc = 0;
+
+    for (i = 2; i < argc; i++) {
+        ChimpRef *module = chimp_compile_file (NULL, argv[i]);
+        if (module == NULL) {
+            fprintf (stderr, "error: failed to compile %s\n", argv[i]);
+            rc = 1;
+            continue;
+        }
+        if (!chimp_code_cache_write (module, argv[i])) {
+            fprintf (stderr, "error: failed to write bytecode for %s\n", argv[i]);
+            rc = 1;
+        }
+    }
+    return rc;
+}
+
 static int
 real_main (int argc, char **argv)
 {
@@ -74,10 +96,18 @@ real_main (int argc, char **argv)
     if (argc < 2) {
         fprintf (stderr, "chimp v%s [%s/%s]\n", CHIMP_VERSION, CHIMP_OS, CHIMP_ARCH);
         fprintf (stderr, "usage: %s <file>\n", argv[0]);
+        fprintf (stderr, "       %s --compile <file>...\n", argv[0]);
         return 1;
     }
 
-    module = CHIMP_COMPILE_MODULE_FROM_FILE (NULL, argv[1]);
+    if (strcmp (argv[1], "--compile") == 0) {
+        return compile_main (argc, argv);
+    }
+
+    module = chimp_code_cache_load (NULL, argv[1]);
+    if (module == chimp_nil) {
+        module = CHIMP_COMPILE_MODULE_FROM_FILE (NULL, argv[1]);
+    }
     if (module == NULL) {
         fprintf (stderr, "error: failed to compile %s\n", argv[1]);
         return 1;
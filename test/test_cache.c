@@ -0,0 +1,181 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+#include <unistd.h>
+
+#define CACHE_TEST_SOURCE \
+    "double n {\n  ret n * 2\n}\n\nmain argv {\n  ret double(21)\n}\n"
+
+static char cache_dir[64];
+static char cache_source[128];
+static char cache_file[128];
+
+void
+test_cache_setup (void)
+{
+    strcpy (cache_dir, "/tmp/chimp-cache-test-XXXXXX");
+    fail_unless (mkdtemp (cache_dir) != NULL, "mkdtemp failed");
+    snprintf (cache_source, sizeof(cache_source), "%s/answer.chimp", cache_dir);
+    snprintf (cache_file, sizeof(cache_file), "%s/answer.chimpc", cache_dir);
+    fail_unless (chimp_core_startup (cache_dir, stack_base), "core_startup failed");
+}
+
+void
+test_cache_teardown (void)
+{
+    chimp_core_shutdown ();
+    remove (cache_file);
+    remove (cache_source);
+    remove (cache_dir);
+}
+
+static void
+cache_write_source (const char *source)
+{
+    FILE *file = fopen (cache_source, "w");
+    fail_unless (file != NULL, "couldn't write %s", cache_source);
+    fputs (source, file);
+    fclose (file);
+}
+
+/* what chimp --compile does for each file it's given */
+static void
+cache_compile (void)
+{
+    ChimpRef *mod = chimp_compile_file (NULL, cache_source);
+    fail_unless (mod != NULL, "expected %s to compile", cache_source);
+    fail_unless (chimp_code_cache_write (mod, cache_source),
+                "expected the cache to be written");
+}
+
+static ChimpRef *
+cache_run_main (ChimpRef *mod)
+{
+    ChimpRef *main_method = chimp_object_getattr_str (mod, "main");
+    fail_unless (main_method != NULL, "expected a main method");
+    return chimp_vm_invoke (
+        NULL, main_method, chimp_array_new_var (chimp_array_new (), NULL));
+}
+
+/* flips a bit n bytes from the end of the cache */
+static void
+cache_corrupt (long n)
+{
+    int c;
+    FILE *file = fopen (cache_file, "r+b");
+    fail_unless (file != NULL, "couldn't open %s", cache_file);
+    fseek (file, -n, SEEK_END);
+    c = fgetc (file);
+    fseek (file, -n, SEEK_END);
+    fputc (c ^ 0x01, file);
+    fclose (file);
+}
+
+/* a module whose main is nothing but the given instruction & a RET */
+static void
+cache_write_module_with (uint32_t instr)
+{
+    ChimpRef *mod = chimp_module_new (CHIMP_STR_NEW ("answer"), NULL);
+    ChimpRef *code = chimp_code_new ();
+    fail_unless (chimp_code_pushconst (code, chimp_int_new (42)), "pushconst failed");
+    fail_unless (chimp_code_ret (code), "ret failed");
+    CHIMP_CODE(code)->bytecode[0] = instr;
+    fail_unless (chimp_module_add_local (mod, CHIMP_STR_NEW ("main"),
+                    chimp_method_new_bytecode (mod, code)), "add_local failed");
+    fail_unless (chimp_code_cache_write (mod, cache_source),
+                "expected the cache to be written");
+}
+
+START_TEST(cache_round_trip)
+{
+    ChimpRef *mod;
+    ChimpRef *result;
+
+    cache_write_source (CACHE_TEST_SOURCE);
+    cache_compile ();
+    fail_unless (access (cache_file, R_OK) == 0, "expected %s", cache_file);
+
+    mod = chimp_code_cache_load (NULL, cache_source);
+    fail_unless (mod != NULL && mod != chimp_nil, "expected the cache to load");
+    result = cache_run_main (mod);
+    fail_unless (result != NULL && CHIMP_ANY_CLASS(result) == chimp_int_class &&
+                    CHIMP_INT(result)->value == 42,
+                "expected main to return 42");
+}
+END_TEST
+
+START_TEST(cache_ignores_stale_source)
+{
+    cache_write_source (CACHE_TEST_SOURCE);
+    cache_compile ();
+
+    /* touched, but the same: still good */
+    cache_write_source (CACHE_TEST_SOURCE);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) != chimp_nil,
+                "expected an unchanged source to keep its cache");
+
+    cache_write_source ("main argv {\n  ret 1\n}\n");
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a changed source to invalidate the cache");
+}
+END_TEST
+
+START_TEST(cache_ignores_corrupt_payload)
+{
+    cache_write_source (CACHE_TEST_SOURCE);
+    cache_compile ();
+    fail_unless (chimp_code_cache_load (NULL, cache_source) != chimp_nil,
+                "expected the cache to load");
+
+    cache_corrupt (3);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a corrupt cache to be ignored");
+
+    fail_unless (truncate (cache_file, 64) == 0, "truncate failed");
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a truncated cache to be ignored");
+}
+END_TEST
+
+START_TEST(cache_ignores_bad_operands)
+{
+    cache_write_source (CACHE_TEST_SOURCE);
+
+    cache_write_module_with ((CHIMP_OPCODE_PUSHCONST << 24) | 0);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) != chimp_nil,
+                "expected a valid constant index to load");
+
+    cache_write_module_with ((CHIMP_OPCODE_PUSHCONST << 24) | 7);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a bad constant index to be rejected");
+
+    cache_write_module_with ((CHIMP_OPCODE_PUSHNAME << 24) | 0);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a bad name index to be rejected");
+
+    cache_write_module_with (
+        (CHIMP_OPCODE_MOVE << 24) | (CHIMP_REG_STACK << 16) | (3 << 8));
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a bad var index to be rejected");
+
+    cache_write_module_with ((CHIMP_OPCODE_JUMP << 24) | 3);
+    fail_unless (chimp_code_cache_load (NULL, cache_source) == chimp_nil,
+                "expected a jump past the end to be rejected");
+}
+END_TEST
+
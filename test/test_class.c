@@ -93,3 +93,58 @@ START_TEST(nil_value_should_have_nil_class)
 }
 END_TEST
 
+
+static ChimpRef *
+_test_class_count_args (ChimpRef *self, size_t argc, ChimpRef **argv)
+{
+    return chimp_int_new ((int64_t) argc);
+}
+
+START_TEST(argv_methods_should_parse_their_signature_once)
+{
+    ChimpRef *args = chimp_array_new ();
+    ChimpRef *result;
+    ChimpRef *method = chimp_method_new_native_argv (
+        NULL, "count", "s|I", _test_class_count_args);
+
+    fail_unless (method != NULL, "creating argv method failed");
+    fail_unless (CHIMP_NATIVE_METHOD(method)->sig.min == 1,
+                "expected 1 required arg");
+    fail_unless (CHIMP_NATIVE_METHOD(method)->sig.max == 2,
+                "expected 2 args at most");
+
+    chimp_array_push (args, CHIMP_STR_NEW ("x"));
+    result = chimp_object_call (method, args);
+    fail_unless (result != NULL && CHIMP_INT_VALUE(result) == 1,
+                "expected the method to see 1 arg");
+
+    chimp_array_push (args, chimp_int_new (3));
+    result = chimp_object_call (method, args);
+    fail_unless (result != NULL && CHIMP_INT_VALUE(result) == 2,
+                "expected the method to see 2 args");
+}
+END_TEST
+
+START_TEST(getmethod_should_bind_native_methods_into_scratch)
+{
+    ChimpRef *a = chimp_array_new ();
+    ChimpRef *b = chimp_array_new ();
+    ChimpRef *scratch = NULL;
+    ChimpRef *method;
+
+    method = chimp_object_getmethod (a, CHIMP_STR_NEW ("size"), &scratch);
+    fail_unless (method != NULL && method == scratch,
+                "expected a new bound method in scratch");
+    fail_unless (CHIMP_METHOD(method)->self == a, "expected it bound to a");
+
+    method = chimp_object_getmethod (b, CHIMP_STR_NEW ("push"), &scratch);
+    fail_unless (method == scratch, "expected scratch to be reused");
+    fail_unless (CHIMP_METHOD(method)->self == b, "expected it bound to b");
+    fail_unless (CHIMP_NATIVE_METHOD(method)->argv != NULL,
+                "expected push to be rebound");
+
+    fail_unless (chimp_object_getmethod (
+                    a, CHIMP_STR_NEW ("nope"), &scratch) == NULL,
+                "expected no such method");
+}
+END_TEST
@@ -0,0 +1,88 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+void
+test_code_setup (void)
+{
+    fail_unless (chimp_core_startup (NULL, stack_base), "core_startup failed");
+}
+
+void
+test_code_teardown (void)
+{
+    chimp_core_shutdown ();
+}
+
+START_TEST(code_operands_are_wider_than_a_byte)
+{
+    size_t i;
+    ChimpRef *code = chimp_code_new ();
+    for (i = 0; i < 300; i++) {
+        fail_unless (chimp_code_pushconst (code, chimp_int_new (i)),
+                    "pushconst failed");
+    }
+    fail_unless (CHIMP_CODE_SIZE(code) == 300, "expected one word per instruction");
+    fail_unless (CHIMP_INSTR_OP(code, 299) == CHIMP_OPCODE_PUSHCONST,
+                "expected a PUSHCONST");
+    fail_unless (CHIMP_INSTR_OPERAND(code, 299) == 299, "expected operand 299");
+    fail_unless (CHIMP_INT(CHIMP_INSTR_CONST(code, 299))->value == 299,
+                "expected constant 299");
+}
+END_TEST
+
+START_TEST(code_extended_arg_prefix_supplies_high_bits)
+{
+    ChimpRef *code = chimp_code_new ();
+    CHIMP_CODE(code)->bytecode[0] = (CHIMP_OPCODE_EXTENDEDARG << 24) | 0x000001;
+    CHIMP_CODE(code)->bytecode[1] = (CHIMP_OPCODE_JUMP << 24) | 0x000002;
+    CHIMP_CODE(code)->used = 2;
+    fail_unless (CHIMP_INSTR_ADDR(code, 1) == 0x1000002,
+                "expected the prefix to supply bits 24-47");
+}
+END_TEST
+
+START_TEST(code_far_jump_gets_extended_arg_prefix)
+{
+    ChimpRef *code = chimp_code_new ();
+    ChimpLabel label = CHIMP_LABEL_INIT;
+    label.addr = 0x1234567;
+    label.in_use = CHIMP_TRUE;
+    fail_unless (chimp_code_jump (code, &label), "jump failed");
+    fail_unless (CHIMP_CODE_SIZE(code) == 2, "expected a prefix & a jump");
+    fail_unless (CHIMP_INSTR_OP(code, 0) == CHIMP_OPCODE_EXTENDEDARG,
+                "expected an EXTENDEDARG prefix");
+    fail_unless (CHIMP_INSTR_ADDR(code, 1) == 0x1234567,
+                "expected the full jump address");
+}
+END_TEST
+
+START_TEST(code_regop_packs_three_operands)
+{
+    ChimpRef *code = chimp_code_new ();
+    fail_unless (chimp_code_regop (code, CHIMP_OPCODE_ADDR,
+                    3, CHIMP_REG_CONST + 1, CHIMP_REG_STACK), "regop failed");
+    fail_unless (CHIMP_CODE_SIZE(code) == 1, "expected a single instruction");
+    fail_unless (CHIMP_INSTR_OP(code, 0) == CHIMP_OPCODE_ADDR,
+                "expected an ADDR");
+    fail_unless (CHIMP_INSTR_REG_DST(code, 0) == 3, "expected dst slot 3");
+    fail_unless (CHIMP_INSTR_REG_LEFT(code, 0) == CHIMP_REG_CONST + 1,
+                "expected constant #1 on the left");
+    fail_unless (CHIMP_INSTR_REG_RIGHT(code, 0) == CHIMP_REG_STACK,
+                "expected the stack on the right");
+}
+END_TEST
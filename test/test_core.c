@@ -25,3 +25,70 @@ START_TEST (test_startup_shutdown)
 }
 END_TEST
 
+
+static void
+write_module (const char *dir, const char *name, const char *source)
+{
+    char filename[256];
+    FILE *file;
+
+    snprintf (filename, sizeof(filename), "%s/%s.chimp", dir, name);
+    file = fopen (filename, "w");
+    fail_unless (file != NULL, "couldn't write %s", filename);
+    fputs (source, file);
+    fclose (file);
+}
+
+static void
+remove_module (const char *dir, const char *name)
+{
+    char filename[256];
+
+    snprintf (filename, sizeof(filename), "%s/%s.chimp", dir, name);
+    remove (filename);
+}
+
+START_TEST (test_use_compiles_shared_modules_once)
+{
+    int stack;
+    char dir[] = "/tmp/chimp-test-XXXXXX";
+    char filename[256];
+    ChimpRef *mod;
+    ChimpRef *a;
+    ChimpRef *b;
+    ChimpRef *a_shared;
+    ChimpRef *b_shared;
+
+    fail_unless (mkdtemp (dir) != NULL, "mkdtemp failed");
+    write_module (dir, "shared", "answer {\n  ret 42\n}\n");
+    write_module (dir, "a", "use shared\n");
+    write_module (dir, "b", "use shared\n");
+    write_module (dir, "main", "use a\nuse b\n");
+
+    /* a & b don't depend on each other: build them side by side */
+    setenv ("CHIMP_COMPILE_WORKERS", "2", 1);
+    fail_unless (chimp_core_startup (dir, (void *)&stack), "expected startup to succeed");
+
+    snprintf (filename, sizeof(filename), "%s/main.chimp", dir);
+    mod = chimp_compile_file (NULL, filename);
+    fail_unless (mod != NULL, "expected main to compile");
+    fail_unless (chimp_hash_get (CHIMP_MODULE_LOCALS(mod), CHIMP_STR_NEW ("a"), &a) == 0,
+                "expected main to use a");
+    fail_unless (chimp_hash_get (CHIMP_MODULE_LOCALS(mod), CHIMP_STR_NEW ("b"), &b) == 0,
+                "expected main to use b");
+    fail_unless (chimp_hash_get (CHIMP_MODULE_LOCALS(a), CHIMP_STR_NEW ("shared"), &a_shared) == 0,
+                "expected a to use shared");
+    fail_unless (chimp_hash_get (CHIMP_MODULE_LOCALS(b), CHIMP_STR_NEW ("shared"), &b_shared) == 0,
+                "expected b to use shared");
+    fail_unless (a_shared == b_shared, "expected a & b to see the same shared module");
+
+    chimp_core_shutdown ();
+    unsetenv ("CHIMP_COMPILE_WORKERS");
+
+    remove_module (dir, "shared");
+    remove_module (dir, "a");
+    remove_module (dir, "b");
+    remove_module (dir, "main");
+    remove (dir);
+}
+END_TEST
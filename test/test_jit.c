@@ -0,0 +1,80 @@
+/*****************************************************************************
+ *                                                                           *
+ * Copyright 2012 Thomas Lee                                                 *
+ *                                                                           *
+ * Licensed under the Apache License, Version 2.0 (the "License");           *
+ * you may not use this file except in compliance with the License.          *
+ * You may obtain a copy of the License at                                   *
+ *                                                                           *
+ *     http://www.apache.org/licenses/LICENSE-2.0                            *
+ *                                                                           *
+ * Unless required by applicable law or agreed to in writing, software       *
+ * distributed under the License is distributed on an "AS IS" BASIS,         *
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  *
+ * See the License for the specific language governing permissions and       *
+ * limitations under the License.                                            *
+ *                                                                           *
+ *****************************************************************************/
+
+
+void
+test_jit_setup (void)
+{
+    fail_unless (chimp_core_startup (NULL, stack_base), "core_startup failed");
+}
+
+void
+test_jit_teardown (void)
+{
+    chimp_core_shutdown ();
+}
+
+/* x = 0; while x < 10 { x = x + 1 }; ret x */
+static ChimpRef *
+test_jit_counting_loop (void)
+{
+    ChimpRef *code = chimp_code_new ();
+    ChimpLabel start = CHIMP_LABEL_INIT;
+    ChimpLabel end = CHIMP_LABEL_INIT;
+    int x, zero, one, ten;
+
+    chimp_array_push (CHIMP_CODE(code)->vars, CHIMP_STR_NEW("x"));
+    x = chimp_code_reg_for_var (code, CHIMP_STR_NEW("x"));
+    zero = chimp_code_reg_for_const (code, chimp_int_new (0));
+    one = chimp_code_reg_for_const (code, chimp_int_new (1));
+    ten = chimp_code_reg_for_const (code, chimp_int_new (10));
+
+    fail_unless (chimp_code_move (code, x, zero), "move failed");
+    chimp_code_use_label (code, &start);
+    fail_unless (chimp_code_regop (code, CHIMP_OPCODE_CMPLTR,
+                    CHIMP_REG_STACK, x, ten), "regop failed");
+    fail_unless (chimp_code_jumpiffalse (code, &end), "jumpiffalse failed");
+    fail_unless (chimp_code_regop (code, CHIMP_OPCODE_ADDR,
+                    x, x, one), "regop failed");
+    fail_unless (chimp_code_jump (code, &start), "jump failed");
+    chimp_code_use_label (code, &end);
+    fail_unless (chimp_code_move (code, CHIMP_REG_STACK, x), "move failed");
+    fail_unless (chimp_code_ret (code), "ret failed");
+    return code;
+}
+
+START_TEST(jit_compiled_code_matches_the_interpreter)
+{
+#ifdef CHIMP_HAVE_JIT
+    ChimpRef *code = test_jit_counting_loop ();
+    ChimpRef *method = chimp_method_new_bytecode (NULL, code);
+    ChimpRef *result;
+
+    result = chimp_vm_invoke (NULL, method, chimp_array_new ());
+    fail_unless (result != NULL, "interpreter failed");
+    fail_unless (CHIMP_INT(result)->value == 10, "interpreter returned the wrong value");
+
+    fail_unless (chimp_jit_compile (code), "JIT failed");
+    fail_unless (CHIMP_CODE_JIT(code) != NULL, "expected native code");
+
+    result = chimp_vm_invoke (NULL, method, chimp_array_new ());
+    fail_unless (result != NULL, "native code failed");
+    fail_unless (CHIMP_INT(result)->value == 10, "native code returned the wrong value");
+#endif
+}
+END_TEST